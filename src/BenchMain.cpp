@@ -0,0 +1,930 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "EmulatorConfig.h"
+#include "ConfigManager.h"
+#include "Machine.h"
+#include "MemoryController.h"
+#include "MemoryDev.h"
+#include "Logger.h"
+#include "Utils.h"
+
+/**
+ * Runs fixed workloads headless with each CPU core, and reports how fast they ran (emulated MHz,
+ * host ns per instruction, instructions per second) as JSON.  Every workload is run once with the
+ * execution counters on to count its instructions (the workloads are deterministic), and then
+ * timed bench.system.repeats times on a fresh machine.  The best and median times are reported.
+ */
+
+const std::string BENCH_TYPE = "bench";
+const std::string REPEATS_NAME = "repeats";
+const std::string BENCHCORE_NAME = "core";
+const std::string WORKLOADS_NAME = "workloads";
+const std::string OUTPUT_NAME = "output";
+const std::string SYNTHCYCLES_NAME = "syntheticCycles";
+const std::string FUNCTIONAL_NAME = "functionalImage";
+const std::string FUNCTIONALPASS_NAME = "functionalSuccess";
+const std::string EHBASICDIR_NAME = "ehbasicDir";
+const std::string NESTEST_NAME = "nestestRom";
+const std::string NESTESTRUNS_NAME = "nestestRuns";
+
+#define DEFAULT_REPEATS 5
+
+/// Cycles each addressing mode microbenchmark runs for
+#define DEFAULT_SYNTHETIC_CYCLES 20000000
+
+/// Where Klaus Dormann's 6502_functional_test.bin (default build) traps when every test passed
+#define DEFAULT_FUNCTIONAL_SUCCESS 0x3469
+
+#define FUNCTIONAL_START 0x0400
+
+/// The functional test takes about 100M cycles, give up if it hasn't finished well after that
+#define FUNCTIONAL_MAX_CYCLES 400000000
+
+/// The functional test is run in chunks this big, checking for a trap (JMP *) after each
+#define FUNCTIONAL_CHUNK_CYCLES 100000
+
+/// nestest's automation mode starts here, and is done when it gets to the RTS at NESTEST_END
+#define NESTEST_START 0xc000
+#define NESTEST_END   0xc66e
+
+/// nestest is short, so the timed run goes through it this many times
+#define DEFAULT_NESTEST_RUNS 50
+
+#define NESTEST_MAX_CYCLES 1000000
+
+#define EHBASIC_MAX_CYCLES 2000000000
+
+/// What the EhBASIC workload's program prints
+#define EHBASIC_RESULT " 2.38663E+07FGHIJKLMNOPQRSTUVWXY"
+
+/// Synthetic programs are loaded here, after the zero page / stack / data pages
+#define SYNTHETIC_START 0x0400
+
+/// Copies of the addressing mode's instructions in each pass of the microbenchmark loop
+#define SYNTHETIC_UNROLL 16
+
+/// Defaults are relative to the top of the source tree
+#ifndef BENCH_DATA_DIR
+   #define BENCH_DATA_DIR ".."
+#endif
+
+/**
+ * Stands in for the network UART EhBASIC talks to (write a character to offset 1, read one from
+ * offset 4, 0 when nothing was typed).  The input is a script, and the device keeps track of when
+ * BASIC is done running it.
+ */
+class ScriptedUart : public MemoryDev
+{
+public:
+   ScriptedUart(CpuAddress address, std::string const & script):
+      MemoryDev("Scripted UART"),
+      theScript(script),
+      theScriptPos(0)
+   {
+      theAddress = address;
+      theSize = 0x10;
+   }
+
+   virtual uint8_t read8(CpuAddress absAddr) override
+   {
+      if ( (absAddr - theAddress != 4) || (theScriptPos >= theScript.size()) )
+      {
+         return 0;
+      }
+
+      theOutputSinceInput.clear();
+      return theScript[theScriptPos++];
+   }
+
+   virtual bool write8(CpuAddress absAddr, uint8_t val) override
+   {
+      if (absAddr - theAddress == 1)
+      {
+         theOutputSinceInput += (char) val;
+      }
+
+      return true;
+   }
+
+   virtual uint16_t read16(CpuAddress absAddr) override
+   {
+      return read8(absAddr) | (read8(absAddr + 1) << 8);
+   }
+
+   virtual bool write16(CpuAddress absAddr, uint16_t val) override
+   {
+      write8(absAddr, val & 0xff);
+      return write8(absAddr + 1, val >> 8);
+   }
+
+   virtual std::string getConfigTypeName() const override
+   {
+      return "ScriptedUART";
+   }
+
+   virtual void resetMemory() override
+   {
+      theScriptPos = 0;
+      theOutputSinceInput.clear();
+   }
+
+   /// True once the whole script was typed in and BASIC said it was ready for more
+   bool isDone() const
+   {
+      return (theScriptPos >= theScript.size()) &&
+             (theOutputSinceInput.find("Ready") != std::string::npos);
+   }
+
+   /// What BASIC printed after the last character of input
+   std::string const & getLastOutput() const
+   {
+      return theOutputSinceInput;
+   }
+
+protected:
+
+   std::string theScript;
+
+   size_t theScriptPos;
+
+   std::string theOutputSinceInput;
+};
+
+/**
+ * A machine setup and a way to run it to the end.  The machine is created from the settings
+ * configure adds, then prepare sets up anything a config can't (programs written to RAM, extra
+ * devices).  run returns false with a reason if the workload didn't end the way it should.
+ */
+class BenchWorkload
+{
+public:
+   virtual ~BenchWorkload() {}
+
+   virtual std::string getName() const = 0;
+
+   /// Empty if the workload can run, otherwise why it is skipped (a file it needs is missing)
+   virtual std::string checkAvailable() const
+   {
+      return "";
+   }
+
+   virtual void configure(ConfigManager* cfg) = 0;
+
+   virtual void prepare(Machine* machine)
+   {
+   }
+
+   virtual bool run(Machine* machine, std::string* failReason) = 0;
+};
+
+/// Checks a file can be opened, for checkAvailable
+static std::string checkFile(std::string const & filename)
+{
+   std::ifstream f(filename.c_str());
+   return (f.is_open() ? "" : filename + " not found");
+}
+
+/// Writes a file into the machine's memory at address
+static bool loadImage(Machine* machine, std::string const & filename, CpuAddress address)
+{
+   std::ifstream f(filename.c_str(), std::ios::binary);
+   if (!f.is_open())
+   {
+      LOG_WARNING() << "Couldn't open" << filename;
+      return false;
+   }
+
+   std::vector<char> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+   MemoryController* mc = machine->getMemoryController();
+   for(size_t i = 0; (i < data.size()) && (address + i <= 0xffff); i++)
+   {
+      mc->getDevice(address + i)->write8(address + i, data[i]);
+   }
+
+   return true;
+}
+
+/// 64 KB of RAM, in two devices because a device's size is 16 bits
+static void configureAllRam(ConfigManager* cfg)
+{
+   cfg->addConfig("RAM.low.startAddress=0");
+   cfg->addConfig("RAM.low.size=0x8000");
+   cfg->addConfig("RAM.high.startAddress=0x8000");
+   cfg->addConfig("RAM.high.size=0x8000");
+}
+
+/**
+ * Klaus Dormann's 6502 functional test (a 64 KB image started at 0x400).  Every test ends in a
+ * JMP to itself, the success one is at a known address.
+ */
+class FunctionalTestWorkload : public BenchWorkload
+{
+public:
+   FunctionalTestWorkload(std::string const & image, CpuAddress successAddr):
+      theImage(image),
+      theSuccessAddr(successAddr)
+   {
+   }
+
+   virtual std::string getName() const override
+   {
+      return "functional";
+   }
+
+   virtual std::string checkAvailable() const override
+   {
+      return checkFile(theImage);
+   }
+
+   virtual void configure(ConfigManager* cfg) override
+   {
+      configureAllRam(cfg);
+      cfg->addConfig(EMULATOR_TYPE + ".system." + EMUSTART_NAME + "=" + std::to_string(FUNCTIONAL_START));
+   }
+
+   virtual void prepare(Machine* machine) override
+   {
+      loadImage(machine, theImage, 0);
+   }
+
+   virtual bool run(Machine* machine, std::string* failReason) override
+   {
+      Cpu6502* cpu = machine->getCpu();
+      MemoryController* mc = machine->getMemoryController();
+
+      while(cpu->getNumClocks() < FUNCTIONAL_MAX_CYCLES)
+      {
+         CpuStopReason reason = cpu->runCycles(FUNCTIONAL_CHUNK_CYCLES);
+
+         CpuAddress pc = cpu->getPc();
+         if (pc == theSuccessAddr)
+         {
+            return true;
+         }
+
+         if (reason != STOP_BUDGET)
+         {
+            *failReason = std::string("stopped (") + Machine::getStopReasonName(reason) + ") at " +
+                          addressToString(pc);
+            return false;
+         }
+
+         // A JMP to itself anywhere else is a test that failed
+         if ( (mc->getDevice(pc)->read8(pc) == 0x4c) &&
+              (mc->getDevice(pc + 1)->read8(pc + 1) == (pc & 0xff)) &&
+              (mc->getDevice(pc + 2)->read8(pc + 2) == (pc >> 8)) )
+         {
+            *failReason = "trapped at " + addressToString(pc);
+            return false;
+         }
+      }
+
+      *failReason = "didn't finish in " + std::to_string(FUNCTIONAL_MAX_CYCLES) + " cycles";
+      return false;
+   }
+
+protected:
+
+   std::string theImage;
+
+   CpuAddress theSuccessAddr;
+};
+
+/**
+ * EhBASIC with a program typed in through the UART.  Done when BASIC prints Ready after running
+ * it.
+ */
+class EhBasicWorkload : public BenchWorkload
+{
+public:
+   EhBasicWorkload(std::string const & romDir):
+      theRomDir(romDir),
+      theUart(nullptr)
+   {
+   }
+
+   virtual std::string getName() const override
+   {
+      return "ehbasic";
+   }
+
+   virtual std::string checkAvailable() const override
+   {
+      return checkFile(theRomDir + "/ehbasic_top_c000.bin");
+   }
+
+   virtual void configure(ConfigManager* cfg) override
+   {
+      cfg->addConfig("RAM.main.startAddress=0");
+      cfg->addConfig("RAM.main.size=0xc000");
+      cfg->addConfig("ROM.top.startAddress=0xc000");
+      cfg->addConfig("ROM.top.filename=" + theRomDir + "/ehbasic_top_c000.bin");
+      cfg->addConfig("ROM.irq.startAddress=0xff80");
+      cfg->addConfig("ROM.irq.filename=" + theRomDir + "/ehbasic_bottom_ff80.bin");
+
+      // The reset code at $FF80 sets up the I/O vectors and asks for a cold / warm start
+      cfg->addConfig(EMULATOR_TYPE + ".system." + EMUSTART_NAME + "=0xff80");
+   }
+
+   virtual void prepare(Machine* machine) override
+   {
+      // Cold start, default memory size, then a program with loops, floating point and strings
+      std::string script = "C\r\r"
+                           "10 S=0:T$=\"\"\r"
+                           "20 FOR I=1 TO 2000\r"
+                           "30 S=S+SQR(I)*I/3\r"
+                           "40 T$=RIGHT$(T$+CHR$(65+I-INT(I/26)*26),20)\r"
+                           "50 NEXT I\r"
+                           "60 PRINT INT(S);T$\r"
+                           "RUN\r";
+
+      // The memory controller deletes its devices
+      theUart = new ScriptedUart(0xf000, script);
+      machine->getMemoryController()->addNewDevice(theUart);
+   }
+
+   virtual bool run(Machine* machine, std::string* failReason) override
+   {
+      Cpu6502* cpu = machine->getCpu();
+
+      while(!theUart->isDone())
+      {
+         CpuStopReason reason = cpu->runCycles(FUNCTIONAL_CHUNK_CYCLES);
+         if (reason != STOP_BUDGET)
+         {
+            *failReason = std::string("stopped (") + Machine::getStopReasonName(reason) + ") at " +
+                          addressToString(cpu->getPc());
+            return false;
+         }
+
+         if (cpu->getNumClocks() > EHBASIC_MAX_CYCLES)
+         {
+            *failReason = "didn't finish the script, last output: " + theUart->getLastOutput();
+            return false;
+         }
+      }
+
+      if (theUart->getLastOutput().find(EHBASIC_RESULT) == std::string::npos)
+      {
+         *failReason = "wrong result: " + theUart->getLastOutput();
+         return false;
+      }
+
+      return true;
+   }
+
+protected:
+
+   std::string theRomDir;
+
+   ScriptedUart* theUart;
+};
+
+/**
+ * nestest in automation mode (started at $C000 instead of the reset vector, no PPU needed).  It
+ * has no trap at the end, so it is run up to its last instruction with runUntil, which uses the
+ * traced instantiation of the core to check the stop address (that is what this measures).
+ */
+class NestestWorkload : public BenchWorkload
+{
+public:
+   NestestWorkload(std::string const & rom, int numRuns):
+      theRom(rom),
+      theNumRuns(numRuns)
+   {
+   }
+
+   virtual std::string getName() const override
+   {
+      return "nestest";
+   }
+
+   virtual std::string checkAvailable() const override
+   {
+      return checkFile(theRom);
+   }
+
+   virtual void configure(ConfigManager* cfg) override
+   {
+      cfg->addConfig("RAM.main.startAddress=0");
+      cfg->addConfig("RAM.main.size=0x800");
+      cfg->addConfig("MirrorMemory.mirror.sourceAddress=0");
+      cfg->addConfig("MirrorMemory.mirror.sourceSize=0x800");
+      cfg->addConfig("MirrorMemory.mirror.destAddress=0x800");
+      cfg->addConfig("MirrorMemory.mirror.destSize=0x1800");
+
+      // Stands in for the PPU / APU registers, so a stray access doesn't halt the machine
+      cfg->addConfig("RAM.io.startAddress=0x2000");
+      cfg->addConfig("RAM.io.size=0x2020");
+
+      cfg->addConfig("iNES.nestest.filename=" + theRom);
+      cfg->addConfig(EMULATOR_TYPE + ".system." + EMUSTART_NAME + "=" + std::to_string(NESTEST_START));
+   }
+
+   virtual bool run(Machine* machine, std::string* failReason) override
+   {
+      Cpu6502* cpu = machine->getCpu();
+      MemoryController* mc = machine->getMemoryController();
+
+      for(int i = 0; i < theNumRuns; i++)
+      {
+         cpu->setAddress(NESTEST_START);
+
+         CpuStopReason reason = cpu->runUntil(NESTEST_END, NESTEST_MAX_CYCLES);
+         if (reason != STOP_BREAKPOINT)
+         {
+            *failReason = std::string("stopped (") + Machine::getStopReasonName(reason) + ") at " +
+                          addressToString(cpu->getPc());
+            return false;
+         }
+      }
+
+      // nestest leaves the number of the first official / unofficial test that failed here
+      uint8_t officialResult = mc->getDevice(0x02)->read8(0x02);
+      uint8_t unofficialResult = mc->getDevice(0x03)->read8(0x03);
+      if ( (officialResult != 0) || (unofficialResult != 0) )
+      {
+         *failReason = "tests failed, $02=" + Utils::toHex8(officialResult) + " $03=" +
+                       Utils::toHex8(unofficialResult);
+         return false;
+      }
+
+      return true;
+   }
+
+protected:
+
+   std::string theRom;
+
+   int theNumRuns;
+};
+
+/**
+ * A loop of the same few instructions over and over, to see what an addressing mode (or branch,
+ * stack, JSR / RTS) costs in each core.  Runs for a fixed number of cycles.
+ */
+class SyntheticWorkload : public BenchWorkload
+{
+public:
+   /**
+    * @param name Workload name
+    * @param body Instructions repeated in the loop, they must not change X or Y (they index)
+    * @param cycles Cycles to run for
+    */
+   SyntheticWorkload(std::string const & name, std::vector<uint8_t> const & body, uint64_t cycles):
+      theName(name),
+      theBody(body),
+      theCycles(cycles)
+   {
+   }
+
+   virtual std::string getName() const override
+   {
+      return theName;
+   }
+
+   virtual void configure(ConfigManager* cfg) override
+   {
+      configureAllRam(cfg);
+      cfg->addConfig(EMULATOR_TYPE + ".system." + EMUSTART_NAME + "=" + std::to_string(SYNTHETIC_START));
+   }
+
+   virtual void prepare(Machine* machine) override
+   {
+      std::vector<uint8_t> program = {
+         0xa2, 0x01,         // LDX #$01
+         0xa0, 0x01,         // LDY #$01
+         0xa9, 0x00,         // LDA #$00   pointers at $20 / $22 to $0300 for the indirect modes
+         0x85, 0x20,         // STA $20
+         0x85, 0x22,         // STA $22
+         0xa9, 0x03,         // LDA #$03
+         0x85, 0x21,         // STA $21
+         0x85, 0x23,         // STA $23
+      };
+
+      CpuAddress loopAddr = SYNTHETIC_START + program.size();
+      for(int i = 0; i < SYNTHETIC_UNROLL; i++)
+      {
+         program.insert(program.end(), theBody.begin(), theBody.end());
+      }
+
+      program.push_back(0x4c);                  // JMP loop
+      program.push_back(loopAddr & 0xff);
+      program.push_back(loopAddr >> 8);
+
+      MemoryController* mc = machine->getMemoryController();
+      for(size_t i = 0; i < program.size(); i++)
+      {
+         mc->getDevice(SYNTHETIC_START + i)->write8(SYNTHETIC_START + i, program[i]);
+      }
+
+      // The JSR microbenchmark calls an RTS at $0380
+      mc->getDevice(0x0380)->write8(0x0380, 0x60);
+   }
+
+   virtual bool run(Machine* machine, std::string* failReason) override
+   {
+      CpuStopReason reason = machine->getCpu()->runCycles(theCycles);
+      if (reason != STOP_BUDGET)
+      {
+         *failReason = std::string("stopped (") + Machine::getStopReasonName(reason) + ") at " +
+                       addressToString(machine->getCpu()->getPc());
+         return false;
+      }
+
+      return true;
+   }
+
+protected:
+
+   std::string theName;
+
+   std::vector<uint8_t> theBody;
+
+   uint64_t theCycles;
+};
+
+/// Results of one workload on one core
+typedef struct BenchResultStruct
+{
+   std::string theWorkload;
+   std::string theCore;
+
+   /// ok, failed or skipped
+   std::string theStatus;
+   std::string theReason;
+
+   uint64_t theCycles;
+   uint64_t theInstructions;
+
+   /// Wall time of each timed run
+   std::vector<double> theTimesMs;
+} BenchResult;
+
+void printUsage(char* appName)
+{
+   std::cout << appName << " benchmarks the CPU cores on fixed workloads" << std::endl;
+   std::cout << std::endl;
+   std::cout << "  " << appName << " [settings]" << std::endl;
+   std::cout << std::endl;
+   std::cout << "  " << BENCH_TYPE << ".system." << REPEATS_NAME << "=5   (timed runs of each workload, default "
+             << DEFAULT_REPEATS << ")" << std::endl;
+   std::cout << "  " << BENCH_TYPE << ".system." << BENCHCORE_NAME << "=switch   (handler, switch or block, default all of them)"
+             << std::endl;
+   std::cout << "  " << BENCH_TYPE << ".system." << WORKLOADS_NAME << "=ehbasic,zeroPage   (default all of them)"
+             << std::endl;
+   std::cout << "  " << BENCH_TYPE << ".system." << OUTPUT_NAME << "=bench.json   (default bench.json)" << std::endl;
+   std::cout << "  " << BENCH_TYPE << ".system." << SYNTHCYCLES_NAME << "=20000000   (cycles of each addressing mode microbenchmark)"
+             << std::endl;
+   std::cout << "  " << BENCH_TYPE << ".system." << FUNCTIONALPASS_NAME << "=0x3469   (address the functional test traps at when it passes)"
+             << std::endl;
+   std::cout << "  " << BENCH_TYPE << ".system." << FUNCTIONAL_NAME << "=6502_functional_test.bin   (default "
+             << BENCH_DATA_DIR << "/6502-tests/6502_functional_test.bin)" << std::endl;
+   std::cout << "  " << BENCH_TYPE << ".system." << EHBASICDIR_NAME << "=test/ehbasic   (default "
+             << BENCH_DATA_DIR << "/test/ehbasic)" << std::endl;
+   std::cout << "  " << BENCH_TYPE << ".system." << NESTEST_NAME << "=nestest.nes   (default "
+             << BENCH_DATA_DIR << "/test/kevtris_nestest/test_src_files/nestest.nes)" << std::endl;
+   std::cout << "  " << BENCH_TYPE << ".system." << NESTESTRUNS_NAME << "=50   (times nestest is run in each timed run)"
+             << std::endl;
+   std::cout << std::endl;
+   std::cout << "Workloads that need a file that isn't there are skipped." << std::endl;
+   std::cout << std::endl;
+}
+
+/// Creates the workload's machine on the core
+Machine* createMachine(BenchWorkload* workload, std::string const & core, ConfigManager* cfg)
+{
+   workload->configure(cfg);
+   cfg->addConfig(EMULATOR_TYPE + ".system." + CPUCORE_NAME + "=" + core);
+   cfg->addConfig(EMULATOR_TYPE + ".system." + UNTHROTTLED_NAME + "=1");
+
+   Machine* machine = new Machine(cfg);
+   machine->makeQuiet();
+   workload->prepare(machine);
+   return machine;
+}
+
+void benchWorkload(BenchWorkload* workload, std::string const & core, int repeats, BenchResult* result)
+{
+   result->theWorkload = workload->getName();
+   result->theCore = core;
+   result->theCycles = 0;
+   result->theInstructions = 0;
+
+   result->theReason = workload->checkAvailable();
+   if (!result->theReason.empty())
+   {
+      result->theStatus = "skipped";
+      return;
+   }
+
+   // Counting run, the workloads run the same every time
+   {
+      ConfigManager cfg;
+      Machine* machine = createMachine(workload, core, &cfg);
+      machine->getCpu()->getExecutionCounters()->setEnabled(true);
+
+      bool success = workload->run(machine, &result->theReason);
+
+      result->theCycles = machine->getCpu()->getNumClocks();
+      result->theInstructions = machine->getCpu()->getExecutionCounters()->getTotalCount().theInstructions;
+      delete machine;
+
+      if (!success)
+      {
+         result->theStatus = "failed";
+         return;
+      }
+   }
+
+   for(int i = 0; i < repeats; i++)
+   {
+      ConfigManager cfg;
+      Machine* machine = createMachine(workload, core, &cfg);
+
+      std::string failReason;
+      std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+      bool success = workload->run(machine, &failReason);
+      std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+
+      uint64_t cycles = machine->getCpu()->getNumClocks();
+      delete machine;
+
+      if (!success || (cycles != result->theCycles))
+      {
+         result->theStatus = "failed";
+         result->theReason = (success ? "timed run took " + std::to_string(cycles) + " cycles" : failReason);
+         return;
+      }
+
+      result->theTimesMs.push_back(std::chrono::duration<double, std::milli>(endTime - startTime).count());
+   }
+
+   result->theStatus = "ok";
+}
+
+/// Escapes a string for JSON (the reasons can have BASIC's output in them)
+std::string jsonString(std::string const & text)
+{
+   std::ostringstream oss;
+   oss << "\"";
+   for(char c: text)
+   {
+      if ( (c == '"') || (c == '\\') )
+      {
+         oss << '\\' << c;
+      }
+      else if ( (unsigned char) c < 0x20)
+      {
+         char buf[8];
+         snprintf(buf, sizeof(buf), "\\u%04x", c);
+         oss << buf;
+      }
+      else
+      {
+         oss << c;
+      }
+   }
+
+   oss << "\"";
+   return oss.str();
+}
+
+/// Middle of the sorted times (average of the middle two for an even number of them)
+double medianOf(std::vector<double> const & sorted)
+{
+   size_t middle = sorted.size() / 2;
+   return (sorted.size() % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2.0);
+}
+
+/// Speeds for a wall time, as JSON members (without the braces)
+void speedsToJson(std::ostringstream& json, std::string const & prefix, BenchResult const & r, double ms)
+{
+   double seconds = ms / 1000.0;
+   json << ", \"" << prefix << "Ms\": " << ms
+        << ", \"" << prefix << "EmulatedMhz\": " << (r.theCycles / seconds / 1000000.0)
+        << ", \"" << prefix << "NsPerInstruction\": " << (ms * 1000000.0 / r.theInstructions)
+        << ", \"" << prefix << "InstructionsPerSecond\": " << (uint64_t) (r.theInstructions / seconds);
+}
+
+std::string resultsToJson(std::vector<BenchResult> const & results, int repeats)
+{
+   std::ostringstream json;
+   json << "{\n  \"repeats\": " << repeats << ",\n  \"results\": [";
+
+   for(size_t i = 0; i < results.size(); i++)
+   {
+      BenchResult const & r = results[i];
+      json << (i == 0 ? "\n" : ",\n")
+           << "    { \"workload\": " << jsonString(r.theWorkload)
+           << ", \"core\": " << jsonString(r.theCore)
+           << ", \"status\": " << jsonString(r.theStatus);
+
+      if (!r.theReason.empty())
+      {
+         json << ", \"reason\": " << jsonString(r.theReason);
+      }
+
+      if (r.theStatus == "ok")
+      {
+         std::vector<double> sorted = r.theTimesMs;
+         std::sort(sorted.begin(), sorted.end());
+
+         json << ", \"cycles\": " << r.theCycles << ", \"instructions\": " << r.theInstructions
+              << ", \"timesMs\": [";
+         for(size_t t = 0; t < r.theTimesMs.size(); t++)
+         {
+            json << (t == 0 ? "" : ", ") << r.theTimesMs[t];
+         }
+         json << "]";
+
+         speedsToJson(json, "min", r, sorted.front());
+         speedsToJson(json, "median", r, medianOf(sorted));
+      }
+
+      json << " }";
+   }
+
+   json << "\n  ]\n}\n";
+   return json.str();
+}
+
+int main(int argc, char* argv[])
+{
+   ConfigManager* configMgr = ConfigManager::createInstance();
+   for(int i = 1; i < argc; i++)
+   {
+      std::string arg = argv[i];
+      if ( (arg == "-h") || (arg == "--help") || (arg.find('=') == std::string::npos) )
+      {
+         printUsage(argv[0]);
+         return 0;
+      }
+
+      configMgr->addConfig(arg);
+   }
+
+   int repeats = DEFAULT_REPEATS;
+   if (configMgr->isConfigPresent(BENCH_TYPE, REPEATS_NAME))
+   {
+      repeats = std::max(1, (int) configMgr->getIntegerConfigValue(BENCH_TYPE, REPEATS_NAME));
+   }
+
+   std::vector<std::string> cores = { "handler", "switch", "block" };
+   if (configMgr->isConfigPresent(BENCH_TYPE, BENCHCORE_NAME))
+   {
+      cores = { configMgr->getStringConfigValue(BENCH_TYPE, BENCHCORE_NAME) };
+   }
+
+   std::string outputFilename = "bench.json";
+   if (configMgr->isConfigPresent(BENCH_TYPE, OUTPUT_NAME))
+   {
+      outputFilename = configMgr->getStringConfigValue(BENCH_TYPE, OUTPUT_NAME);
+   }
+
+   uint64_t syntheticCycles = DEFAULT_SYNTHETIC_CYCLES;
+   if (configMgr->isConfigPresent(BENCH_TYPE, SYNTHCYCLES_NAME))
+   {
+      syntheticCycles = configMgr->getIntegerConfigValue(BENCH_TYPE, SYNTHCYCLES_NAME);
+   }
+
+   std::string dataDir = BENCH_DATA_DIR;
+
+   std::string functionalImage = dataDir + "/6502-tests/6502_functional_test.bin";
+   if (configMgr->isConfigPresent(BENCH_TYPE, FUNCTIONAL_NAME))
+   {
+      functionalImage = configMgr->getStringConfigValue(BENCH_TYPE, FUNCTIONAL_NAME);
+   }
+
+   CpuAddress functionalSuccess = DEFAULT_FUNCTIONAL_SUCCESS;
+   if (configMgr->isConfigPresent(BENCH_TYPE, FUNCTIONALPASS_NAME))
+   {
+      functionalSuccess = configMgr->getIntegerConfigValue(BENCH_TYPE, FUNCTIONALPASS_NAME);
+   }
+
+   std::string ehbasicDir = dataDir + "/test/ehbasic";
+   if (configMgr->isConfigPresent(BENCH_TYPE, EHBASICDIR_NAME))
+   {
+      ehbasicDir = configMgr->getStringConfigValue(BENCH_TYPE, EHBASICDIR_NAME);
+   }
+
+   std::string nestestRom = dataDir + "/test/kevtris_nestest/test_src_files/nestest.nes";
+   if (configMgr->isConfigPresent(BENCH_TYPE, NESTEST_NAME))
+   {
+      nestestRom = configMgr->getStringConfigValue(BENCH_TYPE, NESTEST_NAME);
+   }
+
+   int nestestRuns = DEFAULT_NESTEST_RUNS;
+   if (configMgr->isConfigPresent(BENCH_TYPE, NESTESTRUNS_NAME))
+   {
+      nestestRuns = configMgr->getIntegerConfigValue(BENCH_TYPE, NESTESTRUNS_NAME);
+   }
+
+   std::vector<BenchWorkload*> workloads;
+   workloads.push_back(new FunctionalTestWorkload(functionalImage, functionalSuccess));
+   workloads.push_back(new EhBasicWorkload(ehbasicDir));
+   workloads.push_back(new NestestWorkload(nestestRom, nestestRuns));
+
+   // Zero page $10-$13, data at $0300 (the page crossing ones cross into $0400, the program)
+   workloads.push_back(new SyntheticWorkload("implied",
+         { 0xe8, 0xca, 0xc8, 0x88, 0xaa, 0x8a, 0xea, 0x18 }, syntheticCycles));          // INX DEX INY DEY TAX TXA NOP CLC
+   workloads.push_back(new SyntheticWorkload("immediate",
+         { 0xa9, 0x12, 0x69, 0x01, 0x29, 0x7f, 0xc9, 0x10 }, syntheticCycles));          // LDA # ADC # AND # CMP #
+   workloads.push_back(new SyntheticWorkload("zeroPage",
+         { 0xa5, 0x10, 0x65, 0x11, 0x85, 0x12, 0xe6, 0x13 }, syntheticCycles));          // LDA ADC STA INC zp
+   workloads.push_back(new SyntheticWorkload("zeroPageX",
+         { 0xb5, 0x10, 0x75, 0x11, 0x95, 0x12, 0xf6, 0x13 }, syntheticCycles));          // LDA ADC STA INC zp,X
+   workloads.push_back(new SyntheticWorkload("absolute",
+         { 0xad, 0x00, 0x03, 0x6d, 0x01, 0x03, 0x8d, 0x02, 0x03, 0xee, 0x03, 0x03 }, syntheticCycles));
+   workloads.push_back(new SyntheticWorkload("absoluteX",
+         { 0xbd, 0x00, 0x03, 0x7d, 0x01, 0x03, 0x9d, 0x02, 0x03, 0xfe, 0x03, 0x03 }, syntheticCycles));
+   workloads.push_back(new SyntheticWorkload("absoluteXPageCross",
+         { 0xbd, 0xff, 0x02, 0x7d, 0xff, 0x02, 0xdd, 0xff, 0x02 }, syntheticCycles));    // LDA ADC CMP $02ff,X
+   workloads.push_back(new SyntheticWorkload("absoluteY",
+         { 0xb9, 0x00, 0x03, 0x79, 0x01, 0x03, 0x99, 0x02, 0x03 }, syntheticCycles));    // LDA ADC STA abs,Y
+   workloads.push_back(new SyntheticWorkload("indirectX",
+         { 0xa1, 0x1f, 0x61, 0x1f, 0x81, 0x21 }, syntheticCycles));                      // LDA ADC STA (zp,X)
+   workloads.push_back(new SyntheticWorkload("indirectY",
+         { 0xb1, 0x20, 0x71, 0x20, 0x91, 0x22 }, syntheticCycles));                      // LDA ADC STA (zp),Y
+   workloads.push_back(new SyntheticWorkload("branches",
+         { 0x18, 0x90, 0x00, 0xb0, 0x00, 0xd0, 0x00, 0xf0, 0x00 }, syntheticCycles));    // CLC BCC BCS BNE BEQ
+   workloads.push_back(new SyntheticWorkload("stack",
+         { 0x48, 0x08, 0x28, 0x68 }, syntheticCycles));                                  // PHA PHP PLP PLA
+   workloads.push_back(new SyntheticWorkload("jsrRts",
+         { 0x20, 0x80, 0x03 }, syntheticCycles));                                        // JSR $0380 (RTS)
+
+   std::vector<std::string> selected;
+   if (configMgr->isConfigPresent(BENCH_TYPE, WORKLOADS_NAME))
+   {
+      std::istringstream names(configMgr->getStringConfigValue(BENCH_TYPE, WORKLOADS_NAME));
+      std::string name;
+      while(std::getline(names, name, ','))
+      {
+         selected.push_back(name);
+      }
+   }
+
+   std::vector<BenchResult> results;
+   for(auto workload: workloads)
+   {
+      if (!selected.empty() && (std::find(selected.begin(), selected.end(), workload->getName()) == selected.end()))
+      {
+         continue;
+      }
+
+      for(auto const & core: cores)
+      {
+         BenchResult r;
+         benchWorkload(workload, core, repeats, &r);
+         results.push_back(r);
+      }
+   }
+
+   for(auto workload: workloads)
+   {
+      delete workload;
+   }
+
+   std::string json = resultsToJson(results, repeats);
+   std::ofstream outputFile(outputFilename.c_str());
+   outputFile << json;
+   if (!outputFile.good())
+   {
+      LOG_WARNING() << "Failed to write" << outputFilename;
+   }
+
+   printf("\n%-20s %-8s %-8s %12s %10s %10s %10s %10s\n", "workload", "core", "status", "instructions",
+          "min ms", "median ms", "MHz", "ns/instr");
+   for(auto const & r: results)
+   {
+      if (r.theStatus != "ok")
+      {
+         printf("%-20s %-8s %-8s %s\n", r.theWorkload.c_str(), r.theCore.c_str(), r.theStatus.c_str(),
+                r.theReason.c_str());
+         continue;
+      }
+
+      std::vector<double> sorted = r.theTimesMs;
+      std::sort(sorted.begin(), sorted.end());
+      double medianMs = medianOf(sorted);
+
+      printf("%-20s %-8s %-8s %12lu %10.2f %10.2f %10.1f %10.2f\n", r.theWorkload.c_str(), r.theCore.c_str(),
+             r.theStatus.c_str(), r.theInstructions, sorted.front(), medianMs,
+             r.theCycles / medianMs / 1000.0, medianMs * 1000000.0 / r.theInstructions);
+   }
+
+   printf("\nResults written to %s\n", outputFilename.c_str());
+
+   configMgr->destroyInstance();
+
+   return 0;
+}
@@ -0,0 +1,254 @@
+#include <string.h>
+
+#include "BlockCache.h"
+#include "Decoder6502.h"
+#include "EmulatorConfig.h"
+#include "Logger.h"
+
+#ifdef BLOCK_CACHE_TRACE
+   #define BCACHE_DEBUG    LOG_DEBUG
+   #define BCACHE_WARNING  LOG_WARNING
+#else
+   #define BCACHE_DEBUG    if(0) LOG_DEBUG
+   #define BCACHE_WARNING  if(0) LOG_WARNING
+#endif
+
+BlockCache::BlockCache(MemoryController* memCtrl):
+   theMemoryController(memCtrl),
+   theMemCtrlGeneration(0),
+   theHitCount(0),
+   theMissCount(0),
+   theInvalidationCount(0)
+{
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      thePageBlocks[i] = nullptr;
+      thePageGeneration[i] = 0;
+   }
+
+   syncPageTables();
+}
+
+BlockCache::~BlockCache()
+{
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      if (thePageBlocks[i] == nullptr)
+      {
+         continue;
+      }
+
+      for(int j = 0; j < 0x100; j++)
+      {
+         delete thePageBlocks[i][j];
+      }
+
+      delete[] thePageBlocks[i];
+   }
+}
+
+CachedBlock* BlockCache::getBlockSlow(CpuAddress addr)
+{
+   if (theMemCtrlGeneration != theMemoryController->getPageTableGeneration())
+   {
+      // The memory map changed, none of the blocks can be trusted
+      syncPageTables();
+   }
+
+   uint8_t* hostPage = theMemoryController->getHostReadPage(addr);
+   if (hostPage == nullptr)
+   {
+      return nullptr;
+   }
+
+   uint8_t page = addr >> 8;
+   if (thePageBlocks[page] == nullptr)
+   {
+      thePageBlocks[page] = new CachedBlock*[0x100];
+      memset(thePageBlocks[page], 0, sizeof(CachedBlock*) * 0x100);
+   }
+
+   CachedBlock* block = thePageBlocks[page][addr & 0xff];
+   if (block == nullptr)
+   {
+      block = new CachedBlock();
+      thePageBlocks[page][addr & 0xff] = block;
+      theMissCount++;
+   }
+   else if (isStale(block))
+   {
+      theInvalidationCount++;
+   }
+   else
+   {
+      theHitCount++;
+      return (block->theInstructions.empty() ? nullptr : block);
+   }
+
+   decodeBlock(addr, hostPage, block);
+
+   if (block->theInstructions.empty())
+   {
+      // The first instruction straddles the end of the page
+      return nullptr;
+   }
+
+   return block;
+}
+
+void BlockCache::decodeBlock(CpuAddress addr, uint8_t* hostPage, CachedBlock* block)
+{
+   block->theStartAddress = addr;
+   block->theGeneration = thePageGeneration[addr >> 8];
+   block->theInstructions.clear();
+
+   unsigned int offset = addr & 0xff;
+   while(block->theInstructions.size() < BLOCK_CACHE_MAX_INSTRUCTIONS)
+   {
+      OpCodeInfo* oci = &gOpCodes[hostPage[offset]];
+
+      if (offset + oci->theNumBytes > 0x100)
+      {
+         // Instruction continues on the next page, leave it for the regular decoder
+         break;
+      }
+
+      CachedInstruction ci;
+      ci.theOpCodeInfo = oci;
+      ci.theHandler = oci->theOpCodeHandler;
+      ci.theOpCode2 = (oci->theNumBytes >= 2 ? hostPage[offset + 1] : 0);
+      ci.theOpCode3 = (oci->theNumBytes >= 3 ? hostPage[offset + 2] : 0);
+      resolveOperand((addr & 0xff00) + offset, &ci);
+      block->theInstructions.push_back(ci);
+
+      offset += oci->theNumBytes;
+
+      if (endsBlock(oci) || (offset >= 0x100))
+      {
+         break;
+      }
+   }
+
+   BCACHE_DEBUG() << "Decoded block @ " << addressToString(addr) << " with "
+                  << block->theInstructions.size() << " instructions";
+}
+
+void BlockCache::resolveOperand(CpuAddress instrAddr, CachedInstruction* ci)
+{
+   ci->theOperandAddr = 0;
+   ci->thePageCrossedFlag = false;
+
+   // Same as Cpu6502::preHandlerHook for the modes that only depend on the instruction
+   switch(ci->theOpCodeInfo->theAddrMode)
+   {
+   case IMPLIED:
+   case IMMEDIATE:
+      ci->theOperandKind = CACHED_OPERAND_VALUE;
+      break;
+
+   case ZERO_PAGE:
+      ci->theOperandKind = CACHED_OPERAND_ADDRESS;
+      ci->theOperandAddr = ci->theOpCode2;
+      break;
+
+   case ABSOLUTE:
+   case INDIRECT:
+      ci->theOperandKind = CACHED_OPERAND_ADDRESS;
+      ci->theOperandAddr = ci->theOpCode2 + (ci->theOpCode3 << 8);
+      break;
+
+   case RELATIVE:
+      ci->theOperandKind = CACHED_OPERAND_ADDRESS;
+      ci->theOperandAddr = instrAddr + (int8_t) ci->theOpCode2;
+      ci->thePageCrossedFlag = ( (instrAddr & 0xff00) != (ci->theOperandAddr & 0xff00) );
+      break;
+
+   default:
+      ci->theOperandKind = CACHED_OPERAND_RESOLVE;
+      break;
+   }
+}
+
+bool BlockCache::endsBlock(OpCodeInfo* oci)
+{
+   if (oci->theAddrMode == RELATIVE)
+   {
+      // Branches
+      return true;
+   }
+
+   return (oci->theOpCodeHandler == &Decoder6502::handler_jmp) ||
+          (oci->theOpCodeHandler == &Decoder6502::handler_jsr) ||
+          (oci->theOpCodeHandler == &Decoder6502::handler_rts) ||
+          (oci->theOpCodeHandler == &Decoder6502::handler_rti) ||
+          (oci->theOpCodeHandler == &Decoder6502::handler_brk) ||
+          (oci->theOpCodeHandler == &Decoder6502::handler_kil);
+}
+
+void BlockCache::invalidateAliases(uint8_t page)
+{
+   for(auto alias: thePageAliases[page])
+   {
+      thePageGeneration[alias]++;
+   }
+}
+
+void BlockCache::invalidateAll()
+{
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      thePageGeneration[i]++;
+   }
+}
+
+void BlockCache::syncPageTables()
+{
+   invalidateAll();
+
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      thePageAliases[i].clear();
+
+      uint8_t* hostPage = theMemoryController->getHostReadPage(i << 8);
+      if (hostPage == nullptr)
+      {
+         continue;
+      }
+
+      for(int j = 0; j < MEM_CTRL_NUM_PAGES; j++)
+      {
+         if ( (i != j) && (theMemoryController->getHostReadPage(j << 8) == hostPage) )
+         {
+            thePageAliases[i].push_back(j);
+         }
+      }
+   }
+
+   theMemCtrlGeneration = theMemoryController->getPageTableGeneration();
+
+   BCACHE_DEBUG() << "Block cache synced with memory controller page tables";
+}
+
+uint64_t BlockCache::getHitCount() const
+{
+   return theHitCount;
+}
+
+uint64_t BlockCache::getMissCount() const
+{
+   return theMissCount;
+}
+
+uint64_t BlockCache::getInvalidationCount() const
+{
+   return theInvalidationCount;
+}
+
+void BlockCache::reportStatistics()
+{
+   uint64_t lookups = theHitCount + theMissCount + theInvalidationCount;
+
+   LOG_DEBUG() << "Block cache: " << theHitCount << " hits, " << theMissCount << " misses, "
+               << theInvalidationCount << " invalidated ("
+               << (lookups > 0 ? theHitCount * 100.0 / lookups : 0.0) << "% hit rate)";
+}
@@ -0,0 +1,159 @@
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include <stdint.h>
+#include <vector>
+#include "Cpu6502Defines.h"
+#include "MemoryController.h"
+
+/// Longest run of instructions stored in a single block
+#define BLOCK_CACHE_MAX_INSTRUCTIONS 64
+
+/// How a cached instruction's operand is set up before its handler is called
+enum CachedOperandKind
+{
+   CACHED_OPERAND_VALUE,    ///< IMPLIED / IMMEDIATE, only theOperandVal is set (to theOpCode2)
+   CACHED_OPERAND_ADDRESS,  ///< ZERO_PAGE / ABSOLUTE / INDIRECT / RELATIVE, theOperandAddr was resolved when decoded
+   CACHED_OPERAND_RESOLVE   ///< Indexed and indirect modes, depend on the registers / memory (preHandlerHook)
+};
+
+/// A single predecoded instruction of a cached block
+typedef struct CachedInstructionStruct
+{
+   OpCodeInfo* theOpCodeInfo;
+
+   /// Called directly, the same as theOpCodeInfo->theOpCodeHandler
+   void (Decoder6502::*theHandler)(OpCodeInfo* info);
+
+   CachedOperandKind theOperandKind;
+
+   /// For CACHED_OPERAND_ADDRESS, what preHandlerHook would have set theOperandAddr and
+   /// thePageBoundaryCrossedFlag to
+   CpuAddress theOperandAddr;
+   bool thePageCrossedFlag;
+
+   uint8_t theOpCode2;
+   uint8_t theOpCode3;
+} CachedInstruction;
+
+/**
+ * A run of instructions that starts at theStartAddress and ends at the first branch, jump,
+ * return or interrupt instruction (or at the end of the page)
+ */
+typedef struct CachedBlockStruct
+{
+   CpuAddress theStartAddress;
+
+   /// Value of the page generation when the block was decoded
+   uint32_t theGeneration;
+
+   std::vector<CachedInstruction> theInstructions;
+} CachedBlock;
+
+/**
+ * Cache of predecoded instruction blocks for the handler core, keyed by the address of the first
+ * instruction in the block.  Only code in RAM / ROM pages (the pages the MemoryController has
+ * host pointers for) is cached, everything else gets decoded an instruction at a time.
+ *
+ * A block never extends past the end of the page it starts in.  Every write the CPU makes to a
+ * page bumps the generation of the page, which invalidates all of the blocks in the page (so
+ * self-modifying code still works).  The blocks are rebuilt the next time they are looked up.
+ */
+class BlockCache
+{
+public:
+   BlockCache(MemoryController* memCtrl);
+
+   ~BlockCache();
+
+   /**
+    * Returns the block that starts at the address, decoding it if it isn't cached yet (or if the
+    * cached copy is stale).  Blocks that are already cached are found inline.
+    * @return The block, or nullptr if the address isn't in a RAM / ROM page
+    */
+   inline CachedBlock* getBlock(CpuAddress addr)
+   {
+      CachedBlock** pageBlocks = thePageBlocks[addr >> 8];
+      if ( (pageBlocks != nullptr) && (theMemCtrlGeneration == theMemoryController->getPageTableGeneration()) )
+      {
+         CachedBlock* block = pageBlocks[addr & 0xff];
+         if ( (block != nullptr) && !isStale(block) && !block->theInstructions.empty() )
+         {
+            theHitCount++;
+            return block;
+         }
+      }
+
+      return getBlockSlow(addr);
+   }
+
+   /// Has the page of the block been written to since the block was decoded
+   inline bool isStale(CachedBlock* block) const
+   {
+      return block->theGeneration != thePageGeneration[block->theStartAddress >> 8];
+   }
+
+   /// Called for every write the CPU makes, invalidates the blocks of the page being written
+   inline void invalidateAddress(CpuAddress addr)
+   {
+      uint8_t page = addr >> 8;
+      thePageGeneration[page]++;
+
+      if (!thePageAliases[page].empty())
+      {
+         invalidateAliases(page);
+      }
+   }
+
+   /// Invalidates every block in the cache
+   void invalidateAll();
+
+   uint64_t getHitCount() const;
+
+   uint64_t getMissCount() const;
+
+   /// Number of times a block had to be decoded again because its page was written to
+   uint64_t getInvalidationCount() const;
+
+   /// Logs the hit / miss statistics
+   void reportStatistics();
+
+protected:
+
+   /// Syncs with the page tables, and decodes the block if it isn't cached or is stale
+   CachedBlock* getBlockSlow(CpuAddress addr);
+
+   /// Decodes the block that starts at addr into block
+   void decodeBlock(CpuAddress addr, uint8_t* hostPage, CachedBlock* block);
+
+   /// Resolves the operand of the instruction at instrAddr if it doesn't depend on the registers
+   void resolveOperand(CpuAddress instrAddr, CachedInstruction* ci);
+
+   /// Does the instruction (possibly) change the flow of execution
+   bool endsBlock(OpCodeInfo* oci);
+
+   /// Bumps the generation of the other pages backed by the same memory as page
+   void invalidateAliases(uint8_t page);
+
+   /// Updates the page aliases when the memory controller page tables change
+   void syncPageTables();
+
+   MemoryController* theMemoryController;
+
+   /// Page table generation of the memory controller the cache was last synced with
+   uint32_t theMemCtrlGeneration;
+
+   /// Array of 256 block pointers for each page, allocated when the page first has a block
+   CachedBlock** thePageBlocks[MEM_CTRL_NUM_PAGES];
+
+   uint32_t thePageGeneration[MEM_CTRL_NUM_PAGES];
+
+   /// Other pages that are mirrors of the same host memory
+   std::vector<uint8_t> thePageAliases[MEM_CTRL_NUM_PAGES];
+
+   uint64_t theHitCount;
+   uint64_t theMissCount;
+   uint64_t theInvalidationCount;
+};
+
+#endif // BLOCKCACHE_H
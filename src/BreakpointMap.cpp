@@ -0,0 +1,112 @@
+#include <string.h>
+
+#include "BreakpointMap.h"
+
+BreakpointMap::BreakpointMap():
+   theNumBreakpoints(0),
+   theNumWatchpoints(0)
+{
+   memset(thePageFlags, 0, sizeof(thePageFlags));
+   memset(theBreakpointBits, 0, sizeof(theBreakpointBits));
+   memset(theWatchpointBits, 0, sizeof(theWatchpointBits));
+}
+
+bool BreakpointMap::updateBit(uint64_t* bits, uint8_t pageFlag, CpuAddress addr, bool set)
+{
+   uint64_t mask = 1ULL << (addr & 0x3f);
+   if ( ((bits[addr >> 6] & mask) != 0) == set )
+   {
+      return false;
+   }
+
+   bits[addr >> 6] ^= mask;
+
+   // The page flag stays set while any of the page's bits are
+   uint64_t const * pageBits = &bits[(addr >> 8) * BREAKPOINT_MAP_PAGE_WORDS];
+   bool anySet = false;
+   for(int i = 0; i < BREAKPOINT_MAP_PAGE_WORDS; i++)
+   {
+      anySet |= (pageBits[i] != 0);
+   }
+
+   if (anySet)
+   {
+      thePageFlags[addr >> 8] |= pageFlag;
+   }
+   else
+   {
+      thePageFlags[addr >> 8] &= ~pageFlag;
+   }
+
+   return true;
+}
+
+bool BreakpointMap::addBreakpoint(CpuAddress addr)
+{
+   bool added = updateBit(theBreakpointBits, PAGE_HAS_BREAKPOINT, addr, true);
+   theNumBreakpoints += (added ? 1 : 0);
+   return added;
+}
+
+bool BreakpointMap::removeBreakpoint(CpuAddress addr)
+{
+   bool removed = updateBit(theBreakpointBits, PAGE_HAS_BREAKPOINT, addr, false);
+   theNumBreakpoints -= (removed ? 1 : 0);
+   return removed;
+}
+
+bool BreakpointMap::addWatchpoint(CpuAddress addr)
+{
+   bool added = updateBit(theWatchpointBits, PAGE_HAS_WATCHPOINT, addr, true);
+   theNumWatchpoints += (added ? 1 : 0);
+   return added;
+}
+
+bool BreakpointMap::removeWatchpoint(CpuAddress addr)
+{
+   bool removed = updateBit(theWatchpointBits, PAGE_HAS_WATCHPOINT, addr, false);
+   theNumWatchpoints -= (removed ? 1 : 0);
+   return removed;
+}
+
+uint32_t BreakpointMap::getNumBreakpoints() const
+{
+   return theNumBreakpoints;
+}
+
+uint32_t BreakpointMap::getNumWatchpoints() const
+{
+   return theNumWatchpoints;
+}
+
+std::vector<CpuAddress> BreakpointMap::getAddresses(uint64_t const * bits, uint8_t pageFlag) const
+{
+   std::vector<CpuAddress> retVal;
+   for(int page = 0; page < 0x100; page++)
+   {
+      if ( (thePageFlags[page] & pageFlag) == 0)
+      {
+         continue;
+      }
+
+      for(int addr = page << 8; addr < ((page + 1) << 8); addr++)
+      {
+         if (bits[addr >> 6] & (1ULL << (addr & 0x3f)))
+         {
+            retVal.push_back(addr);
+         }
+      }
+   }
+
+   return retVal;
+}
+
+std::vector<CpuAddress> BreakpointMap::getBreakpoints() const
+{
+   return getAddresses(theBreakpointBits, PAGE_HAS_BREAKPOINT);
+}
+
+std::vector<CpuAddress> BreakpointMap::getWatchpoints() const
+{
+   return getAddresses(theWatchpointBits, PAGE_HAS_WATCHPOINT);
+}
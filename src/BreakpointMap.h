@@ -0,0 +1,89 @@
+#ifndef BREAKPOINTMAP_H
+#define BREAKPOINTMAP_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "Cpu6502Defines.h"
+
+/// thePageFlags bits
+#define PAGE_HAS_BREAKPOINT 0x01
+#define PAGE_HAS_WATCHPOINT 0x02
+
+/// 64-bit words of a 64 Kbit bitmap, and of one page of it
+#define BREAKPOINT_MAP_WORDS 0x400
+#define BREAKPOINT_MAP_PAGE_WORDS 4
+
+/**
+ * The debugger's instruction breakpoints and memory access breakpoints (watchpoints), kept so the
+ * CPU can check them inline.  A flag per page says if anything is set on the page, and only then
+ * is the exact bit looked at, so instructions and accesses on the other pages cost one byte load.
+ *
+ * Only the CPU thread changes or reads it (debugger commands are run on the CPU thread).
+ */
+class BreakpointMap
+{
+public:
+   BreakpointMap();
+
+   /// @return False if there already was a breakpoint at addr
+   bool addBreakpoint(CpuAddress addr);
+
+   /// @return False if there wasn't a breakpoint at addr
+   bool removeBreakpoint(CpuAddress addr);
+
+   /// @return False if there already was a watchpoint at addr
+   bool addWatchpoint(CpuAddress addr);
+
+   /// @return False if there wasn't a watchpoint at addr
+   bool removeWatchpoint(CpuAddress addr);
+
+   inline bool hasBreakpoint(CpuAddress addr) const
+   {
+      return (thePageFlags[addr >> 8] & PAGE_HAS_BREAKPOINT) &&
+             (theBreakpointBits[addr >> 6] & (1ULL << (addr & 0x3f)));
+   }
+
+   /// True if there is a watchpoint anywhere on addr's page
+   inline bool isPageWatched(CpuAddress addr) const
+   {
+      return (thePageFlags[addr >> 8] & PAGE_HAS_WATCHPOINT);
+   }
+
+   inline bool hasWatchpoint(CpuAddress addr) const
+   {
+      return isPageWatched(addr) && (theWatchpointBits[addr >> 6] & (1ULL << (addr & 0x3f)));
+   }
+
+   uint32_t getNumBreakpoints() const;
+
+   uint32_t getNumWatchpoints() const;
+
+   /// Breakpoint addresses, lowest first
+   std::vector<CpuAddress> getBreakpoints() const;
+
+   /// Watchpoint addresses, lowest first
+   std::vector<CpuAddress> getWatchpoints() const;
+
+protected:
+
+   /**
+    * Sets or clears addr's bit, and updates the page flag
+    * @return False if the bit already had that value
+    */
+   bool updateBit(uint64_t* bits, uint8_t pageFlag, CpuAddress addr, bool set);
+
+   std::vector<CpuAddress> getAddresses(uint64_t const * bits, uint8_t pageFlag) const;
+
+   uint8_t thePageFlags[0x100];
+
+   uint64_t theBreakpointBits[BREAKPOINT_MAP_WORDS];
+
+   uint64_t theWatchpointBits[BREAKPOINT_MAP_WORDS];
+
+   uint32_t theNumBreakpoints;
+
+   uint32_t theNumWatchpoints;
+};
+
+#endif // BREAKPOINTMAP_H
@@ -65,6 +65,11 @@ void ConfigManager::processArgs(int argc, char** argv)
    }
 }
 
+void ConfigManager::addConfig(std::string const & arg)
+{
+   processSingleArg(arg);
+}
+
 bool ConfigManager::isConfigTypePresent(std::string const & typeName)
 {
    for(auto const & curConfig : theConfigData)
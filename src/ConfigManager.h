@@ -9,11 +9,16 @@
 /**
  * Loads the configuration from a file or from command line arguments.  Generally just ignores
  * stuff it doesn't understand.
+ *
+ * The application's configuration is the singleton.  Other instances can be created for machines
+ * that each have their own configuration (see Machine).
  */
 class ConfigManager
 {
 public:
 
+   ConfigManager();
+
    // Methods for managing the lifetime of the singleton object
    static ConfigManager* getInstance();
    static ConfigManager* createInstance();
@@ -22,6 +27,9 @@ public:
    /// Process command line arguments
    void processArgs(int argc, char** argv);
 
+   /// Adds a single type.name.member=value setting
+   void addConfig(std::string const & arg);
+
    /// Adds to the configuration by reading the contents of a configuration file
    void loadConfigFile(std::string filename);
 
@@ -67,8 +75,6 @@ protected:
       std::string theValue;
    } ConfigDataEntry;
 
-   ConfigManager();
-
    void processSingleArg(std::string const & arg);
 
    static ConfigManager* theInstance;
@@ -1,15 +1,19 @@
+#include <thread>
+
+#include "BlockCache.h"
 #include "Cpu6502.h"
+#include "Cpu6502Flags.h"
 #include "Logger.h"
 #include "Utils.h"
 
-#include "DebugServer.h"
+#include "DebuggerHooks.h"
 #include "MemoryController.h"
 #include "MemoryDev.h"
-
-
-#ifdef TRACE_EXECUTION
-   #include "Disassembler6502.h"
-#endif
+#include "TraceBuffer.h"
+#include "SaveState.h"
+#include "MachineSnapshot.h"
+#include "RewindBuffer.h"
+#include "FlowTraceBuffer.h"
 
 #ifdef CPU_TRACE
    #define CPU_DEBUG    LOG_DEBUG
@@ -19,6 +23,18 @@
    #define CPU_WARNING  if(0) LOG_WARNING
 #endif
 
+/// Default emulated clock rate, a typical 1 MHz 6502 system
+#define DEFAULT_CLOCK_HZ        1000000
+
+/// Number of slices of execution per second of emulated time when throttling
+#define SLICES_PER_SECOND       1000
+
+/// If the emulator falls this far behind the wall clock, give up trying to catch up
+#define MAX_CLOCK_LAG_US        100000
+
+/// How often the drift between emulated time and wall time is logged
+#define DRIFT_REPORT_PERIOD_US  5000000
+
 #ifdef ADDR_MODE_TRACE
    #define ADDRMODE_DEBUG   LOG_DEBUG
    #define ADDRMODE_WARNING LOG_WARNING
@@ -36,217 +52,1193 @@ Cpu6502::Cpu6502(MemoryController* ctrlr):
    theDebugger(nullptr),
    theDebuggerShutdownFlag(false),
    theRunFlag(true),
+   theJammedFlag(false),
+   theBatchEndClock(0),
+   theBatchChecksFlag(false),
+   theBatchInstructionsLeft(0),
+   theBatchStopAtAddrFlag(false),
+   theBatchStopAddr(0),
+   theBatchBreakpointsFlag(false),
+   theBatchStoppedFlag(false),
    theNumClocks(0),
    theAddrModeExtraClockCycle(0),
-   thePageBoundaryCrossedFlag(false)
+   thePageBoundaryCrossedFlag(false),
+   theCoreType(HANDLER_CORE),
+   theBlockCache(nullptr),
+   theClockHz(DEFAULT_CLOCK_HZ),
+   theThrottleFlag(true),
+   theThrottleStartClocks(0),
+   theRunStartClocks(0),
+   theClockDriftUs(0),
+   theClockLagUs(0),
+   theFlightRecorderFilename("flight.bin"),
+   theExitSaveStateFilename(""),
+   theExitCountersFilename(""),
+   theProfiler(nullptr),
+   theExitProfileFilename(""),
+   theRewindBuffer(nullptr),
+   theRewindRequest(0),
+   theTraceBuffer(nullptr),
+   theFlowTraceBuffer(nullptr),
+   theTraceMode(FULL_TRACE),
+   theTraceFilename("trace.bin"),
+   theNumberOfStepsToTrace(UINT64_MAX),
+   theNumberOfStepsExecuted(0),
+   theTraceMaxStallMs(DEFAULT_TRACE_MAX_STALL_MS),
+   theTraceFlag(false),
+   theTraceFlushFlag(false),
+   theInstrumentedFlag(false),
+   theInstructionCheck(nullptr),
+   theInstructionCheckContext(nullptr)
 {
    thePc = 0;
 
    theMemoryController = ctrlr;
+   theMemoryController->getEventScheduler()->attachClock(&theNumClocks, &theBatchEndClock);
 
    theStatusReg.theWholeRegister = 0x24;
+   loadLazyFlags();
+}
 
-#ifdef TRACE_EXECUTION
-   theDisAss = new Disassembler6502(ctrlr);
-   theDisAss->includeOpCodes(true);
-   theDisAss->includeAddress(true);
-
-   theTraceFile = fopen("trace.txt", "w");
+Cpu6502::~Cpu6502()
+{
+   CPU_DEBUG() << "CPU6502 destructor called";
 
-   if (!theTraceFile)
+   if (theDebugger != nullptr)
    {
-      LOG_WARNING() << "Error opening trace.txt execution trace file";
+      CPU_DEBUG() << "Deleting the debugger";
+      delete theDebugger;
    }
    else
    {
-      fprintf(theTraceFile, "Execution start\n");
+      CPU_DEBUG() << "No debugger to delete";
    }
 
-   theNumberOfStepsToTrace = 0xffffffffffffffff;
-   theNumberOfStepsExecuted = 0;
-#endif
+   delete theBlockCache;
+
+   delete theRewindBuffer;
+
+   delete theProfiler;
+
+   // The memory controller outlives the CPU
+   theMemoryController->getEventScheduler()->attachClock(nullptr, nullptr);
+
+   if (theTraceBuffer || theFlowTraceBuffer)
+   {
+      CPU_DEBUG() << "Closing the trace file";
+      delete theTraceBuffer;
+      delete theFlowTraceBuffer;
+   }
 }
 
-Cpu6502::~Cpu6502()
+void Cpu6502::attachDebugger(DebuggerHooks* debugger)
 {
-   CPU_DEBUG() << "CPU6502 destructor called";
-
    if (theDebugger != nullptr)
    {
-      CPU_DEBUG() << "Deleting the debugger";
+      CPU_WARNING() << "Replacing the debugger that was already attached!";
       delete theDebugger;
    }
-   else
+
+   CPU_DEBUG() << "Debugger attached";
+   theDebugger = debugger;
+}
+
+void Cpu6502::setStepLimit(uint64_t numSteps)
+{
+   theNumberOfStepsToTrace = numSteps;
+   updateInstrumentedFlag();
+}
+
+void Cpu6502::setInstructionCheck(InstructionCheckCallback cb, void* context)
+{
+   theInstructionCheck = cb;
+   theInstructionCheckContext = context;
+   updateInstrumentedFlag();
+}
+
+void Cpu6502::setTraceFilename(std::string const & filename)
+{
+   delete theTraceBuffer;
+   theTraceBuffer = nullptr;
+
+   delete theFlowTraceBuffer;
+   theFlowTraceBuffer = nullptr;
+
+   theTraceFilename = filename;
+}
+
+void Cpu6502::setTraceEnabled(bool enable)
+{
+   CPU_DEBUG() << "Execution trace " << (enable ? "enabled" : "disabled");
+
+   if (!enable)
    {
-      CPU_DEBUG() << "No debugger to delete";
+      // Flush so the trace so far can be looked at while the emulator keeps running.  Only the
+      // CPU thread touches the trace buffer, so it does the flush.
+      theTraceFlushFlag = true;
    }
 
-#ifdef TRACE_EXECUTION
-   CPU_DEBUG() << "Delete the tracer disassembler";
-   delete theDisAss;
+   theTraceFlag = enable;
+   updateInstrumentedFlag();
+}
+
+bool Cpu6502::isTraceEnabled()
+{
+   return theTraceFlag;
+}
 
-   if (theTraceFile)
+void Cpu6502::setTraceMaxStall(uint32_t maxStallMs)
+{
+   theTraceMaxStallMs = maxStallMs;
+
+   if (theTraceBuffer)
    {
-      CPU_DEBUG() << "Closing the trace file";
-      fprintf(theTraceFile, "Execution end\n");
-      fclose(theTraceFile);
-      theTraceFile = nullptr;
+      theTraceBuffer->setMaxStall(maxStallMs);
+   }
+
+   if (theFlowTraceBuffer)
+   {
+      theFlowTraceBuffer->setMaxStall(maxStallMs);
+   }
+}
+
+void Cpu6502::setTraceMode(TraceMode mode)
+{
+   theTraceMode = mode;
+}
+
+void Cpu6502::setFlightRecorderSize(uint32_t numRecords)
+{
+   theFlightRecorder.resize(numRecords);
+}
+
+void Cpu6502::setFlightRecorderFilename(std::string const & filename)
+{
+   theFlightRecorderFilename = filename;
+}
+
+void Cpu6502::getFlightRecords(std::vector<FlightRecord>& records)
+{
+   theFlightRecorder.getRecords(records);
+
+#ifdef LAZY_STATUS_FLAGS
+   // Same as materializeFlags
+   for(auto& r: records)
+   {
+      r.theStatusReg &= ~(FLG_NEG | FLG_ZERO);
+      r.theStatusReg |= (r.theLazySignValue & FLG_NEG);
+      r.theStatusReg |= (r.theLazyZeroValue == 0 ? FLG_ZERO : 0x00);
    }
 #endif
 }
 
-bool Cpu6502::enableDebugger(uint16_t portNumber)
+bool Cpu6502::dumpFlightRecorder(std::string const & filename, uint32_t* numRecords)
+{
+   std::vector<FlightRecord> records;
+   getFlightRecords(records);
+
+   if (numRecords != nullptr)
+   {
+      *numRecords = records.size();
+   }
+
+   if (records.empty())
+   {
+      return true;
+   }
+
+   TraceBuffer flightTrace(records.size());
+   if (!flightTrace.open(filename))
+   {
+      return false;
+   }
+
+   for(auto const & r: records)
+   {
+      flightTrace.addRecord(r.thePc, r.theOpCodes, r.theAccum, r.theRegX, r.theRegY,
+                            r.theStackPtr, r.theStatusReg, r.theClock);
+   }
+
+   // Written out when flightTrace is destroyed
+   return true;
+}
+
+bool Cpu6502::saveState(std::string const & filename)
+{
+   SaveState state;
+
+   materializeFlags();
+
+   state.beginChunk("CPU");
+   state.writeU16(thePc);
+   state.writeU8(theAccum);
+   state.writeU8(theRegX);
+   state.writeU8(theRegY);
+   state.writeU8(theStackPtr);
+   state.writeU8(theStatusReg.theWholeRegister);
+   state.writeU8(theJammedFlag ? 1 : 0);
+   state.writeU64(theNumClocks);
+   theMemoryController->getInterruptController()->saveState(&state);
+   state.endChunk();
+
+   theMemoryController->saveState(&state);
+
+   if (!state.saveFile(filename))
+   {
+      return false;
+   }
+
+   LOG_DEBUG() << "Machine state saved to " << filename;
+   return true;
+}
+
+bool Cpu6502::loadState(std::string const & filename)
+{
+   SaveState state;
+   if (!state.loadFile(filename))
+   {
+      return false;
+   }
+
+   // Nothing is changed until every chunk has been read and loaded
+   uint16_t pc;
+   uint8_t accum;
+   uint8_t regX;
+   uint8_t regY;
+   uint8_t stackPtr;
+   uint8_t statusReg;
+   uint8_t jammed;
+   uint64_t numClocks;
+   uint32_t irqSources;
+   uint32_t nmiSources;
+   bool nmiPending;
+
+   if (!state.openChunk("CPU") || !state.readU16(&pc) || !state.readU8(&accum) ||
+       !state.readU8(&regX) || !state.readU8(&regY) || !state.readU8(&stackPtr) ||
+       !state.readU8(&statusReg) || !state.readU8(&jammed) || !state.readU64(&numClocks) ||
+       !InterruptController::readState(&state, &irqSources, &nmiSources, &nmiPending))
+   {
+      LOG_WARNING() << "Save state file " << filename << " doesn't have a valid CPU state";
+      return false;
+   }
+
+   // Devices schedule their events again relative to the restored clock
+   uint64_t oldNumClocks = theNumClocks;
+   moveClock(numClocks);
+
+   if (!theMemoryController->loadState(&state))
+   {
+      LOG_WARNING() << "Save state file " << filename << " doesn't fit the machine, nothing loaded";
+      moveClock(oldNumClocks);
+      return false;
+   }
+
+   thePc = pc;
+   theAccum = accum;
+   theRegX = regX;
+   theRegY = regY;
+   theStackPtr = stackPtr;
+   theStatusReg.theWholeRegister = statusReg;
+   loadLazyFlags();
+   theJammedFlag = (jammed != 0);
+
+   theMemoryController->getInterruptController()->setLines(irqSources, nmiSources, nmiPending);
+
+   // Memory changed underneath the decoded blocks, and the trace jumps to the restored PC
+   if (theBlockCache != nullptr)
+   {
+      theBlockCache->invalidateAll();
+   }
+
+   theTraceFlushFlag = true;
+
+   // The frames are from a different timeline now
+   if (theRewindBuffer != nullptr)
+   {
+      theRewindBuffer->start();
+   }
+
+   if (theProfiler != nullptr)
+   {
+      theProfiler->restart(thePc);
+   }
+
+   LOG_DEBUG() << "Machine state loaded from " << filename;
+   return true;
+}
+
+void Cpu6502::setExitSaveStateFilename(std::string const & filename)
+{
+   theExitSaveStateFilename = filename;
+}
+
+void Cpu6502::setExitCountersFilename(std::string const & filename)
+{
+   theExitCountersFilename = filename;
+
+   if (!filename.empty())
+   {
+      theExecutionCounters.setEnabled(true);
+   }
+}
+
+void Cpu6502::takeSnapshot(MachineSnapshot* snapshot)
+{
+   materializeFlags();
+
+   SnapshotCpuState* cpuState = snapshot->getCpuState();
+   cpuState->thePc = thePc;
+   cpuState->theAccum = theAccum;
+   cpuState->theRegX = theRegX;
+   cpuState->theRegY = theRegY;
+   cpuState->theStackPtr = theStackPtr;
+   cpuState->theStatusReg = theStatusReg.theWholeRegister;
+   cpuState->theJammedFlag = theJammedFlag;
+   cpuState->theNumClocks = theNumClocks;
+   theMemoryController->getInterruptController()->getLines(&cpuState->theIrqSources,
+                                                           &cpuState->theNmiSources,
+                                                           &cpuState->theNmiPendingFlag);
+
+   theMemoryController->takeSnapshot(snapshot);
+}
+
+void Cpu6502::restoreSnapshot(MachineSnapshot const & snapshot)
+{
+   SnapshotCpuState const * cpuState = snapshot.getCpuState();
+   thePc = cpuState->thePc;
+   theAccum = cpuState->theAccum;
+   theRegX = cpuState->theRegX;
+   theRegY = cpuState->theRegY;
+   theStackPtr = cpuState->theStackPtr;
+   theStatusReg.theWholeRegister = cpuState->theStatusReg;
+   loadLazyFlags();
+   theJammedFlag = cpuState->theJammedFlag;
+   moveClock(cpuState->theNumClocks);
+
+   theMemoryController->getInterruptController()->setLines(cpuState->theIrqSources,
+                                                           cpuState->theNmiSources,
+                                                           cpuState->theNmiPendingFlag);
+
+   // Events belong to the timeline that is being thrown away
+   theMemoryController->getEventScheduler()->clear();
+
+   if (theProfiler != nullptr)
+   {
+      theProfiler->restart(thePc);
+   }
+
+   bool restoredPages[MEM_CTRL_NUM_PAGES];
+   theMemoryController->restoreSnapshot(snapshot, restoredPages);
+
+   if (theBlockCache != nullptr)
+   {
+      for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+      {
+         if (restoredPages[i])
+         {
+            theBlockCache->invalidateAddress(i << 8);
+         }
+      }
+   }
+
+   theTraceFlushFlag = true;
+}
+
+void Cpu6502::setRewind(uint32_t seconds, uint32_t memoryBudgetKb)
+{
+   if (seconds == 0)
+   {
+      delete theRewindBuffer;
+      theRewindBuffer = nullptr;
+      return;
+   }
+
+   if (theRewindBuffer == nullptr)
+   {
+      theRewindBuffer = new RewindBuffer(this, theMemoryController);
+   }
+
+   theRewindBuffer->configure(seconds, (uint64_t) memoryBudgetKb * 1024, theClockHz);
+   theRewindBuffer->start();
+
+   LOG_DEBUG() << "Rewind keeps " << seconds << " seconds, " << memoryBudgetKb << " KB";
+}
+
+bool Cpu6502::rewind(uint32_t numFrames)
+{
+   if ( (theRewindBuffer == nullptr) || (numFrames == 0) )
+   {
+      return false;
+   }
+
+   // Frame 1 is the newest one before now (not the one we may be sitting on)
+   int index = theRewindBuffer->findFrame(theNumClocks);
+   if (index < 0)
+   {
+      return false;
+   }
+
+   index -= numFrames - 1;
+   if (index < 0)
+   {
+      index = 0;
+   }
+
+   CPU_DEBUG() << "Rewinding to clock " << theRewindBuffer->getFrameClock(index);
+   return theRewindBuffer->restoreFrame(index);
+}
+
+bool Cpu6502::reverseStep()
+{
+   if (theRewindBuffer == nullptr)
+   {
+      return false;
+   }
+
+   uint64_t targetClock = theNumClocks;
+   int index = theRewindBuffer->findFrame(targetClock);
+   if (index < 0)
+   {
+      return false;
+   }
+
+   uint64_t frameClock = theRewindBuffer->getFrameClock(index);
+
+   // Replaying what already happened, breakpoints don't apply
+   DebuggerHooks* debugger = theDebugger;
+   theDebugger = nullptr;
+
+   // Count the instructions from the frame to now, then replay all but the last one
+   theRewindBuffer->restoreFrame(index);
+
+   uint64_t numInstructions = 0;
+   while( (theNumClocks < targetClock) && !theJammedFlag && (numInstructions <= targetClock - frameClock) )
+   {
+      stepWithEvents();
+      numInstructions++;
+   }
+
+   theRewindBuffer->restoreFrame(index);
+
+   for(uint64_t i = 1; i < numInstructions; i++)
+   {
+      stepWithEvents();
+   }
+
+   theDebugger = debugger;
+
+   CPU_DEBUG() << "Reverse stepped to " << addressToString(thePc) << " at clock " << theNumClocks;
+   return true;
+}
+
+void Cpu6502::requestRewind(uint32_t numFrames)
+{
+   // Serviced at the start of the next batch (start runs short slices)
+   theRewindRequest.fetch_add(numFrames);
+}
+
+GuestProfiler* Cpu6502::getProfiler()
+{
+   if (theProfiler == nullptr)
+   {
+      theProfiler = new GuestProfiler(theMemoryController->getEventScheduler());
+   }
+
+   return theProfiler;
+}
+
+void Cpu6502::startProfiler(uint32_t sampleCycles)
+{
+   getProfiler()->start(sampleCycles, thePc);
+}
+
+void Cpu6502::stopProfiler()
+{
+   if (theProfiler != nullptr)
+   {
+      theProfiler->stop();
+   }
+}
+
+void Cpu6502::setExitProfileFilename(std::string const & filename)
+{
+   theExitProfileFilename = filename;
+}
+
+void Cpu6502::moveClock(uint64_t numClocks)
+{
+   // Keep the run statistics and the throttle measuring from where they were
+   theRunStartClocks = numClocks - (theNumClocks - theRunStartClocks);
+   theThrottleStartClocks = numClocks - (theNumClocks - theThrottleStartClocks);
+   theNumClocks = numClocks;
+}
+
+void Cpu6502::flightRecorderHalt()
+{
+   if (theFlightRecorderFilename.empty())
+   {
+      return;
+   }
+
+   uint32_t numRecords;
+   if (!dumpFlightRecorder(theFlightRecorderFilename, &numRecords))
+   {
+      LOG_WARNING() << "Couldn't write the flight recorder to " << theFlightRecorderFilename;
+   }
+   else if (numRecords > 0)
+   {
+      LOG_WARNING() << "Last " << numRecords << " instructions before the halt written to "
+                    << theFlightRecorderFilename;
+   }
+}
+
+void Cpu6502::updateInstrumentedFlag()
+{
+   theInstrumentedFlag = theTraceFlag || (theNumberOfStepsToTrace != UINT64_MAX) ||
+                         (theInstructionCheck != nullptr);
+}
+
+void Cpu6502::setClockRate(uint32_t clockHz)
+{
+   if (clockHz == 0)
+   {
+      LOG_WARNING() << "Invalid clock rate of 0 Hz, using " << DEFAULT_CLOCK_HZ << " Hz";
+      clockHz = DEFAULT_CLOCK_HZ;
+   }
+
+   theClockHz = clockHz;
+}
+
+void Cpu6502::setThrottle(bool enable)
+{
+   theThrottleFlag = enable;
+}
+
+int64_t Cpu6502::getClockDrift()
+{
+   return theClockDriftUs;
+}
+
+void Cpu6502::setCoreType(CpuCoreType core)
+{
+   theCoreType = core;
+
+   if ( (core == BLOCK_CACHE_CORE) && (theBlockCache == nullptr) )
+   {
+      theBlockCache = new BlockCache(theMemoryController);
+   }
+   else if (theBlockCache != nullptr)
+   {
+      // Writes from the other cores don't invalidate blocks, start over if we come back
+      theBlockCache->invalidateAll();
+   }
+}
+
+void Cpu6502::exitEmulation()
+{
+   CPU_DEBUG() << "exit Emulation called";
+   theRunFlag = false;
+   theDebuggerShutdownFlag = true;
+}
+
+void Cpu6502::addHaltCallback(HaltFunctionCallback cb)
+{
+   theHaltCallbacksList.push_back(cb);
+}
+
+void Cpu6502::start()
+{
+   // Do a bunch of architecutre specific setup stuff here if necessary
+
+   CPU_DEBUG() << "Cpu6502::start called at address " << addressToString(thePc);
+
+   theRunStartTime = std::chrono::steady_clock::now();
+   theRunStartClocks = theNumClocks;
+   theThrottleStartTime = theRunStartTime;
+   theThrottleStartClocks = theNumClocks;
+   theLastDriftReportTime = theRunStartTime;
+
+   uint64_t sliceCycles = theClockHz / SLICES_PER_SECOND;
+   if (sliceCycles == 0)
+   {
+      sliceCycles = 1;
+   }
+
+   CPU_DEBUG() << "Running at " << theClockHz << " Hz (" << (theThrottleFlag ? "throttled" : "unthrottled")
+               << "), " << sliceCycles << " cycles per slice";
+
+   bool stopFlag = false;
+   while(theRunFlag && !stopFlag)
+   {
+      // A breakpoint (or the debugger having execution paused) just ends the slice early
+      switch(runCycles(sliceCycles))
+      {
+      case STOP_HALT:
+         stopFlag = true;
+         break;
+
+      case STOP_KIL:
+         // Stops the emulator, or lets the user look around if a debugger is attached.  halt()
+         // pauses the debugger, so the next slices just wait in the debugHook until the user
+         // tries to run again (and ends up back here)
+         halt();
+         stopFlag = (theDebugger == nullptr);
+         break;
+
+      default:
+         break;
+      }
+
+      throttleSlice();
+   }
+
+   reportClockDrift();
+
+   if (theBlockCache != nullptr)
+   {
+      theBlockCache->reportStatistics();
+   }
+
+   if (!theExitSaveStateFilename.empty())
+   {
+      saveState(theExitSaveStateFilename);
+   }
+
+   if (!theExitCountersFilename.empty())
+   {
+      theExecutionCounters.dumpJson(theExitCountersFilename);
+   }
+
+   if (!theExitProfileFilename.empty() && (theProfiler != nullptr))
+   {
+      theProfiler->dumpCollapsedStacks(theExitProfileFilename);
+      LOG_DEBUG() << "Guest profile:\n" << theProfiler->getReport(PROFILER_REPORT_ROUTINES);
+   }
+
+   CPU_DEBUG() << "Emulator exitting, calling the halt callbacks";
+
+   // Call the halt callbacks
+   for(auto hcb: theHaltCallbacksList)
+   {
+      CPU_DEBUG() << "Calling a halt callback";
+      hcb();
+   }
+
+   CPU_DEBUG() << "Exiting emulation thread";
+}
+
+int Cpu6502::decodeWithDebugging()
+{
+   int cc;
+   if (theDebugger == nullptr)
+   {
+      CPU_WARNING() << "decodeWithDebugging called with no debugger";
+      return -1;
+   }
+
+   int debuggerStatus = theDebugger->debugHook();
+   if (debuggerStatus == -1)
+   {
+      // User has asked us to shut emulator down
+      return -1;
+   }
+
+   if (debuggerStatus == 0)
+   {
+      // Debugger has the program stopped, don't decode or anything
+      return 0;
+   }
+   else
+   {
+      // Debugger says we can continue execution
+      cc = stepInstruction();
+   }
+
+   if (!theRunFlag)
+   {
+      CPU_DEBUG() << "Run flag set to false!";
+      return -1;
+   }
+
+   if (cc == -1)
+   {
+      // Since we are debugging, we probably want to see the error
+      return 0;
+   }
+
+   return cc;
+}
+
+int Cpu6502::decode()
+{
+   CPU_DEBUG() << "CPU6502::decode";
+
+   int cc = runCore(0);
+
+   if (cc == -1)
+   {
+      // Is the emulator just stopped, or do we really need to shut down
+      return -1;
+   }
+
+   if (!theRunFlag || theJammedFlag)
+   {
+      CPU_DEBUG() << "Run flag set to false, or CPU jammed!";
+      return -1;
+   }
+
+   return cc;
+}
+
+int Cpu6502::runCore(uint64_t cycleLimit)
+{
+   bool traced = theInstrumentedFlag || theBatchChecksFlag;
+
+   switch(theCoreType)
+   {
+   case SWITCH_CORE:
+      return traced ? runSwitchCore<true>(cycleLimit) : runSwitchCore<false>(cycleLimit);
+
+   case BLOCK_CACHE_CORE:
+      return traced ? runBlockCache<true>(cycleLimit) : runBlockCache<false>(cycleLimit);
+
+   default:
+      return traced ? runHandlerCore<true>(cycleLimit) : runHandlerCore<false>(cycleLimit);
+   }
+}
+
+int Cpu6502::stepInstruction()
+{
+   if (theCoreType == SWITCH_CORE)
+   {
+      return theInstrumentedFlag ? runSwitchCore<true>(0) : runSwitchCore<false>(0);
+   }
+
+   return theInstrumentedFlag ? stepHandler<true>() : stepHandler<false>();
+}
+
+template<bool TRACED>
+inline int Cpu6502::executeHandler(OpCodeInfo* oci)
+{
+   // Same as Decoder6502::executeOpCode, but the hooks aren't virtual calls, and the trace is
+   // compiled out of the fast instantiation
+   CpuAddress instrPc = thePc;
+
+   recordInstruction(oci->theOpCode);
+
+   Cpu6502::preHandlerHook(oci);
+
+   if (TRACED)
+   {
+      traceInstruction(oci->theOpCode);
+   }
+
+   (this->*oci->theOpCodeHandler)(oci);
+
+   int clockCycles = Cpu6502::postHandlerHook(oci);
+
+   if (TRACED)
+   {
+      checkStepLimit();
+   }
+
+   Cpu6502::updatePc(oci->theNumBytes);
+
+   if (TRACED)
+   {
+      traceControlFlow(instrPc, oci->theOpCode);
+      checkBatchStop();
+   }
+
+   return clockCycles;
+}
+
+template<bool TRACED>
+inline int Cpu6502::executeCached(CachedInstruction const & ci)
+{
+   OpCodeInfo* oci = ci.theOpCodeInfo;
+   CpuAddress instrPc = thePc;
+
+   theOpCode2 = ci.theOpCode2;
+   theOpCode3 = ci.theOpCode3;
+
+   recordInstruction(oci->theOpCode);
+
+   if (ci.theOperandKind == CACHED_OPERAND_RESOLVE)
+   {
+      Cpu6502::preHandlerHook(oci);
+   }
+   else
+   {
+      // The handlers only use theOperandVal for IMMEDIATE, and theOperandAddr is left alone for
+      // IMPLIED / IMMEDIATE like preHandlerHook does
+      theOperandVal = ci.theOpCode2;
+      if (ci.theOperandKind == CACHED_OPERAND_ADDRESS)
+      {
+         theOperandAddr = ci.theOperandAddr;
+      }
+
+      thePageBoundaryCrossedFlag = ci.thePageCrossedFlag;
+      theAddrModeExtraClockCycle = 0;
+   }
+
+   if (TRACED)
+   {
+      traceInstruction(oci->theOpCode);
+   }
+
+   (this->*ci.theHandler)(oci);
+
+   int clockCycles = Cpu6502::postHandlerHook(oci);
+
+   if (TRACED)
+   {
+      checkStepLimit();
+   }
+
+   Cpu6502::updatePc(oci->theNumBytes);
+
+   if (TRACED)
+   {
+      traceControlFlow(instrPc, oci->theOpCode);
+      checkBatchStop();
+   }
+
+   return clockCycles;
+}
+
+template<bool TRACED>
+inline int Cpu6502::stepHandler()
+{
+   OpCodeInfo* oci = fetchInstruction();
+   if (oci == nullptr)
+   {
+      return -1;
+   }
+
+   return executeHandler<TRACED>(oci);
+}
+
+template<bool TRACED>
+int Cpu6502::runHandlerCore(uint64_t cycleLimit)
+{
+   uint64_t startClocks = theNumClocks;
+   theBatchEndClock = cycleLimit;
+
+   do
+   {
+      if (stepHandler<TRACED>() == -1)
+      {
+         return -1;
+      }
+
+      // halt() and jam() set theBatchEndClock to 0
+   } while(theNumClocks < theBatchEndClock);
+
+   if (!theRunFlag)
+   {
+      return -1;
+   }
+
+   return theNumClocks - startClocks;
+}
+
+template<bool TRACED>
+int Cpu6502::runBlockCache(uint64_t cycleLimit)
+{
+   uint64_t startClocks = theNumClocks;
+   theBatchEndClock = cycleLimit;
+
+   do
+   {
+      CachedBlock* block = theBlockCache->getBlock(thePc);
+
+      if (block == nullptr)
+      {
+         // Not RAM / ROM, decode one instruction the normal way
+         if (stepHandler<TRACED>() == -1)
+         {
+            return -1;
+         }
+      }
+      else
+      {
+         for(auto const & ci: block->theInstructions)
+         {
+            executeCached<TRACED>(ci);
+
+            if ( (theNumClocks >= theBatchEndClock) || theBlockCache->isStale(block))
+            {
+               // Halted, an event is due, or the rest of the block may have been overwritten
+               break;
+            }
+         }
+      }
+
+   } while(theNumClocks < theBatchEndClock);
+
+   if (!theRunFlag)
+   {
+      return -1;
+   }
+
+   return theNumClocks - startClocks;
+}
+
+CpuStopReason Cpu6502::runCycles(uint64_t numCycles)
 {
-   if (theDebugger == nullptr)
-   {
-      CPU_DEBUG() << "Enabling debugger on port " << portNumber;
-      theDebugger = new DebugServer(this, portNumber, theMemoryController);
-
-      return theDebugger->startDebugServer();
-   }
-   else
-   {
-      CPU_WARNING() << "Debugger was already running!";
-      return true;
-   }
+   return runBatch(numCycles, UINT64_MAX, false, 0);
 }
 
-#ifdef TRACE_EXECUTION
-void Cpu6502::setStepLimit(uint64_t numSteps)
+CpuStopReason Cpu6502::runInstructions(uint64_t numInstructions)
 {
-   theNumberOfStepsToTrace = numSteps;
+   return runBatch(UINT64_MAX, numInstructions, false, 0);
 }
-#endif
 
-void Cpu6502::exitEmulation()
+CpuStopReason Cpu6502::runUntil(CpuAddress addr, uint64_t maxCycles)
 {
-   CPU_DEBUG() << "exit Emulation called";
-   theRunFlag = false;
-   theDebuggerShutdownFlag = true;
+   return runBatch(maxCycles, UINT64_MAX, true, addr);
 }
 
-void Cpu6502::addHaltCallback(HaltFunctionCallback cb)
+bool Cpu6502::isJammed()
 {
-   theHaltCallbacksList.push_back(cb);
+   return theJammedFlag;
 }
 
-void Cpu6502::start()
+CpuStopReason Cpu6502::runBatch(uint64_t numCycles, uint64_t numInstructions, bool stopAtAddr,
+                                CpuAddress stopAddr)
 {
-   // Do a bunch of architecutre specific setup stuff here if necessary
+   if (theTraceFlushFlag)
+   {
+      theTraceFlushFlag = false;
+      if (theTraceBuffer)
+      {
+         theTraceBuffer->flush();
+      }
 
-   CPU_DEBUG() << "Cpu6502::start called at address " << addressToString(thePc);
+      if (theFlowTraceBuffer)
+      {
+         theFlowTraceBuffer->flush();
+      }
+   }
+
+   if (!theRunFlag)
+   {
+      return STOP_HALT;
+   }
 
    if (theDebugger)
    {
-      // Debugger running
-      while(theRunFlag)
+      // Called even when the CPU is jammed, so the debugger still gets to talk to its client
+      int debuggerStatus = theDebugger->debugHook();
+      if (debuggerStatus == -1)
       {
-         CPU_DEBUG() << "Cpu6502::start start of the loop executing (debug mode)";
-
-         SDL_Delay(1);
+         // User has asked us to shut emulator down
+         theRunFlag = false;
+         return STOP_HALT;
+      }
 
-         if (-1 == decodeWithDebugging())
-         {
-            break;
-         }
+      if (debuggerStatus == 0)
+      {
+         return STOP_BREAKPOINT;
       }
    }
-   else
+
+   if (theJammedFlag)
    {
-      // Debugger not running
-      while(theRunFlag)
-      {
-         CPU_DEBUG() << "Cpu6502::start start of the loop executing (no debugger)";
+      return STOP_KIL;
+   }
 
-         SDL_Delay(1);
+   if (theRewindRequest.load(std::memory_order_relaxed) != 0)
+   {
+      rewind(theRewindRequest.exchange(0));
+   }
 
-         if (-1 == decode())
-         {
-            break;
-         }
-      }
+   if (numInstructions == 0)
+   {
+      return STOP_BUDGET;
    }
 
-   CPU_DEBUG() << "Emulator exitting, calling the halt callbacks";
+   uint64_t endClock = theNumClocks + numCycles;
+   if (endClock < theNumClocks)
+   {
+      // Overflowed, numCycles is effectively unlimited
+      endClock = UINT64_MAX;
+   }
 
-   // Call the halt callbacks
-   for(auto hcb: theHaltCallbacksList)
+   if ( (theDebugger != nullptr) && !theDebugger->isRunning() )
    {
-      CPU_DEBUG() << "Calling a halt callback";
-      hcb();
+      // Single stepping
+      numInstructions = 1;
    }
 
-   CPU_DEBUG() << "Exiting emulation thread";
-}
+   // The first instruction is always executed, so runUntil can be used to run around a loop (and
+   // the debugger can continue from the breakpoint it stopped at)
+   theBatchBreakpointsFlag = (theDebugger != nullptr) && (theBreakpointMap.getNumBreakpoints() > 0);
+   theBatchChecksFlag = (numInstructions != UINT64_MAX) || stopAtAddr || theBatchBreakpointsFlag;
+   theBatchInstructionsLeft = numInstructions;
+   theBatchStopAtAddrFlag = stopAtAddr;
+   theBatchStopAddr = stopAddr;
+   theBatchStoppedFlag = false;
 
-int Cpu6502::decodeWithDebugging()
-{
-   int cc;
-   if (theDebugger == nullptr)
+   // The core runs instructions in its own loop up to the next scheduled event
+   EventScheduler* scheduler = theMemoryController->getEventScheduler();
+
+   while( (theNumClocks < endClock) && theRunFlag && !theJammedFlag && !theBatchStoppedFlag )
    {
-      CPU_WARNING() << "decodeWithDebugging called with no debugger";
-      return -1;
+      CpuAddress pc = thePc;
+      checkInterrupts();
+
+      if ( (thePc != pc) && ( (stopAtAddr && (thePc == stopAddr)) ||
+                              (theBatchBreakpointsFlag && theBreakpointMap.hasBreakpoint(thePc)) ) )
+      {
+         // An interrupt went to the stop address or a breakpoint
+         break;
+      }
+
+      uint64_t chunkEndClock = scheduler->getNextEventClock();
+      if (chunkEndClock > endClock)
+      {
+         chunkEndClock = endClock;
+      }
+
+      // The core always executes at least one instruction, even if an event is already due
+      if ( (theNumClocks < chunkEndClock) && (runCore(chunkEndClock) == -1) )
+      {
+         break;
+      }
+
+      scheduler->runDueEvents();
    }
 
-   int debuggerStatus = theDebugger->debugHook();
-   if (debuggerStatus == -1)
+   theBatchChecksFlag = false;
+
+   if ( (stopAtAddr && (thePc == stopAddr)) ||
+        (theBatchBreakpointsFlag && theBreakpointMap.hasBreakpoint(thePc)) )
    {
-      // User has asked us to shut emulator down
-      return -1;
+      // The next batch's debugHook pauses the debugger at the breakpoint
+      return STOP_BREAKPOINT;
    }
 
-   if (debuggerStatus == 0)
+   if (theJammedFlag)
    {
-      // Debugger has the program stopped, don't decode or anything
-      return 0;
+      return STOP_KIL;
    }
-   else
+
+   if (!theRunFlag)
    {
-      // Debugger says we can continue execution
-      cc = Decoder6502::decode();
+      return STOP_HALT;
    }
 
-   if (!theRunFlag)
+   if ( (theDebugger != nullptr) && !theDebugger->isRunning() )
    {
-      CPU_DEBUG() << "Run flag set to false!";
-      return -1;
+      // Paused by a watchpoint (or the batch was stepped)
+      return STOP_BREAKPOINT;
    }
 
-   if (cc == -1)
+   return STOP_BUDGET;
+}
+
+void Cpu6502::stepWithEvents()
+{
+   stepInstruction();
+
+   if (theNumClocks >= theMemoryController->getEventScheduler()->getNextEventClock())
    {
-      // Since we are debugging, we probably want to see the error
-      return 0;
+      theMemoryController->getEventScheduler()->runDueEvents();
    }
 
-   return cc;
+   checkInterrupts();
 }
 
-int Cpu6502::decode()
+void Cpu6502::checkInterrupts()
 {
-   CPU_DEBUG() << "CPU6502::decode";
+   if (theJammedFlag)
+   {
+      return;
+   }
 
-   int cc = Decoder6502::decode();
-   if (cc == -1)
+   InterruptController* ic = theMemoryController->getInterruptController();
+
+   // Looking at the lines now, anything asserted after this sets the flag again
+   ic->takeLinesChanged();
+
+   if (ic->acknowledgeNmi())
    {
-      // Is the emulator just stopped, or do we really need to shut down
-      return -1;
+      CPU_DEBUG() << "Taking NMI @ " << addressToString(thePc);
+      interrupt(NMI_VECTOR);
+   }
+   else if (ic->isIrqAsserted() && (theStatusReg.theInterruptFlag == 0))
+   {
+      CPU_DEBUG() << "Taking IRQ @ " << addressToString(thePc);
+      interrupt(IRQ_VECTOR);
    }
+}
 
-   if (!theRunFlag)
+void Cpu6502::interrupt(CpuAddress vector)
+{
+   // Unlike BRK, the PC pushed is the instruction that was interrupted
+   emulatorWrite(0x0100 + theStackPtr, (thePc >> 8) & 0xff);
+   theStackPtr--;
+   emulatorWrite(0x0100 + theStackPtr, thePc & 0xff);
+   theStackPtr--;
+
+   materializeFlags();
+   emulatorWrite(0x0100 + theStackPtr, (theStatusReg.theWholeRegister & ~FLG_BKPT) | 0x20);
+   theStackPtr--;
+
+   theStatusReg.theInterruptFlag = 1;
+
+   thePc = (emulatorRead(vector + 1) << 8) + emulatorRead(vector);
+   theNumClocks += 7;
+
+   traceInterrupt(thePc);
+   profileCall(thePc);
+}
+
+void Cpu6502::irqUnmasked()
+{
+   if (theMemoryController->getInterruptController()->isIrqAsserted())
    {
-      CPU_DEBUG() << "Run flag set to false!";
-      return -1;
+      theBatchEndClock = 0;
    }
+}
 
-   return cc;
+void Cpu6502::checkLinesChanged()
+{
+   if (theMemoryController->getInterruptController()->takeLinesChanged())
+   {
+      theBatchEndClock = 0;
+   }
+}
+
+void Cpu6502::jam()
+{
+   LOG_WARNING() << "CPU jammed by KIL instruction @ " << addressToString(thePc);
+   theJammedFlag = true;
+   theBatchEndClock = 0;
+
+   flightRecorderHalt();
 }
 
 void Cpu6502::halt()
 {
+   // Stop the core loops after the current instruction
+   theBatchEndClock = 0;
+
+   if (!theJammedFlag)
+   {
+      // jam() already wrote it
+      flightRecorderHalt();
+   }
+
    if (theDebugger != nullptr)
    {
       CPU_DEBUG() << "Emulator halting (debugger attached)";
-      theDebugger->emulatorHalt((void*) theDebugger);
+
+      std::vector<FlightRecord> records;
+      getFlightRecords(records);
+      theDebugger->emulatorHalted(records);
    }
    else
    {
@@ -262,6 +1254,56 @@ void Cpu6502::halt()
 
 }
 
+void Cpu6502::throttleSlice()
+{
+   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+   int64_t wallUs = std::chrono::duration_cast<std::chrono::microseconds>(now - theThrottleStartTime).count();
+   int64_t emulatedUs = (int64_t) ((double) (theNumClocks - theThrottleStartClocks) * 1000000.0 / theClockHz);
+
+   theClockDriftUs = emulatedUs - wallUs;
+
+   if (std::chrono::duration_cast<std::chrono::microseconds>(now - theLastDriftReportTime).count() >= DRIFT_REPORT_PERIOD_US)
+   {
+      CPU_DEBUG() << "Emulated clock drift from wall clock = " << theClockDriftUs << " us";
+      theLastDriftReportTime = now;
+   }
+
+   if (!theThrottleFlag)
+   {
+      return;
+   }
+
+   if (theClockDriftUs > 0)
+   {
+      // Emulator is ahead of real hardware
+      std::this_thread::sleep_for(std::chrono::microseconds(theClockDriftUs));
+   }
+   else if (theClockDriftUs < -MAX_CLOCK_LAG_US)
+   {
+      // Host too slow (or debugger had us paused), running flat out to catch up would just make
+      // the emulator jerky.  Start measuring from now instead.
+      CPU_DEBUG() << "Emulator fell " << -theClockDriftUs << " us behind the wall clock";
+      theClockLagUs -= theClockDriftUs;
+      theThrottleStartTime = now;
+      theThrottleStartClocks = theNumClocks;
+   }
+}
+
+void Cpu6502::reportClockDrift()
+{
+   std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+   double wallSecs = std::chrono::duration_cast<std::chrono::microseconds>(now - theRunStartTime).count() / 1000000.0;
+   double emulatedSecs = (double) (theNumClocks - theRunStartClocks) / theClockHz;
+
+   LOG_DEBUG() << "Emulated " << emulatedSecs << " s of CPU time in " << wallSecs << " s of wall time ("
+               << (wallSecs > 0.0 ? (theNumClocks - theRunStartClocks) / wallSecs / 1000000.0 : 0.0)
+               << " MHz effective)";
+   LOG_DEBUG() << "Clock drift at exit = " << theClockDriftUs << " us, time lost falling behind = "
+               << theClockLagUs << " us";
+}
+
 void Cpu6502::updatePc(uint8_t bytesIncrement)
 {
    // Check clock cycles
@@ -433,32 +1475,105 @@ void Cpu6502::preHandlerHook(OpCodeInfo* oci)
    }
 
    theAddrModeExtraClockCycle = 0;
+}
+
+bool Cpu6502::openTrace()
+{
+   if (theTraceFilename.empty())
+   {
+      return false;
+   }
 
-#ifdef TRACE_EXECUTION
-   std::string disassText = theDisAss->debugListing(thePc, 1);
-   disassText.pop_back();  // Remove line ending
+   TraceWriter* writer;
+   if (theTraceMode == FLOW_TRACE)
+   {
+      theFlowTraceBuffer = new FlowTraceBuffer();
+      writer = theFlowTraceBuffer;
+   }
+   else
+   {
+      theTraceBuffer = new TraceBuffer();
+      writer = theTraceBuffer;
+   }
 
-   // Lets get the length to 45 characters
-   while(disassText.size() < 45)
+   writer->setMaxStall(theTraceMaxStallMs);
+   if (!writer->open(theTraceFilename))
    {
-      disassText.push_back(' ');
+      delete writer;
+      theTraceBuffer = nullptr;
+      theFlowTraceBuffer = nullptr;
+      theTraceFilename.clear();
+      return false;
    }
 
-   disassText += "A=";
-   disassText += Utils::toHex8(theAccum, false);
-   disassText += ",  X=";
-   disassText += Utils::toHex8(theRegX, false);
-   disassText += ",  Y=";
-   disassText += Utils::toHex8(theRegY, false);
-   disassText += ",  SP=";
-   disassText += Utils::toHex8(theStackPtr, false);
-   disassText += ",  SR=";
-   disassText += Utils::toHex8(theStatusReg.theWholeRegister, false);
-   disassText += ",  CLK=";
-   disassText += Utils::toHex64(theNumClocks, false);
+   return true;
+}
 
-   fprintf(theTraceFile, "%s\n", disassText.c_str());
-#endif
+void Cpu6502::traceInstruction(uint8_t opCode)
+{
+   if (theInstructionCheck != nullptr)
+   {
+      materializeFlags();
+
+      FlightRecord r;
+      r.theClock = theNumClocks;
+      r.thePc = thePc;
+      r.theOpCodes[0] = opCode;
+      r.theOpCodes[1] = theOpCode2;
+      r.theOpCodes[2] = theOpCode3;
+      r.theAccum = theAccum;
+      r.theRegX = theRegX;
+      r.theRegY = theRegY;
+      r.theStackPtr = theStackPtr;
+      r.theStatusReg = theStatusReg.theWholeRegister;
+
+      if (!theInstructionCheck(theInstructionCheckContext, r))
+      {
+         CPU_DEBUG() << "Instruction check failed at " << addressToString(thePc);
+         halt();
+      }
+   }
+
+   if (!theTraceFlag || (theTraceMode != FULL_TRACE))
+   {
+      // Only the step limit is turned on, or the flow trace is recorded after the instruction
+      return;
+   }
+
+   if (!theTraceBuffer && !openTrace())
+   {
+      return;
+   }
+
+   uint8_t opCodes[3] = { opCode, theOpCode2, theOpCode3 };
+
+   materializeFlags();
+   theTraceBuffer->addRecord(thePc, opCodes, theAccum, theRegX, theRegY, theStackPtr,
+                             theStatusReg.theWholeRegister, theNumClocks);
+}
+
+void Cpu6502::traceControlFlow(CpuAddress instrPc, uint8_t opCode)
+{
+   if (!theTraceFlag || (theTraceMode != FLOW_TRACE))
+   {
+      return;
+   }
+
+   if (!theFlowTraceBuffer && !openTrace())
+   {
+      return;
+   }
+
+   uint8_t opCodes[3] = { opCode, theOpCode2, theOpCode3 };
+   theFlowTraceBuffer->addInstruction(instrPc, opCodes, thePc);
+}
+
+void Cpu6502::traceInterrupt(CpuAddress handlerPc)
+{
+   if (theTraceFlag && theFlowTraceBuffer)
+   {
+      theFlowTraceBuffer->addInterrupt(handlerPc);
+   }
 }
 
 int Cpu6502::postHandlerHook(OpCodeInfo* oci)
@@ -466,12 +1581,20 @@ int Cpu6502::postHandlerHook(OpCodeInfo* oci)
    int clockCycles = oci->theDelayCycles + theAddrModeExtraClockCycle;
    theNumClocks += clockCycles;
 
-#ifdef TRACE_EXECUTION
+   theExecutionCounters.countInstruction(oci->theOpCode, theAddrModeExtraClockCycle);
+
+   CPU_DEBUG() << "Clock cycles for this instruction = " << clockCycles;
+   return clockCycles;
+}
+
+void Cpu6502::checkStepLimit()
+{
    theNumberOfStepsExecuted++;
 
    if (theNumberOfStepsToTrace < theNumberOfStepsExecuted)
    {
-      fprintf(theTraceFile, "Hit the step limit of %ld\n", theNumberOfStepsToTrace);
+      CPU_DEBUG() << "Hit the step limit of " << theNumberOfStepsToTrace;
+
       halt();
    }
    else
@@ -479,10 +1602,6 @@ int Cpu6502::postHandlerHook(OpCodeInfo* oci)
       CPU_DEBUG() << "Step target " << theNumberOfStepsToTrace << ", we are at "
                   << theNumberOfStepsExecuted;
    }
-#endif
-
-   CPU_DEBUG() << "Clock cycles for this instruction = " << clockCycles;
-   return clockCycles;
 }
 
 void Cpu6502::getRegisters(uint8_t* regX, uint8_t* regY, uint8_t* accum)
@@ -497,6 +1616,11 @@ CpuAddress Cpu6502::getPc()
    return thePc;
 }
 
+uint64_t Cpu6502::getNumClocks()
+{
+   return theNumClocks;
+}
+
 uint8_t Cpu6502::getStackPointer()
 {
    return theStackPtr;
@@ -504,6 +1628,7 @@ uint8_t Cpu6502::getStackPointer()
 
 uint8_t Cpu6502::getStatusReg()
 {
+   materializeFlags();
    return theStatusReg.theWholeRegister;
 }
 
@@ -512,12 +1637,29 @@ uint64_t Cpu6502::getInstructionCount()
    return theNumClocks;
 }
 
+void Cpu6502::watchpointHit(CpuAddress addr, bool isWrite)
+{
+   if (theDebugger != nullptr)
+   {
+      theDebugger->debugMemoryAccessHook(addr, isWrite);
+
+      // The debugger paused the emulator, the core loops stop after this instruction
+      theBatchStoppedFlag = true;
+      theBatchEndClock = 0;
+   }
+}
+
 uint8_t Cpu6502::emulatorRead(CpuAddress addr)
 {
-   if (theDebugger)
+   if (theBreakpointMap.hasWatchpoint(addr))
    {
-      // Call debugger incase user has memory access breakpoint
-      theDebugger->debugMemoryAccessHook(addr, false);
+      watchpointHit(addr, false);
+   }
+
+   uint8_t* hostPage = theMemoryController->getHostReadPage(addr);
+   if (hostPage != nullptr)
+   {
+      return hostPage[addr & 0xff];
    }
 
    MemoryDev* theMemDev = theMemoryController->getDevice(addr);
@@ -532,16 +1674,36 @@ uint8_t Cpu6502::emulatorRead(CpuAddress addr)
    }
    else
    {
-      return theMemDev->read8(addr);
+      uint8_t val = theMemDev->read8(addr);
+      checkLinesChanged();
+      return val;
    }
 }
 
 void Cpu6502::emulatorWrite(CpuAddress addr, uint8_t val)
 {
-   if (theDebugger)
+   if (theBreakpointMap.hasWatchpoint(addr))
+   {
+      watchpointHit(addr, true);
+   }
+
+   if (theBlockCache != nullptr)
+   {
+      // Self-modifying code, the page may have instructions that were already decoded
+      theBlockCache->invalidateAddress(addr);
+   }
+
+   uint8_t* hostPage = theMemoryController->getHostWritePage(addr);
+   if (hostPage == nullptr)
+   {
+      // First write to the page since a snapshot was taken or restored?
+      hostPage = theMemoryController->unprotectPage(addr);
+   }
+
+   if (hostPage != nullptr)
    {
-      // Call debugger incase user has memory access breakpoint
-      theDebugger->debugMemoryAccessHook(addr, true);
+      hostPage[addr & 0xff] = val;
+      return;
    }
 
    MemoryDev* theMemDev = theMemoryController->getDevice(addr);
@@ -557,15 +1719,10 @@ void Cpu6502::emulatorWrite(CpuAddress addr, uint8_t val)
    else
    {
       theMemDev->write8(addr, val);
+      checkLinesChanged();
    }
 }
 
-/***** HELPER MACROS *****/
-#define UPDATE_SIGN_FLAG(regValue) theStatusReg.theSignFlag = (regValue & 0x80 ? 1 : 0)
-#define UPDATE_ZERO_FLAG(regValue) theStatusReg.theZeroFlag = (regValue == 0 ? 1 : 0)
-
-#define UPDATE_SZ_FLAGS(regValue)   UPDATE_SIGN_FLAG(regValue); UPDATE_ZERO_FLAG(regValue)
-
 /********************************************/
 /************   LOGIC OPERATIONS ************/
 /********************************************/
@@ -694,8 +1851,8 @@ void Cpu6502::handler_rol(OpCodeInfo* oci)
    }
 
    theStatusReg.theCarryFlag = (setCarryFlag ? 1 : 0);
-   theStatusReg.theSignFlag = (setSignFlag ? 1 : 0);
-   theStatusReg.theZeroFlag = (setZeroFlag ? 1 : 0);
+   SET_SIGN_FLAG(setSignFlag);
+   SET_ZERO_FLAG(setZeroFlag);
 }
 void Cpu6502::handler_ror(OpCodeInfo* oci)
 {
@@ -743,8 +1900,8 @@ void Cpu6502::handler_ror(OpCodeInfo* oci)
    }
 
    theStatusReg.theCarryFlag = (setCarryFlag ? 1 : 0);
-   theStatusReg.theSignFlag = (setSignFlag ? 1 : 0);
-   theStatusReg.theZeroFlag = (setZeroFlag ? 1 : 0);
+   SET_SIGN_FLAG(setSignFlag);
+   SET_ZERO_FLAG(setZeroFlag);
 }
 
 void Cpu6502::handler_asl(OpCodeInfo* oci)
@@ -779,8 +1936,8 @@ void Cpu6502::handler_asl(OpCodeInfo* oci)
    }
 
    theStatusReg.theCarryFlag = (setCarryFlag ? 1 : 0);
-   theStatusReg.theSignFlag = (setSignFlag ? 1 : 0);
-   theStatusReg.theZeroFlag = (setZeroFlag ? 1 : 0);
+   SET_SIGN_FLAG(setSignFlag);
+   SET_ZERO_FLAG(setZeroFlag);
 }
 
 void Cpu6502::handler_lsr(OpCodeInfo* oci)
@@ -812,8 +1969,8 @@ void Cpu6502::handler_lsr(OpCodeInfo* oci)
    }
 
    theStatusReg.theCarryFlag = (setCarryFlag ? 1 : 0);
-   theStatusReg.theSignFlag = 0;
-   theStatusReg.theZeroFlag = (setZeroFlag ? 1 : 0);
+   SET_SIGN_FLAG(false);
+   SET_ZERO_FLAG(setZeroFlag);
 }
 
 /********************************************/
@@ -1095,6 +2252,7 @@ void Cpu6502::handler_cli(OpCodeInfo* oci)
 {
    CPU_DEBUG() << " CLI Handler - Clears interrupt disable flag";
    theStatusReg.theInterruptFlag = 0;
+   irqUnmasked();
 }
 
 void Cpu6502::handler_sei(OpCodeInfo* oci)
@@ -1132,13 +2290,13 @@ void Cpu6502::comparison_operation(uint8_t regValue, uint8_t operandValue)
       CPU_DEBUG() << "Comparison Operation: " << Utils::toHex8(operandValue) << "== regValue ("
                   << Utils::toHex8(regValue) << ")";
       theStatusReg.theCarryFlag = 1;
-      theStatusReg.theZeroFlag = 1;
-      theStatusReg.theSignFlag = 0;
+      SET_ZERO_FLAG(true);
+      SET_SIGN_FLAG(false);
    }
    else
    {
       // They are not the same
-      theStatusReg.theZeroFlag = 0;
+      SET_ZERO_FLAG(false);
       theStatusReg.theCarryFlag = (regValue > operandValue ? 1 : 0);
 
       // Lets do some subtraction, 8 bit style
@@ -1209,11 +2367,11 @@ void Cpu6502::handler_bit(OpCodeInfo* oci)
    uint8_t opVal = emulatorRead(theOperandAddr);
    uint8_t val= opVal & theAccum;
 
-   theStatusReg.theZeroFlag = (val == 0 ? 1 : 0);
+   UPDATE_ZERO_FLAG(val);
 
    // This was a bit confusing at first, but just use the bits 6 and 7 directly from opVal
    theStatusReg.theOverflowFlag = ( opVal & 0x40 ? 1 : 0);
-   theStatusReg.theSignFlag = (opVal & 0x80 ? 1 : 0);
+   UPDATE_SIGN_FLAG(opVal);
 
    CPU_DEBUG() << "BIT Handler - *op & accum = " << Utils::toHex8(opVal) << " & "
                << Utils::toHex8(theAccum) << " = " << Utils::toHex8(val);
@@ -1277,6 +2435,8 @@ void Cpu6502::handler_jsr(OpCodeInfo* oci)
 
    // JSR is always an ABSOLUTE addressing mode instruction
    thePc = theOperandAddr - oci->theNumBytes;
+
+   profileCall(theOperandAddr);
 }
 
 void Cpu6502::handler_rts(OpCodeInfo* oci)
@@ -1294,6 +2454,8 @@ void Cpu6502::handler_rts(OpCodeInfo* oci)
 
    thePc = upperAddress << 8;
    thePc += lowerAddress;
+
+   profileReturn();
 }
 
 void Cpu6502::handler_rti(OpCodeInfo* oci)
@@ -1305,6 +2467,12 @@ void Cpu6502::handler_rti(OpCodeInfo* oci)
    uint8_t unaffectedBits = theStatusReg.theWholeRegister & 0x30;
    theStatusReg.theWholeRegister = srVal & 0xBF;
    theStatusReg.theWholeRegister = srVal | unaffectedBits;
+   loadLazyFlags();
+
+   if (theStatusReg.theInterruptFlag == 0)
+   {
+      irqUnmasked();
+   }
 
    CPU_DEBUG() << "RTI Handler - Popped SR (" << Utils::toHex8(srVal) << ") from stack";
 
@@ -1320,13 +2488,15 @@ void Cpu6502::handler_rti(OpCodeInfo* oci)
                << Utils::toHex8(theStackPtr);
 
    thePc -= oci->theNumBytes;
+
+   profileReturn();
 }
 
 
 
 void Cpu6502::handler_beq(OpCodeInfo* oci)
 {
-   if (theStatusReg.theZeroFlag == 1)
+   if (ZERO_FLAG() == 1)
    {
       CPU_DEBUG() << "BEQ Handler - Branch taken to " << addressToString(theOperandAddr);
 
@@ -1343,7 +2513,7 @@ void Cpu6502::handler_beq(OpCodeInfo* oci)
 
 void Cpu6502::handler_bne(OpCodeInfo* oci)
 {
-   if (theStatusReg.theZeroFlag == 0)
+   if (ZERO_FLAG() == 0)
    {
       CPU_DEBUG() << "BNE Handler - Branch taken to " << addressToString(theOperandAddr);
 
@@ -1360,7 +2530,7 @@ void Cpu6502::handler_bne(OpCodeInfo* oci)
 
 void Cpu6502::handler_bpl(OpCodeInfo* oci)
 {
-   if (theStatusReg.theSignFlag == 0)
+   if (SIGN_FLAG() == 0)
    {
       CPU_DEBUG() << "BPL Handler - Branch taken to " << addressToString(theOperandAddr);
 
@@ -1377,7 +2547,7 @@ void Cpu6502::handler_bpl(OpCodeInfo* oci)
 
 void Cpu6502::handler_bmi(OpCodeInfo* oci)
 {
-   if (theStatusReg.theSignFlag == 1)
+   if (SIGN_FLAG() == 1)
    {
       CPU_DEBUG() << "BMI Handler - Branch taken to " << addressToString(theOperandAddr);
 
@@ -1491,6 +2661,7 @@ void Cpu6502::handler_php(OpCodeInfo* oci)
 
    // Set bits 4 and 5 before pushing
    // https://wiki.nesdev.com/w/index.php/CPU_status_flag_behavior
+   materializeFlags();
    valueToPush = theStatusReg.theWholeRegister | 0x30;
 
    emulatorWrite(0x0100 + theStackPtr, valueToPush);
@@ -1509,6 +2680,12 @@ void Cpu6502::handler_plp(OpCodeInfo* oci)
    uint8_t ignoredBits = theStatusReg.theWholeRegister & 0x30;
    theStatusReg.theWholeRegister = emulatorRead(0x0100 + theStackPtr) & 0xCF;
    theStatusReg.theWholeRegister |= ignoredBits;
+   loadLazyFlags();
+
+   if (theStatusReg.theInterruptFlag == 0)
+   {
+      irqUnmasked();
+   }
 
    CPU_DEBUG() << "PLP Handler - Popped SR (" << Utils::toHex8(theStatusReg.theWholeRegister)
                << ") from stack, now SP=" << Utils::toHex8(theStackPtr);
@@ -1667,7 +2844,11 @@ void Cpu6502::handler_lax(OpCodeInfo* oci)
 
 void Cpu6502::handler_kil(OpCodeInfo* oci)
 {
-   CPU_DEBUG() << "Empty handler for kil";
+   CPU_DEBUG() << "KIL Handler";
+
+   // updatePc will move the PC, but it should stay stuck on the KIL
+   thePc -= oci->theNumBytes;
+   jam();
 }
 
 void Cpu6502::handler_nop(OpCodeInfo* oci)
@@ -1816,6 +2997,7 @@ void Cpu6502::handler_brk(OpCodeInfo* oci)
 
    // Set bits 4 and 5 before pushing
    // https://wiki.nesdev.com/w/index.php/CPU_status_flag_behavior
+   materializeFlags();
    valueToPush = theStatusReg.theWholeRegister | 0x30;
 
    emulatorWrite(0x0100 + theStackPtr, valueToPush);
@@ -1827,6 +3009,8 @@ void Cpu6502::handler_brk(OpCodeInfo* oci)
 
    // This likely needs to be modified because the decoder is going to increment PC after this
    thePc = (emulatorRead(0xffff) << 8) + emulatorRead(0xfffe);
+
+   profileCall(thePc);
 }
 
 
@@ -3,18 +3,54 @@
 
 #include "EmulatorConfig.h"
 #include "Decoder6502.h"
+#include "FlightRecorder.h"
+#include "ExecutionCounters.h"
+#include "GuestProfiler.h"
+#include "BreakpointMap.h"
 #include <vector>
+#include <chrono>
+#include <atomic>
 
-class DebugServer;
+class BlockCache;
+typedef struct CachedInstructionStruct CachedInstruction;
+class DebuggerHooks;
 class MemoryController;
+class MachineSnapshot;
+class RewindBuffer;
 
 typedef void (*HaltFunctionCallback)(void);
 
+/// Called with the CPU state before each instruction executes, return false to halt the CPU
+typedef bool (*InstructionCheckCallback)(void* context, FlightRecord const & state);
+
+/// Which interpreter implementation executes the instructions
+enum CpuCoreType
+{
+   HANDLER_CORE,    ///< Calls the op code handler functions through the gOpCodes table
+   SWITCH_CORE,     ///< Single dispatch loop with each op code inlined (Cpu6502SwitchCore.cpp)
+   BLOCK_CACHE_CORE ///< Handler functions, but instructions are predecoded into cached blocks
+};
+
+/// What the execution trace records
+enum TraceMode
+{
+   FULL_TRACE,      ///< Every instruction and the registers (TraceBuffer)
+   FLOW_TRACE       ///< Only branches, jump targets and interrupts (FlowTraceBuffer)
+};
 
-#ifdef TRACE_EXECUTION
-   #include<stdio.h> // FILE
-   class Disassembler6502;
-#endif
+
+/// Why one of the batch execution functions (runCycles, runInstructions, runUntil) returned
+enum CpuStopReason
+{
+   STOP_BUDGET,      ///< Executed the requested number of cycles or instructions
+   STOP_BREAKPOINT,  ///< Reached a debugger breakpoint / the runUntil address, or debugger paused
+   STOP_HALT,        ///< Emulator halted (invalid memory access, step limit, or exitting)
+   STOP_KIL          ///< A KIL op code jammed the CPU
+};
+
+#include<string>
+class TraceBuffer;
+class FlowTraceBuffer;
 
 class Cpu6502 : public Decoder6502
 {
@@ -26,19 +62,199 @@ public:
     virtual void start();
 
     /**
-     * Opens the debug server socket.
-     * @param portNumber
-     * @return False on errror
+     * Attaches a debugger (DebugServer) to the CPU.  The CPU takes ownership of the debugger and
+     * deletes it when the CPU is destroyed.
+     * @param debugger Debugger that was already started
+     */
+    void attachDebugger(DebuggerHooks* debugger);
+
+    /**
+     * The debugger's breakpoints and watchpoints.  Without any, an attached debugger doesn't slow
+     * the emulator down while it is running.
      */
-    bool enableDebugger(uint16_t portNumber);
+    inline BreakpointMap* getBreakpointMap()
+    {
+       return &theBreakpointMap;
+    }
 
-#ifdef TRACE_EXECUTION
     /**
      * Set an a limit to the number of steps the emulator will execute before exitting for testing
      * @param numSteps Finite number of steps or 0xffffffffffffffff for infinity
      */
     void setStepLimit(uint64_t numSteps);
-#endif
+
+    /**
+     * Has every instruction checked before it executes (the traced instantiation of the cores is
+     * used while a check is set), the CPU halts when the check returns false
+     * @param cb Check, or nullptr to stop checking
+     */
+    void setInstructionCheck(InstructionCheckCallback cb, void* context);
+
+    /**
+     * Sets the file the binary execution trace is written to (trace.bin by default, trace6502
+     * renders it as text).  The file is created when the first instruction is traced, so CPUs
+     * that never run don't touch it.
+     * @param filename Trace filename, or an empty string to turn off the trace
+     */
+    void setTraceFilename(std::string const & filename);
+
+    /**
+     * Turns the execution trace on or off.  Can be called while the emulator is running (from the
+     * debugger), the cores pick it up at the start of their next batch.
+     */
+    void setTraceEnabled(bool enable);
+
+    bool isTraceEnabled();
+
+    /**
+     * How long the CPU waits for the trace writer thread to catch up before it drops trace
+     * records (DEFAULT_TRACE_MAX_STALL_MS by default)
+     * @param maxStallMs Milliseconds, 0 to drop records instead of ever waiting
+     */
+    void setTraceMaxStall(uint32_t maxStallMs);
+
+    /**
+     * Selects what the trace records (FULL_TRACE by default), should be called before the trace
+     * is turned on
+     */
+    void setTraceMode(TraceMode mode);
+
+    /**
+     * Number of instructions the flight recorder remembers (DEFAULT_FLIGHT_RECORDER_SIZE by
+     * default, rounded up to a power of 2).  Should be called before start().
+     */
+    void setFlightRecorderSize(uint32_t numRecords);
+
+    /**
+     * Sets the file the flight recorder is written to when the emulator halts (flight.bin by
+     * default, in the same format as the full trace so trace6502 can render it)
+     * @param filename Flight recorder filename, or an empty string to never write it
+     */
+    void setFlightRecorderFilename(std::string const & filename);
+
+    /**
+     * Copies the last instructions out of the flight recorder (the CPU must not be running)
+     * @param records Filled with the records, oldest first
+     */
+    void getFlightRecords(std::vector<FlightRecord>& records);
+
+    /**
+     * Writes the flight recorder to a binary trace file, the file isn't created when the flight
+     * recorder is empty
+     * @param numRecords Set to the number of records written, if not null
+     * @return False if the file couldn't be created
+     */
+    bool dumpFlightRecorder(std::string const & filename, uint32_t* numRecords = nullptr);
+
+    /// Instructions and cycles executed per op code / addressing mode (once counting is enabled)
+    inline ExecutionCounters* getExecutionCounters()
+    {
+       return &theExecutionCounters;
+    }
+
+    /**
+     * Sets a file to write the execution counters to (as JSON) when start() returns, and turns
+     * counting on
+     * @param filename Counters filename, or an empty string (the default) to not write one
+     */
+    void setExitCountersFilename(std::string const & filename);
+
+    /**
+     * Writes the whole machine (registers, clock count, interrupt lines and every memory device)
+     * to a save state file.  The CPU must not be running (call from the CPU thread or the
+     * debugger).
+     */
+    bool saveState(std::string const & filename);
+
+    /**
+     * Restores a save state made by a machine with the same configuration.  Either the whole
+     * machine is restored, or (if the file is truncated or a device in it doesn't fit the machine)
+     * nothing is changed and false is returned.
+     */
+    bool loadState(std::string const & filename);
+
+    /**
+     * Sets a save state file to write when start() returns
+     * @param filename Save state filename, or an empty string (the default) to not write one
+     */
+    void setExitSaveStateFilename(std::string const & filename);
+
+    /**
+     * Takes an in memory snapshot of the registers, clock count, interrupt lines and memory.  Only
+     * the memory pages written since the last snapshot taken or restored are copied.
+     */
+    void takeSnapshot(MachineSnapshot* snapshot);
+
+    /// Puts the machine back to the snapshot (or a fork of it), only copying the pages that changed
+    void restoreSnapshot(MachineSnapshot const & snapshot);
+
+    /**
+     * Keeps the last seconds of machine state for rewinding.  Capturing starts right away, so call
+     * it after the memory controller's resetAll (which drops all scheduled events).
+     * @param seconds Seconds of emulated time to keep, 0 turns rewinding off
+     * @param memoryBudgetKb Most memory the rewind frames may use
+     */
+    void setRewind(uint32_t seconds, uint32_t memoryBudgetKb);
+
+    /**
+     * Goes back in time (CPU thread only, or while the CPU isn't running)
+     * @param numFrames Number of rewind frames (1 / REWIND_FRAMES_PER_SECOND seconds each)
+     * @return False if rewinding is off or there is nothing to go back to
+     */
+    bool rewind(uint32_t numFrames);
+
+    /**
+     * Goes back to just before the last instruction executed, by rewinding to the frame before it
+     * and running forward again.  Same threading rules as rewind.
+     */
+    bool reverseStep();
+
+    /// Can be called from any thread, the CPU rewinds at the start of its next batch
+    void requestRewind(uint32_t numFrames);
+
+    /**
+     * Clears the guest profile and starts sampling the call stack.  Call it after the memory
+     * controller's resetAll (which drops all scheduled events).
+     * @param sampleCycles Cycles between samples
+     */
+    void startProfiler(uint32_t sampleCycles);
+
+    /// Stops sampling, the profile is kept until the profiler is started again
+    void stopProfiler();
+
+    /// The guest profile and its routine names (created the first time it is needed)
+    GuestProfiler* getProfiler();
+
+    /**
+     * Sets a file to write the profile to (collapsed stacks for flamegraph.pl) when start()
+     * returns, the routines that took the most cycles are logged too
+     * @param filename Profile filename, or an empty string (the default) to not write one
+     */
+    void setExitProfileFilename(std::string const & filename);
+
+    /**
+     * Sets the emulated clock rate.  The run loop sleeps between slices of instructions so the
+     * emulated clock keeps pace with the wall clock
+     * @param clockHz Target clock frequency in Hz
+     */
+    void setClockRate(uint32_t clockHz);
+
+    /**
+     * Unthrottled mode runs as fast as the host allows (emulated time will run ahead of the wall
+     * clock)
+     */
+    void setThrottle(bool enable);
+
+    /**
+     * How far the emulated time is ahead of (positive) or behind (negative) wall clock time
+     * @return Drift in microseconds at the end of the last slice of execution
+     */
+    int64_t getClockDrift();
+
+    /**
+     * Selects the interpreter core, should be called before start()
+     */
+    void setCoreType(CpuCoreType core);
 
     /**
      * Called from debugger to have the emulator exit
@@ -138,6 +354,7 @@ public:
     uint8_t    getStackPointer();
     uint8_t    getStatusReg();
     uint64_t   getInstructionCount();
+    uint64_t   getNumClocks();
 
     /**
      * Our implementation of decode calls debugger hook and makes sure emulator
@@ -148,13 +365,331 @@ public:
     /// Runs fast as possible, only will stop when we are told or when emulator breaks
     virtual int decode();
 
+    /**
+     * Executes instructions until at least numCycles clock cycles have elapsed.  The run flag
+     * and the debugger hook are only checked once for the whole batch.
+     */
+    CpuStopReason runCycles(uint64_t numCycles);
+
+    /// Executes numInstructions instructions
+    CpuStopReason runInstructions(uint64_t numInstructions);
+
+    /**
+     * Executes instructions until the PC reaches addr (the first instruction is always executed,
+     * so this can be used to run around a loop).  Returns STOP_BREAKPOINT when addr is reached.
+     * @param maxCycles Gives up with STOP_BUDGET after this many clock cycles
+     */
+    CpuStopReason runUntil(CpuAddress addr, uint64_t maxCycles = UINT64_MAX);
+
+    /// True once a KIL op code has been executed, the CPU won't execute anything else
+    bool isJammed();
+
 protected:
 
     virtual void updatePc(uint8_t bytesIncrement);
 
+    /**
+     * Common implementation of the batch execution functions.  The selected core runs the batch
+     * in its own loop up to each scheduled event.  An instruction limit or stop address switches
+     * to the traced instantiation of the core, which checks them after every instruction.
+     */
+    CpuStopReason runBatch(uint64_t numCycles, uint64_t numInstructions, bool stopAtAddr,
+                           CpuAddress stopAddr);
+
+    /// Called by the KIL op code, the PC stays on the KIL instruction
+    void jam();
+
+    /**
+     * Takes a pending NMI, or an IRQ if the line is asserted and interrupts aren't disabled.
+     * Only called at batch boundaries, the interrupt controller ends the batch when a line is
+     * asserted.
+     */
+    void checkInterrupts();
+
+    /**
+     * Pushes the PC and status register (with the B flag clear), disables interrupts and jumps
+     * through the vector.  Takes 7 clock cycles.
+     */
+    void interrupt(CpuAddress vector);
+
+    /**
+     * Called after an instruction clears the interrupt disable flag, so an IRQ that is already
+     * asserted is taken at the end of the instruction
+     */
+    void irqUnmasked();
+
+    /**
+     * Called after an access to a memory mapped device, ends the batch if an interrupt line was
+     * asserted so the interrupt is taken at the end of the instruction
+     */
+    void checkLinesChanged();
+
+    /**
+     * Called between slices of execution.  Sleeps if the emulated clock is ahead of the wall
+     * clock, and keeps track of the drift between the two
+     */
+    void throttleSlice();
+
+    /// Logs how emulated time compared to wall time over the whole run
+    void reportClockDrift();
+
+    /**
+     * Executes instructions with the switch core until the clock count reaches cycleLimit.  At
+     * least one instruction is always executed, so a cycleLimit of 0 single steps.
+     * @return Number of clock cycles executed, or -1 if the emulator halted
+     */
+    template<bool TRACED> int runSwitchCore(uint64_t cycleLimit);
+
+    /**
+     * Executes cached blocks of instructions with the handler functions until the clock count
+     * reaches cycleLimit.  At least one block is always executed.
+     * @return Number of clock cycles executed, or -1 if the emulator halted
+     */
+    template<bool TRACED> int runBlockCache(uint64_t cycleLimit);
+
+    /**
+     * Executes instructions with the handler functions until the clock count reaches
+     * cycleLimit.  At least one instruction is always executed.
+     * @return Number of clock cycles executed, or -1 if the emulator halted
+     */
+    template<bool TRACED> int runHandlerCore(uint64_t cycleLimit);
+
+    /// Fetches and executes one instruction with the handler functions
+    template<bool TRACED> inline int stepHandler();
+
+    /// Calls the hooks and handler for an instruction whose operand bytes have been fetched
+    template<bool TRACED> inline int executeHandler(OpCodeInfo* oci);
+
+    /**
+     * Same as executeHandler for an instruction of a cached block.  The operand was resolved when
+     * the block was decoded, unless it depends on the registers, so preHandlerHook is skipped.
+     */
+    template<bool TRACED> inline int executeCached(CachedInstruction const & ci);
+
+    /**
+     * Runs the selected core until the clock count reaches cycleLimit.  Every core is compiled
+     * twice, the traced version is only used while the trace or the step limit is turned on, or
+     * the batch has to stop after a number of instructions or at an address.
+     * @return Number of clock cycles executed, or -1 if the emulator halted
+     */
+    int runCore(uint64_t cycleLimit);
+
+    /// Executes a single instruction with the selected core (the block cache isn't used)
+    int stepInstruction();
+
+    /// Recomputes theInstrumentedFlag after the trace settings change
+    void updateInstrumentedFlag();
+
+    /// Memory accesses for the switch core, reads / writes RAM and ROM pages directly
+    inline uint8_t coreRead(CpuAddress addr);
+    inline void coreWrite(CpuAddress addr, uint8_t val);
+
+    /**
+     * Sets theOperandAddr (and thePageBoundaryCrossedFlag for the indexed modes) for the
+     * instruction at thePc.  The addressing mode is a template parameter, so each op code in the
+     * switch core gets a version without any addressing mode checks.
+     */
+    template<AddressMode6502 MODE> inline void resolveOperand();
+
+    /// The immediate operand, or the value at theOperandAddr
+    template<AddressMode6502 MODE> inline uint8_t readOperand();
+
+    /// Extra clock cycle when an absolute indexed address crossed a page boundary
+    template<AddressMode6502 MODE> inline int pageCrossCycles();
+
+    /// Branch to theOperandAddr if the condition is true, adding the extra clock cycles
+    inline void branchIf(bool condition);
+
+    // Specialized op code templates for the switch core (auto-generated code below)
+    template<AddressMode6502 MODE> inline void spec_adc();
+    template<AddressMode6502 MODE> inline void spec_ahx();
+    template<AddressMode6502 MODE> inline void spec_alr();
+    template<AddressMode6502 MODE> inline void spec_anc();
+    template<AddressMode6502 MODE> inline void spec_and();
+    template<AddressMode6502 MODE> inline void spec_arr();
+    template<AddressMode6502 MODE> inline void spec_asl();
+    template<AddressMode6502 MODE> inline void spec_axs();
+    template<AddressMode6502 MODE> inline void spec_bcc();
+    template<AddressMode6502 MODE> inline void spec_bcs();
+    template<AddressMode6502 MODE> inline void spec_beq();
+    template<AddressMode6502 MODE> inline void spec_bit();
+    template<AddressMode6502 MODE> inline void spec_bmi();
+    template<AddressMode6502 MODE> inline void spec_bne();
+    template<AddressMode6502 MODE> inline void spec_bpl();
+    template<AddressMode6502 MODE> inline void spec_brk();
+    template<AddressMode6502 MODE> inline void spec_bvc();
+    template<AddressMode6502 MODE> inline void spec_bvs();
+    template<AddressMode6502 MODE> inline void spec_clc();
+    template<AddressMode6502 MODE> inline void spec_cld();
+    template<AddressMode6502 MODE> inline void spec_cli();
+    template<AddressMode6502 MODE> inline void spec_clv();
+    template<AddressMode6502 MODE> inline void spec_cmp();
+    template<AddressMode6502 MODE> inline void spec_cpx();
+    template<AddressMode6502 MODE> inline void spec_cpy();
+    template<AddressMode6502 MODE> inline void spec_dcp();
+    template<AddressMode6502 MODE> inline void spec_dec();
+    template<AddressMode6502 MODE> inline void spec_dex();
+    template<AddressMode6502 MODE> inline void spec_dey();
+    template<AddressMode6502 MODE> inline void spec_eor();
+    template<AddressMode6502 MODE> inline void spec_inc();
+    template<AddressMode6502 MODE> inline void spec_inx();
+    template<AddressMode6502 MODE> inline void spec_iny();
+    template<AddressMode6502 MODE> inline void spec_isc();
+    template<AddressMode6502 MODE> inline void spec_jmp();
+    template<AddressMode6502 MODE> inline void spec_jsr();
+    template<AddressMode6502 MODE> inline void spec_kil();
+    template<AddressMode6502 MODE> inline void spec_las();
+    template<AddressMode6502 MODE> inline void spec_lax();
+    template<AddressMode6502 MODE> inline void spec_lda();
+    template<AddressMode6502 MODE> inline void spec_ldx();
+    template<AddressMode6502 MODE> inline void spec_ldy();
+    template<AddressMode6502 MODE> inline void spec_lsr();
+    template<AddressMode6502 MODE> inline void spec_nop();
+    template<AddressMode6502 MODE> inline void spec_ora();
+    template<AddressMode6502 MODE> inline void spec_pha();
+    template<AddressMode6502 MODE> inline void spec_php();
+    template<AddressMode6502 MODE> inline void spec_pla();
+    template<AddressMode6502 MODE> inline void spec_plp();
+    template<AddressMode6502 MODE> inline void spec_rla();
+    template<AddressMode6502 MODE> inline void spec_rol();
+    template<AddressMode6502 MODE> inline void spec_ror();
+    template<AddressMode6502 MODE> inline void spec_rra();
+    template<AddressMode6502 MODE> inline void spec_rti();
+    template<AddressMode6502 MODE> inline void spec_rts();
+    template<AddressMode6502 MODE> inline void spec_sax();
+    template<AddressMode6502 MODE> inline void spec_sbc();
+    template<AddressMode6502 MODE> inline void spec_sec();
+    template<AddressMode6502 MODE> inline void spec_sed();
+    template<AddressMode6502 MODE> inline void spec_sei();
+    template<AddressMode6502 MODE> inline void spec_shx();
+    template<AddressMode6502 MODE> inline void spec_shy();
+    template<AddressMode6502 MODE> inline void spec_slo();
+    template<AddressMode6502 MODE> inline void spec_sre();
+    template<AddressMode6502 MODE> inline void spec_sta();
+    template<AddressMode6502 MODE> inline void spec_stx();
+    template<AddressMode6502 MODE> inline void spec_sty();
+    template<AddressMode6502 MODE> inline void spec_tas();
+    template<AddressMode6502 MODE> inline void spec_tax();
+    template<AddressMode6502 MODE> inline void spec_tay();
+    template<AddressMode6502 MODE> inline void spec_tsx();
+    template<AddressMode6502 MODE> inline void spec_txa();
+    template<AddressMode6502 MODE> inline void spec_txs();
+    template<AddressMode6502 MODE> inline void spec_tya();
+    template<AddressMode6502 MODE> inline void spec_xaa();
+    // End of auto generated code
+
+    /// Adds the instruction at the PC (and the register state) to the flight recorder
+    inline void recordInstruction(uint8_t opCode)
+    {
+       // Built on the stack and copied in one go, storing the bytes one at a time into the ring
+       // makes the compiler reload the registers after every store (they could alias)
+       FlightRecord r;
+       r.theClock = theNumClocks;
+       r.thePc = thePc;
+       r.theOpCodes[0] = opCode;
+       r.theOpCodes[1] = theOpCode2;
+       r.theOpCodes[2] = theOpCode3;
+       r.theAccum = theAccum;
+       r.theRegX = theRegX;
+       r.theRegY = theRegY;
+       r.theStackPtr = theStackPtr;
+       r.theStatusReg = theStatusReg.theWholeRegister;
+#ifdef LAZY_STATUS_FLAGS
+       r.theLazySignValue = theLazySignValue;
+       r.theLazyZeroValue = theLazyZeroValue;
+#endif
+       *theFlightRecorder.nextRecord() = r;
+    }
+
+    /// Writes the flight recorder to its file when the emulator halts
+    void flightRecorderHalt();
+
+    /// Adds a record for the instruction at the PC (and the register state) to the full trace
+    void traceInstruction(uint8_t opCode);
+
+    /**
+     * Adds an instruction that just executed to the control flow trace (thePc is already the
+     * next instruction)
+     * @param instrPc Address of the instruction
+     */
+    void traceControlFlow(CpuAddress instrPc, uint8_t opCode);
+
+    /**
+     * Adds an interrupt to the control flow trace, called after the interrupt changed the PC
+     * @param handlerPc Address of the interrupt handler
+     */
+    void traceInterrupt(CpuAddress handlerPc);
+
+    /// Creates the trace file the first time an instruction is traced
+    bool openTrace();
+
+    /// Tells the profiler a JSR / BRK / interrupt pushed its return address and went to routine
+    inline void profileCall(CpuAddress routine)
+    {
+       if ( (theProfiler != nullptr) && theProfiler->isRunning() )
+       {
+          theProfiler->enterRoutine(routine, theStackPtr);
+       }
+    }
+
+    /// Tells the profiler an RTS / RTI pulled its return address
+    inline void profileReturn()
+    {
+       if ( (theProfiler != nullptr) && theProfiler->isRunning() )
+       {
+          theProfiler->leaveRoutine(theStackPtr);
+       }
+    }
+
+    /// Halts the emulator once it has executed the configured number of steps
+    void checkStepLimit();
+
+    /**
+     * Ends the batch once its instruction limit is used up, or the PC reaches its stop address or
+     * a debugger breakpoint (only the page flag is loaded for PCs on pages without breakpoints)
+     */
+    inline void checkBatchStop()
+    {
+       if ( theBatchChecksFlag &&
+            ( (--theBatchInstructionsLeft == 0) ||
+              (theBatchStopAtAddrFlag && (thePc == theBatchStopAddr)) ||
+              (theBatchBreakpointsFlag && theBreakpointMap.hasBreakpoint(thePc)) ) )
+       {
+          theBatchStoppedFlag = true;
+          theBatchEndClock = 0;
+       }
+    }
+
     void preHandlerHook(OpCodeInfo* oci);
     int postHandlerHook(OpCodeInfo* oci);
 
+    /// Sets the clock count when a state is restored, without upsetting the throttle or statistics
+    void moveClock(uint64_t numClocks);
+
+    /// Executes an instruction, then any events that are due and interrupts (used by reverseStep)
+    void stepWithEvents();
+
+    /**
+     * Brings the sign and zero flags in theStatusReg up to date.  Must be called before the
+     * whole status register is read (pushed to the stack, traced, or returned to the debugger)
+     */
+    inline void materializeFlags()
+    {
+#ifdef LAZY_STATUS_FLAGS
+       theStatusReg.theSignFlag = theLazySignValue >> 7;
+       theStatusReg.theZeroFlag = (theLazyZeroValue == 0 ? 1 : 0);
+#endif
+    }
+
+    /// Must be called after the whole status register is written (PLP, RTI)
+    inline void loadLazyFlags()
+    {
+#ifdef LAZY_STATUS_FLAGS
+       theLazySignValue = (theStatusReg.theSignFlag ? 0x80 : 0x00);
+       theLazyZeroValue = (theStatusReg.theZeroFlag ? 0x00 : 0x01);
+#endif
+    }
+
     /**
      * Safely tries to read memory.  If their is no valid memory device for the
      * address the emulator tried to execute, then execution is halted
@@ -169,6 +704,9 @@ protected:
      */
     void emulatorWrite(CpuAddress addr, uint8_t val);
 
+    /// Tells the debugger a watched address was accessed, and ends the batch
+    void watchpointHit(CpuAddress addr, bool isWrite);
+
     /// The preHandlerHook will set theOperandVal and theOperandAddr based on the
     /// addressing mode
     uint8_t    theOperandVal;
@@ -181,14 +719,49 @@ protected:
     uint8_t theStackPtr;
     StatusReg theStatusReg;
 
+#ifdef LAZY_STATUS_FLAGS
+    /// The sign flag is bit 7 of this value, the zero flag is set when this value is 0
+    uint8_t theLazySignValue;
+    uint8_t theLazyZeroValue;
+#endif
+
     /// The debugger if one is configured, else it is a nullptr
-    DebugServer* theDebugger;
+    DebuggerHooks* theDebugger;
 
     /// Separate flag for the debugger to make the emulator shut down
     bool theDebuggerShutdownFlag;
 
     bool theRunFlag;
 
+    /// Set by KIL, the CPU stays stuck until the emulator is restarted
+    bool theJammedFlag;
+
+    /**
+     * The cores stop executing once the clock count reaches this value.  halt() and jam() set
+     * it to 0 so the core loops only have to check this, and not the run flag, per instruction
+     */
+    uint64_t theBatchEndClock;
+
+    /**
+     * Set while the batch also has to stop after a number of instructions, at an address or at a
+     * breakpoint, the traced instantiation of the cores calls checkBatchStop after every instruction
+     */
+    bool theBatchChecksFlag;
+
+    /// Instructions the batch may still execute
+    uint64_t theBatchInstructionsLeft;
+
+    bool theBatchStopAtAddrFlag;
+
+    CpuAddress theBatchStopAddr;
+
+    /// A debugger with instruction breakpoints is attached
+    bool theBatchBreakpointsFlag;
+
+    /// The batch ended before its clock count (instruction limit, stop address, breakpoint or a
+    /// watchpoint)
+    bool theBatchStoppedFlag;
+
     std::vector<HaltFunctionCallback> theHaltCallbacksList;
 
     /**
@@ -208,15 +781,87 @@ protected:
      */
     bool thePageBoundaryCrossedFlag;
 
-#ifdef TRACE_EXECUTION
-    /// Used to create disassembler listings for each statement
-    Disassembler6502* theDisAss;
+    CpuCoreType theCoreType;
+
+    /// Predecoded blocks for the BLOCK_CACHE_CORE, nullptr for the other cores
+    BlockCache* theBlockCache;
+
+    /// Emulated clock frequency in Hz
+    uint32_t theClockHz;
+
+    /// When false, the run loop never sleeps
+    bool theThrottleFlag;
 
-    FILE* theTraceFile;
+    /// Wall time and clock count the drift computations are relative to (rebased if we fall
+    /// too far behind to ever catch up)
+    std::chrono::steady_clock::time_point theThrottleStartTime;
+    uint64_t theThrottleStartClocks;
+
+    /// Wall time and clock count when start() was called, for the drift report
+    std::chrono::steady_clock::time_point theRunStartTime;
+    uint64_t theRunStartClocks;
+
+    /// Emulated time minus wall time at the end of the last slice
+    int64_t theClockDriftUs;
+
+    /// Total time the emulator gave up on catching up to the wall clock
+    int64_t theClockLagUs;
+
+    /// When the drift was last reported to the log
+    std::chrono::steady_clock::time_point theLastDriftReportTime;
+
+    /// The last instructions executed, always recording
+    FlightRecorder theFlightRecorder;
+
+    std::string theFlightRecorderFilename;
+
+    std::string theExitSaveStateFilename;
+
+    ExecutionCounters theExecutionCounters;
+
+    BreakpointMap theBreakpointMap;
+
+    std::string theExitCountersFilename;
+
+    /// Shadow call stack and samples of the guest, nullptr until the profiler is needed
+    GuestProfiler* theProfiler;
+
+    std::string theExitProfileFilename;
+
+    /// Recent machine states, nullptr when rewinding is off
+    RewindBuffer* theRewindBuffer;
+
+    /// Frames the display thread wants the CPU to rewind
+    std::atomic<uint32_t> theRewindRequest;
+
+    /// Binary trace records, created when the first instruction is traced (full trace mode)
+    TraceBuffer* theTraceBuffer;
+
+    /// Control flow packets, created when the first instruction is traced (flow trace mode)
+    FlowTraceBuffer* theFlowTraceBuffer;
+
+    TraceMode theTraceMode;
+
+    /// Where the trace is written, empty when tracing is turned off
+    std::string theTraceFilename;
 
     uint64_t theNumberOfStepsToTrace;
     uint64_t theNumberOfStepsExecuted;
-#endif
+
+    uint32_t theTraceMaxStallMs;
+
+    /// Execution trace turned on
+    bool theTraceFlag;
+
+    /// Set when the trace is turned off, the CPU thread flushes the trace at its next batch
+    bool theTraceFlushFlag;
+
+    /// Run the traced instantiation of the cores (trace, step limit or instruction check turned on)
+    bool theInstrumentedFlag;
+
+    InstructionCheckCallback theInstructionCheck;
+
+    void* theInstructionCheckContext;
 
 };
 
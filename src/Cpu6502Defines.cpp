@@ -1,9 +1,7 @@
 #include "Cpu6502Defines.h"
 #include "Decoder6502.h"
 
-OpCodeInfo gOpCodes[0x100];
-
-void constructCpuGlobals()
+OpCodeInfo gOpCodes[0x100] =
 {
 
    CPU_OP( 0x0, 1, BRK, brk, IMPLIED    , 0, false, FLG_INTD | FLG_DECI)
@@ -262,5 +260,4 @@ void constructCpuGlobals()
    CPU_OP(0xfd, 3, SBC, sbc, ABSOLUTE_X , 4, false, FLG_CARY | FLG_OVFL | FLG_ZERO | FLG_NEG )
    CPU_OP(0xfe, 3, INC, inc, ABSOLUTE_X , 7, false, FLG_NONE)
    CPU_OP(0xff, 3, ISC, isc, ABSOLUTE_X , 7, false, FLG_NONE)
-
-}
+};
@@ -41,6 +41,10 @@ enum AddressMode6502
 #define FLG_OVFL 0x40
 #define FLG_NEG  0x80
 
+// Interrupt vectors (BRK shares the IRQ vector)
+#define NMI_VECTOR 0xfffa
+#define IRQ_VECTOR 0xfffe
+
 typedef union StatusRegUnion
 {
    uint8_t theWholeRegister;
@@ -71,18 +75,15 @@ typedef struct OpCodeInfoStruct
    void (Decoder6502::*theOpCodeHandler)(struct OpCodeInfoStruct* info);
 } OpCodeInfo;
 
-void constructCpuGlobals();
-
+/**
+ * Information about every op code, indexed by the op code.  The table is initialized statically
+ * and never modified, so any number of CPUs (on any number of threads) can share it.
+ */
 extern OpCodeInfo gOpCodes[0x100];
 
 #define CPU_OP(opCode, numBytes, disMnemonic, mnemonic, addrMode, cycles, extraCycles, flags) \
-   gOpCodes[opCode].theOpCode = opCode; \
-   gOpCodes[opCode].theNumBytes = numBytes; \
-   gOpCodes[opCode].theStatusFlags = flags; \
-   gOpCodes[opCode].theDelayCycles = cycles; \
-   gOpCodes[opCode].theMnemonicDisass = #disMnemonic; \
-   gOpCodes[opCode].theAddrMode = addrMode; \
-   gOpCodes[opCode].theOpCodeHandler = &Decoder6502::handler_##mnemonic;
+   { opCode, numBytes, flags, cycles, #disMnemonic, extraCycles, addrMode, \
+     &Decoder6502::handler_##mnemonic },
 
 
 
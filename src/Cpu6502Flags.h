@@ -0,0 +1,42 @@
+#ifndef CPU6502FLAGS_H
+#define CPU6502FLAGS_H
+
+#include "EmulatorConfig.h"
+
+/**
+ * Status register helper macros shared by the handler functions (Cpu6502.cpp) and the switch
+ * core (Cpu6502SwitchCore.cpp).  Only include this from Cpu6502 member implementations.
+ *
+ * With LAZY_STATUS_FLAGS the sign and zero flags aren't written to theStatusReg when an
+ * instruction computes them.  The value they come from is saved instead, and the flags are only
+ * computed when a branch reads them, or when materializeFlags() is called before the whole
+ * status register is used.
+ */
+
+#ifdef LAZY_STATUS_FLAGS
+
+   #define UPDATE_SIGN_FLAG(regValue)  theLazySignValue = (regValue)
+   #define UPDATE_ZERO_FLAG(regValue)  theLazyZeroValue = (regValue)
+
+   #define SET_SIGN_FLAG(flag)         theLazySignValue = ( (flag) ? 0x80 : 0x00)
+   #define SET_ZERO_FLAG(flag)         theLazyZeroValue = ( (flag) ? 0x00 : 0x01)
+
+   #define SIGN_FLAG()                 (theLazySignValue >> 7)
+   #define ZERO_FLAG()                 (theLazyZeroValue == 0 ? 1 : 0)
+
+#else
+
+   #define UPDATE_SIGN_FLAG(regValue)  theStatusReg.theSignFlag = ( (regValue) & 0x80 ? 1 : 0)
+   #define UPDATE_ZERO_FLAG(regValue)  theStatusReg.theZeroFlag = ( (regValue) == 0 ? 1 : 0)
+
+   #define SET_SIGN_FLAG(flag)         theStatusReg.theSignFlag = ( (flag) ? 1 : 0)
+   #define SET_ZERO_FLAG(flag)         theStatusReg.theZeroFlag = ( (flag) ? 1 : 0)
+
+   #define SIGN_FLAG()                 theStatusReg.theSignFlag
+   #define ZERO_FLAG()                 theStatusReg.theZeroFlag
+
+#endif
+
+#define UPDATE_SZ_FLAGS(regValue)   UPDATE_SIGN_FLAG(regValue); UPDATE_ZERO_FLAG(regValue)
+
+#endif // CPU6502FLAGS_H
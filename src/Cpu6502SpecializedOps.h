@@ -0,0 +1,264 @@
+/**
+ * Op code table for the switch core, each line expands into a case of the dispatch switch
+ *
+ * SPECIALIZED_OP(opCode, mnemonic, addrMode, numBytes, cycles)
+ *
+ * Generated by utils/OpCodeCodeGeneration/generateSpecializedOps.py, don't edit by hand
+ */
+
+SPECIALIZED_OP(0x00, brk, IMPLIED    , 1, 0)
+SPECIALIZED_OP(0x01, ora, INDIRECT_X , 2, 6)
+SPECIALIZED_OP(0x02, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0x03, slo, INDIRECT_X , 2, 8)
+SPECIALIZED_OP(0x04, nop, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x05, ora, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x06, asl, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0x07, slo, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0x08, php, IMPLIED    , 1, 3)
+SPECIALIZED_OP(0x09, ora, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x0a, asl, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x0b, anc, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x0c, nop, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0x0d, ora, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0x0e, asl, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0x0f, slo, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0x10, bpl, RELATIVE   , 2, 3)
+SPECIALIZED_OP(0x11, ora, INDIRECT_Y , 2, 5)
+SPECIALIZED_OP(0x12, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0x13, slo, INDIRECT_Y , 2, 8)
+SPECIALIZED_OP(0x14, nop, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0x15, ora, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0x16, asl, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0x17, slo, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0x18, clc, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x19, ora, ABSOLUTE_Y , 3, 4)
+SPECIALIZED_OP(0x1a, nop, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x1b, slo, ABSOLUTE_Y , 3, 7)
+SPECIALIZED_OP(0x1c, nop, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0x1d, ora, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0x1e, asl, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0x1f, slo, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0x20, jsr, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0x21, and, INDIRECT_X , 2, 6)
+SPECIALIZED_OP(0x22, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0x23, rla, INDIRECT_X , 2, 8)
+SPECIALIZED_OP(0x24, bit, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x25, and, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x26, rol, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0x27, rla, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0x28, plp, IMPLIED    , 1, 4)
+SPECIALIZED_OP(0x29, and, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x2a, rol, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x2b, anc, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x2c, bit, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0x2d, and, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0x2e, rol, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0x2f, rla, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0x30, bmi, RELATIVE   , 2, 2)
+SPECIALIZED_OP(0x31, and, INDIRECT_Y , 2, 5)
+SPECIALIZED_OP(0x32, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0x33, rla, INDIRECT_Y , 2, 8)
+SPECIALIZED_OP(0x34, nop, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0x35, and, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0x36, rol, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0x37, rla, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0x38, sec, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x39, and, ABSOLUTE_Y , 3, 4)
+SPECIALIZED_OP(0x3a, nop, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x3b, rla, ABSOLUTE_Y , 3, 7)
+SPECIALIZED_OP(0x3c, nop, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0x3d, and, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0x3e, rol, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0x3f, rla, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0x40, rti, IMPLIED    , 1, 6)
+SPECIALIZED_OP(0x41, eor, INDIRECT_X , 2, 6)
+SPECIALIZED_OP(0x42, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0x43, sre, INDIRECT_X , 2, 8)
+SPECIALIZED_OP(0x44, nop, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x45, eor, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x46, lsr, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0x47, sre, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0x48, pha, IMPLIED    , 1, 3)
+SPECIALIZED_OP(0x49, eor, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x4a, lsr, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x4b, alr, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x4c, jmp, ABSOLUTE   , 3, 3)
+SPECIALIZED_OP(0x4d, eor, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0x4e, lsr, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0x4f, sre, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0x50, bvc, RELATIVE   , 2, 3)
+SPECIALIZED_OP(0x51, eor, INDIRECT_Y , 2, 5)
+SPECIALIZED_OP(0x52, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0x53, sre, INDIRECT_Y , 2, 8)
+SPECIALIZED_OP(0x54, nop, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0x55, eor, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0x56, lsr, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0x57, sre, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0x58, cli, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x59, eor, ABSOLUTE_Y , 3, 4)
+SPECIALIZED_OP(0x5a, nop, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x5b, sre, ABSOLUTE_Y , 3, 7)
+SPECIALIZED_OP(0x5c, nop, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0x5d, eor, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0x5e, lsr, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0x5f, sre, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0x60, rts, IMPLIED    , 1, 6)
+SPECIALIZED_OP(0x61, adc, INDIRECT_X , 2, 6)
+SPECIALIZED_OP(0x62, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0x63, rra, INDIRECT_X , 2, 8)
+SPECIALIZED_OP(0x64, nop, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x65, adc, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x66, ror, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0x67, rra, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0x68, pla, IMPLIED    , 1, 4)
+SPECIALIZED_OP(0x69, adc, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x6a, ror, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x6b, arr, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x6c, jmp, INDIRECT   , 3, 5)
+SPECIALIZED_OP(0x6d, adc, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0x6e, ror, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0x6f, rra, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0x70, bvs, RELATIVE   , 2, 2)
+SPECIALIZED_OP(0x71, adc, INDIRECT_Y , 2, 5)
+SPECIALIZED_OP(0x72, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0x73, rra, INDIRECT_Y , 2, 8)
+SPECIALIZED_OP(0x74, nop, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0x75, adc, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0x76, ror, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0x77, rra, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0x78, sei, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x79, adc, ABSOLUTE_Y , 3, 4)
+SPECIALIZED_OP(0x7a, nop, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x7b, rra, ABSOLUTE_Y , 3, 7)
+SPECIALIZED_OP(0x7c, nop, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0x7d, adc, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0x7e, ror, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0x7f, rra, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0x80, nop, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x81, sta, INDIRECT_X , 2, 6)
+SPECIALIZED_OP(0x82, nop, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x83, sax, INDIRECT_X , 2, 6)
+SPECIALIZED_OP(0x84, sty, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x85, sta, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x86, stx, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x87, sax, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0x88, dey, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x89, nop, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x8a, txa, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x8b, xaa, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0x8c, sty, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0x8d, sta, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0x8e, stx, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0x8f, sax, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0x90, bcc, RELATIVE   , 2, 3)
+SPECIALIZED_OP(0x91, sta, INDIRECT_Y , 2, 6)
+SPECIALIZED_OP(0x92, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0x93, ahx, INDIRECT_Y , 2, 6)
+SPECIALIZED_OP(0x94, sty, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0x95, sta, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0x96, stx, ZERO_PAGE_Y, 2, 4)
+SPECIALIZED_OP(0x97, sax, ZERO_PAGE_Y, 2, 4)
+SPECIALIZED_OP(0x98, tya, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x99, sta, ABSOLUTE_Y , 3, 5)
+SPECIALIZED_OP(0x9a, txs, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0x9b, tas, ABSOLUTE_Y , 3, 5)
+SPECIALIZED_OP(0x9c, shy, ABSOLUTE_X , 3, 5)
+SPECIALIZED_OP(0x9d, sta, ABSOLUTE_X , 3, 5)
+SPECIALIZED_OP(0x9e, shx, ABSOLUTE_Y , 3, 5)
+SPECIALIZED_OP(0x9f, ahx, ABSOLUTE_Y , 3, 5)
+SPECIALIZED_OP(0xa0, ldy, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xa1, lda, INDIRECT_X , 2, 6)
+SPECIALIZED_OP(0xa2, ldx, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xa3, lax, INDIRECT_X , 2, 6)
+SPECIALIZED_OP(0xa4, ldy, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0xa5, lda, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0xa6, ldx, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0xa7, lax, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0xa8, tay, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xa9, lda, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xaa, tax, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xab, lax, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xac, ldy, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0xad, lda, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0xae, ldx, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0xaf, lax, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0xb0, bcs, RELATIVE   , 2, 2)
+SPECIALIZED_OP(0xb1, lda, INDIRECT_Y , 2, 5)
+SPECIALIZED_OP(0xb2, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0xb3, lax, INDIRECT_Y , 2, 5)
+SPECIALIZED_OP(0xb4, ldy, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0xb5, lda, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0xb6, ldx, ZERO_PAGE_Y, 2, 4)
+SPECIALIZED_OP(0xb7, lax, ZERO_PAGE_Y, 2, 4)
+SPECIALIZED_OP(0xb8, clv, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xb9, lda, ABSOLUTE_Y , 3, 4)
+SPECIALIZED_OP(0xba, tsx, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xbb, las, ABSOLUTE_Y , 3, 4)
+SPECIALIZED_OP(0xbc, ldy, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0xbd, lda, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0xbe, ldx, ABSOLUTE_Y , 3, 4)
+SPECIALIZED_OP(0xbf, lax, ABSOLUTE_Y , 3, 4)
+SPECIALIZED_OP(0xc0, cpy, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xc1, cmp, INDIRECT_X , 2, 6)
+SPECIALIZED_OP(0xc2, nop, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xc3, dcp, INDIRECT_X , 2, 8)
+SPECIALIZED_OP(0xc4, cpy, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0xc5, cmp, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0xc6, dec, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0xc7, dcp, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0xc8, iny, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xc9, cmp, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xca, dex, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xcb, axs, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xcc, cpy, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0xcd, cmp, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0xce, dec, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0xcf, dcp, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0xd0, bne, RELATIVE   , 2, 3)
+SPECIALIZED_OP(0xd1, cmp, INDIRECT_Y , 2, 5)
+SPECIALIZED_OP(0xd2, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0xd3, dcp, INDIRECT_Y , 2, 8)
+SPECIALIZED_OP(0xd4, nop, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0xd5, cmp, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0xd6, dec, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0xd7, dcp, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0xd8, cld, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xd9, cmp, ABSOLUTE_Y , 3, 4)
+SPECIALIZED_OP(0xda, nop, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xdb, dcp, ABSOLUTE_Y , 3, 7)
+SPECIALIZED_OP(0xdc, nop, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0xdd, cmp, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0xde, dec, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0xdf, dcp, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0xe0, cpx, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xe1, sbc, INDIRECT_X , 2, 6)
+SPECIALIZED_OP(0xe2, nop, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xe3, isc, INDIRECT_X , 2, 8)
+SPECIALIZED_OP(0xe4, cpx, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0xe5, sbc, ZERO_PAGE  , 2, 3)
+SPECIALIZED_OP(0xe6, inc, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0xe7, isc, ZERO_PAGE  , 2, 5)
+SPECIALIZED_OP(0xe8, inx, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xe9, sbc, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xea, nop, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xeb, sbc, IMMEDIATE  , 2, 2)
+SPECIALIZED_OP(0xec, cpx, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0xed, sbc, ABSOLUTE   , 3, 4)
+SPECIALIZED_OP(0xee, inc, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0xef, isc, ABSOLUTE   , 3, 6)
+SPECIALIZED_OP(0xf0, beq, RELATIVE   , 2, 2)
+SPECIALIZED_OP(0xf1, sbc, INDIRECT_Y , 2, 5)
+SPECIALIZED_OP(0xf2, kil, IMPLIED    , 1, 1)
+SPECIALIZED_OP(0xf3, isc, INDIRECT_Y , 2, 8)
+SPECIALIZED_OP(0xf4, nop, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0xf5, sbc, ZERO_PAGE_X, 2, 4)
+SPECIALIZED_OP(0xf6, inc, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0xf7, isc, ZERO_PAGE_X, 2, 6)
+SPECIALIZED_OP(0xf8, sed, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xf9, sbc, ABSOLUTE_Y , 3, 4)
+SPECIALIZED_OP(0xfa, nop, IMPLIED    , 1, 2)
+SPECIALIZED_OP(0xfb, isc, ABSOLUTE_Y , 3, 7)
+SPECIALIZED_OP(0xfc, nop, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0xfd, sbc, ABSOLUTE_X , 3, 4)
+SPECIALIZED_OP(0xfe, inc, ABSOLUTE_X , 3, 7)
+SPECIALIZED_OP(0xff, isc, ABSOLUTE_X , 3, 7)
@@ -0,0 +1,560 @@
+#include "Cpu6502.h"
+#include "Cpu6502Flags.h"
+#include "EmulatorConfig.h"
+#include "Logger.h"
+#include "MemoryController.h"
+#include "MemoryDev.h"
+
+/**
+ * The switch core is an alternative to dispatching through the gOpCodes handler table.  Every op
+ * code has its own case in one big switch statement.  The cases come from the generated table in
+ * Cpu6502SpecializedOps.h, and each one calls the addressing mode and operation templates
+ * instantiated for the op code's addressing mode, so all of the addressing mode checks the
+ * handler functions do at runtime are resolved by the compiler.
+ *
+ * The behavior (including the clock cycle counts) needs to stay identical to the handler
+ * functions in Cpu6502.cpp so the two cores can be validated against each other with the
+ * execution trace.
+ */
+
+/***** HELPER MACROS *****/
+#define PUSH(value)  coreWrite(0x0100 + theStackPtr, (value)); theStackPtr--
+#define PULL()       coreRead(0x0100 + (++theStackPtr))
+
+/***** OPERATIONS *****/
+
+#define OP_ORA(value)  theAccum |= (value); UPDATE_SZ_FLAGS(theAccum)
+#define OP_AND(value)  theAccum &= (value); UPDATE_SZ_FLAGS(theAccum)
+#define OP_EOR(value)  theAccum ^= (value); UPDATE_SZ_FLAGS(theAccum)
+
+#define OP_ADC(value)  { uint8_t operand = (value); \
+                         uint16_t sum = theAccum + operand + theStatusReg.theCarryFlag; \
+                         theStatusReg.theOverflowFlag = ( (~(theAccum ^ operand) & (theAccum ^ sum) & 0x80) ? 1 : 0); \
+                         theAccum = sum & 0xff; \
+                         UPDATE_SZ_FLAGS(theAccum); \
+                         theStatusReg.theCarryFlag = (sum & 0xff00 ? 1 : 0); }
+
+#define OP_SBC(value)  OP_ADC(0xff ^ (value))
+
+#define OP_CMP(regValue, value) { uint8_t operand = (value); \
+                                  uint8_t diff = (regValue) - operand; \
+                                  theStatusReg.theCarryFlag = ( (regValue) >= operand ? 1 : 0); \
+                                  UPDATE_SZ_FLAGS(diff); }
+
+// Shifts and rotates operate on a register or on val inside of a RMW
+#define OP_ASL(reg)    theStatusReg.theCarryFlag = ( (reg) & 0x80 ? 1 : 0); \
+                       (reg) <<= 1; \
+                       UPDATE_SZ_FLAGS(reg)
+
+#define OP_LSR(reg)    theStatusReg.theCarryFlag = (reg) & 0x01; \
+                       (reg) >>= 1; \
+                       UPDATE_SZ_FLAGS(reg)
+
+#define OP_ROL(reg)    { uint8_t oldCarry = theStatusReg.theCarryFlag; \
+                         theStatusReg.theCarryFlag = ( (reg) & 0x80 ? 1 : 0); \
+                         (reg) = ((reg) << 1) | oldCarry; \
+                         UPDATE_SZ_FLAGS(reg); }
+
+#define OP_ROR(reg)    { uint8_t oldCarry = theStatusReg.theCarryFlag; \
+                         theStatusReg.theCarryFlag = (reg) & 0x01; \
+                         (reg) = ((reg) >> 1) | (oldCarry << 7); \
+                         UPDATE_SZ_FLAGS(reg); }
+
+#define OP_INC(reg)    (reg)++; UPDATE_SZ_FLAGS(reg)
+#define OP_DEC(reg)    (reg)--; UPDATE_SZ_FLAGS(reg)
+
+/// Read-modify-write of the byte at theOperandAddr, operation modifies val
+#define RMW(operation) { uint8_t val = coreRead(theOperandAddr); \
+                         operation; \
+                         coreWrite(theOperandAddr, val); }
+
+/// Shift / rotate of the accumulator for IMPLIED, or of the operand in memory
+#define SHIFT_OP(operation) if (MODE == IMPLIED) \
+                            { \
+                               operation(theAccum); \
+                            } \
+                            else \
+                            { \
+                               RMW(operation(val)); \
+                            }
+
+#ifdef UNOFFICIAL_NES_OPCODE_SUPPORT
+
+   #define OP_SLO()  { uint8_t val = coreRead(theOperandAddr); \
+                       OP_ASL(val); \
+                       coreWrite(theOperandAddr, val); \
+                       OP_ORA(val); }
+
+   #define OP_RLA()  { uint8_t val = coreRead(theOperandAddr); \
+                       OP_ROL(val); \
+                       coreWrite(theOperandAddr, val); \
+                       OP_AND(val); }
+
+   #define OP_SRE()  { uint8_t val = coreRead(theOperandAddr); \
+                       OP_LSR(val); \
+                       coreWrite(theOperandAddr, val); \
+                       OP_EOR(val); }
+
+   // Same as handler_rra, this one adds a clock cycle for crossing a page
+   #define OP_RRA()  { uint8_t val = coreRead(theOperandAddr); \
+                       OP_ROR(val); \
+                       coreWrite(theOperandAddr, val); \
+                       OP_ADC(val); \
+                       theNumClocks += pageCrossCycles<MODE>(); }
+
+   #define OP_DCP()  { uint8_t val = coreRead(theOperandAddr) - 1; \
+                       coreWrite(theOperandAddr, val); \
+                       OP_CMP(theAccum, val); }
+
+   #define OP_ISC()  { uint8_t val = coreRead(theOperandAddr) + 1; \
+                       coreWrite(theOperandAddr, val); \
+                       OP_SBC(val); }
+
+   #define OP_SAX()  coreWrite(theOperandAddr, theRegX & theAccum)
+
+   // handler_lax always reads from theOperandAddr, even for the immediate op code (which will
+   // read the address left behind by the previous instruction)
+   #define OP_LAX()  theRegX = coreRead(theOperandAddr); \
+                     theAccum = theRegX; \
+                     UPDATE_SZ_FLAGS(theRegX); \
+                     theNumClocks += pageCrossCycles<MODE>()
+
+#else
+
+   // The handlers are empty, so there is no extra cycle for page crossing either
+   #define OP_SLO()
+   #define OP_RLA()
+   #define OP_SRE()
+   #define OP_RRA()
+   #define OP_DCP()
+   #define OP_ISC()
+   #define OP_SAX()
+   #define OP_LAX()
+
+#endif
+
+/***** MEMORY ACCESS *****/
+
+inline uint8_t Cpu6502::coreRead(CpuAddress addr)
+{
+   uint8_t* hostPage = theMemoryController->getHostReadPage(addr);
+   if ( (hostPage != nullptr) && !theBreakpointMap.isPageWatched(addr) )
+   {
+      return hostPage[addr & 0xff];
+   }
+
+   return emulatorRead(addr);
+}
+
+inline void Cpu6502::coreWrite(CpuAddress addr, uint8_t val)
+{
+   uint8_t* hostPage = theMemoryController->getHostWritePage(addr);
+   if ( (hostPage != nullptr) && !theBreakpointMap.isPageWatched(addr) )
+   {
+      hostPage[addr & 0xff] = val;
+      return;
+   }
+
+   emulatorWrite(addr, val);
+}
+
+/***** ADDRESSING MODES *****/
+
+// MODE is a compile time constant, so only one case of the switch is left in each instantiation
+template<AddressMode6502 MODE>
+inline void Cpu6502::resolveOperand()
+{
+   switch(MODE)
+   {
+   case IMPLIED:
+   case IMMEDIATE:
+      // theOperandAddr is left alone
+      break;
+
+   case ZERO_PAGE:
+      theOperandAddr = theOpCode2;
+      break;
+
+   case ZERO_PAGE_X:
+      theOperandAddr = (uint8_t) (theOpCode2 + theRegX);
+      break;
+
+   case ZERO_PAGE_Y:
+      theOperandAddr = (uint8_t) (theOpCode2 + theRegY);
+      break;
+
+   case ABSOLUTE:
+   case INDIRECT:
+      theOperandAddr = theOpCode2 + (theOpCode3 << 8);
+      break;
+
+   case ABSOLUTE_X:
+   case ABSOLUTE_Y:
+      {
+         CpuAddress baseAddr = theOpCode2 + (theOpCode3 << 8);
+         theOperandAddr = baseAddr + (MODE == ABSOLUTE_X ? theRegX : theRegY);
+         thePageBoundaryCrossedFlag = ( (baseAddr & 0xff00) != (theOperandAddr & 0xff00) );
+         break;
+      }
+
+   case RELATIVE:
+      // Page crossing is computed from the address of the branch instruction itself, same as
+      // the preHandlerHook does
+      theOperandAddr = thePc + (int8_t) theOpCode2;
+      thePageBoundaryCrossedFlag = ( (thePc & 0xff00) != (theOperandAddr & 0xff00) );
+      break;
+
+   case INDIRECT_X:
+      {
+         uint8_t zpAddr = theOpCode2 + theRegX;
+         theOperandAddr = coreRead((uint8_t) (zpAddr + 1)) << 8;
+         theOperandAddr += coreRead(zpAddr);
+         break;
+      }
+
+   case INDIRECT_Y:
+      theOperandAddr = coreRead((uint8_t) (theOpCode2 + 1)) << 8;
+      theOperandAddr += coreRead(theOpCode2);
+      theOperandAddr += theRegY;
+      break;
+   }
+}
+
+template<AddressMode6502 MODE>
+inline uint8_t Cpu6502::readOperand()
+{
+   if (MODE == IMMEDIATE)
+   {
+      return theOpCode2;
+   }
+
+   return coreRead(theOperandAddr);
+}
+
+// The handlers never count a page crossing for INDIRECT_Y
+template<AddressMode6502 MODE>
+inline int Cpu6502::pageCrossCycles()
+{
+   if ( (MODE == ABSOLUTE_X) || (MODE == ABSOLUTE_Y) )
+   {
+      return (thePageBoundaryCrossedFlag ? 1 : 0);
+   }
+
+   return 0;
+}
+
+inline void Cpu6502::branchIf(bool condition)
+{
+   if (condition)
+   {
+      thePc = theOperandAddr + 2;
+      theNumClocks += (thePageBoundaryCrossedFlag ? 2 : 1);
+   }
+}
+
+/***** SPECIALIZED OP CODES *****/
+// thePc has already been advanced past the instruction when these are called
+
+/// Op codes the handler functions don't implement
+#define EMPTY_SPECIALIZED_OP(mnemonic) \
+   template<AddressMode6502 MODE> \
+   inline void Cpu6502::spec_##mnemonic() { }
+
+/// Loads and logical operations that add a cycle for crossing a page
+#define LOAD_SPECIALIZED_OP(mnemonic, operation) \
+   template<AddressMode6502 MODE> \
+   inline void Cpu6502::spec_##mnemonic() \
+   { \
+      operation; \
+      theNumClocks += pageCrossCycles<MODE>(); \
+   }
+
+/// Op codes that don't depend on the addressing mode
+#define SIMPLE_SPECIALIZED_OP(mnemonic, operation) \
+   template<AddressMode6502 MODE> \
+   inline void Cpu6502::spec_##mnemonic() \
+   { \
+      operation; \
+   }
+
+EMPTY_SPECIALIZED_OP(anc)
+EMPTY_SPECIALIZED_OP(arr)
+EMPTY_SPECIALIZED_OP(alr)
+EMPTY_SPECIALIZED_OP(ahx)
+EMPTY_SPECIALIZED_OP(tas)
+EMPTY_SPECIALIZED_OP(xaa)
+EMPTY_SPECIALIZED_OP(axs)
+EMPTY_SPECIALIZED_OP(shx)
+EMPTY_SPECIALIZED_OP(shy)
+EMPTY_SPECIALIZED_OP(las)
+EMPTY_SPECIALIZED_OP(nop)
+
+LOAD_SPECIALIZED_OP(ora, OP_ORA(readOperand<MODE>()))
+LOAD_SPECIALIZED_OP(and, OP_AND(readOperand<MODE>()))
+LOAD_SPECIALIZED_OP(eor, OP_EOR(readOperand<MODE>()))
+LOAD_SPECIALIZED_OP(adc, OP_ADC(readOperand<MODE>()))
+LOAD_SPECIALIZED_OP(sbc, OP_SBC(readOperand<MODE>()))
+LOAD_SPECIALIZED_OP(lda, theAccum = readOperand<MODE>(); UPDATE_SZ_FLAGS(theAccum))
+LOAD_SPECIALIZED_OP(ldx, theRegX = readOperand<MODE>(); UPDATE_SZ_FLAGS(theRegX))
+LOAD_SPECIALIZED_OP(ldy, theRegY = readOperand<MODE>(); UPDATE_SZ_FLAGS(theRegY))
+
+// handler_cmp always adds a cycle for the indexed modes, crossing a page or not
+template<AddressMode6502 MODE>
+inline void Cpu6502::spec_cmp()
+{
+   OP_CMP(theAccum, readOperand<MODE>());
+
+   if ( (MODE == ABSOLUTE_X) || (MODE == ABSOLUTE_Y) || (MODE == INDIRECT_Y) )
+   {
+      theNumClocks += 1;
+   }
+}
+
+SIMPLE_SPECIALIZED_OP(cpx, OP_CMP(theRegX, readOperand<MODE>()))
+SIMPLE_SPECIALIZED_OP(cpy, OP_CMP(theRegY, readOperand<MODE>()))
+
+template<AddressMode6502 MODE>
+inline void Cpu6502::spec_bit()
+{
+   uint8_t operand = readOperand<MODE>();
+   UPDATE_ZERO_FLAG(operand & theAccum);
+   theStatusReg.theOverflowFlag = (operand & 0x40 ? 1 : 0);
+   UPDATE_SIGN_FLAG(operand);
+}
+
+SIMPLE_SPECIALIZED_OP(sta, coreWrite(theOperandAddr, theAccum))
+SIMPLE_SPECIALIZED_OP(stx, coreWrite(theOperandAddr, theRegX))
+SIMPLE_SPECIALIZED_OP(sty, coreWrite(theOperandAddr, theRegY))
+
+SIMPLE_SPECIALIZED_OP(asl, SHIFT_OP(OP_ASL))
+SIMPLE_SPECIALIZED_OP(lsr, SHIFT_OP(OP_LSR))
+SIMPLE_SPECIALIZED_OP(rol, SHIFT_OP(OP_ROL))
+SIMPLE_SPECIALIZED_OP(ror, SHIFT_OP(OP_ROR))
+SIMPLE_SPECIALIZED_OP(inc, RMW(OP_INC(val)))
+SIMPLE_SPECIALIZED_OP(dec, RMW(OP_DEC(val)))
+
+SIMPLE_SPECIALIZED_OP(tax, theRegX = theAccum; UPDATE_SZ_FLAGS(theRegX))
+SIMPLE_SPECIALIZED_OP(txa, theAccum = theRegX; UPDATE_SZ_FLAGS(theAccum))
+SIMPLE_SPECIALIZED_OP(tay, theRegY = theAccum; UPDATE_SZ_FLAGS(theRegY))
+SIMPLE_SPECIALIZED_OP(tya, theAccum = theRegY; UPDATE_SZ_FLAGS(theAccum))
+SIMPLE_SPECIALIZED_OP(tsx, theRegX = theStackPtr; UPDATE_SZ_FLAGS(theRegX))
+SIMPLE_SPECIALIZED_OP(txs, theStackPtr = theRegX)
+SIMPLE_SPECIALIZED_OP(inx, OP_INC(theRegX))
+SIMPLE_SPECIALIZED_OP(iny, OP_INC(theRegY))
+SIMPLE_SPECIALIZED_OP(dex, OP_DEC(theRegX))
+SIMPLE_SPECIALIZED_OP(dey, OP_DEC(theRegY))
+
+SIMPLE_SPECIALIZED_OP(clc, theStatusReg.theCarryFlag = 0)
+SIMPLE_SPECIALIZED_OP(sec, theStatusReg.theCarryFlag = 1)
+SIMPLE_SPECIALIZED_OP(cli, theStatusReg.theInterruptFlag = 0; irqUnmasked())
+SIMPLE_SPECIALIZED_OP(sei, theStatusReg.theInterruptFlag = 1)
+SIMPLE_SPECIALIZED_OP(cld, theStatusReg.theBCDFlag = 0)
+SIMPLE_SPECIALIZED_OP(sed, theStatusReg.theBCDFlag = 1)
+SIMPLE_SPECIALIZED_OP(clv, theStatusReg.theOverflowFlag = 0)
+
+SIMPLE_SPECIALIZED_OP(bpl, branchIf(SIGN_FLAG() == 0))
+SIMPLE_SPECIALIZED_OP(bmi, branchIf(SIGN_FLAG() == 1))
+SIMPLE_SPECIALIZED_OP(bvc, branchIf(theStatusReg.theOverflowFlag == 0))
+SIMPLE_SPECIALIZED_OP(bvs, branchIf(theStatusReg.theOverflowFlag == 1))
+SIMPLE_SPECIALIZED_OP(bcc, branchIf(theStatusReg.theCarryFlag == 0))
+SIMPLE_SPECIALIZED_OP(bcs, branchIf(theStatusReg.theCarryFlag == 1))
+SIMPLE_SPECIALIZED_OP(bne, branchIf(ZERO_FLAG() == 0))
+SIMPLE_SPECIALIZED_OP(beq, branchIf(ZERO_FLAG() == 1))
+
+SIMPLE_SPECIALIZED_OP(pha, PUSH(theAccum))
+SIMPLE_SPECIALIZED_OP(pla, theAccum = PULL(); UPDATE_SZ_FLAGS(theAccum))
+
+// Bits 4 and 5 are set when pushed, and ignored when pulled
+SIMPLE_SPECIALIZED_OP(php, materializeFlags(); PUSH(theStatusReg.theWholeRegister | 0x30))
+
+template<AddressMode6502 MODE>
+inline void Cpu6502::spec_plp()
+{
+   uint8_t ignoredBits = theStatusReg.theWholeRegister & 0x30;
+   theStatusReg.theWholeRegister = (PULL() & 0xCF) | ignoredBits;
+   loadLazyFlags();
+
+   if (theStatusReg.theInterruptFlag == 0)
+   {
+      irqUnmasked();
+   }
+}
+
+template<AddressMode6502 MODE>
+inline void Cpu6502::spec_jmp()
+{
+   if (MODE == INDIRECT)
+   {
+      // The upper byte of the address can't cross a page boundary (it will wrap to 0x00 on same
+      // page)
+      uint8_t lowerAddress = coreRead(theOperandAddr);
+      CpuAddress upperByteAddress = (theOperandAddr & 0xff00) + ( (theOperandAddr + 1) & 0x00ff);
+      thePc = (coreRead(upperByteAddress) << 8) + lowerAddress;
+   }
+   else
+   {
+      thePc = theOperandAddr;
+   }
+}
+
+// The return address pushed is the last byte of the JSR instruction
+template<AddressMode6502 MODE>
+inline void Cpu6502::spec_jsr()
+{
+   CpuAddress returnAddr = thePc - 1;
+   PUSH(returnAddr >> 8);
+   PUSH(returnAddr & 0xff);
+   thePc = theOperandAddr;
+   profileCall(thePc);
+}
+
+template<AddressMode6502 MODE>
+inline void Cpu6502::spec_rts()
+{
+   uint8_t lowerAddress = PULL();
+   uint8_t upperAddress = PULL();
+   thePc = (upperAddress << 8) + lowerAddress + 1;
+   profileReturn();
+}
+
+template<AddressMode6502 MODE>
+inline void Cpu6502::spec_rti()
+{
+   uint8_t unaffectedBits = theStatusReg.theWholeRegister & 0x30;
+   theStatusReg.theWholeRegister = PULL() | unaffectedBits;
+   loadLazyFlags();
+
+   if (theStatusReg.theInterruptFlag == 0)
+   {
+      irqUnmasked();
+   }
+
+   uint8_t lowerAddress = PULL();
+   uint8_t upperAddress = PULL();
+   thePc = (upperAddress << 8) + lowerAddress;
+   profileReturn();
+}
+
+// Same as handler_brk, including pushing the address of the BRK itself and the PC that ends up 1
+// byte past the vector
+template<AddressMode6502 MODE>
+inline void Cpu6502::spec_brk()
+{
+   CpuAddress brkAddr = thePc - 1;
+   PUSH(brkAddr >> 8);
+   PUSH(brkAddr & 0xff);
+   materializeFlags();
+   coreWrite(0x0100 + theStackPtr, theStatusReg.theWholeRegister | 0x30);
+   theStatusReg.theBreakpointFlag = 1;
+   thePc = (coreRead(0xffff) << 8) + coreRead(0xfffe) + 1;
+   profileCall(thePc - 1);
+}
+
+// The PC stays stuck on the KIL
+SIMPLE_SPECIALIZED_OP(kil, thePc--; jam())
+
+SIMPLE_SPECIALIZED_OP(slo, OP_SLO())
+SIMPLE_SPECIALIZED_OP(rla, OP_RLA())
+SIMPLE_SPECIALIZED_OP(sre, OP_SRE())
+SIMPLE_SPECIALIZED_OP(rra, OP_RRA())
+SIMPLE_SPECIALIZED_OP(dcp, OP_DCP())
+SIMPLE_SPECIALIZED_OP(isc, OP_ISC())
+SIMPLE_SPECIALIZED_OP(sax, OP_SAX())
+SIMPLE_SPECIALIZED_OP(lax, OP_LAX())
+
+/***** DISPATCH LOOP *****/
+
+template<bool TRACED>
+int Cpu6502::runSwitchCore(uint64_t cycleLimit)
+{
+   uint64_t startClocks = theNumClocks;
+   theBatchEndClock = cycleLimit;
+
+   do
+   {
+      CpuAddress pc = thePc;
+      uint8_t opCode;
+      theOpCode2 = 0;
+      theOpCode3 = 0;
+
+      uint8_t* hostPage = theMemoryController->getHostReadPage(pc);
+      if ( (hostPage != nullptr) && ((pc & 0xff) <= 0xfd) )
+      {
+         uint8_t* instrBytes = &hostPage[pc & 0xff];
+         opCode = instrBytes[0];
+         theOpCode2 = instrBytes[1];
+         theOpCode3 = instrBytes[2];
+      }
+      else
+      {
+         MemoryDev* mem = theMemoryController->getDevice(pc);
+         if (mem == nullptr)
+         {
+            LOG_WARNING() << "Switch core has no memory device for PC " << addressToString(pc);
+            halt();
+            return -1;
+         }
+
+         opCode = mem->read8(pc);
+
+         if (gOpCodes[opCode].theNumBytes >= 2)
+            theOpCode2 = fetchByte(pc + 1);
+
+         if (gOpCodes[opCode].theNumBytes >= 3)
+            theOpCode3 = fetchByte(pc + 2);
+      }
+
+      recordInstruction(opCode);
+
+      if (TRACED)
+      {
+         traceInstruction(opCode);
+      }
+
+      uint64_t instrStartClock = theNumClocks;
+
+      switch(opCode)
+      {
+         // The operand is resolved before thePc is advanced (relative addressing needs the
+         // address of the instruction), jumps and branches overwrite thePc afterwards
+         #define SPECIALIZED_OP(opCode, mnemonic, addrMode, numBytes, cycles) \
+            case opCode: \
+               resolveOperand<addrMode>(); \
+               thePc += numBytes; \
+               theNumClocks += cycles; \
+               spec_##mnemonic<addrMode>(); \
+               break;
+
+         #include "Cpu6502SpecializedOps.h"
+
+         #undef SPECIALIZED_OP
+      }
+
+      if (theExecutionCounters.isEnabled())
+      {
+         // The specialized ops add their extra cycles straight to the clock count
+         theExecutionCounters.countInstruction(opCode, theNumClocks - instrStartClock -
+                                                       gOpCodes[opCode].theDelayCycles);
+      }
+
+      if (TRACED)
+      {
+         traceControlFlow(pc, opCode);
+         checkStepLimit();
+         checkBatchStop();
+      }
+
+      // halt() and jam() set theBatchEndClock to 0
+   } while(theNumClocks < theBatchEndClock);
+
+   if (!theRunFlag)
+   {
+      return -1;
+   }
+
+   return theNumClocks - startClocks;
+}
+
+// Cpu6502::runCore picks one of these depending on whether the trace is turned on
+template int Cpu6502::runSwitchCore<false>(uint64_t cycleLimit);
+template int Cpu6502::runSwitchCore<true>(uint64_t cycleLimit);
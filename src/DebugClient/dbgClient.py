@@ -7,6 +7,7 @@ import sys
 import cmd2
 import socket
 import struct
+import json
 
 def prettyhex(number, numBits):
     hexNumber = hex(number)[2:]
@@ -131,6 +132,8 @@ class DbgClient(cmd2.Cmd):
 
         if (frameSize > 0):
             retData = self.s.recv(frameSize)
+            while (len(retData) < frameSize):
+                retData += self.s.recv(frameSize - len(retData))
             # print("Received {} frame bytes".format(len(retData)))
             return retData
         else:
@@ -291,6 +294,11 @@ class DbgClient(cmd2.Cmd):
 
         self.lastResult += "Num Clocks = {}{}".format(prettyhex(numClkHigh, 32), prettyhex(numClkLow, 32))
 
+        # The emulator halted, and sent the last instructions it executed after the registers
+        if (padding & 0x01):
+            self.lastResult += "\nEmulator halted, last instructions:\n"
+            self.lastResult += self.formatFlightRecords(self.receiveMessage())
+
         print(self.lastResult)
 
     def do_md(self, argstr):
@@ -434,6 +442,187 @@ class DbgClient(cmd2.Cmd):
 
         self.recvBreakpointList()
 
+    def do_trace(self, argstr):
+        """
+        Turns the execution trace (trace.bin) on or off: trace on|off
+        """
+
+        args = argstr.split()
+        if ( (len(args) < 1) or (args[0] not in ["on", "off"]) ):
+            self.lastResult = "Trace command needs on or off"
+            print(self.lastResult)
+            return
+
+        self.sendHeader(14, 1)
+
+        msgData = struct.pack("!B", 1 if args[0] == "on" else 0)
+        self.s.send(msgData)
+
+        self.lastResult = self.receiveMessage()
+        print(self.lastResult)
+
+
+    def do_flight(self, argstr):
+        """
+        Shows the last instructions the emulator executed: flight [numInstructions]
+        """
+
+        args = argstr.split()
+        numInstructions = 32
+        if (len(args) >= 1):
+            numInstructions = int(args[0], 0)
+
+        self.sendHeader(15, 2)
+
+        msgData = struct.pack("!H", numInstructions)
+        self.s.send(msgData)
+
+        self.lastResult = self.formatFlightRecords(self.receiveMessage())
+        print(self.lastResult)
+
+    def formatFlightRecords(self, rspData):
+        if (len(rspData) < 2):
+            return "Invalid flight recorder response"
+
+        numRecords = struct.unpack("!H", rspData[0:2])[0]
+
+        lines = []
+        for i in range(numRecords):
+            recData = rspData[2 + i * 18 : 2 + (i + 1) * 18]
+            (pc, op1, op2, op3, accum, x, y, sp, status, numClkHigh, numClkLow) = struct.unpack("!HBBBBBBBBLL", recData)
+
+            lines.append("{}  {:02x} {:02x} {:02x}  A={}  X={}  Y={}  SP={}  SR={}  CLK={}".format(
+                         prettyhex(pc, 16), op1, op2, op3, prettyhex(accum, 8), prettyhex(x, 8),
+                         prettyhex(y, 8), prettyhex(sp, 8), prettyhex(status, 8),
+                         (numClkHigh << 32) + numClkLow))
+
+        return "\n".join(lines)
+
+    def do_savestate(self, argstr):
+        """
+        Saves the machine to a save state file (emulator must be halted): savestate filename
+        """
+        self.sendStateCommand(16, argstr)
+
+    def do_loadstate(self, argstr):
+        """
+        Restores the machine from a save state file (emulator must be halted): loadstate filename
+        """
+        self.sendStateCommand(17, argstr)
+
+    def sendStateCommand(self, opCode, argstr):
+        filename = argstr.strip()
+        if (len(filename) == 0):
+            self.lastResult = "Save state commands need a filename"
+            print(self.lastResult)
+            return
+
+        msgData = filename.encode()
+        self.sendHeader(opCode, len(msgData))
+        self.s.send(msgData)
+
+        self.lastResult = self.receiveMessage()
+        print(self.lastResult)
+
+    def do_rewind(self, argstr):
+        """
+        Goes back in time (emulator must be halted, rewind enabled): rewind [numFrames]
+
+        Default is 60 frames (1 second), number of frames is in decimal
+        """
+        args = argstr.split()
+        numFrames = 60 if len(args) == 0 else int(args[0])
+
+        self.sendHeader(18, 2)
+        self.s.send(struct.pack("!H", numFrames))
+
+        self.lastResult = self.receiveMessage()
+        print(self.lastResult)
+
+    def do_reversestep(self, argstr):
+        """
+        Goes back to before the last instruction executed (emulator must be halted, rewind enabled)
+        """
+        self.sendHeader(19, 0)
+
+        self.lastResult = self.receiveMessage()
+        print(self.lastResult)
+
+    def do_counters(self, argstr):
+        """
+        Shows the op codes and addressing modes the emulator spent the most cycles on:
+        counters [numOpCodes] [reset | on | off]
+
+        Default is the top 20 op codes, reset clears the counters after reading them, on / off
+        starts / stops counting
+        """
+        actions = { "reset": 1, "on": 2, "off": 3 }
+        args = argstr.split()
+        action = 0
+        for a in args:
+            action = actions.get(a, action)
+        args = [a for a in args if a not in actions]
+        numOpCodes = 20 if len(args) == 0 else int(args[0])
+
+        self.sendHeader(20, 1)
+        self.s.send(struct.pack("!B", action))
+
+        counters = json.loads(self.receiveMessage())
+        total = counters["total"]
+
+        lines = ["Counting is {}".format("on" if counters["enabled"] else "off (counters on to start)")]
+        lines.append("{} instructions, {} cycles, {} page crossings, {} branches taken".format(
+                     total["instructions"], total["cycles"], total["pageCrossings"], total["branchesTaken"]))
+
+        lines.append("")
+        lines.append("OpCode  Mnemonic  Mode          Instructions       Cycles   Cycles%  PageX  Taken")
+        for oc in counters["opCodes"][0:numOpCodes]:
+            lines.append("{:6}  {:8}  {:12} {:13} {:12} {:8.2f}% {:6} {:6}".format(
+                         oc["opCode"], oc["mnemonic"], oc["mode"], oc["instructions"], oc["cycles"],
+                         100.0 * oc["cycles"] / max(total["cycles"], 1), oc["pageCrossings"],
+                         oc["branchesTaken"]))
+
+        lines.append("")
+        lines.append("Mode          Instructions       Cycles   Cycles%  PageX")
+        for mode in counters["addressModes"]:
+            lines.append("{:12} {:13} {:12} {:8.2f}% {:6}".format(
+                         mode["mode"], mode["instructions"], mode["cycles"],
+                         100.0 * mode["cycles"] / max(total["cycles"], 1), mode["pageCrossings"]))
+
+        self.lastResult = "\n".join(lines)
+        print(self.lastResult)
+
+    def do_profile(self, argstr):
+        """
+        Profiles the guest's routines:
+        profile [numRoutines]       Shows the routines that took the most cycles (default 20)
+        profile start [cycles]      Clears the profile and samples every cycles (default 1000)
+        profile stop                Stops sampling and shows the report
+        profile save filename       Writes collapsed stacks for flamegraph.pl
+        """
+        args = argstr.split()
+
+        if (len(args) > 0) and (args[0] == "start"):
+            if len(args) > 1:
+                self.sendHeader(21, 5)
+                self.s.send(struct.pack("!BI", 1, int(args[1])))
+            else:
+                self.sendHeader(21, 1)
+                self.s.send(struct.pack("!B", 1))
+        elif (len(args) > 0) and (args[0] == "stop"):
+            self.sendHeader(21, 1)
+            self.s.send(struct.pack("!B", 2))
+        elif (len(args) > 1) and (args[0] == "save"):
+            filename = args[1].encode()
+            self.sendHeader(21, 1 + len(filename))
+            self.s.send(struct.pack("!B", 3) + filename)
+        else:
+            numRoutines = 20 if len(args) == 0 else int(args[0])
+            self.sendHeader(21, 2)
+            self.s.send(struct.pack("!BB", 0, numRoutines))
+
+        self.lastResult = self.receiveMessage()
+        print(self.lastResult)
 
     def recvBreakpointList(self):
         msgData = self.receiveMessage()
@@ -27,7 +27,9 @@ DebugServer::DebugServer(Cpu6502* cpu, uint16_t portNum, MemoryController* memCo
    theQuitFlag(false),
    theNumberBytesToRx(-1),
    theRegisterDumpSentToClient(false),
-   thePausedOnBreakpointFlag(false)
+   theBreakpointMap(cpu->getBreakpointMap()),
+   thePausedOnBreakpointFlag(false),
+   theLastPollTicks(0)
 {
    DS_DEBUG() << "DebugServer constructed, portNum = " << portNum;
 
@@ -67,7 +69,7 @@ int DebugServer::debugHook()
    // Check breakpoints
    int retVal = 0;
    CpuAddress curAddr = theCpu->getPc();
-   if (theBreakpoints.find(curAddr) != theBreakpoints.end())
+   if (theBreakpointMap->hasBreakpoint(curAddr))
    {
       // We hit the breakpoint
       if (thePausedOnBreakpointFlag)
@@ -94,33 +96,50 @@ int DebugServer::debugHook()
    if (!theDebuggerState.emulatorAllowExecution())
    {
       // DS_DEBUG() << "Emulator not executing";
-      SDL_Delay(5);
+      handleDebuggerClients(DEBUG_SERVER_PAUSED_WAIT_MS);
       retVal = 0;
    }
    else
    {
+      // This is called for every batch the CPU runs, don't slow it down waiting on the client
+      uint32_t now = SDL_GetTicks();
+      if (now - theLastPollTicks >= DEBUG_SERVER_POLL_MS)
+      {
+         theLastPollTicks = now;
+         handleDebuggerClients(0);
+      }
+
       retVal = 1;
    }
 
-   handleDebuggerClients();
-
    return retVal;
 }
 
 void DebugServer::debugMemoryAccessHook(CpuAddress addr, bool isWrite)
 {
-   if (theMemoryAccessBPs.find(addr) != theMemoryAccessBPs.end() )
-   {
-      theDebuggerState.pauseEmulator();
-      DS_DEBUG() << "Debugger hit memory access breakpoint for "
-                 << (isWrite ? "write" : "read") << " at "
-                 << addressToString(addr);
-   }
-   else
+   // The CPU only calls this for addresses in the breakpoint map
+   theDebuggerState.pauseEmulator();
+   DS_DEBUG() << "Debugger hit memory access breakpoint for "
+              << (isWrite ? "write" : "read") << " at "
+              << addressToString(addr);
+}
+
+bool DebugServer::isRunning()
+{
+   return theDebuggerState.isRunning();
+}
+
+void DebugServer::emulatorHalted(std::vector<FlightRecord> const & lastInstructions)
+{
+   // Sent to the client with the halt's register dump, from the CPU thread
+   theHaltFlightRecords.clear();
+   if (!lastInstructions.empty())
    {
-      DS_DEBUG() << "Hook called for " << (isWrite ? "write" : "read") << "memory access at "
-                 << addressToString(addr);
+      theHaltFlightRecords = FlightRecorder::encodeRecords(lastInstructions,
+                                                           DEBUG_SERVER_HALT_FLIGHT_RECORDS);
    }
+
+   emulatorHalt((void*) this);
 }
 
 void DebugServer::emulatorHalt(void* thisPtr)
@@ -132,7 +151,7 @@ void DebugServer::emulatorHalt(void* thisPtr)
    ds->theDebuggerState.pauseEmulator();
 }
 
-int DebugServer::handleDebuggerClients()
+int DebugServer::handleDebuggerClients(uint32_t timeoutMs)
 {
    DS_DEBUG() << "DebuggerServer::handleDebuggerClients";
 
@@ -155,7 +174,16 @@ int DebugServer::handleDebuggerClients()
    }
 
    // Any activities on the sockets?
-   int activity = SDLNet_CheckSockets(theSocketSet, 5);
+   int activity = 0;
+   if (theClientSocket)
+   {
+      activity = SDLNet_CheckSockets(theSocketSet, timeoutMs);
+   }
+   else if (timeoutMs > 0)
+   {
+      // Nothing in the socket set to wait on
+      SDL_Delay(timeoutMs);
+   }
 
    if (activity)
    {
@@ -211,7 +239,17 @@ int DebugServer::handleDebuggerClients()
       if (theClientSocket)
       {
          DS_DEBUG() << "Emulator halted, sending register dump to debugger client";
-         dumpRegistersCommand();
+         if (theHaltFlightRecords.empty())
+         {
+            dumpRegistersCommand();
+         }
+         else if (dumpRegistersCommand(DEBUG_SERVER_FLIGHT_RECORDS_FOLLOW))
+         {
+            DS_DEBUG() << "Sending the last instructions before the halt to the debugger client";
+            sendResponse(theHaltFlightRecords.size(), theHaltFlightRecords.data());
+         }
+
+         theHaltFlightRecords.clear();
          theDebuggerState.acknowledgeHalt();
       }
       else
@@ -302,6 +340,32 @@ void DebugServer::processCommand(uint16_t commandLen, uint16_t command)
    // case 12 is above
    // case 13 is above
 
+   case 14: // Execution trace on / off
+      traceCommand(commandLen);
+      break;
+
+   case 15: // Flight recorder
+      flightRecorderCommand(commandLen);
+      break;
+
+   case 16: // Save state
+   case 17: // Load state
+      saveStateCommand(command, commandLen);
+      break;
+
+   case 18: // Rewind
+   case 19: // Reverse step
+      rewindCommand(command, commandLen);
+      break;
+
+   case 20: // Execution counters
+      executionCountersCommand(commandLen);
+      break;
+
+   case 21: // Guest profiler
+      profileCommand(commandLen);
+      break;
+
    default:
       DS_WARNING() << "Command " << command << " is not implemented!";
    }
@@ -364,14 +428,14 @@ void DebugServer::disassembleCommand(uint16_t commandLen)
    sendResponse(listing.length(), (uint8_t*) listing.c_str());
 }
 
-void DebugServer::dumpRegistersCommand()
+bool DebugServer::dumpRegistersCommand(uint8_t padding)
 {
    DS_DEBUG() << "Dump registers command (or internally generated)";
 
    if (theRegisterDumpSentToClient)
    {
       DS_DEBUG() << "Dump already sent to client, not double dumping, nobody likes #2";
-      return;
+      return false;
    }
 
    theRegisterDumpSentToClient = true;
@@ -394,7 +458,7 @@ void DebugServer::dumpRegistersCommand()
    SDLNet_Write16(pc, msgBuf + 4);
 
    msgBuf[6] = theCpu->getStatusReg();
-   msgBuf[7] = 0;
+   msgBuf[7] = padding;
 
    uint64_t numClocks = theCpu->getInstructionCount();
    uint32_t highClocks = (numClocks >> 32);
@@ -404,6 +468,7 @@ void DebugServer::dumpRegistersCommand()
    SDLNet_Write32(lowClocks, msgBuf + 12);
 
    sendResponse(16, msgBuf);
+   return true;
 }
 
 void DebugServer::stepCommand(uint16_t commandLen)
@@ -488,6 +553,208 @@ void DebugServer::memoryDumpCommand(uint16_t commandLen)
    sendResponse(mdSize + 4, rspBuf);
 }
 
+void DebugServer::traceCommand(uint16_t commandLen)
+{
+   if (commandLen != 1)
+   {
+      char const * traceErrorMessage = "Malformed trace command received from debugger client";
+      DS_WARNING() << traceErrorMessage;
+      sendResponse(strlen(traceErrorMessage), (uint8_t*) traceErrorMessage);
+      return;
+   }
+
+   bool enable = (theRxDataBuffer[0] != 0);
+
+   DS_DEBUG() << "Trace(" << enable << ") received";
+
+   theCpu->setTraceEnabled(enable);
+
+   char const * traceString = (enable ? "Execution trace on" : "Execution trace off");
+   sendResponse(strlen(traceString), (uint8_t*) traceString);
+}
+
+void DebugServer::flightRecorderCommand(uint16_t commandLen)
+{
+   if (commandLen != 2)
+   {
+      char const * frErrorMessage = "Malformed flight recorder command received from debugger client";
+      DS_WARNING() << frErrorMessage;
+      sendResponse(strlen(frErrorMessage), (uint8_t*) frErrorMessage);
+      return;
+   }
+
+   uint16_t numWanted = SDLNet_Read16(theRxDataBuffer);
+
+   std::vector<FlightRecord> records;
+   theCpu->getFlightRecords(records);
+
+   std::vector<uint8_t> rsp = FlightRecorder::encodeRecords(records, numWanted);
+
+   DS_DEBUG() << "FlightRecorder(" << numWanted << ") received, sending "
+              << (rsp.size() - 2) / FLIGHT_RECORD_WIRE_LEN;
+
+   sendResponse(rsp.size(), rsp.data());
+}
+
+void DebugServer::saveStateCommand(uint16_t command, uint16_t commandLen)
+{
+   bool isSave = (command == 16);
+
+   if (commandLen == 0)
+   {
+      char const * ssErrorMessage = "Malformed save state command received from debugger client";
+      DS_WARNING() << ssErrorMessage;
+      sendResponse(strlen(ssErrorMessage), (uint8_t*) ssErrorMessage);
+      return;
+   }
+
+   if (!theDebuggerState.isPaused())
+   {
+      char const * ssErrorMessage = "Halt the emulator before saving or loading state";
+      sendResponse(strlen(ssErrorMessage), (uint8_t*) ssErrorMessage);
+      return;
+   }
+
+   std::string filename((char const *) theRxDataBuffer, commandLen);
+
+   DS_DEBUG() << (isSave ? "SaveState(" : "LoadState(") << filename << ") received";
+
+   std::string result;
+   if (isSave)
+   {
+      result = (theCpu->saveState(filename) ? "Saved state to " : "Failed to save state to ");
+   }
+   else
+   {
+      result = (theCpu->loadState(filename) ? "Loaded state from " : "Failed to load state from ");
+   }
+
+   result += filename;
+   sendResponse(result.length(), (uint8_t const *) result.c_str());
+}
+
+void DebugServer::rewindCommand(uint16_t command, uint16_t commandLen)
+{
+   bool isRewind = (command == 18);
+
+   if (commandLen != (isRewind ? 2 : 0))
+   {
+      char const * rwErrorMessage = "Malformed rewind command received from debugger client";
+      DS_WARNING() << rwErrorMessage;
+      sendResponse(strlen(rwErrorMessage), (uint8_t*) rwErrorMessage);
+      return;
+   }
+
+   if (!theDebuggerState.isPaused())
+   {
+      char const * rwErrorMessage = "Halt the emulator before rewinding";
+      sendResponse(strlen(rwErrorMessage), (uint8_t*) rwErrorMessage);
+      return;
+   }
+
+   bool success;
+   if (isRewind)
+   {
+      uint16_t numFrames = SDLNet_Read16(theRxDataBuffer);
+      DS_DEBUG() << "Rewind(" << numFrames << ") received";
+      success = theCpu->rewind(numFrames);
+   }
+   else
+   {
+      DS_DEBUG() << "ReverseStep received";
+      success = theCpu->reverseStep();
+   }
+
+   std::string result = (success ? "Went back to " : "Nothing to go back to (is rewind enabled?), at ");
+   result += addressToString(theCpu->getPc());
+   result += " clock ";
+   result += std::to_string(theCpu->getNumClocks());
+   sendResponse(result.length(), (uint8_t const *) result.c_str());
+}
+
+void DebugServer::executionCountersCommand(uint16_t commandLen)
+{
+   if (commandLen > 1)
+   {
+      char const * ecErrorMessage = "Malformed execution counters command received from debugger client";
+      DS_WARNING() << ecErrorMessage;
+      sendResponse(strlen(ecErrorMessage), (uint8_t*) ecErrorMessage);
+      return;
+   }
+
+   // 0 = read, 1 = read and reset, 2 = start counting, 3 = stop counting
+   uint8_t action = (commandLen == 1 ? theRxDataBuffer[0] : 0);
+
+   DS_DEBUG() << "ExecutionCounters(" << (int) action << ") received";
+
+   ExecutionCounters* counters = theCpu->getExecutionCounters();
+   if ( (action == 2) || (action == 3) )
+   {
+      counters->setEnabled(action == 2);
+   }
+
+   std::string json = counters->toJson();
+   sendResponse(json.length(), (uint8_t const *) json.c_str());
+
+   if (action == 1)
+   {
+      counters->reset();
+   }
+}
+
+void DebugServer::profileCommand(uint16_t commandLen)
+{
+   uint8_t action = (commandLen > 0 ? theRxDataBuffer[0] : 0xff);
+
+   if ( (action > 3) ||
+        ( (action == 0) && (commandLen > 2) ) ||
+        ( (action == 1) && (commandLen != 1) && (commandLen != 5) ) ||
+        ( (action == 2) && (commandLen != 1) ) ||
+        ( (action == 3) && (commandLen < 2) ) )
+   {
+      char const * pfErrorMessage = "Malformed profile command received from debugger client";
+      DS_WARNING() << pfErrorMessage;
+      sendResponse(strlen(pfErrorMessage), (uint8_t*) pfErrorMessage);
+      return;
+   }
+
+   DS_DEBUG() << "Profile(" << (int) action << ") received";
+
+   GuestProfiler* profiler = theCpu->getProfiler();
+   std::string result;
+   switch(action)
+   {
+   case 0:
+      result = profiler->getReport(commandLen == 2 ? theRxDataBuffer[1] : PROFILER_REPORT_ROUTINES);
+      break;
+
+   case 1:
+   {
+      uint32_t sampleCycles = (commandLen == 5 ? SDLNet_Read32(theRxDataBuffer + 1) :
+                                                 DEFAULT_PROFILER_SAMPLE_CYCLES);
+      theCpu->startProfiler(sampleCycles);
+      result = "Profiling every " + std::to_string(sampleCycles) + " cycles";
+      break;
+   }
+
+   case 2:
+      theCpu->stopProfiler();
+      result = profiler->getReport(PROFILER_REPORT_ROUTINES);
+      break;
+
+   case 3:
+   {
+      std::string filename((char const *) theRxDataBuffer + 1, commandLen - 1);
+      result = (profiler->dumpCollapsedStacks(filename) ? "Profile written to " :
+                                                           "Failed to write the profile to ");
+      result += filename;
+      break;
+   }
+   }
+
+   sendResponse(result.length(), (uint8_t const *) result.c_str());
+}
+
 void DebugServer::addBreakpointCommand(uint16_t command, uint16_t commandLen)
 {
    // We are expecting CpuAddress addr
@@ -502,9 +769,9 @@ void DebugServer::addBreakpointCommand(uint16_t command, uint16_t commandLen)
    CpuAddress addr = SDLNet_Read16(theRxDataBuffer);
 
    if (command == 9)
-      theBreakpoints.insert(addr);
+      theBreakpointMap->addBreakpoint(addr);
    else
-      theMemoryAccessBPs.insert(addr);
+      theBreakpointMap->addWatchpoint(addr);
 
    DS_DEBUG() << "Inserted" << addressToString(addr) << "into breakpoint list " <<
                  (command == 9 ? "instruction" : "memory access");
@@ -525,18 +792,14 @@ void DebugServer::removeBreakpointCommand(uint16_t command, uint16_t commandLen)
 
    CpuAddress addr = SDLNet_Read16(theRxDataBuffer);
 
-   std::set<CpuAddress>* bpList;
+   bool removed;
    if (command == 10)
-      bpList = &theBreakpoints;
+      removed = theBreakpointMap->removeBreakpoint(addr);
    else
-      bpList = &theMemoryAccessBPs;
+      removed = theBreakpointMap->removeWatchpoint(addr);
 
-   auto bpIt = bpList->find(addr);
-   if (bpIt != bpList->end())
+   if (removed)
    {
-      // We found the breakpoint in the list, now remove it
-      bpList->erase(bpIt);
-
       DS_DEBUG() << "Removed breakpoint" << addressToString(addr);
    }
    else
@@ -555,25 +818,28 @@ void DebugServer::listBreakpointCommand()
 
 void DebugServer::sendBreakpointList()
 {
-   uint16_t numberBreakpoints = theBreakpoints.size() + theMemoryAccessBPs.size();
+   std::vector<CpuAddress> breakpoints = theBreakpointMap->getBreakpoints();
+   std::vector<CpuAddress> memoryAccessBPs = theBreakpointMap->getWatchpoints();
+
+   uint16_t numberBreakpoints = breakpoints.size() + memoryAccessBPs.size();
    int frameLength = 2 * sizeof(uint16_t) + numberBreakpoints * sizeof(CpuAddress);
 
    uint8_t* frameBuffer = (uint8_t*) malloc(frameLength);
    uint8_t* fbp = frameBuffer;
 
-   SDLNet_Write16(theBreakpoints.size(), fbp);
+   SDLNet_Write16(breakpoints.size(), fbp);
    fbp += sizeof(uint16_t);
 
-   SDLNet_Write16(theMemoryAccessBPs.size(), fbp);
+   SDLNet_Write16(memoryAccessBPs.size(), fbp);
    fbp += sizeof(uint16_t);
 
-   for(auto BpIt = theBreakpoints.begin(); BpIt != theBreakpoints.end(); BpIt++)
+   for(auto BpIt = breakpoints.begin(); BpIt != breakpoints.end(); BpIt++)
    {
       SDLNet_Write16(*BpIt, fbp);
       fbp += sizeof(CpuAddress);
    }
 
-   for(auto BpMemIt = theMemoryAccessBPs.begin(); BpMemIt != theMemoryAccessBPs.end(); BpMemIt++)
+   for(auto BpMemIt = memoryAccessBPs.begin(); BpMemIt != memoryAccessBPs.end(); BpMemIt++)
    {
       SDLNet_Write16(*BpMemIt, fbp);
       fbp += sizeof(CpuAddress);
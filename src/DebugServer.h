@@ -5,37 +5,56 @@
 #include <SDL.h>
 #include <SDL_net.h>
 #include <vector>
-#include <set>
 #include "DebuggerState.h"
+#include "DebuggerHooks.h"
 #include "Cpu6502Defines.h"
 
 class Cpu6502;
 class MemoryController;
+class BreakpointMap;
 
 #define DEBUGGER_MAX_MSG_LEN  2048
 
+/// Number of flight recorder records sent to the debugger client when the emulator halts
+#define DEBUG_SERVER_HALT_FLIGHT_RECORDS  32
+
+/// Set in the register dump's padding byte when the flight recorder message follows it
+#define DEBUG_SERVER_FLIGHT_RECORDS_FOLLOW  0x01
+
+/// Milliseconds between checks for debugger client commands while the emulator is running
+#define DEBUG_SERVER_POLL_MS  10
+
+/// Milliseconds to wait for a debugger client command while the emulator is paused
+#define DEBUG_SERVER_PAUSED_WAIT_MS  5
+
 /**
  * Class that the debugger client connects to via TCP connection to command the debugger
  */
-class DebugServer
+class DebugServer : public DebuggerHooks
 {
 public:
    DebugServer(Cpu6502* cpu, uint16_t portNum, MemoryController* memController);
 
-   ~DebugServer();
+   virtual ~DebugServer();
 
    /**
     * Called every CPU cycle to see if the debugger needs to do anything
     * @return -1 when application should quit, 0 when debugger paused, 1 when running
     */
-   int debugHook();
+   virtual int debugHook();
 
    /**
-    * Called by the emulator when memory address are accessed for reading or writing
+    * Called by the emulator when a memory access breakpoint's address is read or written
     * @param addr Memory address being written
     * @param isWrite If the access was a read or write
     */
-   void debugMemoryAccessHook(CpuAddress addr, bool isWrite);
+   virtual void debugMemoryAccessHook(CpuAddress addr, bool isWrite);
+
+   /// False while the emulator is paused or single stepping
+   virtual bool isRunning();
+
+   /// Pauses the emulator so the user can look around
+   virtual void emulatorHalted(std::vector<FlightRecord> const & lastInstructions);
 
    bool startDebugServer();
 
@@ -46,7 +65,11 @@ protected:
 
    void closeExistingConnection(char const * reason);
 
-   int handleDebuggerClients();
+   /**
+    * Accepts new connections and handles a command from the client if there is one
+    * @param timeoutMs How long to wait for a command (0 to just poll)
+    */
+   int handleDebuggerClients(uint32_t timeoutMs);
 
    /**
     * Sends a framed message to the debugger client.  The frame contains a 2-byte message length
@@ -67,7 +90,13 @@ protected:
 
    void disassembleCommand(uint16_t commandLen);
 
-   void dumpRegistersCommand();
+   /**
+    * Sends the registers to the client (unless they were already sent since the emulator last ran)
+    * @param padding Value of the padding byte, DEBUG_SERVER_FLIGHT_RECORDS_FOLLOW when the
+    *        flight recorder message is sent right after the registers
+    * @return False if the registers were already sent
+    */
+   bool dumpRegistersCommand(uint8_t padding = 0);
 
    void stepCommand(uint16_t commandLen);
 
@@ -81,6 +110,45 @@ protected:
    void removeBreakpointCommand(uint16_t command, uint16_t commandLen);
    void listBreakpointCommand();
 
+   /// Turns the execution trace on (command data is 1) or off (0)
+   void traceCommand(uint16_t commandLen);
+
+   /**
+    * Sends the last instructions from the flight recorder, the command data is the number of
+    * instructions wanted (16-bit).  Response format is FlightRecorder::encodeRecords.  The same
+    * message follows the register dump the client gets when the emulator halts.
+    */
+   void flightRecorderCommand(uint16_t commandLen);
+
+   /**
+    * Saves (command 16) or loads (command 17) a save state, the command data is the filename.
+    * The emulator has to be halted.  Response is a status string.
+    */
+   void saveStateCommand(uint16_t command, uint16_t commandLen);
+
+   /**
+    * Goes back in time with the CPU's rewind buffer.  Rewind (command 18) has a uint16_t number of
+    * frames, reverse step (command 19) has no data.  The emulator has to be halted.  Response is a
+    * status string.
+    */
+   void rewindCommand(uint16_t command, uint16_t commandLen);
+
+   /**
+    * Sends the execution counters as a JSON string.  The optional 8-bit command data is 0 to just
+    * read them, 1 to reset them after they are sent, 2 to start and 3 to stop counting.
+    */
+   void executionCountersCommand(uint16_t commandLen);
+
+   /**
+    * Guest profiler, the command data is an 8-bit action and its parameters:
+    * 0 Report, uint8_t number of routines (optional, default 20)
+    * 1 Start, uint32_t cycles between samples (optional)
+    * 2 Stop
+    * 3 Save, filename to write the collapsed stacks to
+    * Response is the report for report / stop, a status string otherwise.
+    */
+   void profileCommand(uint16_t commandLen);
+
    /**
     * Sends the list of breakpoints to the debugger client.  Breakpoint list format is:
     * uint16_t Number of instruction breakpoints
@@ -114,11 +182,16 @@ protected:
    /// Stepping into an emulator fault will try to send 2 dumps to the client
    bool theRegisterDumpSentToClient;
 
-   std::set<CpuAddress> theBreakpoints;
+   /// The CPU's breakpoints and memory access breakpoints
+   BreakpointMap* theBreakpointMap;
 
    bool thePausedOnBreakpointFlag;
 
-   std::set<CpuAddress> theMemoryAccessBPs;
+   /// Encoded flight records from the last emulator halt, sent with the next fresh halt dump
+   std::vector<uint8_t> theHaltFlightRecords;
+
+   /// SDL_GetTicks when the client was last checked for commands while the emulator was running
+   uint32_t theLastPollTicks;
 
 };
 
@@ -0,0 +1,47 @@
+#ifndef DEBUGGER_HOOKS_H
+#define DEBUGGER_HOOKS_H
+
+#include <vector>
+
+#include "Cpu6502Defines.h"
+#include "FlightRecorder.h"
+
+/**
+ * Interface the CPU uses to talk to an attached debugger.  The CPU only knows about this class,
+ * so the emulator library doesn't depend on the networking the DebugServer needs.
+ */
+class DebuggerHooks
+{
+public:
+   virtual ~DebuggerHooks() {}
+
+   /**
+    * Called at the start of every batch of instructions to see if the debugger needs to do
+    * anything
+    * @return -1 when application should quit, 0 when debugger paused, 1 when running
+    */
+   virtual int debugHook() = 0;
+
+   /**
+    * Called by the emulator when an address in the CPU's BreakpointMap is read or written
+    * @param addr Memory address being accessed
+    * @param isWrite If the access was a read or write
+    */
+   virtual void debugMemoryAccessHook(CpuAddress addr, bool isWrite) = 0;
+
+   /**
+    * Checked at the start and end of a batch, a batch started while the debugger isn't running
+    * executes a single instruction.  The instruction breakpoints are in the CPU's BreakpointMap.
+    * @return True while the debugger lets the emulator run freely (not paused or single stepping)
+    */
+   virtual bool isRunning() = 0;
+
+   /**
+    * Called when the emulator halts (invalid memory access, KIL instruction, ...)
+    * @param lastInstructions The flight recorder's records, oldest first (empty if nothing was
+    *        recorded)
+    */
+   virtual void emulatorHalted(std::vector<FlightRecord> const & lastInstructions) = 0;
+};
+
+#endif // DEBUGGER_HOOKS_H
@@ -103,3 +103,8 @@ bool DebuggerState::isPaused()
 {
    return ((theState == PAUSE) || (theState == FRESH_HALT));
 }
+
+bool DebuggerState::isRunning()
+{
+   return (theState == RUN);
+}
@@ -49,6 +49,9 @@ public:
 
    bool isPaused();
 
+   /// True when the emulator is free running (not paused or single stepping)
+   bool isRunning();
+
 protected:
 
    typedef enum
@@ -18,6 +18,33 @@ int Decoder6502::decode()
 {
    DECODER_DEBUG() << "Decoder6502::decode(" << Utils::toHex16(thePc) << ")";
 
+   OpCodeInfo* oci = fetchInstruction();
+   if (oci == nullptr)
+   {
+      return -1;
+   }
+
+   return executeOpCode(oci);
+}
+
+OpCodeInfo* Decoder6502::fetchInstruction()
+{
+   // Most code runs out of RAM / ROM, skip the device lookup entirely for those pages
+   uint8_t* hostPage = theMemoryController->getHostReadPage(thePc);
+   if ( (hostPage != nullptr) && ((thePc & 0xff) <= 0xfd) )
+   {
+      uint8_t* instrBytes = &hostPage[thePc & 0xff];
+      OpCodeInfo* oci = &gOpCodes[instrBytes[0]];
+
+      if (oci->theNumBytes >= 2)
+         theOpCode2 = instrBytes[1];
+
+      if (oci->theNumBytes >= 3)
+         theOpCode3 = instrBytes[2];
+
+      return oci;
+   }
+
    MemoryDev* mem = theMemoryController->getDevice(thePc);
 
    if (mem == 0)
@@ -31,7 +58,7 @@ int Decoder6502::decode()
          DECODER_DEBUG() << " MemoryDev: " << singleDev->getDebugString();
       }
 
-      return -1;
+      return nullptr;
    }
 
    uint8_t opCode = mem->read8(thePc);
@@ -39,13 +66,29 @@ int Decoder6502::decode()
    OpCodeInfo* oci = &gOpCodes[opCode];
 
    if (oci->theNumBytes >= 2)
-      theOpCode2 = theMemoryController->getDevice(thePc + 1)->read8(thePc + 1);
+      theOpCode2 = fetchByte(thePc + 1);
 
    if (oci->theNumBytes >= 3)
-      theOpCode3 = theMemoryController->getDevice(thePc + 2)->read8(thePc + 2);
+      theOpCode3 = fetchByte(thePc + 2);
+
+   return oci;
+}
 
+uint8_t Decoder6502::fetchByte(CpuAddress addr)
+{
+   uint8_t* hostPage = theMemoryController->getHostReadPage(addr);
+   if (hostPage != nullptr)
+   {
+      return hostPage[addr & 0xff];
+   }
+
+   return theMemoryController->getDevice(addr)->read8(addr);
+}
+
+int Decoder6502::executeOpCode(OpCodeInfo* oci)
+{
    // Call the handler for the function!
-   DECODER_DEBUG() << "Found opCode " << Utils::toHex8(opCode)
+   DECODER_DEBUG() << "Found opCode " << Utils::toHex8(oci->theOpCode)
                    << " @ addr " << Utils::toHex16(thePc);
 
    preHandlerHook(oci);
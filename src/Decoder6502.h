@@ -106,6 +106,19 @@ protected:
     */
    virtual int decode();
 
+   /**
+    * Reads the op code at thePc into theOpCode2 / theOpCode3
+    * @return Information about the op code, or nullptr (after calling halt) if there is no memory
+    *         at thePc
+    */
+   OpCodeInfo* fetchInstruction();
+
+   /// Calls the hooks and handler for an op code whose operand bytes have already been fetched
+   int executeOpCode(OpCodeInfo* oci);
+
+   /// Reads an instruction byte, using the direct page tables when possible
+   uint8_t fetchByte(CpuAddress addr);
+
    virtual void updatePc(uint8_t bytesIncrement) = 0;
 
    /**
@@ -1,4 +1,5 @@
 #include<iostream>
+#include<fstream>
 
 #include<stdio.h>
 #include<stdlib.h>
@@ -12,13 +13,14 @@
 void printUsage(char* appName)
 {
    std::cout << appName << " is 6502 disassembler" << std::endl;
-   std::cout << appName << " -f filename -b baseaddr [-a address] [-h] [-o] [-l]" << std::endl;
+   std::cout << appName << " -f filename -b baseaddr [-a address] [-h] [-o] [-l] [-s symfile]" << std::endl;
    std::cout << "  -f --file       Filename of the file to disassemble" << std::endl;
    std::cout << "  -b --baseaddr   Base address of the file to disassemble" << std::endl;
    std::cout << "  -a --address    Address of extra entry points to recursively disassemble (multiple)" << std::endl;
    std::cout << "  -h --help       Show this help" << std::endl;
    std::cout << "  -o --opcodes    Show opcodes in the disassembly" << std::endl;
    std::cout << "  -l --location   Show locations / memory address of instructions and data in the listing" << std::endl;
+   std::cout << "  -s --symbols    Write the labels to a symbol file (emulator.system.profileSymbols)" << std::endl;
    std::cout << std::endl;
 }
 
@@ -31,6 +33,7 @@ int main(int argc, char* argv[])
       { "help",     no_argument,       0, 'h'},
       { "opcodes",  no_argument,       0, 'o'},
       { "location", no_argument,       0, 'l'},
+      { "symbols",  required_argument, 0, 's'},
       { 0,          0,                 0, 0}
    };
 
@@ -40,6 +43,7 @@ int main(int argc, char* argv[])
    bool baseAddressDefined = false;
    bool printOpCodes      = false;
    bool printLocations    = false;
+   std::string symbolFilename = "";
 
    std::vector<CpuAddress> executionEntryPoints;
 
@@ -47,7 +51,7 @@ int main(int argc, char* argv[])
 
    while(true)
    {
-      char optChar = getopt_long(argc, argv, "f:b:a:hol", long_options, &optIndex);
+      char optChar = getopt_long(argc, argv, "f:b:a:hols:", long_options, &optIndex);
 
       if (optChar == -1)
       {
@@ -98,6 +102,11 @@ int main(int argc, char* argv[])
          break;
       }
 
+      case 's':
+         LOG_DEBUG() << "Symbol file:" << optarg;
+         symbolFilename = optarg;
+         break;
+
       default:
          std::cerr << "Invalid argument.  Use -h or --help to see usage" << std::endl;
       }
@@ -112,8 +121,6 @@ int main(int argc, char* argv[])
 
    LOG_DEBUG() << "Disassemling " << filename << " at address " << addressToString(baseAddress);
 
-   constructCpuGlobals();
-
    RomMemory programData("Binary ROM");
    programData.setIntConfigValue("startAddress", baseAddress);
    programData.setStringConfigValue("romFilename", filename);
@@ -138,6 +145,21 @@ int main(int argc, char* argv[])
 
    dis.printDisassembly();
 
+   if (symbolFilename != "")
+   {
+      std::ofstream symbolFile(symbolFilename.c_str());
+      if (!symbolFile.is_open())
+      {
+         LOG_WARNING() << "Couldn't create symbol file" << symbolFilename;
+         return 1;
+      }
+
+      for(auto const & label: dis.getLabels())
+      {
+         symbolFile << addressToString(label.first) << " " << label.second << std::endl;
+      }
+   }
+
    return 0;
 }
 
@@ -206,6 +206,18 @@ std::string Disassembler6502::debugListing(CpuAddress addr, int numInstructions)
 
 }
 
+void Disassembler6502::resetListing()
+{
+   theListing.clear();
+   theLabels.clear();
+   theEntryPoints.clear();
+}
+
+std::map<CpuAddress, std::string> const & Disassembler6502::getLabels() const
+{
+   return theLabels;
+}
+
 std::string Disassembler6502::addJumpLabelStatement(CpuAddress destAddr, char const * const prefix)
 {
    char buf[20];
@@ -41,6 +41,12 @@ public:
     */
    std::string debugListing(CpuAddress addr, int numInstructions);
 
+   /// Forgets the listing, labels and entry points found so far (debugListing keeps adding to them)
+   void resetListing();
+
+   /// Labels of the entry points, subroutines and branch targets found so far
+   std::map<CpuAddress, std::string> const & getLabels() const;
+
 
 protected:
 
@@ -4,6 +4,8 @@
 
 #include "Logger.h"
 #include "Utils.h"
+#include "Cpu6502.h"
+#include "RewindBuffer.h"
 
 
 #ifdef DISPLAYWINDOW_DEBUG
@@ -26,7 +28,8 @@ Display::Display():
    theEventCommandQueue(nullptr),
    theWindow(nullptr),
    theRenderer(nullptr),
-   theDisplayClosingExternallyTriggered(false)
+   theDisplayClosingExternallyTriggered(false),
+   theCpu(nullptr)
 {
    DISP_DEBUG() << "Display constructor called";
 }
@@ -119,6 +122,12 @@ bool Display::startDisplay()
          {
          case SDL_KEYDOWN:
             DISP_DEBUG() << "Received Keydown event";
+
+            if ( (ev.key.keysym.sym == DISPLAY_REWIND_KEY) && (theCpu != nullptr) )
+            {
+               // The CPU thread does the rewinding, key repeat keeps going back a second at a time
+               theCpu->requestRewind(REWIND_FRAMES_PER_SECOND);
+            }
             break;
 
          case SDL_KEYUP:
@@ -197,6 +206,11 @@ void Display::setEventQueue(SimpleQueue* eventQ)
     theEventCommandQueue = eventQ;
 }
 
+void Display::setCpu(Cpu6502* cpu)
+{
+   theCpu = cpu;
+}
+
 bool Display::handleDcSetResolution(DisplayCommand* cmd)
 {
    DISP_DEBUG() << "Display has received a set resolution command";
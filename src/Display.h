@@ -9,6 +9,11 @@
 
 #include <vector>
 
+class Cpu6502;
+
+/// Key that rewinds the emulator one second (when rewinding is on)
+#define DISPLAY_REWIND_KEY SDLK_F9
+
 
 /**
  * Displays graphics for the user.  Receives command messages from the display
@@ -32,6 +37,9 @@ public:
 
    void setEventQueue(SimpleQueue* eventQ);
 
+   /// The CPU the rewind key rewinds, the key does nothing without one
+   void setCpu(Cpu6502* cpu);
+
 protected:
 
    bool handleDisplayQueueCommand(DisplayCommand* cmd);
@@ -73,6 +81,8 @@ protected:
 
    std::vector<uint32_t> theEventsOfInterest;
 
+   Cpu6502* theCpu;
+
 };
 
 #endif // DISPLAY_H
@@ -127,6 +127,7 @@ void DisplayManager::configureDisplay(Cpu6502* cpu)
    theDisplay = new Display();
    theDisplay->setCommandQueue(theDisplayCommandQueue);
    theDisplay->setEventQueue(theEventQueue);
+   theDisplay->setCpu(theCpu);
 
    if (theDisplayDevice == nullptr)
    {
@@ -7,6 +7,7 @@
 #include "MemoryController.h"
 #include "Logger.h"
 #include "Easy6502JsInputDevice.h"
+#include "SaveState.h"
 
 #ifdef EASY6502_DISPLAY_TRACE
    #define EASY6502_DEBUG LOG_DEBUG
@@ -148,6 +149,12 @@ void Easy6502JsDisplay::resetMemory()
 {
    memset(theDisplayFrame, 0, theSize);
 
+   if (theDisplayCommandQueue == nullptr)
+   {
+      // The machine is reset before the display is started, startDisplay clears the screen
+      return;
+   }
+
    // Send clear screen command
    DisplayCommand cmd;
    cmd.id = DisplayCommandId::CLEAR_SCREEN;
@@ -194,6 +201,15 @@ void Easy6502JsDisplay::startDisplay()
    cmd.data.DcClearScreen.blankColor.green = 0;
    theDisplayCommandQueue->writeMessage(sizeof(DisplayCommand), (char*) &cmd);
 
+   // The frame may have been restored from a save state before the display was started
+   for(int i = 0; i < (int) theSize; i++)
+   {
+      if (theDisplayFrame[i] != 0)
+      {
+         drawPixelCommand(i, theDisplayFrame[i]);
+      }
+   }
+
    EASY6502_DEBUG() << "Setting up the input device now";
    theMemController->addNewDevice(theInputDevice);
 
@@ -216,8 +232,35 @@ void Easy6502JsDisplay::setMemoryController(MemoryController* mc)
    MemoryDev::setMemoryController(mc);
 }
 
+void Easy6502JsDisplay::saveState(SaveState* state)
+{
+   state->write(theDisplayFrame, theSize);
+}
+
+bool Easy6502JsDisplay::loadState(SaveState* state)
+{
+   if (!state->read(theDisplayFrame, theSize))
+   {
+      return false;
+   }
+
+   // Redraw the whole screen from the restored frame
+   for(int i = 0; i < (int) theSize; i++)
+   {
+      drawPixelCommand(i, theDisplayFrame[i]);
+   }
+
+   return true;
+}
+
 void Easy6502JsDisplay::drawPixelCommand(int offset, uint8_t c)
 {
+   if (theDisplayCommandQueue == nullptr)
+   {
+      // Not started yet, startDisplay draws the frame
+      return;
+   }
+
    DisplayCommand dc;
    dc.id = DRAW_PIXEL;
    dc.data.DcDrawPixel.x = offset % SCREEN_WIDTH;
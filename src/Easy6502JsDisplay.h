@@ -77,6 +77,10 @@ public:
 
    virtual std::string getConfigTypeName() const;
 
+   virtual void saveState(SaveState* state) override;
+
+   virtual bool loadState(SaveState* state) override;
+
 protected:
 
    void drawPixelCommand(int offset, uint8_t c);
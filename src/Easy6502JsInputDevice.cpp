@@ -7,6 +7,8 @@
 #include "Logger.h"
 #include "EmulatorConfig.h"
 #include "DisplayCommands.h"
+#include "SaveState.h"
+#include "MemoryController.h"
 
 #ifdef EASY6502_INPUTDEV_TRACE
    #define EASYINPUT_DEBUG LOG_DEBUG
@@ -102,10 +104,43 @@ std::string Easy6502JsInputDevice::getConfigTypeName() const
    return "Easy6502InputDevice";
 }
 
+void Easy6502JsInputDevice::saveState(SaveState* state)
+{
+   state->writeU8(isKeyPressed ? 1 : 0);
+   state->writeU8(theCurrentKeyPressed);
+}
+
+bool Easy6502JsInputDevice::loadState(SaveState* state)
+{
+   uint8_t keyPressed;
+   if (!state->readU8(&keyPressed) || !state->readU8(&theCurrentKeyPressed))
+   {
+      return false;
+   }
+
+   isKeyPressed = (keyPressed != 0);
+   return true;
+}
+
 void Easy6502JsInputDevice::processEventQueue()
 {
    EASYINPUT_DEBUG() << "Easy6502JsInputDevice::processEventQueue";
 
+   InputLog* inputLog = theMemController->getInputLog();
+   if (inputLog->getMode() == INPUT_LOG_REPLAY)
+   {
+      // The keys come from the log, SDL isn't involved
+      uint32_t key;
+      while(inputLog->replayNext(INPUT_SOURCE_KEYBOARD, &key))
+      {
+         theCurrentKeyPressed = key;
+      }
+
+      return;
+   }
+
+   uint8_t previousKey = theCurrentKeyPressed;
+
    SDL_Event ev;
    memset(&ev, 0, sizeof(SDL_Event));
    bool keepProcessing = true;
@@ -127,6 +162,11 @@ void Easy6502JsInputDevice::processEventQueue()
          break;
       }
    }
+
+   if (theCurrentKeyPressed != previousKey)
+   {
+      inputLog->record(INPUT_SOURCE_KEYBOARD, theCurrentKeyPressed);
+   }
 }
 
 void Easy6502JsInputDevice::processSdlEvent(SDL_Event const & ev)
@@ -37,8 +37,13 @@ public:
 
    virtual std::string getConfigTypeName() const;
 
+   virtual void saveState(SaveState* state) override;
+
+   virtual bool loadState(SaveState* state) override;
+
 protected:
 
+   /// Takes the key events from the display, or the keys from the input log when replaying
    void processEventQueue();
 
    void processSdlEvent(SDL_Event const & ev);
@@ -7,9 +7,12 @@
 #include "EmulatorConfig.h"
 #include "DisplayManager.h"
 #include "ConfigManager.h"
-#include "MemoryFactory.h"
 #include "MemoryController.h"
-#include "Cpu6502.h"
+#include "Machine.h"
+#include "TraceBuffer.h"
+#include "FlightRecorder.h"
+#include "DebugServer.h"
+#include "Easy6502JsDisplay.h"
 #include "Logger.h"
 
 #include <SDL.h>
@@ -19,9 +22,6 @@ const std::string DEBUGGER_TYPE = "debugger";
 const std::string DEBUGGER_PORT = "port";
 const std::string CONFIGFILE_TYPE = "config";
 const std::string CONFIGFILE_NAME = "filename";
-const std::string EMULATOR_TYPE = "emulator";
-const std::string EMUSTART_NAME = "startAddress";
-const std::string TRACESTEPS_NAME = "stepCount";
 
 void printUsage(char* appName)
 {
@@ -63,11 +63,31 @@ void printUsage(char* appName)
    std::cout << std::endl;
 
    std::cout << "  " << EMULATOR_TYPE << ".system." << EMUSTART_NAME << "=0x1234" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << CLOCKHZ_NAME << "=1789773   (default 1000000)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << UNTHROTTLED_NAME << "=1   (run as fast as possible)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << CPUCORE_NAME << "=switch   (handler, switch or block, default handler)" << std::endl;
 
 
-#ifdef TRACE_EXECUTION
+   std::cout << "  " << EMULATOR_TYPE << ".system." << TRACE_NAME << "=1   (binary trace of every instruction in trace.bin)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << TRACEMAXSTALL_NAME << "=0   (drop trace records instead of waiting for the disk, default "
+             << DEFAULT_TRACE_MAX_STALL_MS << ")" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << TRACEMODE_NAME << "=flow   (full or flow, flow only records branches, jump targets and interrupts)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << FLIGHTRECORDER_NAME << "=65536   (instructions written to flight.bin on a halt, default "
+             << DEFAULT_FLIGHT_RECORDER_SIZE << ")" << std::endl;
    std::cout << "  " << EMULATOR_TYPE << ".system." << TRACESTEPS_NAME << "=100" << std::endl;
-#endif
+   std::cout << "  " << EMULATOR_TYPE << ".system." << LOADSTATE_NAME << "=state.bin   (restore the machine from a save state before starting)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << SAVESTATE_NAME << "=state.bin   (save the machine when the emulator stops)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << REWIND_NAME << "=60   (keep the last seconds for the rewind commands / F9 key)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << REWINDMEMORY_NAME << "=4096   (memory budget of the rewind buffer)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << RECORDINPUTS_NAME << "=inputs.bin   (log keys, UART data and RNG seeds)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << REPLAYINPUTS_NAME << "=inputs.bin   (replay a log unthrottled, without the keyboard or network)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << COUNTERS_NAME << "=counters.json   (write the instructions / cycles executed per op code at exit)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << PROFILE_NAME << "=profile.folded   (profile the guest, collapsed stacks for flamegraph.pl written at exit)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << PROFILESAMPLE_NAME << "=1000   (cycles between profile samples, default "
+             << DEFAULT_PROFILER_SAMPLE_CYCLES << ")" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << PROFILESYMBOLS_NAME << "=program.sym   (routine names for the profile, address name per line)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << GOLDENLOG_NAME << "=nestest.log   (compare every instruction to a known good log, stop at the first difference)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << GOLDENLOGCYCLES_NAME << "=1   (compare the CYC: column of the log too, default 0)" << std::endl;
 
    std::cout << std::endl;
 }
@@ -123,25 +143,21 @@ int main(int argc, char* argv[])
       LOG_DEBUG() << "No config file specified";
    }
 
-   // Default settings
-   std::string filename   = "";
-   std::string configFilename = "";
    uint16_t debuggerPort = 0;
    bool debuggerEnabled = false;
 
-#ifdef TRACE_EXECUTION
-   uint64_t numSteps = 0xffffffffffffffff;
-#endif
-
    if (!initializeSdl())
    {
       return 1;
    }
 
-   MemoryController* memControl = new MemoryController();
+   // The machine is the same as the headless emulator's, plus the display devices that need SDL
+   MemoryTypeList displayTypes;
+   displayTypes.push_back(std::make_pair(Easy6502JsDisplay::getTypeName(), Easy6502JsDisplay::getMDC()));
 
-   MemoryFactory memFactory(memControl);
-   memFactory.processConfigData();
+   Machine* machine = new Machine(configMgr, displayTypes);
+   Cpu6502* emu = machine->getCpu();
+   MemoryController* memControl = machine->getMemoryController();
 
    // Is the debugger configured?
    if (configMgr->isConfigPresent(DEBUGGER_TYPE, DEBUGGER_PORT))
@@ -150,55 +166,25 @@ int main(int argc, char* argv[])
       debuggerEnabled = true;
    }
 
-   CpuAddress startAddress = 0;
-   if (configMgr->isConfigPresent(EMULATOR_TYPE, EMUSTART_NAME))
-   {
-      startAddress = configMgr->getIntegerConfigValue(EMULATOR_TYPE, EMUSTART_NAME);
-      LOG_DEBUG() << "Start Address set by CLI:" << addressToString(startAddress);
-
-      // todo do something with the start address
-   } else if (memControl->getStartAddress(&startAddress))
-   {
-      LOG_DEBUG() << "Start Address set my memory controller:" << addressToString(startAddress);
-   }
-   else
-   {
-      LOG_WARNING() << "No start address found!";
-   }
-
-   constructCpuGlobals();
-
-   Cpu6502* emu = new Cpu6502(memControl);
-
-   emu->setAddress(startAddress);
-
    DisplayManager* dispManager = DisplayManager::getInstance();
    dispManager->setMemoryController(memControl);
    dispManager->configureDisplay(emu);
 
-   memControl->resetAll();
-
    if (debuggerEnabled)
    {
-      if (emu->enableDebugger(debuggerPort))
+      DebugServer* debugServer = new DebugServer(emu, debuggerPort, memControl);
+      if (debugServer->startDebugServer())
       {
+         emu->attachDebugger(debugServer);
          LOG_DEBUG() << "Debugger started successfully on port" << debuggerPort;
       }
       else
       {
+         delete debugServer;
          goto FAILED_TO_START;
       }
    }
 
-#ifdef TRACE_EXECUTION
-   if (configMgr->isConfigPresent(EMULATOR_TYPE, TRACESTEPS_NAME))
-   {
-      numSteps = configMgr->getIntegerConfigValue(EMULATOR_TYPE, TRACESTEPS_NAME);
-      LOG_DEBUG() << "Trace Exectuion limited to" << numSteps << "steps";
-   }
-   emu->setStepLimit(numSteps);
-#endif
-
    // Display manager will spawn emulator thread and block for the entire duration of emulation
    dispManager->startEmulator();
 
@@ -207,9 +193,7 @@ int main(int argc, char* argv[])
    // Emulation complete, cleanup
    DisplayManager::destroyInstance();
 
-   delete emu;
-
-   delete memControl;
+   delete machine;
 
    shutdownSdl();
 
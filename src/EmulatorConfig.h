@@ -19,20 +19,50 @@
 // This config is currently set in the CMakeLists.txt
 // #define SDL_INCLUDED
 
-// Prints all CPU instructions executed to a trace.txt log
-#define TRACE_EXECUTION
+// The execution trace (trace.bin) isn't a compile option, it is turned on at runtime with the
+// emulator.system.trace=1 setting or the debugger trace command
 
 // Dumps all of memory into a .dump file when emulator closes
 #define DUMP_MEMORY
 
 // Turns on debug statements in Cpu6502 class
-#define CPU_TRACE
+// #define CPU_TRACE
 
 // Turns on debug statements about the address mode in the Cpu6502 class
-#define ADDR_MODE_TRACE
+// #define ADDR_MODE_TRACE
 
 // Turns on debugger statements for the Decoder6502 class
-#define DECODER_6502_DEBUG
+// #define DECODER_6502_DEBUG
+
+// Turns on debug statements for the BlockCache class
+// #define BLOCK_CACHE_TRACE
+
+// Turns on debug statements for the WorkStealingPool class
+// #define THREAD_POOL_TRACE
+
+// Turns on debug statements for the EventScheduler class
+// #define EVENT_SCHEDULER_TRACE
+
+// Turns on debug statements for the InterruptController class
+// #define INTERRUPT_TRACE
+
+// Turns on debug statements for the SaveState class
+// #define SAVE_STATE_TRACE
+
+// Turns on debug statements for the RewindBuffer class
+// #define REWIND_TRACE
+
+// Turns on debug statements for the InputLog class
+// #define INPUT_LOG_TRACE
+
+// Turns on debug statements for the GuestProfiler class
+// #define PROFILER_TRACE
+
+// Turns on debug statements for the GoldenLog class
+// #define GOLDEN_LOG_TRACE
+
+// Sign and zero flags are only computed when something reads them (see Cpu6502Flags.h)
+#define LAZY_STATUS_FLAGS
 
 // Turning this on implements the unofficial NES op-codes in Cpu6502 class
 #define UNOFFICIAL_NES_OPCODE_SUPPORT                         
@@ -50,7 +80,7 @@
 #define MAPPER_TRACE
 
 // Turns on debug statements in the MirrorMemory class
-#define MIRROR_MEM_TRACE
+// #define MIRROR_MEM_TRACE
 
 // Turns on the debug statements in the RomMemory and NesRom class
 #define ROM_TRACE
@@ -80,7 +110,7 @@
 // #define EASY6502_INPUTDEV_TRACE
 
 // Turns on the debug for the NES PPU Device
-#define PPUDEV_TRACE
+// #define PPUDEV_TRACE
 
 #endif
 
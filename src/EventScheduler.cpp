@@ -0,0 +1,112 @@
+#include <algorithm>
+
+#include "EventScheduler.h"
+#include "EmulatorConfig.h"
+#include "Logger.h"
+
+#ifdef EVENT_SCHEDULER_TRACE
+   #define SCHED_DEBUG   LOG_DEBUG
+#else
+   #define SCHED_DEBUG   if(0) LOG_DEBUG
+#endif
+
+EventScheduler::EventScheduler():
+   theNextEventId(1),
+   theClock(nullptr),
+   theBatchEndClock(nullptr)
+{
+}
+
+void EventScheduler::attachClock(uint64_t const * clock, uint64_t* batchEndClock)
+{
+   theClock = clock;
+   theBatchEndClock = batchEndClock;
+}
+
+uint64_t EventScheduler::getClock() const
+{
+   return (theClock != nullptr ? *theClock : 0);
+}
+
+uint32_t EventScheduler::schedule(uint64_t clock, ScheduledEventCallback callback, void* context)
+{
+   ScheduledEvent ev;
+   ev.theClock = clock;
+   ev.theId = theNextEventId++;
+   ev.theCallback = callback;
+   ev.theContext = context;
+
+   if (theNextEventId == 0)
+   {
+      // 0 is never a valid ID
+      theNextEventId = 1;
+   }
+
+   theEvents.push_back(ev);
+   std::push_heap(theEvents.begin(), theEvents.end(), runsAfter);
+
+   if ( (theBatchEndClock != nullptr) && (clock < *theBatchEndClock) )
+   {
+      // Scheduled by a device in the middle of a batch, the CPU has to stop sooner
+      *theBatchEndClock = clock;
+   }
+
+   SCHED_DEBUG() << "Scheduled event " << ev.theId << " at clock " << clock;
+   return ev.theId;
+}
+
+uint32_t EventScheduler::scheduleIn(uint64_t numCycles, ScheduledEventCallback callback,
+                                    void* context)
+{
+   return schedule(getClock() + numCycles, callback, context);
+}
+
+bool EventScheduler::cancel(uint32_t eventId)
+{
+   for(auto it = theEvents.begin(); it != theEvents.end(); it++)
+   {
+      if (it->theId == eventId)
+      {
+         theEvents.erase(it);
+         std::make_heap(theEvents.begin(), theEvents.end(), runsAfter);
+
+         SCHED_DEBUG() << "Cancelled event " << eventId;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void EventScheduler::runDueEvents()
+{
+   uint64_t now = getClock();
+
+   while(!theEvents.empty() && (theEvents.front().theClock <= now))
+   {
+      std::pop_heap(theEvents.begin(), theEvents.end(), runsAfter);
+      ScheduledEvent ev = theEvents.back();
+      theEvents.pop_back();
+
+      SCHED_DEBUG() << "Running event " << ev.theId << " scheduled for " << ev.theClock
+                    << " at clock " << now;
+
+      // The callback can schedule more events (or cancel them), it isn't holding onto anything
+      ev.theCallback(ev.theContext);
+   }
+}
+
+void EventScheduler::clear()
+{
+   theEvents.clear();
+}
+
+bool EventScheduler::runsAfter(ScheduledEvent const & a, ScheduledEvent const & b)
+{
+   if (a.theClock != b.theClock)
+   {
+      return a.theClock > b.theClock;
+   }
+
+   return a.theId > b.theId;
+}
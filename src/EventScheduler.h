@@ -0,0 +1,93 @@
+#ifndef EVENTSCHEDULER_H
+#define EVENTSCHEDULER_H
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Called when a scheduled event is due
+ * @param context The context pointer given when the event was scheduled (usually the device)
+ */
+typedef void (*ScheduledEventCallback)(void* context);
+
+/**
+ * Calls devices back at a clock count, so a device that has to do something every N cycles
+ * (timers, vblank, ...) doesn't have to be polled by the CPU.  The MemoryController owns the
+ * scheduler, devices get to it through their memory controller.
+ *
+ * The CPU runs instructions in bulk up to the next event, and then calls runDueEvents.  Events
+ * run at the first instruction boundary at or after their clock count.  Events scheduled for the
+ * same clock count run in the order they were scheduled.
+ */
+class EventScheduler
+{
+public:
+   EventScheduler();
+
+   /**
+    * Called by the CPU so the scheduler knows the current clock count, and can end the CPU's
+    * batch of instructions early when an event is scheduled before the end of the batch
+    * @param clock The CPU clock count
+    * @param batchEndClock Clock count the CPU runs instructions up to before it checks for events
+    */
+   void attachClock(uint64_t const * clock, uint64_t* batchEndClock);
+
+   /// Current clock count of the CPU (0 if no CPU is attached)
+   uint64_t getClock() const;
+
+   /**
+    * Schedules a callback
+    * @param clock Clock count the callback should run at
+    * @return Event ID, for cancel
+    */
+   uint32_t schedule(uint64_t clock, ScheduledEventCallback callback, void* context);
+
+   /// Schedules a callback numCycles from the current clock count
+   uint32_t scheduleIn(uint64_t numCycles, ScheduledEventCallback callback, void* context);
+
+   /**
+    * Removes an event that hasn't run yet
+    * @return False if there isn't an event with the ID (it already ran, or was never scheduled)
+    */
+   bool cancel(uint32_t eventId);
+
+   /// Clock count of the earliest event, UINT64_MAX if nothing is scheduled
+   inline uint64_t getNextEventClock() const
+   {
+      return theEvents.empty() ? UINT64_MAX : theEvents.front().theClock;
+   }
+
+   /// Runs all of the events that are due at the current clock count (including ones scheduled
+   /// by the callbacks themselves)
+   void runDueEvents();
+
+   /// Removes all of the scheduled events
+   void clear();
+
+protected:
+
+   typedef struct ScheduledEventStruct
+   {
+      uint64_t theClock;
+
+      /// IDs are handed out in order, so they also order events with the same clock count
+      uint32_t theId;
+
+      ScheduledEventCallback theCallback;
+      void* theContext;
+   } ScheduledEvent;
+
+   /// Heap ordering, the event that should run first is at the front
+   static bool runsAfter(ScheduledEvent const & a, ScheduledEvent const & b);
+
+   /// Min-heap of events on clock count
+   std::vector<ScheduledEvent> theEvents;
+
+   uint32_t theNextEventId;
+
+   uint64_t const * theClock;
+
+   uint64_t* theBatchEndClock;
+};
+
+#endif // EVENTSCHEDULER_H
@@ -0,0 +1,200 @@
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+
+#include "ExecutionCounters.h"
+#include "Logger.h"
+
+/// ZERO_PAGE_Y is the last addressing mode
+#define NUM_ADDRESS_MODES (ZERO_PAGE_Y + 1)
+
+ExecutionCounters::ExecutionCounters():
+   theEnabledFlag(false)
+{
+   reset();
+}
+
+void ExecutionCounters::reset()
+{
+   memset(theHistogram, 0, sizeof(theHistogram));
+}
+
+void ExecutionCounters::setEnabled(bool enabled)
+{
+   theEnabledFlag = enabled;
+}
+
+ExecutionCount ExecutionCounters::getOpCodeCount(uint8_t opCode) const
+{
+   ExecutionCount retVal;
+   memset(&retVal, 0, sizeof(ExecutionCount));
+
+   uint64_t slots[EXEC_COUNTER_EXTRA_CYCLE_SLOTS];
+   for(int extra = 0; extra < EXEC_COUNTER_EXTRA_CYCLE_SLOTS; extra++)
+   {
+      slots[extra] = theHistogram[opCode][extra];
+   }
+
+   for(int extra = 0; extra < EXEC_COUNTER_EXTRA_CYCLE_SLOTS; extra++)
+   {
+      retVal.theInstructions += slots[extra];
+      retVal.theCycles += slots[extra] * (gOpCodes[opCode].theDelayCycles + extra);
+   }
+
+   if (gOpCodes[opCode].theAddrMode == RELATIVE)
+   {
+      retVal.theBranchesTaken = retVal.theInstructions - slots[0];
+      retVal.thePageCrossings = slots[2] + slots[3];
+   }
+   else
+   {
+      retVal.thePageCrossings = retVal.theInstructions - slots[0];
+   }
+
+   return retVal;
+}
+
+ExecutionCount ExecutionCounters::getAddressModeCount(AddressMode6502 mode) const
+{
+   ExecutionCount retVal;
+   memset(&retVal, 0, sizeof(ExecutionCount));
+
+   for(int opCode = 0; opCode < 0x100; opCode++)
+   {
+      if (gOpCodes[opCode].theAddrMode != mode)
+      {
+         continue;
+      }
+
+      ExecutionCount count = getOpCodeCount(opCode);
+      retVal.theInstructions += count.theInstructions;
+      retVal.theCycles += count.theCycles;
+      retVal.thePageCrossings += count.thePageCrossings;
+      retVal.theBranchesTaken += count.theBranchesTaken;
+   }
+
+   return retVal;
+}
+
+ExecutionCount ExecutionCounters::getTotalCount() const
+{
+   ExecutionCount retVal;
+   memset(&retVal, 0, sizeof(ExecutionCount));
+
+   for(int mode = 0; mode < NUM_ADDRESS_MODES; mode++)
+   {
+      ExecutionCount count = getAddressModeCount((AddressMode6502) mode);
+      retVal.theInstructions += count.theInstructions;
+      retVal.theCycles += count.theCycles;
+      retVal.thePageCrossings += count.thePageCrossings;
+      retVal.theBranchesTaken += count.theBranchesTaken;
+   }
+
+   return retVal;
+}
+
+/// The counts as JSON members (without the braces)
+static void countToJson(std::ostringstream& json, ExecutionCount const & count)
+{
+   json << "\"instructions\": " << count.theInstructions
+        << ", \"cycles\": " << count.theCycles
+        << ", \"pageCrossings\": " << count.thePageCrossings
+        << ", \"branchesTaken\": " << count.theBranchesTaken;
+}
+
+std::string ExecutionCounters::toJson() const
+{
+   std::vector<std::pair<uint64_t, int> > opCodesByCycles;
+   for(int opCode = 0; opCode < 0x100; opCode++)
+   {
+      ExecutionCount count = getOpCodeCount(opCode);
+      if (count.theInstructions != 0)
+      {
+         opCodesByCycles.push_back(std::make_pair(count.theCycles, opCode));
+      }
+   }
+
+   std::sort(opCodesByCycles.rbegin(), opCodesByCycles.rend());
+
+   std::ostringstream json;
+   json << "{\n  \"enabled\": " << (theEnabledFlag ? "true" : "false") << ",\n  \"total\": { ";
+   countToJson(json, getTotalCount());
+   json << " },\n  \"opCodes\": [";
+
+   for(size_t i = 0; i < opCodesByCycles.size(); i++)
+   {
+      int opCode = opCodesByCycles[i].second;
+      json << (i == 0 ? "\n" : ",\n")
+           << "    { \"opCode\": \"" << Utils::toHex8(opCode) << "\""
+           << ", \"mnemonic\": \"" << gOpCodes[opCode].theMnemonicDisass << "\""
+           << ", \"mode\": \"" << addressModeToString(gOpCodes[opCode].theAddrMode) << "\", ";
+      countToJson(json, getOpCodeCount(opCode));
+      json << " }";
+   }
+
+   json << "\n  ],\n  \"addressModes\": [";
+
+   bool firstMode = true;
+   for(int mode = 0; mode < NUM_ADDRESS_MODES; mode++)
+   {
+      ExecutionCount count = getAddressModeCount((AddressMode6502) mode);
+      if (count.theInstructions == 0)
+      {
+         continue;
+      }
+
+      json << (firstMode ? "\n" : ",\n")
+           << "    { \"mode\": \"" << addressModeToString((AddressMode6502) mode) << "\", ";
+      countToJson(json, count);
+      json << " }";
+      firstMode = false;
+   }
+
+   json << "\n  ]\n}\n";
+   return json.str();
+}
+
+bool ExecutionCounters::dumpJson(std::string const & filename) const
+{
+   FILE* f = fopen(filename.c_str(), "w");
+   if (f == NULL)
+   {
+      LOG_WARNING() << "Couldn't open execution counters file " << filename << ": " << strerror(errno);
+      return false;
+   }
+
+   std::string json = toJson();
+   bool success = (fwrite(json.c_str(), 1, json.length(), f) == json.length());
+   fclose(f);
+
+   if (!success)
+   {
+      LOG_WARNING() << "Failed to write execution counters file " << filename;
+   }
+
+   return success;
+}
+
+char const * ExecutionCounters::addressModeToString(AddressMode6502 mode)
+{
+   switch(mode)
+   {
+   case IMPLIED:     return "IMPLIED";
+   case IMMEDIATE:   return "IMMEDIATE";
+   case RELATIVE:    return "RELATIVE";
+   case INDIRECT:    return "INDIRECT";
+   case INDIRECT_X:  return "INDIRECT_X";
+   case INDIRECT_Y:  return "INDIRECT_Y";
+   case ABSOLUTE:    return "ABSOLUTE";
+   case ZERO_PAGE:   return "ZERO_PAGE";
+   case ABSOLUTE_X:  return "ABSOLUTE_X";
+   case ABSOLUTE_Y:  return "ABSOLUTE_Y";
+   case ZERO_PAGE_X: return "ZERO_PAGE_X";
+   case ZERO_PAGE_Y: return "ZERO_PAGE_Y";
+   }
+
+   return "UNKNOWN";
+}
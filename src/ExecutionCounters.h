@@ -0,0 +1,82 @@
+#ifndef EXECUTIONCOUNTERS_H
+#define EXECUTIONCOUNTERS_H
+
+#include <stdint.h>
+#include <string>
+
+#include "Cpu6502Defines.h"
+
+/// Extra cycles an instruction can take over its base cycles (branch taken, page crossed)
+#define EXEC_COUNTER_EXTRA_CYCLE_SLOTS 4
+
+/// Totals for one op code (or one addressing mode)
+typedef struct ExecutionCountStruct
+{
+   uint64_t theInstructions;
+   uint64_t theCycles;
+
+   /// Instructions that took an extra cycle for crossing a page
+   uint64_t thePageCrossings;
+
+   uint64_t theBranchesTaken;
+} ExecutionCount;
+
+/**
+ * Counts what the guest executes: instructions and cycles per op code and per addressing mode,
+ * page crossings and branches taken.  Always compiled in, and counts once enabled, for tuning
+ * guest code and finding the op codes that are worth a fast path in the emulator.
+ *
+ * Counting is turned on with setEnabled (the countersFile config or the debugger), when it is off
+ * the cores only test the flag.  Counting every instruction costs the fast cores 15-20%.
+ *
+ * The cores only do a single increment per instruction: a histogram of how many extra cycles
+ * each op code took over its base cycles.  A branch takes 1 extra cycle when taken and 2 when it
+ * also crosses a page, other instructions take 1 for crossing a page, so everything else can be
+ * worked out from the histogram when the counters are read.
+ */
+class ExecutionCounters
+{
+public:
+   ExecutionCounters();
+
+   inline void countInstruction(uint8_t opCode, unsigned int extraCycles)
+   {
+      if (theEnabledFlag)
+      {
+         theHistogram[opCode][extraCycles & (EXEC_COUNTER_EXTRA_CYCLE_SLOTS - 1)]++;
+      }
+   }
+
+   /// Starts / stops counting, the counts are kept either way
+   void setEnabled(bool enabled);
+
+   inline bool isEnabled() const
+   {
+      return theEnabledFlag;
+   }
+
+   void reset();
+
+   ExecutionCount getOpCodeCount(uint8_t opCode) const;
+
+   ExecutionCount getAddressModeCount(AddressMode6502 mode) const;
+
+   /// Totals of every op code
+   ExecutionCount getTotalCount() const;
+
+   /// Whether counting, op codes (sorted by cycles) and addressing modes that were executed, as JSON
+   std::string toJson() const;
+
+   bool dumpJson(std::string const & filename) const;
+
+   static char const * addressModeToString(AddressMode6502 mode);
+
+protected:
+
+   bool theEnabledFlag;
+
+   /// Number of instructions of each op code that took 0, 1, 2, 3 extra cycles
+   uint64_t theHistogram[0x100][EXEC_COUNTER_EXTRA_CYCLE_SLOTS];
+};
+
+#endif // EXECUTIONCOUNTERS_H
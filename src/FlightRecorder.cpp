@@ -0,0 +1,87 @@
+#include "FlightRecorder.h"
+
+FlightRecorder::FlightRecorder(uint32_t numRecords):
+   theRecords(nullptr)
+{
+   resize(numRecords);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+   delete[] theRecords;
+}
+
+void FlightRecorder::resize(uint32_t numRecords)
+{
+   uint32_t ringSize = 1;
+   while( (ringSize < numRecords) && (ringSize < 0x80000000) )
+   {
+      ringSize <<= 1;
+   }
+
+   delete[] theRecords;
+   theRecords = new FlightRecord[ringSize];
+   theMask = ringSize - 1;
+   theNumRecorded = 0;
+}
+
+void FlightRecorder::getRecords(std::vector<FlightRecord>& records)
+{
+   uint64_t ringSize = (uint64_t) theMask + 1;
+   uint64_t numRecords = (theNumRecorded < ringSize ? theNumRecorded : ringSize);
+
+   records.clear();
+   records.reserve(numRecords);
+
+   for(uint64_t i = theNumRecorded - numRecords; i < theNumRecorded; i++)
+   {
+      records.push_back(theRecords[i & theMask]);
+   }
+}
+
+static uint8_t* writeBigEndian(uint8_t* pos, uint64_t value, int numBytes)
+{
+   for(int i = numBytes - 1; i >= 0; i--)
+   {
+      *pos++ = (value >> (i * 8)) & 0xff;
+   }
+
+   return pos;
+}
+
+std::vector<uint8_t> FlightRecorder::encodeRecords(std::vector<FlightRecord> const & records,
+                                                   uint16_t maxRecords)
+{
+   // Has to fit in one 16-bit framed message
+   uint16_t numRecords = (0xffff - 2) / FLIGHT_RECORD_WIRE_LEN;
+   if (maxRecords < numRecords)
+   {
+      numRecords = maxRecords;
+   }
+
+   if (records.size() < numRecords)
+   {
+      numRecords = records.size();
+   }
+
+   std::vector<uint8_t> msg(2 + numRecords * FLIGHT_RECORD_WIRE_LEN);
+   uint8_t* pos = writeBigEndian(msg.data(), numRecords, 2);
+
+   for(auto it = records.end() - numRecords; it != records.end(); it++)
+   {
+      OpCodeInfo* oci = &gOpCodes[it->theOpCodes[0]];
+
+      pos = writeBigEndian(pos, it->thePc, 2);
+      *pos++ = it->theOpCodes[0];
+      *pos++ = (oci->theNumBytes >= 2 ? it->theOpCodes[1] : 0);
+      *pos++ = (oci->theNumBytes >= 3 ? it->theOpCodes[2] : 0);
+      *pos++ = it->theAccum;
+      *pos++ = it->theRegX;
+      *pos++ = it->theRegY;
+      *pos++ = it->theStackPtr;
+      *pos++ = it->theStatusReg;
+      pos = writeBigEndian(pos, it->theClock, 8);
+   }
+
+   return msg;
+}
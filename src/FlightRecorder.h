@@ -0,0 +1,91 @@
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "Cpu6502Defines.h"
+
+/// Number of instructions the flight recorder remembers by default
+#define DEFAULT_FLIGHT_RECORDER_SIZE 4096
+
+/// Bytes per record in the flight recorder messages sent to the debugger client
+#define FLIGHT_RECORD_WIRE_LEN 18
+
+typedef struct FlightRecordStruct
+{
+   /// Clock count before the instruction executed
+   uint64_t theClock;
+
+   uint16_t thePc;
+
+   /// Op code and operand bytes, bytes past the end of the instruction are garbage
+   uint8_t theOpCodes[3];
+
+   uint8_t theAccum;
+   uint8_t theRegX;
+   uint8_t theRegY;
+   uint8_t theStackPtr;
+
+   /// The sign and zero flags are only up to date after Cpu6502::getFlightRecords fixes them up
+   uint8_t theStatusReg;
+
+   /// Lazy sign and zero flag values (LAZY_STATUS_FLAGS)
+   uint8_t theLazySignValue;
+   uint8_t theLazyZeroValue;
+} FlightRecord;
+
+/**
+ * Ring of the last instructions the CPU executed, so there is something to look at when the
+ * emulator halts without having a full trace turned on.  It is always on, so recording an
+ * instruction is only a few stores into a preallocated ring.  Only the CPU thread writes it, and
+ * it is only read from the CPU thread (on a halt, or from the debugger hook).
+ */
+class FlightRecorder
+{
+public:
+   /**
+    * @param numRecords Number of instructions to remember, rounded up to a power of 2
+    */
+   FlightRecorder(uint32_t numRecords = DEFAULT_FLIGHT_RECORDER_SIZE);
+
+   ~FlightRecorder();
+
+   /// Changes the number of instructions remembered, and forgets the ones recorded so far
+   void resize(uint32_t numRecords);
+
+   /// The record to fill in for the next instruction (overwrites the oldest one)
+   inline FlightRecord* nextRecord()
+   {
+      return &theRecords[theNumRecorded++ & theMask];
+   }
+
+   /**
+    * Copies the recorded instructions out of the ring
+    * @param records Filled with the records, oldest first
+    */
+   void getRecords(std::vector<FlightRecord>& records);
+
+   /**
+    * Encodes the last records for the debugger client: a uint16_t number of records, then for
+    * each record (oldest first) the PC (16-bit), the 3 instruction bytes (0 past the end of the
+    * instruction), A, X, Y, SP, SR, and the clock count before the instruction (high and low
+    * 32-bits).  Everything is big endian.
+    * @param records Records, oldest first (from getRecords)
+    * @param maxRecords Most records to encode, it is also limited to what fits in one message
+    */
+   static std::vector<uint8_t> encodeRecords(std::vector<FlightRecord> const & records,
+                                             uint16_t maxRecords);
+
+protected:
+
+   FlightRecord* theRecords;
+
+   /// Ring size - 1
+   uint32_t theMask;
+
+   /// Total number of instructions recorded
+   uint64_t theNumRecorded;
+};
+
+#endif // FLIGHTRECORDER_H
@@ -0,0 +1,146 @@
+#include <string.h>
+
+#include "FlowTraceBuffer.h"
+
+FlowTraceBuffer::FlowTraceBuffer(uint32_t bufferSize):
+   TraceWriter(bufferSize, FLOW_TRACE_FILE_MAGIC),
+   theTntBits(0),
+   theNumTntBits(0),
+   theNumInstructions(0),
+   theNextPc(0),
+   theSyncNeededFlag(true)
+{
+   for(int i = 0; i < 256; i++)
+   {
+      theFlowKinds[i] = getFlowKind(i);
+   }
+
+   memset(theCodeKnown, 0, sizeof(theCodeKnown));
+}
+
+FlowTraceBuffer::~FlowTraceBuffer()
+{
+   flush();
+   close();
+}
+
+FlowKind FlowTraceBuffer::getFlowKind(uint8_t opCode)
+{
+   OpCodeInfo* oci = &gOpCodes[opCode];
+
+   if (oci->theAddrMode == RELATIVE)
+   {
+      return FLOW_BRANCH;
+   }
+
+   if ( (strcmp(oci->theMnemonicDisass, "JSR") == 0) ||
+        ( (strcmp(oci->theMnemonicDisass, "JMP") == 0) && (oci->theAddrMode == ABSOLUTE) ) )
+   {
+      return FLOW_DIRECT;
+   }
+
+   if ( (strcmp(oci->theMnemonicDisass, "JMP") == 0) ||
+        (strcmp(oci->theMnemonicDisass, "RTS") == 0) ||
+        (strcmp(oci->theMnemonicDisass, "RTI") == 0) ||
+        (strcmp(oci->theMnemonicDisass, "BRK") == 0) )
+   {
+      return FLOW_INDIRECT;
+   }
+
+   return FLOW_LINEAR;
+}
+
+void FlowTraceBuffer::addInterrupt(CpuAddress handlerPc)
+{
+   if (theDataSize + FLOW_MAX_INSTRUCTION_BYTES > theCapacity)
+   {
+      endBlock();
+   }
+
+   if (theSyncNeededFlag)
+   {
+      // The first instruction of the handler starts with a SYNC anyways
+      return;
+   }
+
+   addPacket(FLOW_PACKET_INTERRUPT);
+   addCount();
+   addPc(handlerPc);
+
+   theNextPc = handlerPc;
+}
+
+void FlowTraceBuffer::flush()
+{
+   if (!theSyncNeededFlag)
+   {
+      addEnd();
+      theSyncNeededFlag = true;
+   }
+
+   TraceWriter::flush();
+}
+
+void FlowTraceBuffer::addCount()
+{
+   uint64_t count = theNumInstructions;
+   while(count >= 0x80)
+   {
+      theData[theDataSize++] = (count & 0x7f) | 0x80;
+      count >>= 7;
+   }
+
+   theData[theDataSize++] = count;
+
+   theNumInstructions = 0;
+}
+
+void FlowTraceBuffer::addSync(CpuAddress pc)
+{
+   if (!theSyncNeededFlag)
+   {
+      // Tell the decoder where the previous run of instructions stopped
+      addEnd();
+   }
+
+   addPacket(FLOW_PACKET_SYNC);
+   addPc(pc);
+
+   theNumInstructions = 0;
+   theSyncNeededFlag = false;
+}
+
+void FlowTraceBuffer::addCode(CpuAddress pc, uint8_t const * opCodes, uint8_t numBytes)
+{
+   addPacket(FLOW_PACKET_CODE);
+   addCount();
+
+   for(uint8_t i = 0; i < numBytes; i++)
+   {
+      CpuAddress addr = pc + i;
+      theData[theDataSize++] = opCodes[i];
+      theCode[addr] = opCodes[i];
+      theCodeKnown[addr] = true;
+   }
+}
+
+void FlowTraceBuffer::addEnd()
+{
+   addPacket(FLOW_PACKET_END);
+   addCount();
+}
+
+void FlowTraceBuffer::endBlock()
+{
+   if (!theSyncNeededFlag)
+   {
+      addEnd();
+      theSyncNeededFlag = true;
+   }
+
+   if (!submitBuffer(false))
+   {
+      // The decoder won't see the CODE packets in the dropped block
+      memset(theCodeKnown, 0, sizeof(theCodeKnown));
+   }
+}
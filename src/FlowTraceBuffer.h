@@ -0,0 +1,206 @@
+#ifndef FLOWTRACEBUFFER_H
+#define FLOWTRACEBUFFER_H
+
+#include <stdint.h>
+
+#include "TraceWriter.h"
+#include "Cpu6502Defines.h"
+
+/**
+ * Control flow trace.  Only the things that can't be worked out from the instructions themselves
+ * are recorded: whether each branch was taken, where indirect jumps / returns / BRK went, and
+ * where interrupts happened.  FlowTraceDecoder (used by trace6502) walks the instructions from the
+ * last known PC to expand it back into the full list of executed instructions.
+ *
+ * The bytes of each instruction are written to the trace the first time it is executed (and
+ * again if they change), so the trace doesn't depend on the ROM images, and code the guest
+ * copies into RAM or modifies reconstructs correctly.
+ *
+ * The data of each block is a stream of packets:
+ * @li TNT: 1 byte with bit 7 clear, 1 to 6 branch outcomes.  The highest set bit marks the
+ *     number of outcomes, the bits below it are the outcomes (1 = taken), oldest in bit 0.
+ * @li SYNC: FLOW_PACKET_SYNC, 16-bit PC.  Where execution starts.  Every block starts with one,
+ *     and one follows an END when execution didn't continue where the trace left off.
+ * @li TARGET: FLOW_PACKET_TARGET, 16-bit PC.  Where a JMP (indirect), RTS, RTI or BRK went.
+ * @li CODE: FLOW_PACKET_CODE, count, the op code and operand bytes of the next instruction
+ * @li INTERRUPT: FLOW_PACKET_INTERRUPT, count, 16-bit PC of the interrupt handler
+ * @li END: FLOW_PACKET_END, count.  The trace stops after count more instructions.
+ *
+ * The count is the number of instructions executed since the previous CODE / INTERRUPT / END /
+ * SYNC packet, it is stored 7 bits at a time (least significant first, bit 7 set when more
+ * follow).  PCs are little endian.  Packets are in the order the instructions executed, so TNT
+ * and TARGET packets are consumed by the branches and jumps as the decoder reaches them.
+ */
+
+/// Magic at the start of a control flow trace file
+#define FLOW_TRACE_FILE_MAGIC    "6502FLW1"
+
+/// Size of each of the two buffers in bytes
+#define FLOW_TRACE_BUFFER_SIZE   0x40000
+
+#define FLOW_PACKET_SYNC         0x80
+#define FLOW_PACKET_TARGET       0x81
+#define FLOW_PACKET_INTERRUPT    0x82
+#define FLOW_PACKET_CODE         0x83
+#define FLOW_PACKET_END          0x84
+
+/// Most branch outcomes in a TNT packet
+#define FLOW_TNT_MAX_BITS        6
+
+/// Most bytes one instruction can add to the buffer (END, SYNC, CODE, TNT and TARGET)
+#define FLOW_MAX_INSTRUCTION_BYTES 32
+
+/// How the decoder finds the instruction after one with each op code
+enum FlowKind
+{
+   FLOW_LINEAR,     ///< Next instruction follows this one
+   FLOW_BRANCH,     ///< Conditional branch, a TNT bit says if it was taken
+   FLOW_DIRECT,     ///< JMP / JSR absolute, the target is the operand
+   FLOW_INDIRECT    ///< JMP (indirect), RTS, RTI and BRK, the target is in a TARGET packet
+};
+
+/**
+ * Collects control flow packets for the CPU thread, TraceWriter writes them out in the
+ * background.
+ */
+class FlowTraceBuffer : public TraceWriter
+{
+public:
+   FlowTraceBuffer(uint32_t bufferSize = FLOW_TRACE_BUFFER_SIZE);
+
+   /// Ends the trace and writes out the last block
+   ~FlowTraceBuffer();
+
+   /// Returns how the decoder finds the instruction after opCode
+   static FlowKind getFlowKind(uint8_t opCode);
+
+   /**
+    * Adds an instruction that has executed
+    * @param pc Address of the instruction
+    * @param opCodes The op code and operand bytes (only as many as the instruction has are used)
+    * @param nextPc The PC after the instruction executed
+    */
+   inline void addInstruction(CpuAddress pc, uint8_t const * opCodes, CpuAddress nextPc)
+   {
+      if (theDataSize + FLOW_MAX_INSTRUCTION_BYTES > theCapacity)
+      {
+         endBlock();
+      }
+
+      if ( theSyncNeededFlag || (pc != theNextPc) )
+      {
+         // New block, or the trace was turned off for a while / the debugger moved the PC
+         addSync(pc);
+      }
+
+      uint8_t numBytes = gOpCodes[opCodes[0]].theNumBytes;
+      for(uint8_t i = 0; i < numBytes; i++)
+      {
+         CpuAddress addr = pc + i;
+         if ( !theCodeKnown[addr] || (theCode[addr] != opCodes[i]) )
+         {
+            addCode(pc, opCodes, numBytes);
+            break;
+         }
+      }
+
+      switch(theFlowKinds[opCodes[0]])
+      {
+      case FLOW_BRANCH:
+         addBranch(nextPc != (CpuAddress) (pc + numBytes));
+         break;
+
+      case FLOW_INDIRECT:
+         addPacket(FLOW_PACKET_TARGET);
+         addPc(nextPc);
+         break;
+
+      default:
+         break;
+      }
+
+      theNumInstructions++;
+      theNumRecords++;
+      theNextPc = nextPc;
+   }
+
+   /**
+    * Adds an interrupt, called between instructions
+    * @param handlerPc Address of the interrupt handler (where the interrupt vector points)
+    */
+   void addInterrupt(CpuAddress handlerPc);
+
+   /// Ends the trace so far (the next instruction starts with a SYNC), and writes it out
+   void flush();
+
+protected:
+
+   inline void addBranch(bool taken)
+   {
+      theTntBits |= (taken ? 1 : 0) << theNumTntBits;
+      theNumTntBits++;
+
+      if (theNumTntBits == FLOW_TNT_MAX_BITS)
+      {
+         flushTnt();
+      }
+   }
+
+   /// Writes the pending branch outcomes
+   inline void flushTnt()
+   {
+      if (theNumTntBits > 0)
+      {
+         theData[theDataSize++] = (1 << theNumTntBits) | theTntBits;
+         theTntBits = 0;
+         theNumTntBits = 0;
+      }
+   }
+
+   /// Writes the header of a packet, and any branch outcomes that come before it
+   inline void addPacket(uint8_t packetType)
+   {
+      flushTnt();
+      theData[theDataSize++] = packetType;
+   }
+
+   inline void addPc(CpuAddress pc)
+   {
+      theData[theDataSize++] = pc & 0xff;
+      theData[theDataSize++] = pc >> 8;
+   }
+
+   /// Writes the number of instructions since the last counted packet
+   void addCount();
+
+   void addSync(CpuAddress pc);
+
+   void addCode(CpuAddress pc, uint8_t const * opCodes, uint8_t numBytes);
+
+   /// Adds an END packet, so the decoder knows when to stop
+   void addEnd();
+
+   /// Ends the block and hands it to the writer thread
+   void endBlock();
+
+   FlowKind theFlowKinds[256];
+
+   /// Instruction bytes the decoder already has
+   uint8_t theCode[0x10000];
+   bool theCodeKnown[0x10000];
+
+   /// Branch outcomes not written yet
+   uint8_t theTntBits;
+   uint8_t theNumTntBits;
+
+   /// Instructions since the last counted packet
+   uint64_t theNumInstructions;
+
+   /// Where the decoder will think the next instruction is
+   CpuAddress theNextPc;
+
+   /// The next instruction has to start with a SYNC
+   bool theSyncNeededFlag;
+};
+
+#endif // FLOWTRACEBUFFER_H
@@ -0,0 +1,281 @@
+#include <string.h>
+
+#include "FlowTraceDecoder.h"
+#include "FlowTraceBuffer.h"
+#include "Logger.h"
+
+FlowTraceDecoder::FlowTraceDecoder(FlowTraceListener* listener):
+   theListener(listener),
+   theData(nullptr),
+   theDataSize(0),
+   thePos(0),
+   thePc(0),
+   theRunningFlag(false),
+   theStartedFlag(false),
+   theTntBits(0),
+   theNumTntBits(0)
+{
+   memset(theCode, 0, sizeof(theCode));
+}
+
+bool FlowTraceDecoder::decodeBlock(uint8_t const * data, uint32_t dataSize, uint32_t numInstructions)
+{
+   theData = data;
+   theDataSize = dataSize;
+   thePos = 0;
+   theRunningFlag = false;
+   theNumTntBits = 0;
+
+   // Next CODE / INTERRUPT / END packet, and where its body starts
+   bool headValid = false;
+   uint8_t headType = 0;
+   uint64_t headCount = 0;
+   uint32_t headBodyPos = 0;
+
+   uint64_t sinceLast = 0;
+   uint64_t numExecuted = 0;
+
+   while(true)
+   {
+      if (!headValid && (thePos < theDataSize) && isCountedPacket(theData[thePos]))
+      {
+         headType = theData[thePos];
+         headBodyPos = thePos + 1;
+         if (!readCount(&headBodyPos, &headCount))
+         {
+            return false;
+         }
+         headValid = true;
+      }
+
+      if (headValid && (headCount == sinceLast))
+      {
+         thePos = headBodyPos;
+         headValid = false;
+         sinceLast = 0;
+
+         if (!applyPacket(headType))
+         {
+            return false;
+         }
+         continue;
+      }
+
+      if (!theRunningFlag)
+      {
+         if (thePos == theDataSize)
+         {
+            // Done with the block
+            return true;
+         }
+
+         if ( (theData[thePos] != FLOW_PACKET_SYNC) || !readSync())
+         {
+            LOG_WARNING() << "Flow trace packet before the start of execution";
+            return false;
+         }
+         continue;
+      }
+
+      if ( (thePos == theDataSize) || (++numExecuted > numInstructions) )
+      {
+         LOG_WARNING() << "Flow trace block doesn't end";
+         return false;
+      }
+
+      if (!executeInstruction())
+      {
+         return false;
+      }
+
+      sinceLast++;
+   }
+}
+
+bool FlowTraceDecoder::isCountedPacket(uint8_t packetType)
+{
+   return (packetType == FLOW_PACKET_CODE) || (packetType == FLOW_PACKET_INTERRUPT) ||
+          (packetType == FLOW_PACKET_END);
+}
+
+bool FlowTraceDecoder::readCount(uint32_t* pos, uint64_t* count)
+{
+   *count = 0;
+   for(int shift = 0; shift < 64; shift += 7)
+   {
+      if (*pos >= theDataSize)
+      {
+         return false;
+      }
+
+      uint8_t val = theData[(*pos)++];
+      *count |= (uint64_t) (val & 0x7f) << shift;
+      if ( (val & 0x80) == 0)
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+bool FlowTraceDecoder::readPc(CpuAddress* pc)
+{
+   if (thePos + 2 > theDataSize)
+   {
+      return false;
+   }
+
+   *pc = theData[thePos] | (theData[thePos + 1] << 8);
+   thePos += 2;
+   return true;
+}
+
+bool FlowTraceDecoder::readSync()
+{
+   thePos++;
+
+   CpuAddress pc;
+   if (!readPc(&pc))
+   {
+      return false;
+   }
+
+   if (theStartedFlag && (pc != thePc))
+   {
+      theListener->flowResumed(pc);
+   }
+
+   thePc = pc;
+   theRunningFlag = true;
+   theStartedFlag = true;
+   return true;
+}
+
+bool FlowTraceDecoder::applyPacket(uint8_t packetType)
+{
+   if (!theRunningFlag)
+   {
+      LOG_WARNING() << "Flow trace packet before the start of execution";
+      return false;
+   }
+
+   switch(packetType)
+   {
+   case FLOW_PACKET_CODE:
+   {
+      if (thePos >= theDataSize)
+      {
+         return false;
+      }
+
+      uint8_t numBytes = gOpCodes[theData[thePos]].theNumBytes;
+      if (thePos + numBytes > theDataSize)
+      {
+         return false;
+      }
+
+      for(uint8_t i = 0; i < numBytes; i++)
+      {
+         theCode[(CpuAddress) (thePc + i)] = theData[thePos++];
+      }
+      return true;
+   }
+
+   case FLOW_PACKET_INTERRUPT:
+      if (!readPc(&thePc))
+      {
+         return false;
+      }
+
+      theListener->flowInterrupt(thePc);
+      return true;
+
+   default:
+      // END
+      theRunningFlag = false;
+      return true;
+   }
+}
+
+bool FlowTraceDecoder::executeInstruction()
+{
+   uint8_t opCodes[3];
+   for(int i = 0; i < 3; i++)
+   {
+      opCodes[i] = theCode[(CpuAddress) (thePc + i)];
+   }
+
+   theListener->flowInstruction(thePc, opCodes);
+
+   CpuAddress nextPc = thePc + gOpCodes[opCodes[0]].theNumBytes;
+
+   switch(FlowTraceBuffer::getFlowKind(opCodes[0]))
+   {
+   case FLOW_BRANCH:
+   {
+      bool taken;
+      if (!nextBranch(&taken))
+      {
+         LOG_WARNING() << "Flow trace is missing the branch at " << addressToString(thePc);
+         return false;
+      }
+
+      if (taken)
+      {
+         nextPc += (int8_t) opCodes[1];
+      }
+      break;
+   }
+
+   case FLOW_DIRECT:
+      nextPc = opCodes[1] | (opCodes[2] << 8);
+      break;
+
+   case FLOW_INDIRECT:
+      if ( (theNumTntBits > 0) || (thePos >= theDataSize) ||
+           (theData[thePos] != FLOW_PACKET_TARGET) )
+      {
+         LOG_WARNING() << "Flow trace is missing the target at " << addressToString(thePc);
+         return false;
+      }
+
+      thePos++;
+      if (!readPc(&nextPc))
+      {
+         return false;
+      }
+      break;
+
+   default:
+      break;
+   }
+
+   thePc = nextPc;
+   return true;
+}
+
+bool FlowTraceDecoder::nextBranch(bool* taken)
+{
+   if (theNumTntBits == 0)
+   {
+      if ( (thePos >= theDataSize) || (theData[thePos] & 0x80) || (theData[thePos] == 0) )
+      {
+         return false;
+      }
+
+      uint8_t tnt = theData[thePos++];
+
+      // The highest bit set marks how many outcomes are in the packet
+      while( (tnt >> theNumTntBits) > 1)
+      {
+         theNumTntBits++;
+      }
+      theTntBits = tnt & ((1 << theNumTntBits) - 1);
+   }
+
+   *taken = theTntBits & 0x1;
+   theTntBits >>= 1;
+   theNumTntBits--;
+   return true;
+}
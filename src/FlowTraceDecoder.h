@@ -0,0 +1,90 @@
+#ifndef FLOWTRACEDECODER_H
+#define FLOWTRACEDECODER_H
+
+#include <stdint.h>
+
+#include "Cpu6502Defines.h"
+
+/**
+ * Told about each instruction FlowTraceDecoder expands a control flow trace into, in the order
+ * they executed
+ */
+class FlowTraceListener
+{
+public:
+   virtual ~FlowTraceListener() { }
+
+   /**
+    * An instruction executed
+    * @param opCodes The op code and operand bytes, as they were when the instruction executed
+    */
+   virtual void flowInstruction(CpuAddress pc, uint8_t const * opCodes) = 0;
+
+   /// An interrupt was taken, the next instruction is the first one of the handler
+   virtual void flowInterrupt(CpuAddress handlerPc) = 0;
+
+   /// The trace was turned off for a while (or the debugger moved the PC), and carries on at pc
+   virtual void flowResumed(CpuAddress pc) = 0;
+};
+
+/**
+ * Expands the packets of a control flow trace (FlowTraceBuffer) into the executed instructions.
+ * The instructions are walked from the PC of the SYNC packet, each branch takes the next TNT bit
+ * and each indirect jump the next TARGET packet.  CODE, INTERRUPT and END packets are applied
+ * once their count of instructions has been walked.  The instruction bytes from the CODE packets
+ * are kept for the whole trace, blocks have to be decoded in the order they are in the file.
+ */
+class FlowTraceDecoder
+{
+public:
+   FlowTraceDecoder(FlowTraceListener* listener);
+
+   /**
+    * Expands the packets of a block
+    * @param numInstructions Number of instructions in the block, from the block header
+    * @return False if the packets are corrupt
+    */
+   bool decodeBlock(uint8_t const * data, uint32_t dataSize, uint32_t numInstructions);
+
+protected:
+
+   bool isCountedPacket(uint8_t packetType);
+
+   bool readCount(uint32_t* pos, uint64_t* count);
+
+   bool readPc(CpuAddress* pc);
+
+   bool readSync();
+
+   /// Applies a CODE, INTERRUPT or END packet, thePos is at its body
+   bool applyPacket(uint8_t packetType);
+
+   /// Tells the listener about the instruction at the PC and moves the PC to the next instruction
+   bool executeInstruction();
+
+   /// Takes the next branch outcome out of the TNT packets
+   bool nextBranch(bool* taken);
+
+   FlowTraceListener* theListener;
+
+   uint8_t const * theData;
+   uint32_t theDataSize;
+   uint32_t thePos;
+
+   CpuAddress thePc;
+
+   /// Between a SYNC and an END
+   bool theRunningFlag;
+
+   /// Seen the first SYNC
+   bool theStartedFlag;
+
+   /// Outcomes left from the last TNT packet
+   uint8_t theTntBits;
+   uint8_t theNumTntBits;
+
+   /// Instruction bytes from the CODE packets so far
+   uint8_t theCode[0x10000];
+};
+
+#endif // FLOWTRACEDECODER_H
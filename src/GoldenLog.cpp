@@ -0,0 +1,267 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <sstream>
+
+#include "GoldenLog.h"
+#include "Cpu6502Defines.h"
+#include "EmulatorConfig.h"
+#include "Logger.h"
+#include "Utils.h"
+
+#ifdef GOLDEN_LOG_TRACE
+   #define GOLDEN_LOG_DEBUG    LOG_DEBUG
+#else
+   #define GOLDEN_LOG_DEBUG    if(0) LOG_DEBUG
+#endif
+
+/// The registers start in this column of a nestest.log line
+#define GOLDEN_LOG_REGISTERS_COLUMN 48
+
+/// The instruction bytes start in this column (after the address and 2 spaces)
+#define GOLDEN_LOG_BYTES_COLUMN 6
+
+/// Only the real flags are compared (not B and the unused bit)
+#define GOLDEN_LOG_STATUS_MASK 0xcf
+
+GoldenLog::GoldenLog():
+   theCheckCyclesFlag(false),
+   theLineNumber(0),
+   theNumMatched(0),
+   theCycleOffset(0),
+   thePassedFlag(false),
+   theDivergedFlag(false)
+{
+}
+
+GoldenLog::~GoldenLog()
+{
+}
+
+bool GoldenLog::open(std::string const & filename)
+{
+   theFile.open(filename.c_str());
+   if (!theFile.is_open())
+   {
+      LOG_WARNING() << "Couldn't open golden log " << filename << ": " << strerror(errno);
+      return false;
+   }
+
+   theFilename = filename;
+   if (!readLine())
+   {
+      LOG_WARNING() << "Golden log " << filename << " doesn't have any instructions in it";
+      theFile.close();
+      return false;
+   }
+
+   LOG_DEBUG() << "Comparing the CPU to" << filename;
+   return true;
+}
+
+void GoldenLog::setCheckCycles(bool check)
+{
+   theCheckCyclesFlag = check;
+}
+
+bool GoldenLog::readLine()
+{
+   while(std::getline(theFile, theLine))
+   {
+      theLineNumber++;
+
+      if (!theLine.empty() && (theLine.back() == '\r'))
+      {
+         theLine.pop_back();
+      }
+
+      // Every instruction line starts with its address
+      if ( (theLine.size() > GOLDEN_LOG_BYTES_COLUMN) && isxdigit(theLine[0]) && isxdigit(theLine[1]) &&
+           isxdigit(theLine[2]) && isxdigit(theLine[3]) && (theLine[4] == ' ') )
+      {
+         return true;
+      }
+
+      GOLDEN_LOG_DEBUG() << "Skipping golden log line" << theLineNumber;
+   }
+
+   theLine.clear();
+   return false;
+}
+
+int GoldenLog::parseField(char const * name, int base) const
+{
+   // Only where the name starts a word, so P: isn't found in SP: or PPU:
+   for(size_t pos = theLine.find(name, GOLDEN_LOG_BYTES_COLUMN); pos != std::string::npos;
+       pos = theLine.find(name, pos + 1))
+   {
+      if (isspace(theLine[pos - 1]))
+      {
+         return strtol(theLine.c_str() + pos + strlen(name), nullptr, base);
+      }
+   }
+
+   return -1;
+}
+
+bool GoldenLog::checkInstructionCallback(void* context, FlightRecord const & state)
+{
+   return ((GoldenLog*) context)->checkInstruction(state);
+}
+
+bool GoldenLog::checkInstruction(FlightRecord const & state)
+{
+   if (thePassedFlag || theDivergedFlag)
+   {
+      return false;
+   }
+
+   std::ostringstream mismatch;
+
+   int pc = strtol(theLine.substr(0, 4).c_str(), nullptr, 16);
+   if (pc != state.thePc)
+   {
+      mismatch << " PC " << addressToString(state.thePc) << " (log " << addressToString(pc) << ")";
+   }
+
+   // Up to 3 bytes, each followed by a space, before the disassembly
+   size_t pos = GOLDEN_LOG_BYTES_COLUMN;
+   for(int i = 0; (i < 3) && (pos + 2 < theLine.size()) && isxdigit(theLine[pos]) &&
+                  isxdigit(theLine[pos + 1]) && (theLine[pos + 2] == ' '); i++, pos += 3)
+   {
+      int logByte = strtol(theLine.substr(pos, 2).c_str(), nullptr, 16);
+      if (logByte != state.theOpCodes[i])
+      {
+         mismatch << " byte " << i << " " << Utils::toHex8(state.theOpCodes[i]) << " (log "
+                  << Utils::toHex8(logByte) << ")";
+      }
+   }
+
+   struct
+   {
+      char const * theField;
+      char const * theName;
+      int theValue;
+      int theMask;
+   } registers[] = { { "A:",  "A",  state.theAccum,     0xff },
+                     { "X:",  "X",  state.theRegX,      0xff },
+                     { "Y:",  "Y",  state.theRegY,      0xff },
+                     { "P:",  "P",  state.theStatusReg, GOLDEN_LOG_STATUS_MASK },
+                     { "SP:", "SP", state.theStackPtr,  0xff } };
+
+   for(auto const & reg: registers)
+   {
+      int logValue = parseField(reg.theField, 16);
+      if ( (logValue >= 0) && ((logValue & reg.theMask) != (reg.theValue & reg.theMask)) )
+      {
+         mismatch << " " << reg.theName << " " << Utils::toHex8(reg.theValue) << " (log "
+                  << Utils::toHex8(logValue) << ")";
+      }
+   }
+
+   int logCycles = parseField("CYC:", 10);
+   if ( (logCycles >= 0) && (theNumMatched == 0) )
+   {
+      theCycleOffset = (int64_t) logCycles - (int64_t) state.theClock;
+   }
+   else if ( theCheckCyclesFlag && (logCycles >= 0) &&
+             ((int64_t) state.theClock + theCycleOffset != logCycles) )
+   {
+      mismatch << " CYC " << (int64_t) state.theClock + theCycleOffset << " (log " << logCycles << ")";
+   }
+
+   if (!mismatch.str().empty())
+   {
+      theDivergedFlag = true;
+      theMismatch = mismatch.str();
+      theActualState = formatState(state);
+
+      GOLDEN_LOG_DEBUG() << "Golden log line" << theLineNumber << "doesn't match:" << theMismatch;
+      return false;
+   }
+
+   theContext.push_back(theLine);
+   if (theContext.size() > GOLDEN_LOG_CONTEXT_LINES)
+   {
+      theContext.pop_front();
+   }
+
+   theNumMatched++;
+
+   if (!readLine())
+   {
+      thePassedFlag = true;
+      return false;
+   }
+
+   return true;
+}
+
+std::string GoldenLog::formatState(FlightRecord const & state) const
+{
+   char text[GOLDEN_LOG_REGISTERS_COLUMN + 64];
+   int pos = snprintf(text, sizeof(text), "%04X  ", state.thePc);
+   for(int i = 0; i < gOpCodes[state.theOpCodes[0]].theNumBytes; i++)
+   {
+      pos += snprintf(text + pos, sizeof(text) - pos, "%02X ", state.theOpCodes[i]);
+   }
+
+   // No disassembly, the registers line up with the log's
+   while(pos < GOLDEN_LOG_REGISTERS_COLUMN)
+   {
+      text[pos++] = ' ';
+   }
+
+   snprintf(text + pos, sizeof(text) - pos, "A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%" PRId64,
+            state.theAccum, state.theRegX, state.theRegY, state.theStatusReg, state.theStackPtr,
+            (int64_t) state.theClock + theCycleOffset);
+
+   return text;
+}
+
+bool GoldenLog::isPassed() const
+{
+   return thePassedFlag;
+}
+
+bool GoldenLog::isDiverged() const
+{
+   return theDivergedFlag;
+}
+
+uint64_t GoldenLog::getNumMatched() const
+{
+   return theNumMatched;
+}
+
+std::string GoldenLog::getReport() const
+{
+   std::ostringstream oss;
+   if (thePassedFlag)
+   {
+      oss << "Matched all " << theNumMatched << " instructions of " << theFilename << "\n";
+      return oss.str();
+   }
+
+   if (!theDivergedFlag)
+   {
+      oss << "Stopped after matching " << theNumMatched << " instructions of " << theFilename
+          << ", the log goes on at line " << theLineNumber << "\n";
+      return oss.str();
+   }
+
+   oss << "Diverged from " << theFilename << " at line " << theLineNumber << " after " << theNumMatched
+       << " instructions:" << theMismatch << "\n";
+
+   for(auto const & line: theContext)
+   {
+      oss << "      " << line << "\n";
+   }
+
+   oss << "log > " << theLine << "\n";
+   oss << "cpu > " << theActualState << "\n";
+   return oss.str();
+}
@@ -0,0 +1,97 @@
+#ifndef GOLDENLOG_H
+#define GOLDENLOG_H
+
+#include <stdint.h>
+#include <string>
+#include <fstream>
+#include <deque>
+
+#include "FlightRecorder.h"
+
+/// Matching log lines shown before the line where the emulator went a different way
+#define GOLDEN_LOG_CONTEXT_LINES 10
+
+/**
+ * Compares the CPU to a log of a known good run (the nestest.log that comes with nestest), one
+ * instruction at a time, and stops it at the first instruction that doesn't match.  The log is
+ * read from the file as the CPU gets to each line, so it doesn't matter how big it is.
+ *
+ * Each line is compared on the address, the instruction bytes, A, X, Y, P and SP.  P is compared
+ * without the B and unused bits (they aren't real flags, and logs don't agree on them).  The cycle
+ * count (CYC:) is only compared when asked for, counted from the cycle count on the first line.
+ */
+class GoldenLog
+{
+public:
+   GoldenLog();
+
+   ~GoldenLog();
+
+   bool open(std::string const & filename);
+
+   /// Compare the CYC: column too
+   void setCheckCycles(bool check);
+
+   /**
+    * Cpu6502::setInstructionCheck callback, context is the GoldenLog
+    * @return False to stop the CPU (it didn't match, or the log is done)
+    */
+   static bool checkInstructionCallback(void* context, FlightRecord const & state);
+
+   /// Compares the CPU before an instruction executes to the next line of the log
+   bool checkInstruction(FlightRecord const & state);
+
+   /// The CPU matched every line of the log
+   bool isPassed() const;
+
+   /// The CPU didn't match a line of the log
+   bool isDiverged() const;
+
+   /// Lines matched so far
+   uint64_t getNumMatched() const;
+
+   /// Result of the comparison, with the log lines before a divergence, the line that didn't
+   /// match and what the CPU had instead
+   std::string getReport() const;
+
+protected:
+
+   /// The next line of the log that has an instruction in it, false at the end of the file
+   bool readLine();
+
+   /// A register in the line (name includes the :, and has to start a word), -1 if the line
+   /// doesn't have it
+   int parseField(char const * name, int base) const;
+
+   /// The CPU's state in the same columns as the log
+   std::string formatState(FlightRecord const & state) const;
+
+   std::string theFilename;
+
+   std::ifstream theFile;
+
+   bool theCheckCyclesFlag;
+
+   std::string theLine;
+
+   uint64_t theLineNumber;
+
+   uint64_t theNumMatched;
+
+   /// CYC: of the first line minus the clock count of the first instruction
+   int64_t theCycleOffset;
+
+   bool thePassedFlag;
+
+   bool theDivergedFlag;
+
+   /// The last lines that matched
+   std::deque<std::string> theContext;
+
+   /// What was different, and what the CPU had instead of the log line
+   std::string theMismatch;
+
+   std::string theActualState;
+};
+
+#endif // GOLDENLOG_H
@@ -0,0 +1,271 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "GuestProfiler.h"
+#include "EventScheduler.h"
+#include "EmulatorConfig.h"
+#include "Logger.h"
+#include "Utils.h"
+
+#ifdef PROFILER_TRACE
+   #define PROFILER_DEBUG    LOG_DEBUG
+#else
+   #define PROFILER_DEBUG    if(0) LOG_DEBUG
+#endif
+
+GuestProfiler::GuestProfiler(EventScheduler* scheduler):
+   theScheduler(scheduler),
+   theRunningFlag(false),
+   theSampleCycles(DEFAULT_PROFILER_SAMPLE_CYCLES),
+   theSampleEventId(0),
+   theLastSampleClock(0)
+{
+   theStack.reserve(PROFILER_MAX_DEPTH);
+}
+
+GuestProfiler::~GuestProfiler()
+{
+   stop();
+}
+
+void GuestProfiler::start(uint32_t sampleCycles, CpuAddress entryPc)
+{
+   stop();
+
+   theSampleCycles = (sampleCycles == 0 ? 1 : sampleCycles);
+   theSamples.clear();
+   theRunningFlag = true;
+
+   restart(entryPc);
+
+   LOG_DEBUG() << "Profiling every" << theSampleCycles << "cycles from" << addressToString(entryPc);
+}
+
+void GuestProfiler::stop()
+{
+   if (theRunningFlag)
+   {
+      theScheduler->cancel(theSampleEventId);
+      theRunningFlag = false;
+   }
+}
+
+void GuestProfiler::restart(CpuAddress entryPc)
+{
+   if (!theRunningFlag)
+   {
+      return;
+   }
+
+   // The old event is usually already gone with the rest of the scheduled events
+   theScheduler->cancel(theSampleEventId);
+
+   theStack.clear();
+   ProfilerFrame frame = { entryPc, 0xff };
+   theStack.push_back(frame);
+
+   theLastSampleClock = theScheduler->getClock();
+   theSampleEventId = theScheduler->scheduleIn(theSampleCycles, sampleEvent, this);
+}
+
+void GuestProfiler::sampleEvent(void* context)
+{
+   ((GuestProfiler*) context)->takeSample();
+}
+
+void GuestProfiler::takeSample()
+{
+   uint64_t clock = theScheduler->getClock();
+
+   std::vector<CpuAddress> stack(theStack.size());
+   for(size_t i = 0; i < theStack.size(); i++)
+   {
+      stack[i] = theStack[i].theRoutine;
+   }
+
+   // The event runs at the first instruction boundary after it was due
+   theSamples[stack] += clock - theLastSampleClock;
+   theLastSampleClock = clock;
+
+   PROFILER_DEBUG() << "Sample at clock" << clock << "in" << getRoutineName(stack.back())
+                    << "depth" << stack.size();
+
+   theSampleEventId = theScheduler->scheduleIn(theSampleCycles, sampleEvent, this);
+}
+
+bool GuestProfiler::loadSymbols(std::string const & filename)
+{
+   std::ifstream f(filename.c_str());
+   if (!f.is_open())
+   {
+      LOG_WARNING() << "Couldn't open symbol file " << filename << ": " << strerror(errno);
+      return false;
+   }
+
+   int numSymbols = 0;
+   std::string line;
+   while(std::getline(f, line))
+   {
+      std::istringstream iss(line);
+      std::string addrText;
+      std::string name;
+      if (!(iss >> addrText >> name) || (addrText[0] == '#') || (addrText[0] == ';'))
+      {
+         continue;
+      }
+
+      if (addrText == "al")
+      {
+         // al 00C000 .name
+         addrText = name;
+         if (!(iss >> name))
+         {
+            continue;
+         }
+      }
+
+      if (name[0] == '.')
+      {
+         name.erase(0, 1);
+      }
+
+      // Addresses are hex, with or without a 0x / $ in front
+      if (addrText[0] == '$')
+      {
+         addrText.erase(0, 1);
+      }
+      else if (addrText.compare(0, 2, "0x") == 0)
+      {
+         addrText.erase(0, 2);
+      }
+
+      char* addrEnd;
+      unsigned long addr = strtoul(addrText.c_str(), &addrEnd, 16);
+      if ( (*addrEnd != 0) || addrText.empty() || (addr > 0xffff) || name.empty())
+      {
+         PROFILER_DEBUG() << "Skipping symbol file line:" << line;
+         continue;
+      }
+
+      theSymbols[addr] = name;
+      numSymbols++;
+   }
+
+   LOG_DEBUG() << "Loaded" << numSymbols << "symbols from" << filename;
+   return true;
+}
+
+std::string GuestProfiler::getRoutineName(CpuAddress routine) const
+{
+   auto symbol = theSymbols.find(routine);
+   if (symbol != theSymbols.end())
+   {
+      return symbol->second;
+   }
+
+   // Same as the disassembler names a JSR target
+   char buf[20];
+   snprintf(buf, 20, "sub_0x%04x", routine);
+   return buf;
+}
+
+std::string GuestProfiler::getCollapsedStacks() const
+{
+   std::ostringstream oss;
+   for(auto const & sample: theSamples)
+   {
+      for(size_t i = 0; i < sample.first.size(); i++)
+      {
+         oss << (i == 0 ? "" : ";") << getRoutineName(sample.first[i]);
+      }
+
+      oss << " " << sample.second << "\n";
+   }
+
+   return oss.str();
+}
+
+bool GuestProfiler::dumpCollapsedStacks(std::string const & filename) const
+{
+   FILE* f = fopen(filename.c_str(), "w");
+   if (f == NULL)
+   {
+      LOG_WARNING() << "Couldn't open profile file " << filename << ": " << strerror(errno);
+      return false;
+   }
+
+   std::string stacks = getCollapsedStacks();
+   bool success = (fwrite(stacks.c_str(), 1, stacks.length(), f) == stacks.length());
+   fclose(f);
+
+   if (!success)
+   {
+      LOG_WARNING() << "Failed to write profile file " << filename;
+   }
+
+   return success;
+}
+
+uint64_t GuestProfiler::getSampledCycles() const
+{
+   uint64_t total = 0;
+   for(auto const & sample: theSamples)
+   {
+      total += sample.second;
+   }
+
+   return total;
+}
+
+std::string GuestProfiler::getReport(unsigned int numRoutines) const
+{
+   // Cycles in the routine itself, and including everything it called (recursion counted once)
+   std::map<CpuAddress, std::pair<uint64_t, uint64_t> > routineCycles;
+   for(auto const & sample: theSamples)
+   {
+      std::vector<CpuAddress> const & stack = sample.first;
+      routineCycles[stack.back()].first += sample.second;
+
+      for(size_t i = 0; i < stack.size(); i++)
+      {
+         if (std::find(stack.begin(), stack.begin() + i, stack[i]) == stack.begin() + i)
+         {
+            routineCycles[stack[i]].second += sample.second;
+         }
+      }
+   }
+
+   std::vector<std::pair<uint64_t, CpuAddress> > bySelfCycles;
+   for(auto const & rc: routineCycles)
+   {
+      bySelfCycles.push_back(std::make_pair(rc.second.first, rc.first));
+   }
+
+   std::sort(bySelfCycles.rbegin(), bySelfCycles.rend());
+
+   uint64_t total = getSampledCycles();
+   double percent = (total > 0 ? 100.0 / total : 0.0);
+
+   std::ostringstream oss;
+   oss << total << " cycles sampled every " << theSampleCycles << " cycles\n";
+   oss << "     Self   Self%    Total  Total%  Routine\n";
+   oss << std::fixed << std::setprecision(2);
+
+   for(size_t i = 0; (i < bySelfCycles.size()) && (i < numRoutines); i++)
+   {
+      CpuAddress routine = bySelfCycles[i].second;
+      uint64_t totalCycles = routineCycles[routine].second;
+
+      oss << std::setw(9) << bySelfCycles[i].first << " " << std::setw(6) << bySelfCycles[i].first * percent << "% "
+          << std::setw(9) << totalCycles << " " << std::setw(6) << totalCycles * percent << "%  "
+          << getRoutineName(routine) << " (" << addressToString(routine) << ")\n";
+   }
+
+   return oss.str();
+}
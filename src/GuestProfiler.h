@@ -0,0 +1,137 @@
+#ifndef GUESTPROFILER_H
+#define GUESTPROFILER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Cpu6502Defines.h"
+
+class EventScheduler;
+
+/// Cycles between samples when none is configured
+#define DEFAULT_PROFILER_SAMPLE_CYCLES 1000
+
+/// Deeper calls are counted as part of the routine at this depth
+#define PROFILER_MAX_DEPTH 64
+
+/// Routines in the report written at exit
+#define PROFILER_REPORT_ROUTINES 20
+
+typedef struct ProfilerFrameStruct
+{
+   CpuAddress theRoutine;
+
+   /// Stack pointer after the return address was pushed
+   uint8_t theStackPtr;
+} ProfilerFrame;
+
+/**
+ * Profiles the guest: keeps a shadow call stack from JSR / BRK / interrupts and RTS / RTI, and
+ * every N cycles adds the cycles since the last sample to the routines on the stack.  Only the
+ * call / return instructions and the sample events cost anything, so it can run all the time.
+ *
+ * Frames are popped when a return leaves the stack pointer above the frame, or a call pushes its
+ * return address over it.  So guest code that jumps with RTS (pushing an address and returning to
+ * it), or that resets the stack and jumps back to its main loop, doesn't leave the shadow stack out
+ * of step for long.
+ *
+ * The profile can be written as collapsed stacks (routine;routine;routine cycles, one stack per
+ * line) for flamegraph.pl, or as a report of the routines that took the most cycles.  Routines are
+ * named from a symbol file (the disassembler writes its labels to one), or sub_0x1234 like the
+ * disassembler names them.
+ */
+class GuestProfiler
+{
+public:
+   GuestProfiler(EventScheduler* scheduler);
+
+   ~GuestProfiler();
+
+   /**
+    * Clears the profile and starts sampling
+    * @param sampleCycles Cycles between samples
+    * @param entryPc Bottom of the call stack (where the CPU is)
+    */
+   void start(uint32_t sampleCycles, CpuAddress entryPc);
+
+   void stop();
+
+   inline bool isRunning() const
+   {
+      return theRunningFlag;
+   }
+
+   /// Starts over with an empty call stack after a state was loaded (the scheduled sample was
+   /// dropped with the other events), the profile is kept
+   void restart(CpuAddress entryPc);
+
+   /// Called after a JSR, BRK or interrupt pushed its return address
+   inline void enterRoutine(CpuAddress routine, uint8_t stackPtr)
+   {
+      // Frames at or above the stack pointer were abandoned (the stack was reset)
+      while( (theStack.size() > 1) && (theStack.back().theStackPtr <= stackPtr) )
+      {
+         theStack.pop_back();
+      }
+
+      if (theStack.size() < PROFILER_MAX_DEPTH)
+      {
+         ProfilerFrame frame = { routine, stackPtr };
+         theStack.push_back(frame);
+      }
+   }
+
+   /// Called after an RTS or RTI pulled its return address
+   inline void leaveRoutine(uint8_t stackPtr)
+   {
+      while( (theStack.size() > 1) && (theStack.back().theStackPtr < stackPtr) )
+      {
+         theStack.pop_back();
+      }
+   }
+
+   /**
+    * Reads routine names from a symbol file.  Each line is a hex address and a name (0x1234 name
+    * like the disassembler's -s file, or the al 001234 .name labels from ld65 -Ln / VICE)
+    */
+   bool loadSymbols(std::string const & filename);
+
+   std::string getRoutineName(CpuAddress routine) const;
+
+   /// Every call stack sampled and its cycles, one line each for flamegraph.pl
+   std::string getCollapsedStacks() const;
+
+   bool dumpCollapsedStacks(std::string const & filename) const;
+
+   /// The routines with the most cycles (of their own, and including the routines they called)
+   std::string getReport(unsigned int numRoutines) const;
+
+   uint64_t getSampledCycles() const;
+
+protected:
+
+   static void sampleEvent(void* context);
+
+   void takeSample();
+
+   EventScheduler* theScheduler;
+
+   bool theRunningFlag;
+
+   uint32_t theSampleCycles;
+
+   uint32_t theSampleEventId;
+
+   uint64_t theLastSampleClock;
+
+   std::vector<ProfilerFrame> theStack;
+
+   /// Cycles of each call stack sampled (routines from the bottom of the stack up)
+   std::map<std::vector<CpuAddress>, uint64_t> theSamples;
+
+   std::map<CpuAddress, std::string> theSymbols;
+};
+
+#endif // GUESTPROFILER_H
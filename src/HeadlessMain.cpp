@@ -0,0 +1,131 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "EmulatorConfig.h"
+#include "ConfigManager.h"
+#include "Machine.h"
+#include "TraceBuffer.h"
+#include "FlightRecorder.h"
+#include "GoldenLog.h"
+#include "Logger.h"
+
+/**
+ * Headless emulator, runs the CPU on the main thread without any display, debugger or SDL.
+ * Meant for test runs where starting up the video / networking would take longer than the run
+ * itself.
+ */
+
+const std::string CONFIGFILE_TYPE = "config";
+const std::string CONFIGFILE_NAME = "filename";
+
+void printUsage(char* appName)
+{
+   std::cout << appName << " is a 6502 emulator without any display or debugger" << std::endl;
+
+   std::cout << std::endl;
+
+   std::cout << "  " << CONFIGFILE_TYPE << ".uniquename." << CONFIGFILE_NAME << "=config.txt" << std::endl;
+   std::cout << std::endl;
+
+   std::cout << "  ROM.uniquename.filename=data.bin" << std::endl;
+   std::cout << "  ROM.uniquename.address=0x1234" << std::endl;
+   std::cout << std::endl;
+
+   std::cout << "  RAM.uniquename.size=0x1000" << std::endl;
+   std::cout << "  RAM.uniquename.startAddress=0x0000" << std::endl;
+   std::cout << std::endl;
+
+   std::cout << "  RNG.uniquename.size=1" << std::endl;
+   std::cout << "  RNG.uniquename.startAddress=0xff" << std::endl;
+   std::cout << std::endl;
+
+   std::cout << "  MirrorMemory.uniquename.size=0x100" << std::endl;
+   std::cout << "  MirrorMemory.uniquename.cloneDest=0x100" << std::endl;
+   std::cout << "  MirrorMemory.uniquename.cloneSource=0x200" << std::endl;
+   std::cout << std::endl;
+
+   std::cout << "  iNES.uniquename.filename=game.nes" << std::endl;
+   std::cout << std::endl;
+
+   std::cout << "  " << EMULATOR_TYPE << ".system." << EMUSTART_NAME << "=0x1234" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << CLOCKHZ_NAME << "=1789773   (default 1000000)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << UNTHROTTLED_NAME << "=0   (default 1, run as fast as possible)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << CPUCORE_NAME << "=switch   (handler, switch or block, default handler)" << std::endl;
+
+   std::cout << "  " << EMULATOR_TYPE << ".system." << TRACE_NAME << "=1   (binary trace of every instruction in trace.bin)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << TRACEMAXSTALL_NAME << "=0   (drop trace records instead of waiting for the disk, default "
+             << DEFAULT_TRACE_MAX_STALL_MS << ")" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << TRACEMODE_NAME << "=flow   (full or flow, flow only records branches, jump targets and interrupts)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << FLIGHTRECORDER_NAME << "=65536   (instructions written to flight.bin on a halt, default "
+             << DEFAULT_FLIGHT_RECORDER_SIZE << ")" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << TRACESTEPS_NAME << "=100" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << LOADSTATE_NAME << "=state.bin   (restore the machine from a save state before starting)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << SAVESTATE_NAME << "=state.bin   (save the machine when the emulator stops)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << REWIND_NAME << "=60   (keep the last seconds for the rewind commands)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << REWINDMEMORY_NAME << "=4096   (memory budget of the rewind buffer)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << RECORDINPUTS_NAME << "=inputs.bin   (log keys, UART data and RNG seeds)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << REPLAYINPUTS_NAME << "=inputs.bin   (replay a log unthrottled, without the keyboard or network)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << COUNTERS_NAME << "=counters.json   (write the instructions / cycles executed per op code at exit)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << PROFILE_NAME << "=profile.folded   (profile the guest, collapsed stacks for flamegraph.pl written at exit)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << PROFILESAMPLE_NAME << "=1000   (cycles between profile samples, default "
+             << DEFAULT_PROFILER_SAMPLE_CYCLES << ")" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << PROFILESYMBOLS_NAME << "=program.sym   (routine names for the profile, address name per line)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << GOLDENLOG_NAME << "=nestest.log   (compare every instruction to a known good log, stop at the first difference)" << std::endl;
+   std::cout << "  " << EMULATOR_TYPE << ".system." << GOLDENLOGCYCLES_NAME << "=1   (compare the CYC: column of the log too, default 0)" << std::endl;
+
+   std::cout << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc == 1)
+   {
+      printUsage(argv[0]);
+      return 0;
+   }
+
+   ConfigManager* configMgr = ConfigManager::createInstance();
+   configMgr->processArgs(argc, argv);
+
+   if(configMgr->isConfigPresent(CONFIGFILE_TYPE, CONFIGFILE_NAME))
+   {
+      std::string configFileName = configMgr->getStringConfigValue(CONFIGFILE_TYPE, CONFIGFILE_NAME);
+
+      LOG_DEBUG() << "Load configuration from file: " << configFileName;
+      configMgr->loadConfigFile(configFileName);
+   }
+
+   Machine* machine = new Machine(configMgr);
+
+   if (configMgr->isConfigPresent(EMULATOR_TYPE, GOLDENLOG_NAME) && (machine->getGoldenLog() == nullptr))
+   {
+      // A regression run that can't compare anything shouldn't look like it passed
+      delete machine;
+      configMgr->destroyInstance();
+      return 1;
+   }
+
+   if (!configMgr->isConfigPresent(EMULATOR_TYPE, UNTHROTTLED_NAME))
+   {
+      // Nobody is watching a headless run, so it runs as fast as it can unless asked not to
+      machine->getCpu()->setThrottle(false);
+   }
+
+   // Returns when the emulator halts
+   machine->getCpu()->start();
+
+   int retVal = 0;
+   GoldenLog* goldenLog = machine->getGoldenLog();
+   if (goldenLog != nullptr)
+   {
+      printf("%s", goldenLog->getReport().c_str());
+      retVal = (goldenLog->isPassed() ? 0 : 1);
+   }
+
+   delete machine;
+
+   configMgr->destroyInstance();
+
+   return retVal;
+}
@@ -0,0 +1,259 @@
+#include <string.h>
+#include <errno.h>
+
+#include "InputLog.h"
+#include "EventScheduler.h"
+#include "EmulatorConfig.h"
+#include "Logger.h"
+
+#ifdef INPUT_LOG_TRACE
+   #define INPUT_DEBUG    LOG_DEBUG
+#else
+   #define INPUT_DEBUG    if(0) LOG_DEBUG
+#endif
+
+/// Records are written to the file in blocks of about this size
+#define INPUT_LOG_FLUSH_SIZE 0x1000
+
+InputLog::InputLog(EventScheduler* scheduler):
+   theMode(INPUT_LOG_OFF),
+   theScheduler(scheduler),
+   theFile(NULL),
+   theLastClock(0),
+   theDivergedFlag(false)
+{
+   memset(theReplayIndex, 0, sizeof(theReplayIndex));
+}
+
+InputLog::~InputLog()
+{
+   stop();
+}
+
+bool InputLog::startRecording(std::string const & filename)
+{
+   stop();
+
+   theFile = fopen(filename.c_str(), "wb");
+   if (theFile == NULL)
+   {
+      LOG_WARNING() << "Couldn't open input log " << filename << ": " << strerror(errno);
+      return false;
+   }
+
+   InputLogHeader hdr;
+   memset(&hdr, 0, sizeof(InputLogHeader));
+   memcpy(hdr.theMagic, INPUT_LOG_MAGIC, sizeof(hdr.theMagic));
+   hdr.theVersion = INPUT_LOG_VERSION;
+
+   theRecordBuffer.assign((uint8_t*) &hdr, (uint8_t*) &hdr + sizeof(InputLogHeader));
+
+   theFilename = filename;
+   theLastClock = 0;
+   theMode = INPUT_LOG_RECORD;
+
+   LOG_DEBUG() << "Recording inputs to " << filename;
+   return true;
+}
+
+bool InputLog::startReplay(std::string const & filename)
+{
+   stop();
+
+   FILE* f = fopen(filename.c_str(), "rb");
+   if (f == NULL)
+   {
+      LOG_WARNING() << "Couldn't open input log " << filename << ": " << strerror(errno);
+      return false;
+   }
+
+   std::vector<uint8_t> data;
+   uint8_t block[INPUT_LOG_FLUSH_SIZE];
+   size_t bytesRead;
+   while( (bytesRead = fread(block, 1, sizeof(block), f)) > 0)
+   {
+      data.insert(data.end(), block, block + bytesRead);
+   }
+   fclose(f);
+
+   InputLogHeader const * hdr = (InputLogHeader const *) data.data();
+   if ( (data.size() < sizeof(InputLogHeader)) ||
+        (memcmp(hdr->theMagic, INPUT_LOG_MAGIC, sizeof(hdr->theMagic)) != 0) )
+   {
+      LOG_WARNING() << filename << " isn't an input log";
+      return false;
+   }
+
+   if (hdr->theVersion != INPUT_LOG_VERSION)
+   {
+      LOG_WARNING() << "Input log " << filename << " is version " << hdr->theVersion
+                    << ", only version " << INPUT_LOG_VERSION << " is supported";
+      return false;
+   }
+
+   size_t pos = sizeof(InputLogHeader);
+   uint64_t clock = 0;
+   uint64_t numRecords = 0;
+   while(pos < data.size())
+   {
+      uint8_t source = data[pos++];
+
+      uint64_t clockDelta;
+      uint64_t value;
+      if ( (source >= INPUT_NUM_SOURCES) ||
+           !readVarint(&data[0], data.size(), &pos, &clockDelta) ||
+           !readVarint(&data[0], data.size(), &pos, &value) )
+      {
+         LOG_WARNING() << "Input log " << filename << " is corrupt after " << numRecords
+                       << " records";
+         break;
+      }
+
+      clock += clockDelta;
+
+      InputRecord rec;
+      rec.theClock = clock;
+      rec.theValue = (uint32_t) value;
+      theReplayRecords[source].push_back(rec);
+      numRecords++;
+   }
+
+   theMode = INPUT_LOG_REPLAY;
+
+   LOG_DEBUG() << "Replaying " << numRecords << " inputs from " << filename;
+   return true;
+}
+
+void InputLog::stop()
+{
+   if (theMode == INPUT_LOG_RECORD)
+   {
+      flush();
+      fclose(theFile);
+      theFile = NULL;
+
+      INPUT_DEBUG() << "Input log " << theFilename << " closed";
+   }
+
+   for(int i = 0; i < INPUT_NUM_SOURCES; i++)
+   {
+      theReplayRecords[i].clear();
+      theReplayIndex[i] = 0;
+   }
+
+   theDivergedFlag = false;
+   theMode = INPUT_LOG_OFF;
+}
+
+void InputLog::record(InputSource source, uint32_t value)
+{
+   if (theMode != INPUT_LOG_RECORD)
+   {
+      return;
+   }
+
+   uint64_t clock = theScheduler->getClock();
+   if (clock < theLastClock)
+   {
+      // A state was loaded or the machine rewound, the log can only go forward
+      LOG_WARNING() << "Input logged at clock " << clock << ", after clock " << theLastClock;
+      clock = theLastClock;
+   }
+
+   INPUT_DEBUG() << "Input " << (int) source << " = " << value << " at clock " << clock;
+
+   theRecordBuffer.push_back((uint8_t) source);
+   writeVarint(clock - theLastClock);
+   writeVarint(value);
+
+   theLastClock = clock;
+
+   if (theRecordBuffer.size() >= INPUT_LOG_FLUSH_SIZE)
+   {
+      flush();
+   }
+}
+
+bool InputLog::replayNext(InputSource source, uint32_t* value)
+{
+   if ( (theMode != INPUT_LOG_REPLAY) ||
+        (theReplayIndex[source] >= theReplayRecords[source].size()) )
+   {
+      return false;
+   }
+
+   InputRecord const & rec = theReplayRecords[source][theReplayIndex[source]];
+   uint64_t clock = theScheduler->getClock();
+   if (rec.theClock > clock)
+   {
+      return false;
+   }
+
+   if ( (rec.theClock < clock) && !theDivergedFlag)
+   {
+      // The CPU didn't look at the device at the same clock count as when recording
+      LOG_WARNING() << "Replay has diverged from the input log at clock " << clock
+                    << " (input was logged at " << rec.theClock << ")";
+      theDivergedFlag = true;
+   }
+
+   *value = rec.theValue;
+   theReplayIndex[source]++;
+   return true;
+}
+
+bool InputLog::replayAny(InputSource source, uint32_t* value)
+{
+   if ( (theMode != INPUT_LOG_REPLAY) ||
+        (theReplayIndex[source] >= theReplayRecords[source].size()) )
+   {
+      return false;
+   }
+
+   *value = theReplayRecords[source][theReplayIndex[source]].theValue;
+   theReplayIndex[source]++;
+   return true;
+}
+
+void InputLog::writeVarint(uint64_t val)
+{
+   while(val >= 0x80)
+   {
+      theRecordBuffer.push_back( (uint8_t) (val | 0x80) );
+      val >>= 7;
+   }
+
+   theRecordBuffer.push_back( (uint8_t) val);
+}
+
+bool InputLog::readVarint(uint8_t const * data, size_t size, size_t* pos, uint64_t* val)
+{
+   *val = 0;
+   for(int shift = 0; (*pos < size) && (shift < 64); shift += 7)
+   {
+      uint8_t b = data[(*pos)++];
+      *val |= (uint64_t) (b & 0x7f) << shift;
+
+      if ( (b & 0x80) == 0)
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void InputLog::flush()
+{
+   if ( (theFile == NULL) || theRecordBuffer.empty())
+   {
+      return;
+   }
+
+   if (fwrite(&theRecordBuffer[0], 1, theRecordBuffer.size(), theFile) != theRecordBuffer.size())
+   {
+      LOG_WARNING() << "Failed to write input log " << theFilename;
+   }
+
+   theRecordBuffer.clear();
+}
@@ -0,0 +1,125 @@
+#ifndef INPUTLOG_H
+#define INPUTLOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+class EventScheduler;
+
+/// Identifies an input log file
+#define INPUT_LOG_MAGIC "6502INPT"
+
+/// Bumped whenever the layout of the records changes
+#define INPUT_LOG_VERSION 1
+
+/// Start of an input log file, followed by the records
+typedef struct InputLogHeaderStruct
+{
+   char theMagic[8];
+   uint32_t theVersion;
+   uint32_t theReserved;
+} InputLogHeader;
+
+typedef enum InputLogModeEnum
+{
+   INPUT_LOG_OFF,
+   INPUT_LOG_RECORD,
+   INPUT_LOG_REPLAY
+} InputLogMode;
+
+/// Where a value came from, each source is replayed in the order it was recorded
+typedef enum InputSourceEnum
+{
+   INPUT_SOURCE_KEYBOARD,  ///< Key the Easy6502 input device reports, logged when it changes
+   INPUT_SOURCE_UART,      ///< Byte the UART received from its socket
+   INPUT_SOURCE_RNG_SEED,  ///< Seed an RNG device picked when it was reset
+   INPUT_NUM_SOURCES
+} InputSource;
+
+typedef struct InputRecordStruct
+{
+   uint64_t theClock;
+   uint32_t theValue;
+} InputRecord;
+
+/**
+ * Records every value a device gets from outside the emulator (keys, network, the time the RNG
+ * was seeded), so a session can be run again exactly the same.  When replaying, the devices take
+ * the values from the log instead of SDL and sockets, so a replay can run headless and
+ * unthrottled.
+ *
+ * Each record is the source (1 byte), the clock count since the record before it and the value
+ * (both variable length, 7 bits a byte).  Devices log the value at the clock count the CPU saw it,
+ * and replaying hands the value back when the CPU gets to that clock count again.  The clock counts
+ * are only the same with the same CPU core, replay with the core the log was recorded with.
+ *
+ * The MemoryController owns the log, devices get to it through their memory controller.
+ */
+class InputLog
+{
+public:
+   InputLog(EventScheduler* scheduler);
+
+   ~InputLog();
+
+   /// Starts logging values to the file (replaces it)
+   bool startRecording(std::string const & filename);
+
+   /// Reads the whole log, devices take their values from it from now on
+   bool startReplay(std::string const & filename);
+
+   /// Writes out what is left of a recording, and stops recording / replaying
+   void stop();
+
+   inline InputLogMode getMode() const
+   {
+      return theMode;
+   }
+
+   /// Logs a value at the current clock count (does nothing unless recording)
+   void record(InputSource source, uint32_t value);
+
+   /**
+    * Gets the next value of the source if the CPU has gotten to the clock count it was logged at
+    * @return False if there isn't a value due (or not replaying)
+    */
+   bool replayNext(InputSource source, uint32_t* value);
+
+   /// Like replayNext, but takes the next value of the source no matter the clock count
+   bool replayAny(InputSource source, uint32_t* value);
+
+protected:
+
+   void writeVarint(uint64_t val);
+
+   bool readVarint(uint8_t const * data, size_t size, size_t* pos, uint64_t* val);
+
+   /// Writes the buffered records to the file
+   void flush();
+
+   InputLogMode theMode;
+
+   EventScheduler* theScheduler;
+
+   FILE* theFile;
+
+   std::string theFilename;
+
+   /// Records that haven't been written to the file yet
+   std::vector<uint8_t> theRecordBuffer;
+
+   /// Clock count of the last record logged, records store the difference
+   uint64_t theLastClock;
+
+   /// Replayed values of each source, and the index of the next one to hand out
+   std::vector<InputRecord> theReplayRecords[INPUT_NUM_SOURCES];
+
+   size_t theReplayIndex[INPUT_NUM_SOURCES];
+
+   /// Set once a value is handed out later than it was logged, so the warning isn't repeated
+   bool theDivergedFlag;
+};
+
+#endif // INPUTLOG_H
@@ -0,0 +1,116 @@
+#include "InterruptController.h"
+#include "SaveState.h"
+#include "EmulatorConfig.h"
+#include "Logger.h"
+
+#ifdef INTERRUPT_TRACE
+   #define IRQ_DEBUG   LOG_DEBUG
+#else
+   #define IRQ_DEBUG   if(0) LOG_DEBUG
+#endif
+
+InterruptController::InterruptController():
+   theIrqSources(0),
+   theNmiSources(0),
+   theNmiPendingFlag(false),
+   theLinesChangedFlag(false),
+   theAllocatedSources(0)
+{
+}
+
+uint32_t InterruptController::allocateSource()
+{
+   for(int i = 0; i < 32; i++)
+   {
+      uint32_t source = 1u << i;
+      if ( (theAllocatedSources & source) == 0)
+      {
+         theAllocatedSources |= source;
+         return source;
+      }
+   }
+
+   LOG_WARNING() << "All of the interrupt sources are already allocated";
+   return 0;
+}
+
+void InterruptController::setIrqLine(uint32_t source, bool asserted)
+{
+   if (!asserted)
+   {
+      theIrqSources.fetch_and(~source);
+      return;
+   }
+
+   if (theIrqSources.fetch_or(source) == 0)
+   {
+      IRQ_DEBUG() << "IRQ asserted";
+
+      // The CPU looks at the lines at its next boundary
+      theLinesChangedFlag = true;
+   }
+}
+
+void InterruptController::setNmiLine(uint32_t source, bool asserted)
+{
+   if (!asserted)
+   {
+      theNmiSources.fetch_and(~source);
+      return;
+   }
+
+   if (theNmiSources.fetch_or(source) == 0)
+   {
+      IRQ_DEBUG() << "NMI edge";
+
+      theNmiPendingFlag = true;
+      theLinesChangedFlag = true;
+   }
+}
+
+bool InterruptController::acknowledgeNmi()
+{
+   return theNmiPendingFlag.exchange(false);
+}
+
+void InterruptController::reset()
+{
+   theIrqSources = 0;
+   theNmiSources = 0;
+   theNmiPendingFlag = false;
+   theLinesChangedFlag = false;
+}
+
+void InterruptController::saveState(SaveState* state)
+{
+   state->writeU32(theIrqSources);
+   state->writeU32(theNmiSources);
+   state->writeU8(theNmiPendingFlag ? 1 : 0);
+}
+
+bool InterruptController::readState(SaveState* state, uint32_t* irqSources, uint32_t* nmiSources,
+                                    bool* nmiPending)
+{
+   uint8_t pending;
+   if (!state->readU32(irqSources) || !state->readU32(nmiSources) || !state->readU8(&pending))
+   {
+      return false;
+   }
+
+   *nmiPending = (pending != 0);
+   return true;
+}
+
+void InterruptController::getLines(uint32_t* irqSources, uint32_t* nmiSources, bool* nmiPending) const
+{
+   *irqSources = theIrqSources;
+   *nmiSources = theNmiSources;
+   *nmiPending = theNmiPendingFlag;
+}
+
+void InterruptController::setLines(uint32_t irqSources, uint32_t nmiSources, bool nmiPending)
+{
+   theIrqSources = irqSources;
+   theNmiSources = nmiSources;
+   theNmiPendingFlag = nmiPending;
+}
@@ -0,0 +1,98 @@
+#ifndef INTERRUPTCONTROLLER_H
+#define INTERRUPTCONTROLLER_H
+
+#include <stdint.h>
+#include <atomic>
+
+class SaveState;
+
+/**
+ * The IRQ and NMI inputs of the CPU.  Owned by the MemoryController, devices get to it the same
+ * way they get to the EventScheduler.
+ *
+ * Both lines are wired-or, every device that can pull them low allocates its own source bit.
+ * IRQ is level triggered, the CPU takes it at an instruction boundary for as long as any source
+ * asserts it and the interrupt disable flag is clear.  NMI is edge triggered, the CPU takes it
+ * once every time the line goes from released to asserted.
+ *
+ * The CPU doesn't look at the lines per instruction.  Asserting a line sets the lines changed
+ * flag, which the CPU checks at batch and event boundaries, and after every access to a memory
+ * mapped device (so a device that asserts a line when it is written interrupts the very next
+ * instruction).  The lines and the flag are atomic, so devices running in other threads can change
+ * the lines too, the CPU notices by the end of the batch it is running.
+ */
+class InterruptController
+{
+public:
+   InterruptController();
+
+   /**
+    * Gives a device its own source bit for the lines
+    * @return The source bit, or 0 if all 32 sources are already allocated
+    */
+   uint32_t allocateSource();
+
+   /// Asserts (pulls low) or releases the IRQ line for the source
+   void setIrqLine(uint32_t source, bool asserted);
+
+   /// Asserts (pulls low) or releases the NMI line for the source
+   void setNmiLine(uint32_t source, bool asserted);
+
+   /// Is any source asserting IRQ
+   inline bool isIrqAsserted() const
+   {
+      return theIrqSources.load(std::memory_order_relaxed) != 0;
+   }
+
+   /// Has the NMI line had an edge the CPU hasn't taken yet
+   inline bool isNmiPending() const
+   {
+      return theNmiPendingFlag.load(std::memory_order_relaxed);
+   }
+
+   /**
+    * Called by the CPU at a boundary where it looks at the lines
+    * @return True if a line was asserted since the last call
+    */
+   inline bool takeLinesChanged()
+   {
+      return theLinesChangedFlag.load(std::memory_order_relaxed) &&
+             theLinesChangedFlag.exchange(false);
+   }
+
+   /**
+    * Called by the CPU when it takes the NMI
+    * @return True if an NMI edge was pending
+    */
+   bool acknowledgeNmi();
+
+   /// Releases both lines and forgets a pending NMI.  Sources stay allocated.
+   void reset();
+
+   /// Writes the lines and whether an NMI is pending (part of the CPU's save state chunk)
+   void saveState(SaveState* state);
+
+   /// Reads the lines saveState wrote, without changing anything (setLines applies them)
+   static bool readState(SaveState* state, uint32_t* irqSources, uint32_t* nmiSources,
+                         bool* nmiPending);
+
+   void getLines(uint32_t* irqSources, uint32_t* nmiSources, bool* nmiPending) const;
+
+   void setLines(uint32_t irqSources, uint32_t nmiSources, bool nmiPending);
+
+protected:
+
+   /// Sources that have the line asserted
+   std::atomic<uint32_t> theIrqSources;
+   std::atomic<uint32_t> theNmiSources;
+
+   std::atomic<bool> theNmiPendingFlag;
+
+   /// Set when a line is asserted, until the CPU looks at the lines
+   std::atomic<bool> theLinesChangedFlag;
+
+   /// Bits given out by allocateSource
+   uint32_t theAllocatedSources;
+};
+
+#endif // INTERRUPTCONTROLLER_H
@@ -0,0 +1,206 @@
+#include <string.h>
+
+#include "LzCodec.h"
+
+#define MIN_MATCH       4
+
+/// Matches can't start in the last bytes of the input, they are always literals
+#define LAST_LITERALS   8
+
+#define MAX_OFFSET      0xffff
+
+#define HASH_BITS       13
+
+static inline uint32_t read32(uint8_t const * p)
+{
+   uint32_t val;
+   memcpy(&val, p, sizeof(val));
+   return val;
+}
+
+static inline uint32_t hashSequence(uint32_t seq)
+{
+   return (seq * 2654435761U) >> (32 - HASH_BITS);
+}
+
+/// Writes the extra length bytes for a length that didn't fit in its nibble
+static inline uint8_t* writeExtraLength(uint8_t* op, size_t len)
+{
+   while(len >= 255)
+   {
+      *op++ = 255;
+      len -= 255;
+   }
+
+   *op++ = len;
+   return op;
+}
+
+/// Writes a sequence, a matchLen of 0 is the last literals only sequence
+static uint8_t* writeSequence(uint8_t* op, uint8_t const * literals, size_t numLiterals,
+                              size_t offset, size_t matchLen)
+{
+   uint8_t* token = op++;
+
+   size_t litNibble = (numLiterals >= 15 ? 15 : numLiterals);
+   if (numLiterals >= 15)
+   {
+      op = writeExtraLength(op, numLiterals - 15);
+   }
+
+   memcpy(op, literals, numLiterals);
+   op += numLiterals;
+
+   size_t matchNibble = 0;
+   if (matchLen > 0)
+   {
+      *op++ = offset & 0xff;
+      *op++ = offset >> 8;
+
+      size_t len = matchLen - MIN_MATCH;
+      matchNibble = (len >= 15 ? 15 : len);
+      if (len >= 15)
+      {
+         op = writeExtraLength(op, len - 15);
+      }
+   }
+
+   *token = (litNibble << 4) | matchNibble;
+   return op;
+}
+
+size_t LzCodec::compressBound(size_t srcLen)
+{
+   return srcLen + (srcLen / 255) + 16;
+}
+
+size_t LzCodec::compress(uint8_t const * src, size_t srcLen, uint8_t* dst)
+{
+   // Positions + 1 of the last sequence with each hash, 0 is empty
+   uint32_t hashTable[1 << HASH_BITS];
+   memset(hashTable, 0, sizeof(hashTable));
+
+   uint8_t* op = dst;
+   size_t ip = 0;
+   size_t anchor = 0;
+
+   if (srcLen > LAST_LITERALS + MIN_MATCH)
+   {
+      size_t matchLimit = srcLen - LAST_LITERALS;
+      while(ip + MIN_MATCH <= matchLimit)
+      {
+         uint32_t seq = read32(src + ip);
+         uint32_t h = hashSequence(seq);
+         size_t ref = hashTable[h];
+         hashTable[h] = ip + 1;
+
+         if ( (ref == 0) || (ip - (ref - 1) > MAX_OFFSET) || (read32(src + ref - 1) != seq) )
+         {
+            ip++;
+            continue;
+         }
+
+         ref--;
+
+         size_t matchLen = MIN_MATCH;
+         while( (ip + matchLen < matchLimit) && (src[ref + matchLen] == src[ip + matchLen]) )
+         {
+            matchLen++;
+         }
+
+         op = writeSequence(op, src + anchor, ip - anchor, ip - ref, matchLen);
+
+         ip += matchLen;
+         anchor = ip;
+      }
+   }
+
+   op = writeSequence(op, src + anchor, srcLen - anchor, 0, 0);
+
+   return op - dst;
+}
+
+/// Reads the extra length bytes after a nibble of 15
+static inline bool readExtraLength(uint8_t const * & ip, uint8_t const * end, size_t* len)
+{
+   uint8_t val;
+   do
+   {
+      if (ip >= end)
+      {
+         return false;
+      }
+
+      val = *ip++;
+      *len += val;
+   } while(val == 255);
+
+   return true;
+}
+
+bool LzCodec::decompress(uint8_t const * src, size_t srcLen, uint8_t* dst, size_t dstLen)
+{
+   uint8_t const * ip = src;
+   uint8_t const * ipEnd = src + srcLen;
+   size_t op = 0;
+
+   while(op < dstLen)
+   {
+      if (ip >= ipEnd)
+      {
+         return false;
+      }
+
+      uint8_t token = *ip++;
+
+      size_t numLiterals = token >> 4;
+      if ( (numLiterals == 15) && !readExtraLength(ip, ipEnd, &numLiterals) )
+      {
+         return false;
+      }
+
+      if ( (numLiterals > (size_t) (ipEnd - ip)) || (numLiterals > dstLen - op) )
+      {
+         return false;
+      }
+
+      memcpy(dst + op, ip, numLiterals);
+      ip += numLiterals;
+      op += numLiterals;
+
+      if (op == dstLen)
+      {
+         // Last sequence doesn't have a match
+         break;
+      }
+
+      if (ipEnd - ip < 2)
+      {
+         return false;
+      }
+
+      size_t offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+
+      size_t matchLen = token & 0xf;
+      if ( (matchLen == 15) && !readExtraLength(ip, ipEnd, &matchLen) )
+      {
+         return false;
+      }
+      matchLen += MIN_MATCH;
+
+      if ( (offset == 0) || (offset > op) || (matchLen > dstLen - op) )
+      {
+         return false;
+      }
+
+      // Byte at a time, the match can overlap the bytes it is producing
+      for(size_t i = 0; i < matchLen; i++)
+      {
+         dst[op + i] = dst[op - offset + i];
+      }
+      op += matchLen;
+   }
+
+   return true;
+}
@@ -0,0 +1,41 @@
+#ifndef LZCODEC_H
+#define LZCODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Small LZ77 style codec (same idea as LZ4) for the trace files, so the emulator doesn't need
+ * zlib.  It is fast rather than tight.
+ *
+ * The compressed data is a list of sequences.  Each sequence is:
+ * @li Token byte: high nibble is the number of literals, low nibble is the match length - 4.  A
+ *     nibble of 15 is followed by extra length bytes (255 means another byte follows)
+ * @li The literals
+ * @li 16-bit little endian offset back to the start of the match
+ *
+ * The last sequence only has literals, the decoder knows it is done when it has produced the
+ * expected number of bytes.
+ */
+class LzCodec
+{
+public:
+   /// Worst case compressed size for srcLen bytes of input
+   static size_t compressBound(size_t srcLen);
+
+   /**
+    * Compresses the source data
+    * @param dst Must be at least compressBound(srcLen) bytes
+    * @return Number of bytes written to dst
+    */
+   static size_t compress(uint8_t const * src, size_t srcLen, uint8_t* dst);
+
+   /**
+    * Decompresses data from compress
+    * @param dstLen The exact number of bytes the data decompresses to
+    * @return False if the compressed data is corrupt
+    */
+   static bool decompress(uint8_t const * src, size_t srcLen, uint8_t* dst, size_t dstLen);
+};
+
+#endif // LZCODEC_H
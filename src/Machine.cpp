@@ -0,0 +1,268 @@
+#include "Machine.h"
+#include "EmulatorConfig.h"
+#include "ConfigManager.h"
+#include "MemoryFactory.h"
+#include "MemoryController.h"
+#include "RewindBuffer.h"
+#include "GoldenLog.h"
+#include "Logger.h"
+
+const std::string EMULATOR_TYPE = "emulator";
+const std::string EMUSTART_NAME = "startAddress";
+const std::string TRACE_NAME = "trace";
+const std::string TRACESTEPS_NAME = "stepCount";
+const std::string TRACEMAXSTALL_NAME = "traceMaxStallMs";
+const std::string TRACEMODE_NAME = "traceMode";
+const std::string FLIGHTRECORDER_NAME = "flightRecorderSize";
+const std::string CLOCKHZ_NAME = "clockHz";
+const std::string UNTHROTTLED_NAME = "unthrottled";
+const std::string CPUCORE_NAME = "core";
+const std::string SAVESTATE_NAME = "saveState";
+const std::string LOADSTATE_NAME = "loadState";
+const std::string REWIND_NAME = "rewindSeconds";
+const std::string REWINDMEMORY_NAME = "rewindMemoryKb";
+const std::string RECORDINPUTS_NAME = "recordInputs";
+const std::string REPLAYINPUTS_NAME = "replayInputs";
+const std::string COUNTERS_NAME = "countersFile";
+const std::string PROFILE_NAME = "profileFile";
+const std::string PROFILESAMPLE_NAME = "profileSampleCycles";
+const std::string PROFILESYMBOLS_NAME = "profileSymbols";
+const std::string GOLDENLOG_NAME = "goldenLog";
+const std::string GOLDENLOGCYCLES_NAME = "goldenLogCycles";
+
+Machine::Machine(ConfigManager* cfgMgr, MemoryTypeList const & extraMemoryTypes):
+   theGoldenLog(nullptr)
+{
+   if (cfgMgr == nullptr)
+   {
+      cfgMgr = ConfigManager::getInstance();
+   }
+
+   theMemoryController = new MemoryController();
+
+   MemoryFactory memFactory(theMemoryController, cfgMgr);
+   for(auto const & memType: extraMemoryTypes)
+   {
+      memFactory.addMemoryType(memType.first, memType.second);
+   }
+
+   memFactory.processConfigData();
+
+   CpuAddress startAddress = 0;
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, EMUSTART_NAME))
+   {
+      startAddress = cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, EMUSTART_NAME);
+      LOG_DEBUG() << "Start Address set by config:" << addressToString(startAddress);
+   }
+   else if (theMemoryController->getStartAddress(&startAddress))
+   {
+      LOG_DEBUG() << "Start Address set my memory controller:" << addressToString(startAddress);
+   }
+   else
+   {
+      LOG_WARNING() << "No start address found!";
+   }
+
+   theCpu = new Cpu6502(theMemoryController);
+
+   theCpu->setAddress(startAddress);
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, CLOCKHZ_NAME))
+   {
+      theCpu->setClockRate(cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, CLOCKHZ_NAME));
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, UNTHROTTLED_NAME))
+   {
+      theCpu->setThrottle(cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, UNTHROTTLED_NAME) == 0);
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, CPUCORE_NAME))
+   {
+      std::string coreName = cfgMgr->getStringConfigValue(EMULATOR_TYPE, CPUCORE_NAME);
+      if (coreName == "switch")
+      {
+         theCpu->setCoreType(SWITCH_CORE);
+      }
+      else if (coreName == "block")
+      {
+         theCpu->setCoreType(BLOCK_CACHE_CORE);
+      }
+      else if (coreName != "handler")
+      {
+         LOG_WARNING() << "Unknown CPU core " << coreName << ", using the handler core";
+      }
+
+      LOG_DEBUG() << "CPU core:" << coreName;
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, FLIGHTRECORDER_NAME))
+   {
+      theCpu->setFlightRecorderSize(cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, FLIGHTRECORDER_NAME));
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, TRACEMODE_NAME))
+   {
+      std::string traceMode = cfgMgr->getStringConfigValue(EMULATOR_TYPE, TRACEMODE_NAME);
+      if (traceMode == "flow")
+      {
+         theCpu->setTraceMode(FLOW_TRACE);
+      }
+      else if (traceMode != "full")
+      {
+         LOG_WARNING() << "Unknown trace mode " << traceMode << ", using the full trace";
+      }
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, TRACE_NAME))
+   {
+      theCpu->setTraceEnabled(cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, TRACE_NAME) != 0);
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, TRACEMAXSTALL_NAME))
+   {
+      theCpu->setTraceMaxStall(cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, TRACEMAXSTALL_NAME));
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, TRACESTEPS_NAME))
+   {
+      uint64_t numSteps = cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, TRACESTEPS_NAME);
+      LOG_DEBUG() << "Trace Exectuion limited to" << numSteps << "steps";
+      theCpu->setStepLimit(numSteps);
+   }
+
+   // Devices log / replay their inputs from the moment they are reset
+   InputLog* inputLog = theMemoryController->getInputLog();
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, REPLAYINPUTS_NAME))
+   {
+      if (inputLog->startReplay(cfgMgr->getStringConfigValue(EMULATOR_TYPE, REPLAYINPUTS_NAME)))
+      {
+         // Nothing to wait for, the inputs are all in the log
+         theCpu->setThrottle(false);
+      }
+   }
+   else if (cfgMgr->isConfigPresent(EMULATOR_TYPE, RECORDINPUTS_NAME))
+   {
+      inputLog->startRecording(cfgMgr->getStringConfigValue(EMULATOR_TYPE, RECORDINPUTS_NAME));
+   }
+
+   theMemoryController->resetAll();
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, LOADSTATE_NAME))
+   {
+      theCpu->loadState(cfgMgr->getStringConfigValue(EMULATOR_TYPE, LOADSTATE_NAME));
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, REWIND_NAME))
+   {
+      uint32_t memoryKb = DEFAULT_REWIND_MEMORY_KB;
+      if (cfgMgr->isConfigPresent(EMULATOR_TYPE, REWINDMEMORY_NAME))
+      {
+         memoryKb = cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, REWINDMEMORY_NAME);
+      }
+
+      theCpu->setRewind(cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, REWIND_NAME), memoryKb);
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, SAVESTATE_NAME))
+   {
+      theCpu->setExitSaveStateFilename(cfgMgr->getStringConfigValue(EMULATOR_TYPE, SAVESTATE_NAME));
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, COUNTERS_NAME))
+   {
+      theCpu->setExitCountersFilename(cfgMgr->getStringConfigValue(EMULATOR_TYPE, COUNTERS_NAME));
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, PROFILESYMBOLS_NAME))
+   {
+      theCpu->getProfiler()->loadSymbols(cfgMgr->getStringConfigValue(EMULATOR_TYPE, PROFILESYMBOLS_NAME));
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, PROFILE_NAME))
+   {
+      uint32_t sampleCycles = DEFAULT_PROFILER_SAMPLE_CYCLES;
+      if (cfgMgr->isConfigPresent(EMULATOR_TYPE, PROFILESAMPLE_NAME))
+      {
+         sampleCycles = cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, PROFILESAMPLE_NAME);
+      }
+
+      theCpu->startProfiler(sampleCycles);
+      theCpu->setExitProfileFilename(cfgMgr->getStringConfigValue(EMULATOR_TYPE, PROFILE_NAME));
+   }
+
+   if (cfgMgr->isConfigPresent(EMULATOR_TYPE, GOLDENLOG_NAME))
+   {
+      theGoldenLog = new GoldenLog();
+      if (theGoldenLog->open(cfgMgr->getStringConfigValue(EMULATOR_TYPE, GOLDENLOG_NAME)))
+      {
+         if (cfgMgr->isConfigPresent(EMULATOR_TYPE, GOLDENLOGCYCLES_NAME))
+         {
+            theGoldenLog->setCheckCycles(cfgMgr->getIntegerConfigValue(EMULATOR_TYPE, GOLDENLOGCYCLES_NAME) != 0);
+         }
+
+         theCpu->setInstructionCheck(GoldenLog::checkInstructionCallback, theGoldenLog);
+      }
+      else
+      {
+         delete theGoldenLog;
+         theGoldenLog = nullptr;
+      }
+   }
+}
+
+Machine::~Machine()
+{
+   delete theCpu;
+
+   delete theMemoryController;
+
+   delete theGoldenLog;
+}
+
+Cpu6502* Machine::getCpu()
+{
+   return theCpu;
+}
+
+MemoryController* Machine::getMemoryController()
+{
+   return theMemoryController;
+}
+
+GoldenLog* Machine::getGoldenLog()
+{
+   return theGoldenLog;
+}
+
+void Machine::makeQuiet()
+{
+   theCpu->setTraceEnabled(false);
+   theCpu->setTraceFilename("");
+   theCpu->setFlightRecorderFilename("");
+   theCpu->setExitSaveStateFilename("");
+   theCpu->setExitCountersFilename("");
+   theCpu->setExitProfileFilename("");
+
+   theMemoryController->setDumpOnDestroy(false);
+}
+
+char const * Machine::getStopReasonName(CpuStopReason reason)
+{
+   switch(reason)
+   {
+   case STOP_BUDGET:
+      return "budget";
+
+   case STOP_BREAKPOINT:
+      return "breakpoint";
+
+   case STOP_HALT:
+      return "halt";
+
+   case STOP_KIL:
+      return "kil";
+   }
+
+   return "unknown";
+}
@@ -0,0 +1,83 @@
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include <string>
+#include <stdint.h>
+#include "Cpu6502.h"
+#include "MemoryFactory.h"
+
+class ConfigManager;
+class MemoryController;
+class GoldenLog;
+
+/// Configuration type / names of the emulator.system settings a Machine applies
+extern const std::string EMULATOR_TYPE;
+extern const std::string EMUSTART_NAME;
+extern const std::string TRACE_NAME;
+extern const std::string TRACESTEPS_NAME;
+extern const std::string TRACEMAXSTALL_NAME;
+extern const std::string TRACEMODE_NAME;
+extern const std::string FLIGHTRECORDER_NAME;
+extern const std::string CLOCKHZ_NAME;
+extern const std::string UNTHROTTLED_NAME;
+extern const std::string CPUCORE_NAME;
+extern const std::string SAVESTATE_NAME;
+extern const std::string LOADSTATE_NAME;
+extern const std::string REWIND_NAME;
+extern const std::string REWINDMEMORY_NAME;
+extern const std::string RECORDINPUTS_NAME;
+extern const std::string REPLAYINPUTS_NAME;
+extern const std::string COUNTERS_NAME;
+extern const std::string PROFILE_NAME;
+extern const std::string PROFILESAMPLE_NAME;
+extern const std::string PROFILESYMBOLS_NAME;
+extern const std::string GOLDENLOG_NAME;
+extern const std::string GOLDENLOGCYCLES_NAME;
+
+/**
+ * A complete emulated system: the memory controller, the memory devices and the CPU.  Everything
+ * a machine uses belongs to the machine, so any number of them can be created and run on
+ * different threads at the same time.
+ *
+ * The machine is built from a configuration, which is only used while the machine is being
+ * constructed.
+ */
+class Machine
+{
+public:
+   /**
+    * Creates the memory devices and the CPU, and applies the emulator.system settings (start
+    * address, clock rate, throttling, core type, trace, step limit, save states) from the
+    * configuration
+    * @param cfgMgr Configuration of the machine, nullptr for the ConfigManager singleton
+    * @param extraMemoryTypes Devices the application adds to the MemoryFactory (the displays
+    *        that need SDL)
+    */
+   Machine(ConfigManager* cfgMgr = nullptr,
+           MemoryTypeList const & extraMemoryTypes = MemoryTypeList());
+
+   ~Machine();
+
+   Cpu6502* getCpu();
+
+   MemoryController* getMemoryController();
+
+   /// The log the CPU is compared to (emulator.system.goldenLog), nullptr if there isn't one
+   GoldenLog* getGoldenLog();
+
+   /// Turns off the trace file, memory dump and exit save state, for machines that are run by the thousands
+   void makeQuiet();
+
+   /// Name of a stop reason for reports
+   static char const * getStopReasonName(CpuStopReason reason);
+
+protected:
+
+   MemoryController* theMemoryController;
+
+   Cpu6502* theCpu;
+
+   GoldenLog* theGoldenLog;
+};
+
+#endif // MACHINE_H
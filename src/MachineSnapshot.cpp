@@ -0,0 +1,124 @@
+#include <string.h>
+
+#include "MachineSnapshot.h"
+
+MachineSnapshot::MachineSnapshot()
+{
+   memset(thePages, 0, sizeof(thePages));
+   memset(&theCpuState, 0, sizeof(SnapshotCpuState));
+}
+
+MachineSnapshot::MachineSnapshot(MachineSnapshot const & other)
+{
+   memset(thePages, 0, sizeof(thePages));
+   *this = other;
+}
+
+MachineSnapshot& MachineSnapshot::operator=(MachineSnapshot const & other)
+{
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      setPage(i, other.thePages[i]);
+   }
+
+   theCpuState = other.theCpuState;
+   return *this;
+}
+
+MachineSnapshot::~MachineSnapshot()
+{
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      releasePage(thePages[i]);
+   }
+}
+
+uint8_t MachineSnapshot::read8(CpuAddress addr) const
+{
+   SnapshotPage* page = thePages[addr >> 8];
+   return (page != nullptr ? page->theData[addr & 0xff] : 0);
+}
+
+bool MachineSnapshot::write8(CpuAddress addr, uint8_t val)
+{
+   uint8_t* data = getWritablePage(addr >> 8);
+   if (data == nullptr)
+   {
+      return false;
+   }
+
+   data[addr & 0xff] = val;
+   return true;
+}
+
+uint8_t* MachineSnapshot::getWritablePage(int page)
+{
+   SnapshotPage* data = thePages[page];
+   if (data == nullptr)
+   {
+      return nullptr;
+   }
+
+   if (data->theRefCount.load() != 1)
+   {
+      // Shared, the other snapshots keep the original
+      SnapshotPage* copy = allocatePage();
+      memcpy(copy->theData, data->theData, sizeof(copy->theData));
+
+      releasePage(data);
+      thePages[page] = copy;
+      data = copy;
+   }
+
+   return data->theData;
+}
+
+void MachineSnapshot::setPage(int page, SnapshotPage* data)
+{
+   if (thePages[page] == data)
+   {
+      return;
+   }
+
+   if (data != nullptr)
+   {
+      addPageReference(data);
+   }
+
+   releasePage(thePages[page]);
+   thePages[page] = data;
+}
+
+int MachineSnapshot::getNumPrivatePages() const
+{
+   int retVal = 0;
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      if ( (thePages[i] != nullptr) && (thePages[i]->theRefCount.load() == 1) )
+      {
+         retVal++;
+      }
+   }
+
+   return retVal;
+}
+
+SnapshotPage* MachineSnapshot::allocatePage()
+{
+   SnapshotPage* page = new SnapshotPage;
+   page->theRefCount = 1;
+   return page;
+}
+
+void MachineSnapshot::addPageReference(SnapshotPage* page)
+{
+   page->theRefCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MachineSnapshot::releasePage(SnapshotPage* page)
+{
+   if ( (page != nullptr) && (page->theRefCount.fetch_sub(1) == 1) )
+   {
+      delete page;
+   }
+}
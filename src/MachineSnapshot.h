@@ -0,0 +1,111 @@
+#ifndef MACHINESNAPSHOT_H
+#define MACHINESNAPSHOT_H
+
+#include <stdint.h>
+#include <atomic>
+#include "Cpu6502Defines.h"
+#include "MemoryController.h"
+
+/// A 256-byte page of memory, shared by every snapshot that has the same contents for the page
+typedef struct SnapshotPageStruct
+{
+   std::atomic<uint32_t> theRefCount;
+   uint8_t theData[0x100];
+} SnapshotPage;
+
+/// Registers of the CPU and the interrupt lines when the snapshot was taken
+typedef struct SnapshotCpuStateStruct
+{
+   CpuAddress thePc;
+   uint8_t theAccum;
+   uint8_t theRegX;
+   uint8_t theRegY;
+   uint8_t theStackPtr;
+   uint8_t theStatusReg;
+   bool theJammedFlag;
+   uint64_t theNumClocks;
+   uint32_t theIrqSources;
+   uint32_t theNmiSources;
+   bool theNmiPendingFlag;
+} SnapshotCpuState;
+
+/**
+ * An in memory snapshot of a machine, for restoring the same starting point many times (fuzzing,
+ * exploring different inputs).  Only the pages of memory that are backed by host memory (RAM and
+ * ROM) are part of the snapshot.  Devices that have their own state (RNG, UART, displays) aren't.
+ *
+ * The memory is a table of reference counted pages.  Copying a snapshot forks it: the fork shares
+ * every page with the original, so it only costs the page table.  A page is copied the first time
+ * a snapshot that shares it is written to.  Taking a snapshot shares every page the CPU hasn't
+ * written since the last snapshot was taken or restored, and restoring one only copies the pages
+ * that are different from what is in memory (see MemoryController::takeSnapshot).
+ *
+ * The pages are immutable while they are shared, so forks of the same snapshot can be restored
+ * into machines running on different threads.  A single snapshot object isn't thread safe.
+ */
+class MachineSnapshot
+{
+public:
+   MachineSnapshot();
+
+   /// Forks the snapshot, the fork shares all the pages of other
+   MachineSnapshot(MachineSnapshot const & other);
+
+   MachineSnapshot& operator=(MachineSnapshot const & other);
+
+   ~MachineSnapshot();
+
+   /// Reads a byte of the snapshot memory, 0 for addresses that aren't part of the snapshot
+   uint8_t read8(CpuAddress addr) const;
+
+   /**
+    * Changes a byte of the snapshot memory (the input of a fork), the page is copied first if any
+    * other snapshot shares it
+    * @return False if the address isn't part of the snapshot
+    */
+   bool write8(CpuAddress addr, uint8_t val);
+
+   /// The page with the page number, nullptr if the page isn't part of the snapshot
+   inline SnapshotPage* getPage(int page) const
+   {
+      return thePages[page];
+   }
+
+   /**
+    * Gets the page for changing it, copying it first if any other snapshot shares it
+    * @return Contents of the page, nullptr if the page isn't part of the snapshot
+    */
+   uint8_t* getWritablePage(int page);
+
+   /// Replaces a page, the snapshot holds a reference to the new page
+   void setPage(int page, SnapshotPage* data);
+
+   /// Number of pages that no other snapshot (or machine) shares
+   int getNumPrivatePages() const;
+
+   inline SnapshotCpuState* getCpuState()
+   {
+      return &theCpuState;
+   }
+
+   inline SnapshotCpuState const * getCpuState() const
+   {
+      return &theCpuState;
+   }
+
+   /// Allocates a page with a reference count of 1 (the contents are uninitialized)
+   static SnapshotPage* allocatePage();
+
+   static void addPageReference(SnapshotPage* page);
+
+   /// Drops a reference to the page, and frees it if that was the last one.  nullptr is ignored
+   static void releasePage(SnapshotPage* page);
+
+protected:
+
+   SnapshotPage* thePages[MEM_CTRL_NUM_PAGES];
+
+   SnapshotCpuState theCpuState;
+};
+
+#endif // MACHINESNAPSHOT_H
@@ -1,19 +1,31 @@
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
 #include "MemoryController.h"
 #include "MemoryDev.h"
+#include "SaveState.h"
+#include "MachineSnapshot.h"
 #include "Logger.h"
 #include "EmulatorConfig.h"
 
 
-MemoryController::MemoryController()
+MemoryController::MemoryController():
+   thePageTableGeneration(0),
+   theHasMirrorsFlag(false),
+   theDumpOnDestroyFlag(true),
+   theInputLog(&theEventScheduler)
 {
-
+   memset(theBasePages, 0, sizeof(theBasePages));
+   rebuildPageTables();
 }
 
 MemoryController::~MemoryController()
 {
 #ifdef DUMP_MEMORY
-   debugDumpMemoryController(true);
+   if (theDumpOnDestroyFlag)
+   {
+      debugDumpMemoryController(true);
+   }
 #endif
 
    while(theDevices.size() > 0)
@@ -24,6 +36,8 @@ MemoryController::~MemoryController()
       LOG_DEBUG() << "Deleting MemoryDev:" << theCurrentDev->getDebugString();
       delete theCurrentDev;
    }
+
+   dropSnapshotBase();
 }
 
 std::vector<std::string> MemoryController::getDeviceNames()
@@ -57,12 +71,14 @@ void MemoryController::addNewDevice(MemoryDev* device)
       {
          theDevices.insert(existingDevice, device);
          LOG_DEBUG() << "Memory Controller added device " << device->getDebugString();
+         rebuildPageTables();
          return;
       }
    }
 
    theDevices.push_back(device);
    LOG_DEBUG() << "Memory Controller added device " << device->getDebugString();
+   rebuildPageTables();
 }
 
 void MemoryController::deleteDevice(MemoryDev* device)
@@ -72,6 +88,7 @@ void MemoryController::deleteDevice(MemoryDev* device)
       if (*curDevice == device)
       {
          theDevices.erase(curDevice);
+         rebuildPageTables();
          return;
       }
    }
@@ -79,7 +96,7 @@ void MemoryController::deleteDevice(MemoryDev* device)
    LOG_WARNING() << "Can't find device " << device->getName() << " in list of devices to delete it!";
 }
 
-MemoryDev* MemoryController::getDevice(CpuAddress address)
+MemoryDev* MemoryController::getDeviceSlow(CpuAddress address)
 {
    for(auto curDevice = theDevices.begin(); curDevice != theDevices.end(); curDevice++)
    {
@@ -120,10 +137,315 @@ void MemoryController::resetAll()
 {
    LOG_DEBUG() << "Reseting all memory devices";
 
+   // Devices schedule their events again when they reset
+   theEventScheduler.clear();
+   theInterruptController.reset();
+
    for(auto md: theDevices)
    {
       md->resetMemory();
    }
+
+   // Devices allocate their storage during reset
+   rebuildPageTables();
+}
+
+void MemoryController::rebuildPageTables()
+{
+   int numDirectPages = 0;
+
+   thePageTableGeneration++;
+
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      thePageDevices[i] = nullptr;
+      theHostReadPages[i] = nullptr;
+      theHostWritePages[i] = nullptr;
+   }
+
+   for(auto curDevice: theDevices)
+   {
+      MemoryRange range = curDevice->getAddressRange();
+
+      if (curDevice->getSize() == 0)
+      {
+         continue;
+      }
+
+      // Only the pages that the device completely covers go in the table
+      int firstPage = (range.first + 0xff) >> 8;
+      int lastPage = ((int) range.second + 1) >> 8;
+
+      for(int page = firstPage; page < lastPage; page++)
+      {
+         CpuAddress pageAddr = page << 8;
+
+         thePageDevices[page] = curDevice;
+         theHostReadPages[page] = curDevice->getHostReadPage(pageAddr);
+         theHostWritePages[page] = curDevice->getHostWritePage(pageAddr);
+
+         if (theHostReadPages[page] != nullptr)
+         {
+            numDirectPages++;
+         }
+      }
+   }
+
+   // Mirrors share the dirty flag and snapshot page of the first page backed by the memory
+   theHasMirrorsFlag = false;
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      theSnapshotPages[i] = theHostWritePages[i];
+      theCanonicalPages[i] = i;
+
+      if (theHostWritePages[i] == nullptr)
+      {
+         continue;
+      }
+
+      for(int j = 0; j < i; j++)
+      {
+         if (theHostWritePages[j] == theHostWritePages[i])
+         {
+            theCanonicalPages[i] = j;
+            theHasMirrorsFlag = true;
+            break;
+         }
+      }
+   }
+
+   dropSnapshotBase();
+
+   LOG_DEBUG() << "Memory Controller page tables rebuilt, " << numDirectPages
+               << " pages accessed directly";
+}
+
+void MemoryController::takeSnapshot(MachineSnapshot* snapshot)
+{
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      if ( (theSnapshotPages[i] == nullptr) || (theCanonicalPages[i] != i) )
+      {
+         snapshot->setPage(i, nullptr);
+         continue;
+      }
+
+      if (theDirtyPages[i] || (theBasePages[i] == nullptr))
+      {
+         SnapshotPage* page = MachineSnapshot::allocatePage();
+         memcpy(page->theData, theSnapshotPages[i], sizeof(page->theData));
+
+         MachineSnapshot::releasePage(theBasePages[i]);
+         theBasePages[i] = page;
+      }
+
+      snapshot->setPage(i, theBasePages[i]);
+
+      theDirtyPages[i] = false;
+   }
+
+   protectPages();
+}
+
+void MemoryController::restoreSnapshot(MachineSnapshot const & snapshot, bool* restoredPages)
+{
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      restoredPages[i] = false;
+
+      if ( (theSnapshotPages[i] == nullptr) || (theCanonicalPages[i] != i) )
+      {
+         continue;
+      }
+
+      SnapshotPage* page = snapshot.getPage(i);
+      if (page == nullptr)
+      {
+         // Not in the snapshot (different memory map), leave the page alone
+         MachineSnapshot::releasePage(theBasePages[i]);
+         theBasePages[i] = nullptr;
+         continue;
+      }
+
+      if (theDirtyPages[i] || (theBasePages[i] != page))
+      {
+         memcpy(theSnapshotPages[i], page->theData, sizeof(page->theData));
+         restoredPages[i] = true;
+
+         MachineSnapshot::addPageReference(page);
+         MachineSnapshot::releasePage(theBasePages[i]);
+         theBasePages[i] = page;
+      }
+
+      theDirtyPages[i] = false;
+   }
+
+   protectPages();
+}
+
+uint8_t* MemoryController::unprotectPage(CpuAddress address)
+{
+   int page = address >> 8;
+   uint8_t* hostPage = theSnapshotPages[page];
+   if (hostPage == nullptr)
+   {
+      return nullptr;
+   }
+
+   int canonicalPage = theCanonicalPages[page];
+   theDirtyPages[canonicalPage] = true;
+
+   if (!theHasMirrorsFlag)
+   {
+      theHostWritePages[page] = hostPage;
+      return hostPage;
+   }
+
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      if (theCanonicalPages[i] == canonicalPage)
+      {
+         theHostWritePages[i] = theSnapshotPages[i];
+      }
+   }
+
+   return hostPage;
+}
+
+void MemoryController::protectPages()
+{
+   // Mirrors are protected along with the page they mirror
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      bool isProtected = (theBasePages[theCanonicalPages[i]] != nullptr);
+      theHostWritePages[i] = (isProtected ? nullptr : theSnapshotPages[i]);
+   }
+}
+
+void MemoryController::dropSnapshotBase()
+{
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      MachineSnapshot::releasePage(theBasePages[i]);
+      theBasePages[i] = nullptr;
+      theDirtyPages[i] = false;
+
+      theHostWritePages[i] = theSnapshotPages[i];
+   }
+}
+
+void MemoryController::saveState(SaveState* state)
+{
+   for(auto md: theDevices)
+   {
+      state->beginChunk(md->getConfigTypeName() + "." + md->getName());
+      md->saveState(state);
+      state->endChunk();
+   }
+}
+
+bool MemoryController::loadState(SaveState* state)
+{
+   for(auto md: theDevices)
+   {
+      if (!state->openChunk(md->getConfigTypeName() + "." + md->getName()))
+      {
+         LOG_WARNING() << "Save state doesn't have the device " << md->getConfigTypeName() << "."
+                       << md->getName();
+         return false;
+      }
+   }
+
+   // Whether a chunk fits its device is only known once the device has loaded it, so keep what
+   // the devices and the scheduler had to put back if one of them doesn't
+   SaveState backup;
+   saveState(&backup);
+   EventScheduler scheduledEvents = theEventScheduler;
+
+   theEventScheduler.clear();
+
+   // The devices change their memory behind the write protection
+   dropSnapshotBase();
+
+   for(auto md: theDevices)
+   {
+      if (!loadDeviceState(md, state))
+      {
+         std::vector<uint8_t> const & backupData = backup.getSaveData();
+         backup.loadBuffer(backupData.data(), backupData.size());
+
+         for(auto restoreMd: theDevices)
+         {
+            loadDeviceState(restoreMd, &backup);
+         }
+
+         // Drops anything the devices scheduled while they were loading
+         theEventScheduler = scheduledEvents;
+         return false;
+      }
+   }
+
+   return true;
+}
+
+void MemoryController::saveDeviceStates(SaveState* state)
+{
+   for(auto md: theDevices)
+   {
+      if (hasSnapshotPages(md))
+      {
+         continue;
+      }
+
+      state->beginChunk(md->getConfigTypeName() + "." + md->getName());
+      md->saveState(state);
+      state->endChunk();
+   }
+}
+
+bool MemoryController::loadDeviceStates(SaveState* state)
+{
+   for(auto md: theDevices)
+   {
+      if (!hasSnapshotPages(md) && !loadDeviceState(md, state))
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+bool MemoryController::loadDeviceState(MemoryDev* device, SaveState* state)
+{
+   std::string chunkName = device->getConfigTypeName() + "." + device->getName();
+
+   if (!state->openChunk(chunkName))
+   {
+      LOG_WARNING() << "Save state doesn't have the device " << chunkName;
+      return false;
+   }
+
+   if (!device->loadState(state))
+   {
+      LOG_WARNING() << "Save state for the device " << chunkName << " doesn't fit the device";
+      return false;
+   }
+
+   return true;
+}
+
+bool MemoryController::hasSnapshotPages(MemoryDev* device) const
+{
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      if ( (thePageDevices[i] == device) && (theSnapshotPages[i] != nullptr) )
+      {
+         return true;
+      }
+   }
+
+   return false;
 }
 
 std::vector<MemoryDev*> MemoryController::getAllDevices()
@@ -209,6 +531,35 @@ MemoryRange MemoryController::mergeRanges(MemoryRange dev1, MemoryRange dev2)
 
 }
 
+uint64_t MemoryController::getMemoryChecksum() const
+{
+   uint64_t hash = 0xcbf29ce484222325ULL;
+
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      uint8_t* hostPage = theHostReadPages[i];
+      if (hostPage == nullptr)
+      {
+         continue;
+      }
+
+      // Include the page number so moving data between pages changes the checksum
+      hash = (hash ^ i) * 0x100000001b3ULL;
+
+      for(int j = 0; j < 0x100; j++)
+      {
+         hash = (hash ^ hostPage[j]) * 0x100000001b3ULL;
+      }
+   }
+
+   return hash;
+}
+
+void MemoryController::setDumpOnDestroy(bool enable)
+{
+   theDumpOnDestroyFlag = enable;
+}
+
 void MemoryController::debugDumpMemoryController(bool dumpContents)
 {
    FILE* dumpFile = NULL;
@@ -5,8 +5,17 @@
 #include <stdint.h>
 #include <iostream>
 #include "Cpu6502Defines.h"
+#include "EventScheduler.h"
+#include "InterruptController.h"
+#include "InputLog.h"
 
 class MemoryDev;
+class SaveState;
+class MachineSnapshot;
+typedef struct SnapshotPageStruct SnapshotPage;
+
+/// Number of 256-byte pages in the 6502 address space
+#define MEM_CTRL_NUM_PAGES 0x100
 
 /**
  * Controls what memory devices are at each particular set of memory addresses when a decoder
@@ -29,7 +38,43 @@ public:
 
     void deleteDevice(MemoryDev* device);
 
-    MemoryDev* getDevice(CpuAddress address);
+    /**
+     * Returns the device that services the address.  Pages that are completely covered by a
+     * single device are resolved with a single table lookup, only pages that are shared between
+     * devices (or are unmapped) fall back to searching the device list.
+     */
+    inline MemoryDev* getDevice(CpuAddress address)
+    {
+       MemoryDev* dev = thePageDevices[address >> 8];
+       return (dev != nullptr ? dev : getDeviceSlow(address));
+    }
+
+    /**
+     * Returns the host memory backing the page that contains address, or nullptr if the access
+     * must go through the device.  Index the result with (address & 0xff).
+     */
+    inline uint8_t* getHostReadPage(CpuAddress address) const
+    {
+       return theHostReadPages[address >> 8];
+    }
+
+    /// Same as getHostReadPage, but for writes
+    inline uint8_t* getHostWritePage(CpuAddress address) const
+    {
+       return theHostWritePages[address >> 8];
+    }
+
+    /**
+     * Rebuilds the page tables.  Needs to be called if a device moves or reallocates the memory
+     * that backs it after it was added to the controller (resetAll does this automatically)
+     */
+    void rebuildPageTables();
+
+    /// Incremented every time the page tables are rebuilt, so caches of the tables know to flush
+    inline uint32_t getPageTableGeneration() const
+    {
+       return thePageTableGeneration;
+    }
 
     /**
      * Gets a list of all the valid memory ranges available to the processor
@@ -42,6 +87,84 @@ public:
 
     bool getStartAddress(CpuAddress* addr) const;
 
+    /**
+     * Checksum (64-bit FNV-1a) of the contents of every page backed by RAM / ROM storage.  Pages
+     * that belong to devices with side effects aren't read, so this doesn't disturb the machine.
+     */
+    uint64_t getMemoryChecksum() const;
+
+    /**
+     * Devices that need to do something at a particular clock count schedule callbacks here,
+     * instead of being polled every instruction
+     */
+    inline EventScheduler* getEventScheduler()
+    {
+       return &theEventScheduler;
+    }
+
+    /// The IRQ and NMI lines devices can assert
+    inline InterruptController* getInterruptController()
+    {
+       return &theInterruptController;
+    }
+
+    /// Devices log the values they get from outside the emulator here, or replay them
+    inline InputLog* getInputLog()
+    {
+       return &theInputLog;
+    }
+
+    /// Writes a chunk for every device, named after the device's type and name
+    void saveState(SaveState* state);
+
+    /**
+     * Restores every device from its chunk.  Scheduled events are dropped, devices that use the
+     * scheduler schedule their events again in loadState.  Either every device is restored, or
+     * none of them are changed (and the scheduled events are kept).
+     * @return False if a device is missing from the state, or its chunk doesn't fit the device
+     */
+    bool loadState(SaveState* state);
+
+    /**
+     * Copies the pages backed by host memory into the snapshot.  Pages that haven't been written
+     * since the last snapshot was taken or restored are shared with that snapshot instead of
+     * copied.  Afterwards the pages are write protected (their host write page is nullptr), so the
+     * CPU's first write to each page goes through unprotectPage and marks the page dirty.
+     */
+    void takeSnapshot(MachineSnapshot* snapshot);
+
+    /**
+     * Puts the contents of the snapshot's pages back into memory, only copying the pages that are
+     * dirty or that are different pages than the last snapshot taken or restored.  The pages are
+     * write protected again afterwards.
+     * @param restoredPages Array of MEM_CTRL_NUM_PAGES flags, set for every page that was copied
+     */
+    void restoreSnapshot(MachineSnapshot const & snapshot, bool* restoredPages);
+
+    /**
+     * Called by the CPU when a page has no host write page.  If the page is only write protected
+     * for snapshots, marks it dirty and gives it (and its mirrors) the host write page back.
+     * @return The host write page, or nullptr if the write has to go through the device
+     */
+    uint8_t* unprotectPage(CpuAddress address);
+
+    /**
+     * Same as saveState, but only for the devices that aren't backed by host memory pages (the
+     * ones a MachineSnapshot doesn't have)
+     */
+    void saveDeviceStates(SaveState* state);
+
+    /// Restores the devices saveDeviceStates saved, without touching the snapshot tracking
+    bool loadDeviceStates(SaveState* state);
+
+    /// Has the page been written since the last snapshot was taken or restored
+    inline bool isPageDirty(CpuAddress address) const
+    {
+       return theDirtyPages[theCanonicalPages[address >> 8]];
+    }
+
+    /// Turns the dump.txt memory dump on destruction on / off (DUMP_MEMORY builds only)
+    void setDumpOnDestroy(bool enable);
 
 
 protected:
@@ -65,7 +188,54 @@ protected:
 
     void debugDumpMemoryController(bool dumpContents = false);
 
+    /// Searches the device list for the address, used for pages shared by multiple devices
+    MemoryDev* getDeviceSlow(CpuAddress address);
+
     std::vector<MemoryDev*> theDevices;
+
+    /// Device that covers each entire page, nullptr if the page is shared or unmapped
+    MemoryDev* thePageDevices[MEM_CTRL_NUM_PAGES];
+
+    /// Direct host pointers for pages backed by plain RAM / ROM storage
+    uint8_t* theHostReadPages[MEM_CTRL_NUM_PAGES];
+    uint8_t* theHostWritePages[MEM_CTRL_NUM_PAGES];
+
+    uint32_t thePageTableGeneration;
+
+    /// Does any page of the device have a host page (the device is part of snapshots)
+    bool hasSnapshotPages(MemoryDev* device) const;
+
+    /// Restores one device from its chunk
+    bool loadDeviceState(MemoryDev* device, SaveState* state);
+
+    /// Write protects the pages that have a base page
+    void protectPages();
+
+    /// Forgets the last snapshot and turns off the write protection
+    void dropSnapshotBase();
+
+    /// Host write page of every page, even when it is write protected
+    uint8_t* theSnapshotPages[MEM_CTRL_NUM_PAGES];
+
+    /// Lowest numbered page backed by the same host memory as the page (the page itself if no mirror)
+    uint8_t theCanonicalPages[MEM_CTRL_NUM_PAGES];
+
+    /// Written since the last snapshot (indexed by canonical page)
+    bool theDirtyPages[MEM_CTRL_NUM_PAGES];
+
+    /// Contents of each canonical page at the last snapshot taken or restored (a reference is held)
+    SnapshotPage* theBasePages[MEM_CTRL_NUM_PAGES];
+
+    /// Is some page mirrored by another page
+    bool theHasMirrorsFlag;
+
+    bool theDumpOnDestroyFlag;
+
+    EventScheduler theEventScheduler;
+
+    InterruptController theInterruptController;
+
+    InputLog theInputLog;
 };
 
 #endif // MEMORYCONTROLLER_H
@@ -7,7 +7,8 @@ MemoryDev::MemoryDev(std::string name):
    theAddress(0),
    theSize(0),
    theName(name),
-   theMemController(nullptr)
+   theMemController(nullptr),
+   theConfigManager(nullptr)
 {
    // Purposely blank
 }
@@ -22,6 +23,11 @@ void MemoryDev::setMemoryController(MemoryController* mc)
     theMemController = mc;
 }
 
+void MemoryDev::setConfigManager(ConfigManager* cfgMgr)
+{
+   theConfigManager = cfgMgr;
+}
+
 std::string MemoryDev::getName() const
 {
    return theName;
@@ -162,6 +168,26 @@ CpuAddress MemoryDev::getStartPcAddress() const
    return 0;
 }
 
+uint8_t* MemoryDev::getHostReadPage(CpuAddress pageAddr)
+{
+   return nullptr;
+}
+
+uint8_t* MemoryDev::getHostWritePage(CpuAddress pageAddr)
+{
+   return nullptr;
+}
+
+void MemoryDev::saveState(SaveState* state)
+{
+   // No state by default
+}
+
+bool MemoryDev::loadState(SaveState* state)
+{
+   return true;
+}
+
 bool MemoryDev::isFullyConfigured() const
 {
    return true;
@@ -208,7 +234,12 @@ void MemoryDev::setStringConfigValue(std::string paramName, std::string value)
 
 bool MemoryDev::configSelf()
 {
-   ConfigManager* theCfgMgr = ConfigManager::getInstance();
+   ConfigManager* theCfgMgr = theConfigManager;
+   if (theCfgMgr == nullptr)
+   {
+      theCfgMgr = ConfigManager::getInstance();
+   }
+
    bool retVal = true;
 
    // Get all of our int configuration parameters
@@ -9,6 +9,8 @@
 
 class MemoryDev;
 class MemoryController;
+class ConfigManager;
+class SaveState;
 
 typedef MemoryDev* (*MemoryDeviceConstructor)(std::string instanceName);
 
@@ -24,6 +26,12 @@ public:
 
    virtual void setMemoryController(MemoryController* mc);
 
+   /**
+    * Sets the configuration the device configures itself from.  Defaults to the ConfigManager
+    * singleton, machines with their own configuration (see Machine) set this.
+    */
+   void setConfigManager(ConfigManager* cfgMgr);
+
    std::string getName() const;
 
    virtual uint8_t read8(CpuAddress absAddr) = 0;
@@ -73,6 +81,30 @@ public:
    /// Configures self from ConfigManager.  Returns false if req'd config missing
    virtual bool configSelf();
 
+   /**
+    * Returns a pointer to the host memory that backs the 256-byte page starting at pageAddr, so
+    * the memory controller can service reads without calling read8.  Devices with side effects
+    * on access (or that don't back the whole page contiguously) return nullptr, which is the
+    * default.
+    */
+   virtual uint8_t* getHostReadPage(CpuAddress pageAddr);
+
+   /// Same as getHostReadPage, but for writes.  Default returns nullptr (use write8)
+   virtual uint8_t* getHostWritePage(CpuAddress pageAddr);
+
+   /**
+    * Writes the device's state into its save state chunk (the memory controller has already
+    * started the chunk).  Anything the configuration sets up doesn't need to be saved.  The
+    * default writes nothing.
+    */
+   virtual void saveState(SaveState* state);
+
+   /**
+    * Restores the state saveState wrote, the device's chunk is already open
+    * @return False if the state doesn't fit this device
+    */
+   virtual bool loadState(SaveState* state);
+
 protected:   
 
    CpuAddress theAddress;
@@ -83,6 +115,9 @@ protected:
 
    MemoryController* theMemController;
 
+   /// Configuration for configSelf(), nullptr means the ConfigManager singleton
+   ConfigManager* theConfigManager;
+
    std::map<std::string, uint32_t*> theUint32ConfigParams;
 
    std::map<std::string, uint16_t*> theUint16ConfigParams;
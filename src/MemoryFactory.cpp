@@ -9,10 +9,7 @@
 #include "RomMemory.h"
 #include "MirrorMemory.h"
 #include "RngDev.h"
-#include "Easy6502JsDisplay.h"
-#include "Easy6502JsInputDevice.h"
 #include "NesRom.h"
-#include "NesPpuDisplayDevice.h"
 
 #ifdef MEMORY_FACTORY_DEBUG
    #define MFACTORY_DEBUG   LOG_DEBUG
@@ -22,38 +19,51 @@
    #define MFACTORY_WARNING if(0) LOG_WARNING
 #endif
 
-MemoryFactory::MemoryFactory(MemoryController* memController):
+MemoryFactory::MemoryFactory(MemoryController* memController, ConfigManager* cfgMgr):
    theStartAddressSetFlag(false),
    theStartAddress(0)
 {
    MFACTORY_DEBUG() << "Created a Memory Factory";
    theMemoryController = memController;
+
+   theConfigManager = cfgMgr;
+   if (theConfigManager == nullptr)
+   {
+      theConfigManager = ConfigManager::getInstance();
+   }
+
+   addMemoryType(RamMemory::getTypeName(), RamMemory::getMDC());
+   addMemoryType(RomMemory::getTypeName(), RomMemory::getMDC());
+   addMemoryType(RngDev::getTypeName(), RngDev::getMDC());
+   addMemoryType(MirrorMemory::getTypeName(), MirrorMemory::getMDC());
+   addMemoryType(NesRom::getTypeName(), NesRom::getMDC());
 }
 
-void MemoryFactory::processConfigData()
+void MemoryFactory::addMemoryType(std::string typeName, MemoryDeviceConstructor mdc)
 {
-   // Process RAM configuration
-   processSingleMemoryType(RamMemory::getTypeName(), RamMemory::getMDC());
-   processSingleMemoryType(RomMemory::getTypeName(), RomMemory::getMDC());
-   processSingleMemoryType(RngDev::getTypeName(), RngDev::getMDC());
-   processSingleMemoryType(MirrorMemory::getTypeName(), MirrorMemory::getMDC());
-   processSingleMemoryType(Easy6502JsDisplay::getTypeName(), Easy6502JsDisplay::getMDC());
-   processSingleMemoryType(NesRom::getTypeName(), NesRom::getMDC());
+   MFACTORY_DEBUG() << "Memory type " << typeName << " added to the factory";
+   theMemoryTypes.push_back(std::make_pair(typeName, mdc));
+}
 
+void MemoryFactory::processConfigData()
+{
+   for(auto const & memType: theMemoryTypes)
+   {
+      processSingleMemoryType(memType.first, memType.second);
+   }
 }
 
 void MemoryFactory::processSingleMemoryType(std::string typeName, MemoryDeviceConstructor mdc)
 {
-   ConfigManager* theConfig = ConfigManager::getInstance();
-
    // Process RAM configuration
    std::set<std::string> devInstanceNames;
-   devInstanceNames = theConfig->getConfigTypeInstanceNames(typeName);
+   devInstanceNames = theConfigManager->getConfigTypeInstanceNames(typeName);
    for(auto const & singleInstance: devInstanceNames)
    {
       MemoryDev* currentDev = mdc(singleInstance);
 
       currentDev->setMemoryController(theMemoryController);
+      currentDev->setConfigManager(theConfigManager);
 
       if (currentDev->configSelf())
       {
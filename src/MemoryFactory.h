@@ -1,20 +1,42 @@
 #ifndef MEMORYFACTORY_H
 #define MEMORYFACTORY_H
 
+#include <utility>
+#include <vector>
 #include "Cpu6502Defines.h"
 #include "MemoryDev.h"
 
 class MemoryController;
+class ConfigManager;
+
+/// Configuration type names of memory devices, and the functions that construct them
+typedef std::vector<std::pair<std::string, MemoryDeviceConstructor> > MemoryTypeList;
 
 /**
  * Class instantiates all the memory devices from the configuration data and adds them to the
  * memory controller.  The memory controller will take care of deleting the objects when it is
  * finished.
+ *
+ * The factory only knows about the devices in the emulator library (RAM, ROM, RNG, mirrors and
+ * iNES ROMs).  Devices that need SDL (the displays) are added by the application with
+ * addMemoryType() before processConfigData() is called.
  */
 class MemoryFactory
 {
 public:
-   MemoryFactory(MemoryController* memController);
+   /**
+    * @param memController Memory controller the devices are added to
+    * @param cfgMgr Configuration the devices are created from, nullptr for the ConfigManager
+    *        singleton
+    */
+   MemoryFactory(MemoryController* memController, ConfigManager* cfgMgr = nullptr);
+
+   /**
+    * Adds a type of memory device the factory can create from the configuration data
+    * @param typeName Configuration type name of the device (ie, RAM)
+    * @param mdc Function that constructs the device
+    */
+   void addMemoryType(std::string typeName, MemoryDeviceConstructor mdc);
 
    void processConfigData();
 
@@ -28,6 +50,11 @@ protected:
 
    MemoryController* theMemoryController;
 
+   ConfigManager* theConfigManager;
+
+   /// Types of devices that are created, in the order they are created
+   MemoryTypeList theMemoryTypes;
+
    bool theStartAddressSetFlag;
 
    CpuAddress theStartAddress;
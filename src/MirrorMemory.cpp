@@ -4,6 +4,7 @@
 #include "EmulatorConfig.h"
 #include "Logger.h"
 #include "MemoryController.h"
+#include "SaveState.h"
 
 
 #ifdef MIRROR_MEM_TRACE
@@ -219,3 +220,52 @@ void MirrorMemory::resetMemory()
    //   LOG_FATAL() << "Mirror Memory has incomplete configuration!";
    //}
 }
+
+uint8_t* MirrorMemory::getHostReadPage(CpuAddress pageAddr)
+{
+   // Only whole pages that map contiguously onto the original device can be accessed directly
+   if ( (theRealMemDev == nullptr) || (theSizeOfMemoryMirrored < 0x100) ||
+        (theSizeOfMemoryMirrored & 0xff) || (theAddress & 0xff) || (theAddrOfMemoryMirrored & 0xff) )
+   {
+      return nullptr;
+   }
+
+   CpuAddress offset = pageAddr - theAddress;
+   CpuAddress mask = theSizeOfMemoryMirrored - 1;
+   CpuAddress original = (offset & mask) + theAddrOfMemoryMirrored;
+
+   return theRealMemDev->getHostReadPage(original);
+}
+
+uint8_t* MirrorMemory::getHostWritePage(CpuAddress pageAddr)
+{
+   if ( (theRealMemDev == nullptr) || (theSizeOfMemoryMirrored < 0x100) ||
+        (theSizeOfMemoryMirrored & 0xff) || (theAddress & 0xff) || (theAddrOfMemoryMirrored & 0xff) )
+   {
+      return nullptr;
+   }
+
+   CpuAddress offset = pageAddr - theAddress;
+   CpuAddress mask = theSizeOfMemoryMirrored - 1;
+   CpuAddress original = (offset & mask) + theAddrOfMemoryMirrored;
+
+   return theRealMemDev->getHostWritePage(original);
+}
+
+void MirrorMemory::saveState(SaveState* state)
+{
+   state->writeU16(theAddrOfMemoryMirrored);
+   state->writeU32(theSizeOfMemoryMirrored);
+}
+
+bool MirrorMemory::loadState(SaveState* state)
+{
+   uint16_t addr;
+   uint32_t size;
+   if (!state->readU16(&addr) || !state->readU32(&size))
+   {
+      return false;
+   }
+
+   return (addr == theAddrOfMemoryMirrored) && (size == theSizeOfMemoryMirrored);
+}
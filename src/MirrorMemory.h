@@ -44,6 +44,16 @@ public:
 
    virtual void resetMemory() override;
 
+   virtual uint8_t* getHostReadPage(CpuAddress pageAddr) override;
+
+   virtual uint8_t* getHostWritePage(CpuAddress pageAddr) override;
+
+   /// Only saves which device is mirrored, the contents belong to that device
+   virtual void saveState(SaveState* state) override;
+
+   /// Checks the same device is mirrored
+   virtual bool loadState(SaveState* state) override;
+
 protected:
 
    int theConfigFlags;
@@ -1,6 +1,9 @@
+#include <string.h>
+
 #include "NesPpuDisplayDevice.h"
 #include "EmulatorConfig.h"
 #include "Logger.h"
+#include "SaveState.h"
 
 #ifdef PPUDEV_TRACE
    #define PPUDEV_DEBUG LOG_DEBUG
@@ -84,6 +87,20 @@ std::string NesPpuDisplayDevice::getConfigTypeName() const
    return "NesPPU";
 }
 
+void NesPpuDisplayDevice::saveState(SaveState* state)
+{
+   state->write(thePpuRegisters, NUM_PPU_REGISTERS);
+   state->write(theSpriteRam, SPRITE_RAM_SIZE);
+   state->write(theVRam, VRAM_SIZE);
+}
+
+bool NesPpuDisplayDevice::loadState(SaveState* state)
+{
+   return state->read(thePpuRegisters, NUM_PPU_REGISTERS) &&
+          state->read(theSpriteRam, SPRITE_RAM_SIZE) &&
+          state->read(theVRam, VRAM_SIZE);
+}
+
 std::string NesPpuDisplayDevice::regNameToString(int offset) const
 {
    switch(offset)
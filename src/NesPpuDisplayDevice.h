@@ -24,6 +24,10 @@ public:
 
    virtual std::string getConfigTypeName() const;
 
+   virtual void saveState(SaveState* state) override;
+
+   virtual bool loadState(SaveState* state) override;
+
 protected:
 
    enum ppuRegNames
@@ -6,12 +6,12 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <cstring>
-
-#include <SDL.h>
+#include <errno.h>
 
 #include "Logger.h"
 
 #include "NRomMapper.h"
+#include "SaveState.h"
 
 #define ROM_TRACE
 
@@ -192,34 +192,26 @@ void NesRom::resetMemory()
          LOG_FATAL() << "ROM " << theName << " not fully configured during reset";
       }
 
-      int fd = open(theRomFile.c_str(), O_RDONLY);
-
-      if (fd <= 0)
-      {
-         NES_ROM_WARNING() << "ROM INIT ERROR: Couldn't open ROM file " << theRomFile;
-         return;
-      }
-
-      SDL_RWops* f = SDL_RWFromFile(theRomFile.c_str(), "r");
+      FILE* f = fopen(theRomFile.c_str(), "rb");
 
       if (f == NULL)
       {
          NES_ROM_WARNING() << "ROM INIT ERROR: Couldn't open ROM file (" << theRomFile << ") "
-                           << SDL_GetError();
+                           << strerror(errno);
          return;
       }
 
       size_t numHeaderBytesRead = 0;
       while (numHeaderBytesRead < sizeof(struct INesHeader))
       {
-         int bytesRead = SDL_RWread(f, &theHeaderBytes + numHeaderBytesRead,
-                                    1, sizeof(struct INesHeader) - numHeaderBytesRead);
+         int bytesRead = fread(&theHeaderBytes + numHeaderBytesRead,
+                               1, sizeof(struct INesHeader) - numHeaderBytesRead, f);
          if (bytesRead == 0)
          {
             // File not even long enough to contain the header
             LOG_FATAL() << "Failed to read iNES file " << theRomFile << ", " << numHeaderBytesRead
                         << " bytes of header read of " << sizeof(struct INesHeader);
-            SDL_RWclose(f);
+            fclose(f);
             return;
          }
 
@@ -237,7 +229,7 @@ void NesRom::resetMemory()
           if (nbr != 512)
           {
               NES_ROM_WARNING() << "EOF encountered after reading " << nbr << " bytes of trainer data";
-              SDL_RWclose(f);
+              fclose(f);
               return;
           }
 
@@ -261,7 +253,7 @@ void NesRom::resetMemory()
 
       }
 
-      SDL_RWclose(f);
+      fclose(f);
 
 }
 
@@ -366,3 +358,37 @@ uint32_t NesRom::getChrRomSize() const
 {
     return theHeaderBytes.theChrRomSizeBlocks * 1024 * 8;
 }
+
+void NesRom::saveState(SaveState* state)
+{
+   state->writeString(theRomFile);
+   state->write(&theHeaderBytes, sizeof(struct INesHeader));
+
+   if (theMapper != nullptr)
+   {
+      theMapper->saveState(state);
+   }
+}
+
+bool NesRom::loadState(SaveState* state)
+{
+   std::string romFile;
+   struct INesHeader header;
+   if (!state->readString(&romFile) || !state->read(&header, sizeof(struct INesHeader)))
+   {
+      return false;
+   }
+
+   if ( (romFile != theRomFile) || (memcmp(&header, &theHeaderBytes, sizeof(struct INesHeader)) != 0) )
+   {
+      LOG_WARNING() << "Save state was made with the NES ROM " << romFile << ", not " << theRomFile;
+      return false;
+   }
+
+   if (theMapper != nullptr)
+   {
+      return theMapper->loadState(state);
+   }
+
+   return true;
+}
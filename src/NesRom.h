@@ -122,6 +122,11 @@ public:
 
    virtual CpuAddress getStartPcAddress() const override;
 
+   /// Saves which ROM file is loaded (not the contents) and the mapper's state
+   virtual void saveState(SaveState* state) override;
+
+   virtual bool loadState(SaveState* state) override;
+
    void dumpHeaderInfo() const;
 
    uint8_t getMapperNumber() const;
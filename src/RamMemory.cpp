@@ -3,6 +3,7 @@
 #include "RamMemory.h"
 #include "EmulatorConfig.h"
 #include "Logger.h"
+#include "SaveState.h"
 
 #ifdef RAM_TRACE
    #define RAM_DEBUG    LOG_DEBUG
@@ -160,3 +161,42 @@ void RamMemory::resetMemory()
                   << addressToString(theAddress + theSize - 1);
    }
 }
+
+uint8_t* RamMemory::getHostReadPage(CpuAddress pageAddr)
+{
+   if (theData == nullptr)
+   {
+      return nullptr;
+   }
+
+   return &theData[pageAddr - theAddress];
+}
+
+uint8_t* RamMemory::getHostWritePage(CpuAddress pageAddr)
+{
+   return getHostReadPage(pageAddr);
+}
+
+void RamMemory::saveState(SaveState* state)
+{
+   state->writeU32(theSize);
+   state->write(theData, theSize);
+}
+
+bool RamMemory::loadState(SaveState* state)
+{
+   uint32_t size;
+   if (!state->readU32(&size) || (size != theSize) || (theData == nullptr))
+   {
+      return false;
+   }
+
+   uint8_t const * contents = state->readPointer(theSize);
+   if (contents == nullptr)
+   {
+      return false;
+   }
+
+   memcpy(theData, contents, theSize);
+   return true;
+}
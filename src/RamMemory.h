@@ -45,6 +45,14 @@ public:
 
    virtual void resetMemory() override;
 
+   virtual uint8_t* getHostReadPage(CpuAddress pageAddr) override;
+
+   virtual uint8_t* getHostWritePage(CpuAddress pageAddr) override;
+
+   virtual void saveState(SaveState* state) override;
+
+   virtual bool loadState(SaveState* state) override;
+
 protected:
 
    int theConfigFlags;
@@ -0,0 +1,510 @@
+#include <string.h>
+
+#ifdef __SSE2__
+   #include <emmintrin.h>
+#endif
+
+#include "RewindBuffer.h"
+#include "Cpu6502.h"
+#include "MemoryController.h"
+#include "SaveState.h"
+#include "EmulatorConfig.h"
+#include "Logger.h"
+
+#ifdef REWIND_TRACE
+   #define REWIND_DEBUG   LOG_DEBUG
+#else
+   #define REWIND_DEBUG   if(0) LOG_DEBUG
+#endif
+
+/// Device states in a delta
+#define DEVICE_STATES_SAME  0
+#define DEVICE_STATES_XOR   1
+#define DEVICE_STATES_FULL  2
+
+/**
+ * XORs size bytes of a and b into out
+ * @return False if a and b are the same
+ */
+static bool xorBlock(uint8_t const * a, uint8_t const * b, uint8_t* out, uint32_t size)
+{
+   uint32_t i = 0;
+   bool different = false;
+
+#ifdef __SSE2__
+   __m128i diff = _mm_setzero_si128();
+   for(; i + 16 <= size; i += 16)
+   {
+      __m128i x = _mm_xor_si128(_mm_loadu_si128((__m128i const *) (a + i)),
+                                _mm_loadu_si128((__m128i const *) (b + i)));
+      _mm_storeu_si128((__m128i*) (out + i), x);
+      diff = _mm_or_si128(diff, x);
+   }
+
+   different = (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff);
+#endif
+
+   for(; i < size; i++)
+   {
+      out[i] = a[i] ^ b[i];
+      different |= (out[i] != 0);
+   }
+
+   return different;
+}
+
+/**
+ * Run length encodes XOR data, which is mostly zeros.  Each run is a count of zero bytes, a
+ * count of literal bytes, then the literal bytes.
+ */
+static void encodeRuns(uint8_t const * data, uint32_t size, std::vector<uint8_t>* out)
+{
+   uint32_t i = 0;
+   while(i < size)
+   {
+      uint32_t numZeros = 0;
+      while( (i + numZeros < size) && (data[i + numZeros] == 0) && (numZeros < 0xff) )
+      {
+         numZeros++;
+      }
+
+      i += numZeros;
+
+      // Literals run until a pair of zeros, a single zero is cheaper to keep in the literals
+      uint32_t numLiterals = 0;
+      while( (i + numLiterals < size) && (numLiterals < 0xff) )
+      {
+         if ( (data[i + numLiterals] == 0) &&
+              ( (i + numLiterals + 1 >= size) || (data[i + numLiterals + 1] == 0) ) )
+         {
+            break;
+         }
+
+         numLiterals++;
+      }
+
+      out->push_back(numZeros);
+      out->push_back(numLiterals);
+      out->insert(out->end(), data + i, data + i + numLiterals);
+
+      i += numLiterals;
+   }
+}
+
+/**
+ * XORs run length encoded data back into dest
+ * @return Number of encoded bytes used, 0 if the encoded data is corrupt
+ */
+static uint32_t applyRuns(uint8_t const * encoded, uint32_t encodedSize, uint8_t* dest, uint32_t size)
+{
+   uint32_t pos = 0;
+   uint32_t i = 0;
+   while(i < size)
+   {
+      if (pos + 2 > encodedSize)
+      {
+         return 0;
+      }
+
+      uint32_t numZeros = encoded[pos];
+      uint32_t numLiterals = encoded[pos + 1];
+      pos += 2;
+
+      if ( (i + numZeros + numLiterals > size) || (pos + numLiterals > encodedSize) ||
+           (numZeros + numLiterals == 0) )
+      {
+         return 0;
+      }
+
+      i += numZeros;
+      for(uint32_t j = 0; j < numLiterals; j++)
+      {
+         dest[i++] ^= encoded[pos++];
+      }
+   }
+
+   return pos;
+}
+
+static void appendU32(std::vector<uint8_t>* out, uint32_t val)
+{
+   uint8_t const * bytes = (uint8_t const *) &val;
+   out->insert(out->end(), bytes, bytes + sizeof(uint32_t));
+}
+
+RewindBuffer::RewindBuffer(Cpu6502* cpu, MemoryController* mc):
+   theCpu(cpu),
+   theMemoryController(mc),
+   theFrameClocks(0),
+   theMaxFrames(0),
+   theMemoryBudget(DEFAULT_REWIND_MEMORY_KB * 1024),
+   theMemoryUsage(0),
+   theFramesSinceKeyframe(0),
+   theCaptureEventId(0),
+   theCapturingFlag(false)
+{
+}
+
+RewindBuffer::~RewindBuffer()
+{
+   stop();
+}
+
+void RewindBuffer::configure(uint32_t seconds, uint64_t memoryBudget, uint32_t clockHz)
+{
+   theMaxFrames = seconds * REWIND_FRAMES_PER_SECOND;
+   theMemoryBudget = memoryBudget;
+
+   theFrameClocks = clockHz / REWIND_FRAMES_PER_SECOND;
+   if (theFrameClocks == 0)
+   {
+      theFrameClocks = 1;
+   }
+}
+
+void RewindBuffer::start()
+{
+   stop();
+
+   theCapturingFlag = true;
+   captureFrame();
+}
+
+void RewindBuffer::stop()
+{
+   if (theCapturingFlag)
+   {
+      theMemoryController->getEventScheduler()->cancel(theCaptureEventId);
+      theCapturingFlag = false;
+   }
+
+   while(!theFrames.empty())
+   {
+      dropNewestFrame();
+   }
+}
+
+int RewindBuffer::getNumFrames() const
+{
+   return theFrames.size();
+}
+
+uint64_t RewindBuffer::getFrameClock(int index) const
+{
+   return theFrames[index].theCpuState.theNumClocks;
+}
+
+int RewindBuffer::findFrame(uint64_t clock) const
+{
+   for(int i = theFrames.size() - 1; i >= 0; i--)
+   {
+      if (theFrames[i].theCpuState.theNumClocks < clock)
+      {
+         return i;
+      }
+   }
+
+   return -1;
+}
+
+uint64_t RewindBuffer::getMemoryUsage() const
+{
+   return theMemoryUsage;
+}
+
+void RewindBuffer::captureEvent(void* context)
+{
+   RewindBuffer* rb = (RewindBuffer*) context;
+   rb->captureFrame();
+}
+
+void RewindBuffer::captureFrame()
+{
+   MachineSnapshot snapshot;
+   theCpu->takeSnapshot(&snapshot);
+
+   std::vector<uint8_t> deviceStates;
+   saveDeviceStates(&deviceStates);
+
+   RewindFrame frame;
+   frame.theCpuState = *snapshot.getCpuState();
+   frame.theKeyframe = nullptr;
+
+   if (theFrames.empty() || (theFramesSinceKeyframe + 1 >= REWIND_KEYFRAME_INTERVAL))
+   {
+      frame.theKeyframe = new MachineSnapshot(snapshot);
+      frame.theData = deviceStates;
+      theFramesSinceKeyframe = 0;
+
+      // Pages that aren't shared with the keyframe before it are what this keyframe costs
+      MachineSnapshot const * prevKeyframe = nullptr;
+      for(auto it = theFrames.rbegin(); it != theFrames.rend(); it++)
+      {
+         if (it->theKeyframe != nullptr)
+         {
+            prevKeyframe = it->theKeyframe;
+            break;
+         }
+      }
+
+      frame.theMemoryUsage = sizeof(MachineSnapshot);
+      for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+      {
+         SnapshotPage* page = snapshot.getPage(i);
+         if ( (page != nullptr) && ( (prevKeyframe == nullptr) || (prevKeyframe->getPage(i) != page) ) )
+         {
+            frame.theMemoryUsage += sizeof(SnapshotPage);
+         }
+      }
+   }
+   else
+   {
+      encodeDelta(snapshot, deviceStates, &frame.theData);
+      frame.theData.shrink_to_fit();
+      frame.theMemoryUsage = 0;
+      theFramesSinceKeyframe++;
+   }
+
+   frame.theMemoryUsage += sizeof(RewindFrame) + frame.theData.capacity();
+   theMemoryUsage += frame.theMemoryUsage;
+   theFrames.push_back(frame);
+
+   thePrevSnapshot = snapshot;
+   thePrevDeviceStates.swap(deviceStates);
+
+   dropOldFrames();
+
+   REWIND_DEBUG() << "Rewind frame at clock " << frame.theCpuState.theNumClocks << ", "
+                  << frame.theMemoryUsage << " bytes (" << theFrames.size() << " frames, "
+                  << theMemoryUsage << " bytes)";
+
+   theCaptureEventId = theMemoryController->getEventScheduler()->scheduleIn(theFrameClocks,
+                                                                           captureEvent, this);
+}
+
+void RewindBuffer::saveDeviceStates(std::vector<uint8_t>* buffer)
+{
+   SaveState state;
+   theMemoryController->saveDeviceStates(&state);
+   *buffer = state.getSaveData();
+}
+
+void RewindBuffer::encodeDelta(MachineSnapshot const & snapshot,
+                               std::vector<uint8_t> const & deviceStates,
+                               std::vector<uint8_t>* delta)
+{
+   uint8_t xorData[0x100];
+
+   // Number of pages is filled in after the pages
+   delta->push_back(0);
+   delta->push_back(0);
+   uint16_t numPages = 0;
+
+   for(int i = 0; i < MEM_CTRL_NUM_PAGES; i++)
+   {
+      SnapshotPage* page = snapshot.getPage(i);
+      SnapshotPage* prevPage = thePrevSnapshot.getPage(i);
+
+      // Pages the CPU didn't write are shared with the frame before
+      if ( (page == prevPage) || (page == nullptr) || (prevPage == nullptr) )
+      {
+         continue;
+      }
+
+      if (!xorBlock(page->theData, prevPage->theData, xorData, sizeof(xorData)))
+      {
+         // Written with the same values
+         continue;
+      }
+
+      delta->push_back(i);
+      encodeRuns(xorData, sizeof(xorData), delta);
+      numPages++;
+   }
+
+   memcpy(&(*delta)[0], &numPages, sizeof(uint16_t));
+
+   if (deviceStates.size() != thePrevDeviceStates.size())
+   {
+      delta->push_back(DEVICE_STATES_FULL);
+      appendU32(delta, deviceStates.size());
+      delta->insert(delta->end(), deviceStates.begin(), deviceStates.end());
+      return;
+   }
+
+   std::vector<uint8_t> xorStates(deviceStates.size());
+   if (!xorBlock(deviceStates.data(), thePrevDeviceStates.data(), xorStates.data(), xorStates.size()))
+   {
+      delta->push_back(DEVICE_STATES_SAME);
+      return;
+   }
+
+   delta->push_back(DEVICE_STATES_XOR);
+   encodeRuns(xorStates.data(), xorStates.size(), delta);
+}
+
+bool RewindBuffer::applyDelta(std::vector<uint8_t> const & delta, MachineSnapshot* snapshot,
+                              std::vector<uint8_t>* deviceStates)
+{
+   uint8_t const * data = delta.data();
+   uint32_t size = delta.size();
+
+   if (size < sizeof(uint16_t))
+   {
+      return false;
+   }
+
+   uint16_t numPages;
+   memcpy(&numPages, data, sizeof(uint16_t));
+   uint32_t pos = sizeof(uint16_t);
+
+   for(int i = 0; i < numPages; i++)
+   {
+      if (pos >= size)
+      {
+         return false;
+      }
+
+      uint8_t* page = snapshot->getWritablePage(data[pos++]);
+      if (page == nullptr)
+      {
+         return false;
+      }
+
+      uint32_t numUsed = applyRuns(data + pos, size - pos, page, 0x100);
+      if (numUsed == 0)
+      {
+         return false;
+      }
+
+      pos += numUsed;
+   }
+
+   if (pos >= size)
+   {
+      return false;
+   }
+
+   switch(data[pos++])
+   {
+   case DEVICE_STATES_SAME:
+      return true;
+
+   case DEVICE_STATES_XOR:
+      return (applyRuns(data + pos, size - pos, deviceStates->data(), deviceStates->size()) != 0);
+
+   case DEVICE_STATES_FULL:
+   {
+      uint32_t numBytes;
+      if (pos + sizeof(uint32_t) > size)
+      {
+         return false;
+      }
+
+      memcpy(&numBytes, data + pos, sizeof(uint32_t));
+      pos += sizeof(uint32_t);
+
+      if (pos + numBytes > size)
+      {
+         return false;
+      }
+
+      deviceStates->assign(data + pos, data + pos + numBytes);
+      return true;
+   }
+
+   default:
+      return false;
+   }
+}
+
+bool RewindBuffer::restoreFrame(int index)
+{
+   if ( (index < 0) || (index >= (int) theFrames.size()) )
+   {
+      return false;
+   }
+
+   int keyframeIndex = index;
+   while(theFrames[keyframeIndex].theKeyframe == nullptr)
+   {
+      keyframeIndex--;
+   }
+
+   MachineSnapshot snapshot(*theFrames[keyframeIndex].theKeyframe);
+   std::vector<uint8_t> deviceStates = theFrames[keyframeIndex].theData;
+
+   for(int i = keyframeIndex + 1; i <= index; i++)
+   {
+      if (!applyDelta(theFrames[i].theData, &snapshot, &deviceStates))
+      {
+         LOG_WARNING() << "Rewind frame " << i << " is corrupt";
+         return false;
+      }
+   }
+
+   *snapshot.getCpuState() = theFrames[index].theCpuState;
+
+   // Drops the scheduled events (including the next capture)
+   theCpu->restoreSnapshot(snapshot);
+
+   SaveState state;
+   if ( !state.loadBuffer(deviceStates.data(), deviceStates.size()) ||
+        !theMemoryController->loadDeviceStates(&state) )
+   {
+      LOG_WARNING() << "Couldn't restore the devices from the rewind frame";
+   }
+
+   while((int) theFrames.size() > index + 1)
+   {
+      dropNewestFrame();
+   }
+
+   thePrevSnapshot = snapshot;
+   thePrevDeviceStates.swap(deviceStates);
+   theFramesSinceKeyframe = index - keyframeIndex;
+
+   REWIND_DEBUG() << "Rewound to clock " << theFrames[index].theCpuState.theNumClocks;
+
+   if (theCapturingFlag)
+   {
+      theCaptureEventId = theMemoryController->getEventScheduler()->scheduleIn(theFrameClocks,
+                                                                              captureEvent, this);
+   }
+
+   return true;
+}
+
+void RewindBuffer::dropOldFrames()
+{
+   while( (theFrames.size() > theMaxFrames) || (theMemoryUsage > theMemoryBudget) )
+   {
+      // Only whole keyframe groups are dropped, the newest one is always kept
+      unsigned int nextKeyframe = 1;
+      while( (nextKeyframe < theFrames.size()) && (theFrames[nextKeyframe].theKeyframe == nullptr) )
+      {
+         nextKeyframe++;
+      }
+
+      if (nextKeyframe >= theFrames.size())
+      {
+         return;
+      }
+
+      for(unsigned int i = 0; i < nextKeyframe; i++)
+      {
+         RewindFrame& oldest = theFrames.front();
+         theMemoryUsage -= oldest.theMemoryUsage;
+         delete oldest.theKeyframe;
+         theFrames.pop_front();
+      }
+   }
+}
+
+void RewindBuffer::dropNewestFrame()
+{
+   RewindFrame& newest = theFrames.back();
+   theMemoryUsage -= newest.theMemoryUsage;
+   delete newest.theKeyframe;
+   theFrames.pop_back();
+}
@@ -0,0 +1,140 @@
+#ifndef REWINDBUFFER_H
+#define REWINDBUFFER_H
+
+#include <stdint.h>
+#include <vector>
+#include <deque>
+
+#include "MachineSnapshot.h"
+
+class Cpu6502;
+class MemoryController;
+
+/// Number of frames captured per second of emulated time
+#define REWIND_FRAMES_PER_SECOND 60
+
+/// Every this many frames is a keyframe (a full snapshot), the frames in between are deltas
+#define REWIND_KEYFRAME_INTERVAL 60
+
+/// Memory budget of the rewind buffer when none is configured
+#define DEFAULT_REWIND_MEMORY_KB 4096
+
+typedef struct RewindFrameStruct
+{
+   SnapshotCpuState theCpuState;
+
+   /// Memory pages of a keyframe, nullptr for the frames in between
+   MachineSnapshot* theKeyframe;
+
+   /**
+    * Keyframes: the states of the devices that aren't memory pages (a SaveState buffer).  Other
+    * frames: the XOR / run length deltas of the pages and device states from the frame before.
+    */
+   std::vector<uint8_t> theData;
+
+   /// Estimate of the memory the frame is using
+   uint64_t theMemoryUsage;
+} RewindFrame;
+
+/**
+ * Keeps the machine state of the last seconds of emulation, so the user can go back in time (the
+ * debugger's rewind / reverse step commands, and a display hotkey).
+ *
+ * A frame is captured REWIND_FRAMES_PER_SECOND times per emulated second from a scheduler event.
+ * Keyframes are MachineSnapshots, which share all the pages that didn't change with the keyframe
+ * before them.  The frames in between only store the pages the CPU wrote since the frame before
+ * (found with the snapshot write protection), XORed with what the page used to be and run length
+ * encoded, so a page with a few changed bytes costs a few bytes.  Devices that aren't memory
+ * pages (displays, RNG, PPU) are saved with their saveState hooks and delta encoded the same way.
+ *
+ * The oldest keyframe and its frames are dropped when the buffer holds more than the configured
+ * number of seconds, or uses more than the memory budget.  Only used from the CPU thread.
+ */
+class RewindBuffer
+{
+public:
+   RewindBuffer(Cpu6502* cpu, MemoryController* mc);
+
+   ~RewindBuffer();
+
+   /**
+    * @param seconds Seconds of emulated time to keep
+    * @param memoryBudget Bytes the frames may use (the oldest frames are dropped first)
+    * @param clockHz Clock rate of the CPU, to know how many clocks are in a frame
+    */
+   void configure(uint32_t seconds, uint64_t memoryBudget, uint32_t clockHz);
+
+   /// Forgets all frames, captures a keyframe of the current state, and starts the capture event
+   void start();
+
+   /// Forgets all frames and stops capturing
+   void stop();
+
+   int getNumFrames() const;
+
+   /// Clock count of the frame (0 is the oldest)
+   uint64_t getFrameClock(int index) const;
+
+   /// Index of the newest frame captured before the clock count, -1 if there isn't one
+   int findFrame(uint64_t clock) const;
+
+   /**
+    * Puts the machine back to the frame.  The frames after it are dropped, and capturing starts
+    * again from there.
+    */
+   bool restoreFrame(int index);
+
+   /// Estimate of the memory used by the frames
+   uint64_t getMemoryUsage() const;
+
+protected:
+
+   static void captureEvent(void* context);
+
+   void captureFrame();
+
+   /// Drops the oldest keyframe and its frames while over the frame limit or the memory budget
+   void dropOldFrames();
+
+   /// Drops the newest frame
+   void dropNewestFrame();
+
+   /// Saves the devices that aren't memory pages into buffer
+   void saveDeviceStates(std::vector<uint8_t>* buffer);
+
+   /// Appends the XOR / run length delta of the frame's changes since thePrevSnapshot
+   void encodeDelta(MachineSnapshot const & snapshot, std::vector<uint8_t> const & deviceStates,
+                    std::vector<uint8_t>* delta);
+
+   /// Applies a delta encodeDelta made to the pages / device states of the frame before it
+   bool applyDelta(std::vector<uint8_t> const & delta, MachineSnapshot* snapshot,
+                   std::vector<uint8_t>* deviceStates);
+
+   Cpu6502* theCpu;
+
+   MemoryController* theMemoryController;
+
+   uint64_t theFrameClocks;
+
+   uint32_t theMaxFrames;
+
+   uint64_t theMemoryBudget;
+
+   uint64_t theMemoryUsage;
+
+   std::deque<RewindFrame> theFrames;
+
+   /// Memory pages of the newest frame, deltas are made against these
+   MachineSnapshot thePrevSnapshot;
+
+   /// Device states of the newest frame
+   std::vector<uint8_t> thePrevDeviceStates;
+
+   int theFramesSinceKeyframe;
+
+   uint32_t theCaptureEventId;
+
+   bool theCapturingFlag;
+};
+
+#endif // REWINDBUFFER_H
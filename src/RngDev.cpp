@@ -3,9 +3,12 @@
 #include "RngDev.h"
 #include "EmulatorConfig.h"
 #include "Logger.h"
+#include "SaveState.h"
+#include "MemoryController.h"
 
 #include <stdlib.h>
 #include <time.h>
+#include <sstream>
 
 #ifdef RANDOMDEV_TRACE
    #define RNG_DEBUG    LOG_DEBUG
@@ -36,7 +39,7 @@ RngDev::RngDev(std::string name):
    theConfigFlags(0)
 {
    int timeSeed = time(0);
-   srand(timeSeed);
+   theGenerator.seed(timeSeed);
 
    RNG_DEBUG() << "Created a random number generator device: " << name;
    RNG_DEBUG() << "RNG Seed = " << timeSeed;
@@ -57,7 +60,7 @@ uint8_t RngDev::read8(CpuAddress absAddr)
       return 0;
    }
 
-   return rand() & 0xff;
+   return theGenerator() & 0xff;
 }
 
 bool RngDev::write8(CpuAddress absAddr, uint8_t val)
@@ -78,7 +81,7 @@ uint16_t RngDev::read16(CpuAddress absAddr)
       return 0;
    }
 
-   return rand() & 0xffff;
+   return theGenerator() & 0xffff;
 }
 
 bool RngDev::write16(CpuAddress absAddr, uint16_t val)
@@ -144,6 +147,20 @@ void RngDev::setStringConfigValue(std::string paramName, std::string value)
 
 void RngDev::resetMemory()
 {
+   // The seed is the only thing random about the device, log it (or take it from the log) so
+   // runs can be repeated
+   InputLog* inputLog = theMemController->getInputLog();
+   uint32_t seed;
+   if (!inputLog->replayAny(INPUT_SOURCE_RNG_SEED, &seed))
+   {
+      seed = time(0);
+   }
+
+   inputLog->record(INPUT_SOURCE_RNG_SEED, seed);
+   theGenerator.seed(seed);
+
+   RNG_DEBUG() << "RNG Seed = " << seed;
+
    // If the object is completely configured, initialize itself properly
    if (isFullyConfigured())
    {
@@ -152,3 +169,23 @@ void RngDev::resetMemory()
                   << addressToString(theAddress + theSize - 1);
    }
 }
+
+void RngDev::saveState(SaveState* state)
+{
+   std::ostringstream generatorState;
+   generatorState << theGenerator;
+   state->writeString(generatorState.str());
+}
+
+bool RngDev::loadState(SaveState* state)
+{
+   std::string generatorText;
+   if (!state->readString(&generatorText))
+   {
+      return false;
+   }
+
+   std::istringstream generatorState(generatorText);
+   generatorState >> theGenerator;
+   return !generatorState.fail();
+}
@@ -3,9 +3,12 @@
 
 #include "MemoryDev.h"
 #include <iostream>
+#include <random>
 
 /**
- * A memory device that returns random data when read.  Doesn't do anything when
+ * A memory device that returns random data when read.  Doesn't do anything when written.  The
+ * generator is seeded when the device is reset, the seed is logged to (or replayed from) the input
+ * log
  */
 class RngDev : public MemoryDev
 {
@@ -44,10 +47,18 @@ public:
 
    virtual void resetMemory() override;
 
+   /// Saves the generator, so a restored machine reads the same random numbers
+   virtual void saveState(SaveState* state) override;
+
+   virtual bool loadState(SaveState* state) override;
+
 protected:
 
    int theConfigFlags;
 
+   /// Each device has its own generator, so machines running on other threads don't share one
+   std::minstd_rand theGenerator;
+
 };
 
 #endif // RNGDEV_H
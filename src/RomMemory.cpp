@@ -9,6 +9,7 @@
 #include <unistd.h>
 
 #include "Logger.h"
+#include "SaveState.h"
 
 #ifdef ROM_TRACE
    #define ROM_DEBUG    LOG_DEBUG
@@ -246,7 +247,12 @@ CpuAddress RomMemory::getStartPcAddress() const
 bool RomMemory::configSelf()
 {
    // Is startEmulatorAddress config set for this instance?
-   ConfigManager* configMgr = ConfigManager::getInstance();
+   ConfigManager* configMgr = theConfigManager;
+   if (configMgr == nullptr)
+   {
+      configMgr = ConfigManager::getInstance();
+   }
+
    if (configMgr->isConfigPresent(getConfigTypeName(), theName, "startEmulatorAddress"))
    {
       uint32_t pc = configMgr->getIntegerConfigValue(getConfigTypeName(), theName, "startEmulatorAddress");
@@ -265,3 +271,44 @@ bool RomMemory::configSelf()
 
    return retVal;
 }
+
+uint8_t* RomMemory::getHostReadPage(CpuAddress pageAddr)
+{
+   if (theData == nullptr)
+   {
+      return nullptr;
+   }
+
+   return &theData[pageAddr - theAddress];
+}
+
+uint8_t* RomMemory::getHostWritePage(CpuAddress pageAddr)
+{
+   // write8 of the ROM device modifies theData too, so writes can go direct as well
+   return getHostReadPage(pageAddr);
+}
+
+void RomMemory::saveState(SaveState* state)
+{
+   state->writeString(theRomFile);
+   state->writeU32(theSize);
+}
+
+bool RomMemory::loadState(SaveState* state)
+{
+   std::string romFile;
+   uint32_t size;
+   if (!state->readString(&romFile) || !state->readU32(&size))
+   {
+      return false;
+   }
+
+   if ( (romFile != theRomFile) || (size != theSize) )
+   {
+      LOG_WARNING() << "Save state was made with the ROM " << romFile << " (" << size
+                    << " bytes), not " << theRomFile << " (" << theSize << " bytes)";
+      return false;
+   }
+
+   return true;
+}
@@ -41,6 +41,16 @@ public:
 
    virtual void resetMemory() override;
 
+   virtual uint8_t* getHostReadPage(CpuAddress pageAddr) override;
+
+   virtual uint8_t* getHostWritePage(CpuAddress pageAddr) override;
+
+   /// Only saves which ROM file is loaded, the contents come from the file
+   virtual void saveState(SaveState* state) override;
+
+   /// Checks the same ROM file is loaded
+   virtual bool loadState(SaveState* state) override;
+
    virtual bool specifiesStartAddress() const override;
 
    virtual CpuAddress getStartPcAddress() const;
@@ -0,0 +1,158 @@
+#include <iostream>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "EmulatorConfig.h"
+#include "ConfigManager.h"
+#include "Machine.h"
+#include "MemoryController.h"
+#include "WorkStealingPool.h"
+#include "Logger.h"
+#include "Utils.h"
+
+/**
+ * Runs a batch of independent machines (fuzz cases, regression ROMs, ...) on a thread pool and
+ * reports how each of them ended.
+ */
+
+const std::string RUNNER_TYPE = "runner";
+const std::string THREADS_NAME = "threads";
+const std::string MAXCYCLES_NAME = "maxCycles";
+
+/// Default number of cycles a machine gets to run before the runner stops it
+#define DEFAULT_MAX_CYCLES 100000000
+
+/// How a single machine in the batch ended
+typedef struct RunResultStruct
+{
+   std::string theJobName;
+   CpuStopReason theStopReason;
+   uint64_t theCycles;
+   CpuAddress thePc;
+   uint64_t theChecksum;
+} RunResult;
+
+void printUsage(char* appName)
+{
+   std::cout << appName << " runs a batch of 6502 machines in parallel" << std::endl;
+   std::cout << std::endl;
+   std::cout << "  " << appName << " [settings] job1.cfg job2.cfg ..." << std::endl;
+   std::cout << std::endl;
+   std::cout << "Every job is a config file describing a machine (same options as emu6502-headless)."
+             << std::endl;
+   std::cout << "Settings (type.name.member=value) are given to every machine before its config file."
+             << std::endl;
+   std::cout << std::endl;
+   std::cout << "  " << RUNNER_TYPE << ".system." << THREADS_NAME << "=4   (default one per hardware thread)"
+             << std::endl;
+   std::cout << "  " << RUNNER_TYPE << ".system." << MAXCYCLES_NAME << "=1000000   (default "
+             << DEFAULT_MAX_CYCLES << ")" << std::endl;
+   std::cout << std::endl;
+}
+
+void runJob(std::vector<std::string> const & sharedSettings, uint64_t maxCycles, RunResult* result)
+{
+   ConfigManager cfg;
+   for(auto const & setting: sharedSettings)
+   {
+      cfg.addConfig(setting);
+   }
+
+   cfg.loadConfigFile(result->theJobName);
+
+   Machine machine(&cfg);
+   machine.makeQuiet();
+
+   Cpu6502* cpu = machine.getCpu();
+   result->theStopReason = cpu->runCycles(maxCycles);
+   result->theCycles = cpu->getInstructionCount();
+   result->thePc = cpu->getPc();
+   result->theChecksum = machine.getMemoryController()->getMemoryChecksum();
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc == 1)
+   {
+      printUsage(argv[0]);
+      return 0;
+   }
+
+   ConfigManager* configMgr = ConfigManager::createInstance();
+
+   std::vector<std::string> sharedSettings;
+   std::vector<RunResult> results;
+   for(int i = 1; i < argc; i++)
+   {
+      std::string arg = argv[i];
+      if (arg.find('=') == std::string::npos)
+      {
+         RunResult r;
+         r.theJobName = arg;
+         results.push_back(r);
+      }
+      else if (arg.compare(0, RUNNER_TYPE.size() + 1, RUNNER_TYPE + ".") == 0)
+      {
+         configMgr->addConfig(arg);
+      }
+      else
+      {
+         sharedSettings.push_back(arg);
+      }
+   }
+
+   unsigned int numThreads = 0;
+   if (configMgr->isConfigPresent(RUNNER_TYPE, THREADS_NAME))
+   {
+      numThreads = configMgr->getIntegerConfigValue(RUNNER_TYPE, THREADS_NAME);
+   }
+
+   uint64_t maxCycles = DEFAULT_MAX_CYCLES;
+   if (configMgr->isConfigPresent(RUNNER_TYPE, MAXCYCLES_NAME))
+   {
+      maxCycles = configMgr->getIntegerConfigValue(RUNNER_TYPE, MAXCYCLES_NAME);
+   }
+
+   std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+   unsigned int threadsUsed;
+   {
+      WorkStealingPool pool(numThreads);
+      threadsUsed = pool.getNumThreads();
+
+      for(auto & r: results)
+      {
+         RunResult* resultPtr = &r;
+         pool.submit([&sharedSettings, maxCycles, resultPtr] { runJob(sharedSettings, maxCycles, resultPtr); });
+      }
+
+      pool.waitAll();
+   }
+
+   int64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+
+   uint64_t numByReason[STOP_KIL + 1] = { 0 };
+   uint64_t totalCycles = 0;
+   for(auto const & r: results)
+   {
+      printf("%-40s %-10s cycles=%-12lu pc=%s checksum=%s\n", r.theJobName.c_str(),
+             Machine::getStopReasonName(r.theStopReason), r.theCycles,
+             addressToString(r.thePc).c_str(), Utils::toHex64(r.theChecksum).c_str());
+
+      numByReason[r.theStopReason]++;
+      totalCycles += r.theCycles;
+   }
+
+   printf("\n%lu machines on %u threads in %ld ms, %lu cycles total\n", results.size(), threadsUsed,
+          elapsedMs, totalCycles);
+   printf("  budget=%lu breakpoint=%lu halt=%lu kil=%lu\n", numByReason[STOP_BUDGET],
+          numByReason[STOP_BREAKPOINT], numByReason[STOP_HALT], numByReason[STOP_KIL]);
+
+   configMgr->destroyInstance();
+
+   return 0;
+}
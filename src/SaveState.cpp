@@ -0,0 +1,342 @@
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "SaveState.h"
+#include "EmulatorConfig.h"
+#include "Logger.h"
+
+#ifdef SAVE_STATE_TRACE
+   #define STATE_DEBUG   LOG_DEBUG
+#else
+   #define STATE_DEBUG   if(0) LOG_DEBUG
+#endif
+
+/// Chunk names and data are padded to this, so chunk data is aligned in the mapped file
+#define SAVE_STATE_ALIGNMENT 8
+
+SaveState::SaveState():
+   theChunkStart(0),
+   theNumChunks(0),
+   theMapping(nullptr),
+   theMappingSize(0),
+   theReadPos(nullptr),
+   theReadEnd(nullptr)
+{
+   SaveStateHeader hdr;
+   memset(&hdr, 0, sizeof(SaveStateHeader));
+   write(&hdr, sizeof(SaveStateHeader));
+}
+
+SaveState::~SaveState()
+{
+   unmapFile();
+}
+
+void SaveState::beginChunk(std::string const & name)
+{
+   theChunkStart = theSaveData.size();
+
+   SaveStateChunkHeader hdr;
+   hdr.theNameLength = name.size();
+   hdr.theReserved = 0;
+   hdr.theDataSize = 0;
+   write(&hdr, sizeof(SaveStateChunkHeader));
+
+   write(name.c_str(), name.size());
+   pad();
+}
+
+void SaveState::write(void const * data, uint64_t size)
+{
+   uint8_t const * bytes = (uint8_t const *) data;
+   theSaveData.insert(theSaveData.end(), bytes, bytes + size);
+}
+
+void SaveState::writeU8(uint8_t val)
+{
+   write(&val, sizeof(uint8_t));
+}
+
+void SaveState::writeU16(uint16_t val)
+{
+   write(&val, sizeof(uint16_t));
+}
+
+void SaveState::writeU32(uint32_t val)
+{
+   write(&val, sizeof(uint32_t));
+}
+
+void SaveState::writeU64(uint64_t val)
+{
+   write(&val, sizeof(uint64_t));
+}
+
+void SaveState::writeString(std::string const & val)
+{
+   writeU32(val.size());
+   write(val.c_str(), val.size());
+}
+
+void SaveState::endChunk()
+{
+   SaveStateChunkHeader* hdr = (SaveStateChunkHeader*) &theSaveData[theChunkStart];
+   uint64_t dataStart = theChunkStart + sizeof(SaveStateChunkHeader) + hdr->theNameLength;
+   dataStart = (dataStart + SAVE_STATE_ALIGNMENT - 1) & ~(uint64_t) (SAVE_STATE_ALIGNMENT - 1);
+
+   hdr->theDataSize = theSaveData.size() - dataStart;
+   pad();
+
+   theNumChunks++;
+}
+
+bool SaveState::saveFile(std::string const & filename)
+{
+   getSaveData();
+
+   FILE* f = fopen(filename.c_str(), "wb");
+   if (f == NULL)
+   {
+      LOG_WARNING() << "Couldn't open save state file " << filename << ": " << strerror(errno);
+      return false;
+   }
+
+   size_t bytesWritten = fwrite(&theSaveData[0], 1, theSaveData.size(), f);
+   fclose(f);
+
+   if (bytesWritten != theSaveData.size())
+   {
+      LOG_WARNING() << "Failed to write save state file " << filename;
+      return false;
+   }
+
+   STATE_DEBUG() << "Saved " << theNumChunks << " chunks (" << theSaveData.size() << " bytes) to "
+                 << filename;
+   return true;
+}
+
+bool SaveState::loadFile(std::string const & filename)
+{
+   unmapFile();
+
+   int fd = open(filename.c_str(), O_RDONLY);
+   if (fd < 0)
+   {
+      LOG_WARNING() << "Couldn't open save state file " << filename << ": " << strerror(errno);
+      return false;
+   }
+
+   struct stat fileInfo;
+   if ( (fstat(fd, &fileInfo) != 0) || (fileInfo.st_size < (off_t) sizeof(SaveStateHeader)) )
+   {
+      LOG_WARNING() << "Save state file " << filename << " is too short";
+      close(fd);
+      return false;
+   }
+
+   void* mapping = mmap(NULL, fileInfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+
+   if (mapping == MAP_FAILED)
+   {
+      LOG_WARNING() << "Couldn't map save state file " << filename << ": " << strerror(errno);
+      return false;
+   }
+
+   theMapping = (uint8_t*) mapping;
+   theMappingSize = fileInfo.st_size;
+
+   if (!indexChunks(theMapping, theMappingSize, filename))
+   {
+      unmapFile();
+      return false;
+   }
+
+   return true;
+}
+
+bool SaveState::loadBuffer(uint8_t const * data, uint64_t size)
+{
+   unmapFile();
+
+   if (size < sizeof(SaveStateHeader))
+   {
+      LOG_WARNING() << "Save state buffer is too short";
+      return false;
+   }
+
+   return indexChunks(data, size, "buffer");
+}
+
+std::vector<uint8_t> const & SaveState::getSaveData()
+{
+   SaveStateHeader* hdr = (SaveStateHeader*) &theSaveData[0];
+   memcpy(hdr->theMagic, SAVE_STATE_MAGIC, sizeof(hdr->theMagic));
+   hdr->theVersion = SAVE_STATE_VERSION;
+   hdr->theNumChunks = theNumChunks;
+
+   return theSaveData;
+}
+
+bool SaveState::indexChunks(uint8_t const * data, uint64_t size, std::string const & filename)
+{
+   theChunks.clear();
+
+   SaveStateHeader const * hdr = (SaveStateHeader const *) data;
+   if (memcmp(hdr->theMagic, SAVE_STATE_MAGIC, sizeof(hdr->theMagic)) != 0)
+   {
+      LOG_WARNING() << filename << " isn't a save state file";
+      return false;
+   }
+
+   if (hdr->theVersion != SAVE_STATE_VERSION)
+   {
+      LOG_WARNING() << "Save state file " << filename << " is version " << hdr->theVersion
+                    << ", only version " << SAVE_STATE_VERSION << " is supported";
+      return false;
+   }
+
+   uint64_t offset = sizeof(SaveStateHeader);
+   for(uint32_t i = 0; i < hdr->theNumChunks; i++)
+   {
+      if (offset + sizeof(SaveStateChunkHeader) > size)
+      {
+         LOG_WARNING() << "Save state file " << filename << " is truncated";
+         return false;
+      }
+
+      SaveStateChunkHeader const * chunkHdr = (SaveStateChunkHeader const *) (data + offset);
+      uint64_t nameStart = offset + sizeof(SaveStateChunkHeader);
+      uint64_t dataStart = nameStart + chunkHdr->theNameLength;
+      dataStart = (dataStart + SAVE_STATE_ALIGNMENT - 1) & ~(uint64_t) (SAVE_STATE_ALIGNMENT - 1);
+
+      if ( (dataStart > size) || (chunkHdr->theDataSize > size - dataStart) )
+      {
+         LOG_WARNING() << "Save state file " << filename << " is truncated";
+         return false;
+      }
+
+      std::string name((char const *) data + nameStart, chunkHdr->theNameLength);
+
+      ChunkLocation loc;
+      loc.theData = data + dataStart;
+      loc.theSize = chunkHdr->theDataSize;
+      theChunks[name] = loc;
+
+      STATE_DEBUG() << "Save state chunk " << name << ", " << loc.theSize << " bytes";
+
+      offset = dataStart + chunkHdr->theDataSize;
+      offset = (offset + SAVE_STATE_ALIGNMENT - 1) & ~(uint64_t) (SAVE_STATE_ALIGNMENT - 1);
+   }
+
+   return true;
+}
+
+bool SaveState::openChunk(std::string const & name)
+{
+   auto it = theChunks.find(name);
+   if (it == theChunks.end())
+   {
+      theReadPos = nullptr;
+      theReadEnd = nullptr;
+      return false;
+   }
+
+   theReadPos = it->second.theData;
+   theReadEnd = it->second.theData + it->second.theSize;
+   return true;
+}
+
+bool SaveState::read(void* data, uint64_t size)
+{
+   uint8_t const * src = readPointer(size);
+   if (src == nullptr)
+   {
+      return false;
+   }
+
+   memcpy(data, src, size);
+   return true;
+}
+
+uint8_t const * SaveState::readPointer(uint64_t size)
+{
+   if (size > getChunkBytesLeft())
+   {
+      return nullptr;
+   }
+
+   uint8_t const * retVal = theReadPos;
+   theReadPos += size;
+   return retVal;
+}
+
+bool SaveState::readU8(uint8_t* val)
+{
+   return read(val, sizeof(uint8_t));
+}
+
+bool SaveState::readU16(uint16_t* val)
+{
+   return read(val, sizeof(uint16_t));
+}
+
+bool SaveState::readU32(uint32_t* val)
+{
+   return read(val, sizeof(uint32_t));
+}
+
+bool SaveState::readU64(uint64_t* val)
+{
+   return read(val, sizeof(uint64_t));
+}
+
+bool SaveState::readString(std::string* val)
+{
+   uint32_t len;
+   if (!readU32(&len))
+   {
+      return false;
+   }
+
+   uint8_t const * chars = readPointer(len);
+   if (chars == nullptr)
+   {
+      return false;
+   }
+
+   val->assign((char const *) chars, len);
+   return true;
+}
+
+uint64_t SaveState::getChunkBytesLeft() const
+{
+   return theReadEnd - theReadPos;
+}
+
+void SaveState::pad()
+{
+   while(theSaveData.size() % SAVE_STATE_ALIGNMENT)
+   {
+      theSaveData.push_back(0);
+   }
+}
+
+void SaveState::unmapFile()
+{
+   if (theMapping != nullptr)
+   {
+      munmap(theMapping, theMappingSize);
+      theMapping = nullptr;
+      theMappingSize = 0;
+   }
+
+   theChunks.clear();
+   theReadPos = nullptr;
+   theReadEnd = nullptr;
+}
@@ -0,0 +1,135 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
+/// Identifies a save state file
+#define SAVE_STATE_MAGIC "6502SAVE"
+
+/// Bumped whenever the layout of the file or of any chunk changes
+#define SAVE_STATE_VERSION 1
+
+/// Start of a save state file, followed by the chunks
+typedef struct SaveStateHeaderStruct
+{
+   char theMagic[8];
+   uint32_t theVersion;
+   uint32_t theNumChunks;
+} SaveStateHeader;
+
+/// Start of each chunk, followed by the name and then the data (each padded to 8 bytes)
+typedef struct SaveStateChunkHeaderStruct
+{
+   uint32_t theNameLength;
+   uint32_t theReserved;
+   uint64_t theDataSize;
+} SaveStateChunkHeader;
+
+/**
+ * A snapshot of a whole machine in a chunked binary file.  Every part of the machine (the CPU,
+ * each memory device) writes its own named chunk, so loading can find the chunk for each part no
+ * matter what order the devices were created in.
+ *
+ * Loading maps the file into memory instead of reading it, and the data of every chunk is 8 byte
+ * aligned, so devices can copy their contents straight out of the mapping.  Values are stored in
+ * host byte order, the files are for restoring a machine on the same host, not for sharing.
+ */
+class SaveState
+{
+public:
+   SaveState();
+
+   ~SaveState();
+
+   // Saving
+
+   /// Starts a chunk, everything written until endChunk belongs to it
+   void beginChunk(std::string const & name);
+
+   void write(void const * data, uint64_t size);
+
+   void writeU8(uint8_t val);
+   void writeU16(uint16_t val);
+   void writeU32(uint32_t val);
+   void writeU64(uint64_t val);
+
+   /// Length prefixed string
+   void writeString(std::string const & val);
+
+   void endChunk();
+
+   bool saveFile(std::string const & filename);
+
+   /// The whole state (header and chunks) as it would be written to a file
+   std::vector<uint8_t> const & getSaveData();
+
+   // Loading
+
+   /// Maps the file and indexes its chunks
+   bool loadFile(std::string const & filename);
+
+   /// Indexes the chunks of a state that is already in memory (must outlive the reads)
+   bool loadBuffer(uint8_t const * data, uint64_t size);
+
+   /**
+    * Makes the chunk with the name the one the read functions read from
+    * @return False if the state doesn't have the chunk
+    */
+   bool openChunk(std::string const & name);
+
+   /// All of the read functions return false (nullptr) when they would read past the chunk
+   bool read(void* data, uint64_t size);
+
+   /// Points at the next size bytes of the chunk in the mapped file, and moves past them
+   uint8_t const * readPointer(uint64_t size);
+
+   bool readU8(uint8_t* val);
+   bool readU16(uint16_t* val);
+   bool readU32(uint32_t* val);
+   bool readU64(uint64_t* val);
+   bool readString(std::string* val);
+
+   /// Number of bytes of the open chunk that haven't been read
+   uint64_t getChunkBytesLeft() const;
+
+protected:
+
+   void pad();
+
+   /// Validates the header and finds the chunks of a file / buffer
+   bool indexChunks(uint8_t const * data, uint64_t size, std::string const & filename);
+
+   void unmapFile();
+
+   // Saving state
+
+   std::vector<uint8_t> theSaveData;
+
+   /// Offset of the header of the chunk being written
+   uint64_t theChunkStart;
+
+   uint32_t theNumChunks;
+
+   // Loading state
+
+   uint8_t* theMapping;
+
+   uint64_t theMappingSize;
+
+   typedef struct ChunkLocationStruct
+   {
+      uint8_t const * theData;
+      uint64_t theSize;
+   } ChunkLocation;
+
+   std::map<std::string, ChunkLocation> theChunks;
+
+   uint8_t const * theReadPos;
+
+   uint8_t const * theReadEnd;
+};
+
+#endif // SAVESTATE_H
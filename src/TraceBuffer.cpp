@@ -0,0 +1,32 @@
+#include "TraceBuffer.h"
+
+TraceBuffer::TraceBuffer(uint32_t numRecords):
+   TraceWriter(numRecords * sizeof(TraceRecord), TRACE_FILE_MAGIC),
+   theCapacityRecords(numRecords),
+   theLastClock(0)
+{
+   thePlaneBuffer = new uint8_t[numRecords * sizeof(TraceRecord)];
+}
+
+TraceBuffer::~TraceBuffer()
+{
+   // The writer thread still needs prepareBlock and the plane buffer for the last block
+   close();
+
+   delete[] thePlaneBuffer;
+}
+
+uint8_t const * TraceBuffer::prepareBlock(uint8_t const * data, uint32_t dataSize,
+                                          uint32_t numRecords)
+{
+   for(uint32_t b = 0; b < sizeof(TraceRecord); b++)
+   {
+      uint8_t* plane = thePlaneBuffer + b * numRecords;
+      for(uint32_t i = 0; i < numRecords; i++)
+      {
+         plane[i] = data[i * sizeof(TraceRecord) + b];
+      }
+   }
+
+   return thePlaneBuffer;
+}
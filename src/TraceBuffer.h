@@ -0,0 +1,106 @@
+#ifndef TRACEBUFFER_H
+#define TRACEBUFFER_H
+
+#include <stdint.h>
+
+#include "TraceWriter.h"
+#include "Cpu6502Defines.h"
+
+/**
+ * Binary execution trace.  Every traced instruction is a fixed size record with the state of the
+ * CPU before the instruction executed.  Records are stored in host byte order, trace6502 renders
+ * them back into text.
+ *
+ * The records of each block are split into byte planes (byte 0 of every record, then byte 1 of
+ * every record, ...) before they are compressed.
+ */
+
+/// Magic at the start of a full binary trace file
+#define TRACE_FILE_MAGIC    "6502TRC3"
+
+/// Number of records in each of the two buffers
+#define TRACE_BUFFER_RECORDS 0x10000
+
+typedef struct TraceRecordStruct
+{
+   uint16_t thePc;
+
+   /// Op code and operand bytes, bytes past the end of the instruction are 0
+   uint8_t theOpCodes[3];
+
+   uint8_t theAccum;
+   uint8_t theRegX;
+   uint8_t theRegY;
+   uint8_t theStackPtr;
+   uint8_t theStatusReg;
+
+   /// Clock cycles since the previous record in the block (0 for the first record)
+   uint16_t theCycleDelta;
+} TraceRecord;
+
+static_assert(sizeof(TraceRecord) == 12, "Trace records are written to the file as-is");
+
+/**
+ * Collects full trace records for the CPU thread, TraceWriter writes them out in the background.
+ */
+class TraceBuffer : public TraceWriter
+{
+public:
+   TraceBuffer(uint32_t numRecords = TRACE_BUFFER_RECORDS);
+
+   ~TraceBuffer();
+
+   /**
+    * Adds a record for the instruction at pc
+    * @param opCodes The op code and operand bytes (only as many as the instruction has are used)
+    * @param clock Clock count before the instruction executed
+    */
+   inline void addRecord(CpuAddress pc, uint8_t const * opCodes, uint8_t accum, uint8_t regX,
+                         uint8_t regY, uint8_t stackPtr, uint8_t statusReg, uint64_t clock)
+   {
+      uint64_t delta = clock - theLastClock;
+      if ( (theNumRecords == theCapacityRecords) || ((theNumRecords != 0) && (delta > UINT16_MAX)) )
+      {
+         // Full, or the clock jumped (trace was turned off for a while)
+         submitBuffer(false);
+      }
+
+      if (theNumRecords == 0)
+      {
+         theBlockStartClock = clock;
+         delta = 0;
+      }
+
+      TraceRecord* r = (TraceRecord*) theData + theNumRecords++;
+      r->thePc = pc;
+      r->theOpCodes[0] = opCodes[0];
+      r->theOpCodes[1] = (gOpCodes[opCodes[0]].theNumBytes >= 2 ? opCodes[1] : 0);
+      r->theOpCodes[2] = (gOpCodes[opCodes[0]].theNumBytes >= 3 ? opCodes[2] : 0);
+      r->theAccum = accum;
+      r->theRegX = regX;
+      r->theRegY = regY;
+      r->theStackPtr = stackPtr;
+      r->theStatusReg = statusReg;
+      r->theCycleDelta = delta;
+
+      theDataSize += sizeof(TraceRecord);
+      theLastClock = clock;
+   }
+
+protected:
+
+   /// The same byte of consecutive records is usually the same or close (PC in a loop, op codes,
+   /// registers that don't change), splitting them into planes makes that compress well
+   virtual uint8_t const * prepareBlock(uint8_t const * data, uint32_t dataSize,
+                                        uint32_t numRecords);
+
+   uint32_t theCapacityRecords;
+
+   /// Clock count of the last record added
+   uint64_t theLastClock;
+
+   /// Records split into byte planes (used by the writer thread)
+   uint8_t* thePlaneBuffer;
+};
+
+#endif // TRACEBUFFER_H
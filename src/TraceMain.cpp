@@ -0,0 +1,403 @@
+#include<iostream>
+
+#include<inttypes.h>
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<getopt.h>
+#include<vector>
+#include "RamMemory.h"
+#include "MemoryController.h"
+#include "Disassembler6502.h"
+#include "TraceBuffer.h"
+#include "TraceReader.h"
+#include "FlowTraceDecoder.h"
+#include "Logger.h"
+
+/**
+ * Renders the binary execution trace written by the emulator (trace.bin) as text.  The default
+ * output is the same format the emulator used to write to trace.txt.  The nestest mode writes
+ * the columns of the well known nestest.log that don't depend on the contents of memory or the
+ * PPU: the PC, instruction bytes, disassembly (without the "= xx" memory annotations), the
+ * registers, and the clock count in place of the PPU / CYC columns.
+ *
+ * A control flow trace (emulator.system.traceMode=flow) is expanded back into the list of
+ * executed instructions.  It doesn't have the registers or clock counts, so only the address,
+ * instruction bytes and disassembly of each instruction are written.
+ */
+
+
+void printUsage(char* appName)
+{
+   std::cout << appName << " renders a binary 6502 execution trace (full or control flow) as text" << std::endl;
+   std::cout << appName << " -f filename [-o output] [-n] [-h]" << std::endl;
+   std::cout << "  -f --file       Binary trace file (trace.bin)" << std::endl;
+   std::cout << "  -o --output     Text file to write (default is stdout, mixed with the log)" << std::endl;
+   std::cout << "  -n --nestest    Output in the nestest.log format (full traces only)" << std::endl;
+   std::cout << "  -h --help       Show this help" << std::endl;
+   std::cout << std::endl;
+}
+
+/**
+ * Disassembles the instructions in the trace.  The disassembler reads the instruction out of
+ * memory, so the bytes from each record are written into a RAM covering the whole address space
+ * first.  The instructions of a control flow trace come from FlowTraceDecoder.
+ */
+class TraceRenderer : public FlowTraceListener
+{
+public:
+   TraceRenderer(FILE* output):
+      theDisassembler(&theMemoryController),
+      theOutput(output)
+   {
+      // A RAM device can't cover all 64K
+      for(int i = 0; i < 2; i++)
+      {
+         RamMemory* ram = new RamMemory(i == 0 ? "Low RAM" : "High RAM");
+         ram->setIntConfigValue("startAddress", i * 0x8000);
+         ram->setIntConfigValue("size", 0x8000);
+         ram->resetMemory();
+
+         theMemoryController.addNewDevice(ram);
+      }
+
+      theMemoryController.setDumpOnDestroy(false);
+
+      theDisassembler.includeOpCodes(true);
+      theDisassembler.includeAddress(true);
+   }
+
+   /// Same format as the text trace the emulator used to write
+   void printTextRecord(TraceRecord const & r, uint64_t clock)
+   {
+      for(int i = 0; i < 3; i++)
+      {
+         write8(r.thePc + i, r.theOpCodes[i]);
+      }
+
+      std::string disassText = disassemble(r.thePc);
+
+      // Lets get the length to 45 characters
+      while(disassText.size() < 45)
+      {
+         disassText.push_back(' ');
+      }
+
+      fprintf(theOutput, "%sA=%02x,  X=%02x,  Y=%02x,  SP=%02x,  SR=%02x,  CLK=%016" PRIx64 "\n",
+             disassText.c_str(), r.theAccum, r.theRegX, r.theRegY, r.theStackPtr,
+             r.theStatusReg, clock);
+   }
+
+   /// The nestest.log columns that only depend on the instruction and the registers
+   void printNestestRecord(TraceRecord const & r, uint64_t clock)
+   {
+      OpCodeInfo* oci = &gOpCodes[r.theOpCodes[0]];
+
+      char bytesText[16];
+      int pos = snprintf(bytesText, sizeof(bytesText), "%02X ", r.theOpCodes[0]);
+      for(int i = 1; i < 3; i++)
+      {
+         if (i < oci->theNumBytes)
+         {
+            pos += snprintf(bytesText + pos, sizeof(bytesText) - pos, "%02X ", r.theOpCodes[i]);
+         }
+         else
+         {
+            pos += snprintf(bytesText + pos, sizeof(bytesText) - pos, "   ");
+         }
+      }
+
+      std::string mnemonic = oci->theMnemonicDisass;
+      if (mnemonic == "ISC")
+      {
+         // nestest.log uses the other common name
+         mnemonic = "ISB";
+      }
+
+      uint16_t absAddr = r.theOpCodes[1] | (r.theOpCodes[2] << 8);
+      char operandText[16] = "";
+      switch(oci->theAddrMode)
+      {
+      case IMPLIED:
+         if ( (r.theOpCodes[0] & 0x9f) == 0x0a)
+         {
+            // ASL, ROL, LSR, ROR of the accumulator
+            strcpy(operandText, "A");
+         }
+         break;
+
+      case IMMEDIATE:
+         snprintf(operandText, sizeof(operandText), "#$%02X", r.theOpCodes[1]);
+         break;
+
+      case ZERO_PAGE:
+         snprintf(operandText, sizeof(operandText), "$%02X", r.theOpCodes[1]);
+         break;
+
+      case ZERO_PAGE_X:
+         snprintf(operandText, sizeof(operandText), "$%02X,X", r.theOpCodes[1]);
+         break;
+
+      case ZERO_PAGE_Y:
+         snprintf(operandText, sizeof(operandText), "$%02X,Y", r.theOpCodes[1]);
+         break;
+
+      case ABSOLUTE:
+         snprintf(operandText, sizeof(operandText), "$%04X", absAddr);
+         break;
+
+      case ABSOLUTE_X:
+         snprintf(operandText, sizeof(operandText), "$%04X,X", absAddr);
+         break;
+
+      case ABSOLUTE_Y:
+         snprintf(operandText, sizeof(operandText), "$%04X,Y", absAddr);
+         break;
+
+      case INDIRECT:
+         snprintf(operandText, sizeof(operandText), "($%04X)", absAddr);
+         break;
+
+      case INDIRECT_X:
+         snprintf(operandText, sizeof(operandText), "($%02X,X)", r.theOpCodes[1]);
+         break;
+
+      case INDIRECT_Y:
+         snprintf(operandText, sizeof(operandText), "($%02X),Y", r.theOpCodes[1]);
+         break;
+
+      case RELATIVE:
+         snprintf(operandText, sizeof(operandText), "$%04X",
+                  (uint16_t) (r.thePc + 2 + (int8_t) r.theOpCodes[1]));
+         break;
+      }
+
+      std::string disassText = mnemonic;
+      if (operandText[0] != 0)
+      {
+         disassText += " ";
+         disassText += operandText;
+      }
+
+      fprintf(theOutput, "%04X  %s%c%-32sA:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%" PRIu64 "\n", r.thePc,
+             bytesText, isUnofficial(r.theOpCodes[0]) ? '*' : ' ', disassText.c_str(),
+             r.theAccum, r.theRegX, r.theRegY, r.theStatusReg, r.theStackPtr, clock);
+   }
+
+   /// Address, instruction bytes and disassembly of an instruction of a control flow trace
+   virtual void flowInstruction(CpuAddress pc, uint8_t const * opCodes) override
+   {
+      for(int i = 0; i < 3; i++)
+      {
+         write8(pc + i, opCodes[i]);
+      }
+
+      fprintf(theOutput, "%s\n", disassemble(pc).c_str());
+   }
+
+   virtual void flowInterrupt(CpuAddress handlerPc) override
+   {
+      fprintf(theOutput, "Interrupt, handler at $%04X\n", handlerPc);
+   }
+
+   virtual void flowResumed(CpuAddress pc) override
+   {
+      fprintf(theOutput, "Trace resumed at $%04X\n", pc);
+   }
+
+protected:
+
+   /// Memory the instructions are disassembled from
+   void write8(CpuAddress addr, uint8_t val)
+   {
+      theMemoryController.getDevice(addr)->write8(addr, val);
+   }
+
+   /// Disassembles the instruction in memory at pc (without a line ending)
+   std::string disassemble(CpuAddress pc)
+   {
+      std::string disassText = theDisassembler.debugListing(pc, 1);
+      disassText.pop_back();  // Remove line ending
+      theDisassembler.resetListing();
+      return disassText;
+   }
+
+   /// nestest.log marks the undocumented op codes with a *
+   bool isUnofficial(uint8_t opCode)
+   {
+      char const * const unofficialMnemonics[] = { "SLO", "RLA", "SRE", "RRA", "SAX", "LAX",
+                                                   "DCP", "ISC", "ANC", "ALR", "ARR", "XAA",
+                                                   "AXS", "AHX", "SHX", "SHY", "TAS", "LAS",
+                                                   "KIL" };
+
+      char const * mnemonic = gOpCodes[opCode].theMnemonicDisass;
+      for(auto um: unofficialMnemonics)
+      {
+         if (strcmp(mnemonic, um) == 0)
+         {
+            return true;
+         }
+      }
+
+      // The extra NOPs and the SBC copy
+      return ( (strcmp(mnemonic, "NOP") == 0) && (opCode != 0xea) ) || (opCode == 0xeb);
+   }
+
+   MemoryController theMemoryController;
+
+   Disassembler6502 theDisassembler;
+
+   FILE* theOutput;
+};
+
+int main(int argc, char* argv[])
+{
+   struct option long_options[] = {
+      { "file",     required_argument, 0, 'f'},
+      { "output",   required_argument, 0, 'o'},
+      { "nestest",  no_argument,       0, 'n'},
+      { "help",     no_argument,       0, 'h'},
+      { 0,          0,                 0, 0}
+   };
+
+   // Default settings
+   std::string filename = "";
+   std::string outputFilename = "";
+   bool nestestFormat   = false;
+
+   int optIndex;
+
+   while(true)
+   {
+      char optChar = getopt_long(argc, argv, "f:o:nh", long_options, &optIndex);
+
+      if (optChar == -1)
+      {
+         break;
+      }
+
+      switch (optChar)
+      {
+      case 'f':
+         filename = optarg;
+         break;
+
+      case 'o':
+         outputFilename = optarg;
+         break;
+
+      case 'n':
+         nestestFormat = true;
+         break;
+
+      case 'h':
+         printUsage(argv[0]);
+         return 0;
+
+      default:
+         std::cerr << "Invalid argument.  Use -h or --help to see usage" << std::endl;
+      }
+   }
+
+   if (filename == "")
+   {
+      LOG_WARNING() << "Filename is a required parameter!";
+      printUsage(argv[0]);
+      return 1;
+   }
+
+   TraceReader reader;
+   if (!reader.open(filename))
+   {
+      return 1;
+   }
+
+   bool flowTrace = reader.isFlowTrace();
+
+   if (flowTrace && nestestFormat)
+   {
+      LOG_WARNING() << "A control flow trace doesn't have the registers for the nestest format";
+      nestestFormat = false;
+   }
+
+   FILE* output = stdout;
+   if (outputFilename != "")
+   {
+      output = fopen(outputFilename.c_str(), "w");
+      if (!output)
+      {
+         LOG_WARNING() << "Error creating output file " << outputFilename;
+         return 1;
+      }
+   }
+
+   TraceRenderer renderer(output);
+   FlowTraceDecoder flowDecoder(&renderer);
+   std::vector<uint8_t> data;
+   std::vector<TraceRecord> records;
+
+   if (!nestestFormat)
+   {
+      fprintf(output, "Execution start\n");
+   }
+
+   int retVal = 0;
+   TraceBlockHeader blockHeader;
+   while(reader.readBlock(&blockHeader, data))
+   {
+      if (!flowTrace && !TraceReader::readRecords(blockHeader, data, records))
+      {
+         LOG_WARNING() << "Trace file " << filename << " is truncated or corrupt";
+         retVal = 1;
+         break;
+      }
+
+      if ( (blockHeader.theNumDropped > 0) && !nestestFormat)
+      {
+         fprintf(output, "Trace writer fell behind, dropped %u instructions\n", blockHeader.theNumDropped);
+      }
+
+      if (flowTrace)
+      {
+         if (!flowDecoder.decodeBlock(data.data(), data.size(), blockHeader.theNumRecords))
+         {
+            LOG_WARNING() << "Flow trace " << filename << " is corrupt";
+            retVal = 1;
+            break;
+         }
+         continue;
+      }
+
+      uint64_t clock = blockHeader.theStartClock;
+      for(auto const & r: records)
+      {
+         clock += r.theCycleDelta;
+
+         if (nestestFormat)
+         {
+            renderer.printNestestRecord(r, clock);
+         }
+         else
+         {
+            renderer.printTextRecord(r, clock);
+         }
+      }
+   }
+
+   if (reader.isCorrupt())
+   {
+      retVal = 1;
+   }
+
+   if (!nestestFormat)
+   {
+      fprintf(output, "Execution end\n");
+   }
+
+   if (output != stdout)
+   {
+      fclose(output);
+   }
+
+   return retVal;
+}
@@ -0,0 +1,119 @@
+#include <string.h>
+
+#include "TraceReader.h"
+#include "FlowTraceBuffer.h"
+#include "LzCodec.h"
+#include "Logger.h"
+
+TraceReader::TraceReader():
+   theFile(nullptr),
+   theFlowTraceFlag(false),
+   theCorruptFlag(false)
+{
+}
+
+TraceReader::~TraceReader()
+{
+   close();
+}
+
+bool TraceReader::open(std::string const & filename)
+{
+   close();
+
+   theFile = fopen(filename.c_str(), "rb");
+   if (!theFile)
+   {
+      LOG_WARNING() << "Error opening trace file " << filename;
+      return false;
+   }
+
+   theFilename = filename;
+   theCorruptFlag = false;
+
+   TraceFileHeader fileHeader;
+   memset(&fileHeader, 0, sizeof(fileHeader));
+   if (fread(&fileHeader, sizeof(fileHeader), 1, theFile) == 1)
+   {
+      theFlowTraceFlag = (memcmp(fileHeader.theMagic, FLOW_TRACE_FILE_MAGIC, sizeof(fileHeader.theMagic)) == 0);
+   }
+
+   if ( !theFlowTraceFlag && (memcmp(fileHeader.theMagic, TRACE_FILE_MAGIC, sizeof(fileHeader.theMagic)) != 0) )
+   {
+      LOG_WARNING() << filename << " isn't a binary execution trace";
+      close();
+      return false;
+   }
+
+   return true;
+}
+
+void TraceReader::close()
+{
+   if (theFile)
+   {
+      fclose(theFile);
+      theFile = nullptr;
+   }
+}
+
+bool TraceReader::isFlowTrace() const
+{
+   return theFlowTraceFlag;
+}
+
+bool TraceReader::readBlock(TraceBlockHeader* header, std::vector<uint8_t>& data)
+{
+   if (!theFile || (fread(header, sizeof(TraceBlockHeader), 1, theFile) != 1))
+   {
+      return false;
+   }
+
+   if (header->theMagic != TRACE_BLOCK_MAGIC)
+   {
+      LOG_WARNING() << "Corrupt block header in " << theFilename;
+      theCorruptFlag = true;
+      return false;
+   }
+
+   std::vector<uint8_t> compressed(header->theCompressedSize);
+   data.resize(header->theDataSize);
+
+   if ( (fread(compressed.data(), 1, compressed.size(), theFile) != compressed.size()) ||
+        !LzCodec::decompress(compressed.data(), compressed.size(), data.data(), data.size()) )
+   {
+      LOG_WARNING() << "Trace file " << theFilename << " is truncated or corrupt";
+      theCorruptFlag = true;
+      return false;
+   }
+
+   return true;
+}
+
+bool TraceReader::isCorrupt() const
+{
+   return theCorruptFlag;
+}
+
+bool TraceReader::readRecords(TraceBlockHeader const & header, std::vector<uint8_t> const & planes,
+                              std::vector<TraceRecord>& records)
+{
+   if (header.theDataSize != header.theNumRecords * sizeof(TraceRecord))
+   {
+      return false;
+   }
+
+   records.resize(header.theNumRecords);
+
+   uint8_t* dst = (uint8_t*) records.data();
+   for(uint32_t b = 0; b < sizeof(TraceRecord); b++)
+   {
+      uint8_t const * plane = planes.data() + b * header.theNumRecords;
+      for(uint32_t i = 0; i < header.theNumRecords; i++)
+      {
+         dst[i * sizeof(TraceRecord) + b] = plane[i];
+      }
+   }
+
+   return true;
+}
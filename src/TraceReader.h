@@ -0,0 +1,63 @@
+#ifndef TRACEREADER_H
+#define TRACEREADER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "TraceWriter.h"
+#include "TraceBuffer.h"
+
+/**
+ * Reads back the blocks of a binary trace file written by TraceWriter, either kind of trace.  The
+ * data of a full trace block is put back into records with readRecords, the data of a control
+ * flow trace block is expanded with FlowTraceDecoder.
+ */
+class TraceReader
+{
+public:
+   TraceReader();
+
+   ~TraceReader();
+
+   /**
+    * Opens the trace file and checks its header
+    * @return False if it can't be opened, or isn't a binary execution trace
+    */
+   bool open(std::string const & filename);
+
+   void close();
+
+   /// Control flow trace (FlowTraceBuffer) rather than a full trace (TraceBuffer)
+   bool isFlowTrace() const;
+
+   /**
+    * Reads and decompresses the next block
+    * @param data Set to the data of the block
+    * @return False at the end of the file, or if the block is truncated or corrupt (isCorrupt)
+    */
+   bool readBlock(TraceBlockHeader* header, std::vector<uint8_t>& data);
+
+   /// The last readBlock stopped at a truncated or corrupt block, rather than the end of the file
+   bool isCorrupt() const;
+
+   /**
+    * Puts the byte planes of a full trace block back together into records
+    * @return False if the block isn't the size of its records
+    */
+   static bool readRecords(TraceBlockHeader const & header, std::vector<uint8_t> const & planes,
+                           std::vector<TraceRecord>& records);
+
+protected:
+
+   FILE* theFile;
+
+   std::string theFilename;
+
+   bool theFlowTraceFlag;
+
+   bool theCorruptFlag;
+};
+
+#endif // TRACEREADER_H
@@ -0,0 +1,213 @@
+#include <string.h>
+
+#include "TraceWriter.h"
+#include "LzCodec.h"
+#include "Logger.h"
+
+TraceWriter::TraceWriter(uint32_t capacity, char const * fileMagic):
+   theCapacity(capacity),
+   theDataSize(0),
+   theNumRecords(0),
+   theBlockStartClock(0),
+   theMaxStallMs(DEFAULT_TRACE_MAX_STALL_MS),
+   theNumDroppedSinceBlock(0),
+   theTotalDropped(0),
+   theWritePendingFlag(false),
+   theShutdownFlag(false),
+   theWriteDataSize(0),
+   theNumWriteRecords(0),
+   theWriteStartClock(0),
+   theWriteNumDropped(0),
+   theFile(nullptr)
+{
+   memcpy(theFileMagic, fileMagic, sizeof(theFileMagic));
+
+   theData = new uint8_t[theCapacity];
+   theWriteData = new uint8_t[theCapacity];
+
+   theCompressedBuffer = new uint8_t[LzCodec::compressBound(theCapacity)];
+}
+
+TraceWriter::~TraceWriter()
+{
+   close();
+
+   if (theTotalDropped > 0)
+   {
+      LOG_WARNING() << "Trace writer fell behind, dropped " << theTotalDropped << " instructions";
+   }
+
+   delete[] theData;
+   delete[] theWriteData;
+   delete[] theCompressedBuffer;
+}
+
+bool TraceWriter::open(std::string const & filename)
+{
+   theFile = fopen(filename.c_str(), "wb");
+   if (!theFile)
+   {
+      LOG_WARNING() << "Error opening " << filename << " execution trace file";
+      return false;
+   }
+
+   TraceFileHeader header;
+   memcpy(header.theMagic, theFileMagic, sizeof(header.theMagic));
+   fwrite(&header, sizeof(header), 1, theFile);
+
+   theWriterThread = std::thread(&TraceWriter::writerThread, this);
+
+   return true;
+}
+
+void TraceWriter::close()
+{
+   if (!theFile)
+   {
+      return;
+   }
+
+   flush();
+
+   {
+      std::lock_guard<std::mutex> lock(theLock);
+      theShutdownFlag = true;
+   }
+   theWorkAvailable.notify_one();
+
+   theWriterThread.join();
+
+   fclose(theFile);
+   theFile = nullptr;
+}
+
+void TraceWriter::setMaxStall(uint32_t maxStallMs)
+{
+   theMaxStallMs = maxStallMs;
+}
+
+void TraceWriter::flush()
+{
+   if (!theFile)
+   {
+      theDataSize = 0;
+      theNumRecords = 0;
+      return;
+   }
+
+   // An empty block still carries the count of dropped instructions
+   if ( (theDataSize > 0) || (theNumDroppedSinceBlock > 0) )
+   {
+      submitBuffer(true);
+   }
+
+   std::unique_lock<std::mutex> lock(theLock);
+   theWriteDone.wait(lock, [this] { return !theWritePendingFlag; });
+
+   fflush(theFile);
+}
+
+uint64_t TraceWriter::getNumDropped()
+{
+   return theTotalDropped;
+}
+
+bool TraceWriter::submitBuffer(bool waitForever)
+{
+   if (!theFile)
+   {
+      // Nowhere to write it
+      theDataSize = 0;
+      theNumRecords = 0;
+      return false;
+   }
+
+   std::unique_lock<std::mutex> lock(theLock);
+
+   if (waitForever)
+   {
+      theWriteDone.wait(lock, [this] { return !theWritePendingFlag; });
+   }
+   else if (!theWriteDone.wait_for(lock, std::chrono::milliseconds(theMaxStallMs),
+                                   [this] { return !theWritePendingFlag; }))
+   {
+      // Writer is still busy with the other buffer, throw this one away
+      theNumDroppedSinceBlock += theNumRecords;
+      theTotalDropped += theNumRecords;
+      theDataSize = 0;
+      theNumRecords = 0;
+      return false;
+   }
+
+   uint8_t* writerBuffer = theWriteData;
+   theWriteData = theData;
+   theWriteDataSize = theDataSize;
+   theNumWriteRecords = theNumRecords;
+   theWriteStartClock = theBlockStartClock;
+   theWriteNumDropped = theNumDroppedSinceBlock;
+   theWritePendingFlag = true;
+
+   theData = writerBuffer;
+   theDataSize = 0;
+   theNumRecords = 0;
+   theNumDroppedSinceBlock = 0;
+
+   lock.unlock();
+   theWorkAvailable.notify_one();
+
+   return true;
+}
+
+uint8_t const * TraceWriter::prepareBlock(uint8_t const * data, uint32_t dataSize,
+                                          uint32_t numRecords)
+{
+   return data;
+}
+
+void TraceWriter::writerThread()
+{
+   std::unique_lock<std::mutex> lock(theLock);
+
+   while(true)
+   {
+      theWorkAvailable.wait(lock, [this] { return theShutdownFlag || theWritePendingFlag; });
+
+      if (theWritePendingFlag)
+      {
+         // The CPU won't touch the write buffer until theWritePendingFlag is cleared
+         lock.unlock();
+         writeBlock(theWriteData, theWriteDataSize, theNumWriteRecords, theWriteStartClock,
+                    theWriteNumDropped);
+         lock.lock();
+
+         theWritePendingFlag = false;
+         theWriteDone.notify_all();
+         continue;
+      }
+
+      if (theShutdownFlag)
+      {
+         return;
+      }
+   }
+}
+
+void TraceWriter::writeBlock(uint8_t const * data, uint32_t dataSize, uint32_t numRecords,
+                             uint64_t startClock, uint32_t numDropped)
+{
+   uint8_t const * blockData = prepareBlock(data, dataSize, numRecords);
+
+   size_t compressedSize = LzCodec::compress(blockData, dataSize, theCompressedBuffer);
+
+   TraceBlockHeader header;
+   header.theMagic = TRACE_BLOCK_MAGIC;
+   header.theNumRecords = numRecords;
+   header.theStartClock = startClock;
+   header.theDataSize = dataSize;
+   header.theCompressedSize = compressedSize;
+   header.theNumDropped = numDropped;
+   header.theReserved = 0;
+
+   fwrite(&header, sizeof(header), 1, theFile);
+   fwrite(theCompressedBuffer, 1, compressedSize, theFile);
+}
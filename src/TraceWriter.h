@@ -0,0 +1,170 @@
+#ifndef TRACEWRITER_H
+#define TRACEWRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Binary trace file shared by the full execution trace (TraceBuffer) and the control flow trace
+ * (FlowTraceBuffer).
+ *
+ * File layout:
+ * @li TraceFileHeader, the magic says which kind of trace it is
+ * @li Any number of blocks: TraceBlockHeader followed by theCompressedSize bytes of data,
+ *     compressed with LzCodec.  theDataSize is the size of the data after decompression.
+ */
+
+/// Magic at the start of every block
+#define TRACE_BLOCK_MAGIC   0x4b4c4254   // "TBLK"
+
+/// How long the CPU waits for the writer thread before it starts dropping data
+#define DEFAULT_TRACE_MAX_STALL_MS 1000
+
+typedef struct TraceFileHeaderStruct
+{
+   char theMagic[8];
+} TraceFileHeader;
+
+typedef struct TraceBlockHeaderStruct
+{
+   uint32_t theMagic;
+
+   /// Number of instructions in the block
+   uint32_t theNumRecords;
+
+   /// Clock count at the start of the block
+   uint64_t theStartClock;
+
+   uint32_t theDataSize;
+   uint32_t theCompressedSize;
+
+   /// Instructions the writer couldn't keep up with, and were dropped before this block
+   uint32_t theNumDropped;
+
+   uint32_t theReserved;
+} TraceBlockHeader;
+
+/**
+ * Buffers trace data for the CPU thread, and writes it out to the trace file from a background
+ * thread.  There are two preallocated buffers, the CPU fills one while the writer thread
+ * compresses and writes the other.  The subclasses fill the buffer without allocating, locking
+ * or formatting anything.
+ *
+ * If the CPU fills its buffer before the writer is done, the CPU waits up to the max stall time
+ * for the writer, and then drops the data in its buffer.  The number of dropped instructions is
+ * written to the file, so trace6502 can show where the holes are.
+ */
+class TraceWriter
+{
+public:
+   /**
+    * @param capacity Size of each of the two buffers in bytes
+    * @param fileMagic 8 character magic written at the start of the file
+    */
+   TraceWriter(uint32_t capacity, char const * fileMagic);
+
+   /// Writes out any buffered data, stops the writer thread and closes the file
+   virtual ~TraceWriter();
+
+   /**
+    * Creates the trace file, writes the file header and starts the writer thread
+    * @return False if the file couldn't be created
+    */
+   bool open(std::string const & filename);
+
+   /**
+    * How long the CPU thread will wait for the writer thread when both buffers are full
+    * @param maxStallMs Milliseconds, 0 drops data immediately
+    */
+   void setMaxStall(uint32_t maxStallMs);
+
+   /// Writes out all of the buffered data, and waits until it is in the file
+   void flush();
+
+   /// Total number of instructions dropped because the writer thread fell behind
+   uint64_t getNumDropped();
+
+protected:
+
+   /**
+    * Hands the CPU's buffer to the writer thread, and gives the CPU the writer's buffer
+    * @param waitForever Wait for the writer no matter what, instead of dropping data
+    * @return False if the data was dropped
+    */
+   bool submitBuffer(bool waitForever);
+
+   /**
+    * Called by the writer thread before a block is compressed, so the subclass can rearrange
+    * the data into something that compresses better
+    * @return The data to compress, either data or a buffer of the subclass
+    */
+   virtual uint8_t const * prepareBlock(uint8_t const * data, uint32_t dataSize,
+                                        uint32_t numRecords);
+
+   /// Must be called by the subclass destructor, so the last block is written with the subclass
+   void close();
+
+   void writerThread();
+
+   /// Compresses and writes a block to the file
+   void writeBlock(uint8_t const * data, uint32_t dataSize, uint32_t numRecords,
+                   uint64_t startClock, uint32_t numDropped);
+
+   // Used by the CPU thread only
+
+   /// The buffer the CPU is filling
+   uint8_t* theData;
+
+   uint32_t theCapacity;
+
+   uint32_t theDataSize;
+
+   /// Instructions in theData
+   uint32_t theNumRecords;
+
+   /// Clock count at the start of theData
+   uint64_t theBlockStartClock;
+
+   uint32_t theMaxStallMs;
+
+   /// Instructions dropped since the last block was handed to the writer
+   uint32_t theNumDroppedSinceBlock;
+
+   uint64_t theTotalDropped;
+
+   // Shared between the threads, protected by theLock
+
+   std::mutex theLock;
+
+   std::condition_variable theWorkAvailable;
+
+   std::condition_variable theWriteDone;
+
+   /// Set when the writer has a buffer to write (until it is written)
+   bool theWritePendingFlag;
+
+   bool theShutdownFlag;
+
+   /// The buffer the writer thread owns, and the block information to write with it
+   uint8_t* theWriteData;
+   uint32_t theWriteDataSize;
+   uint32_t theNumWriteRecords;
+   uint64_t theWriteStartClock;
+   uint32_t theWriteNumDropped;
+
+   // Used by the writer thread only
+
+   FILE* theFile;
+
+   char theFileMagic[8];
+
+   uint8_t* theCompressedBuffer;
+
+   std::thread theWriterThread;
+};
+
+#endif // TRACEWRITER_H
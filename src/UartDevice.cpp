@@ -2,6 +2,7 @@
 #include "EmulatorConfig.h"
 #include "Utils.h"
 #include "Logger.h"
+#include "MemoryController.h"
 
 #ifdef UART_TRACE
    #define UART_DEBUG   LOG_DEBUG
@@ -78,6 +79,13 @@ uint8_t UartDevice::read8(CpuAddress absAddr)
       return 0;
    }
 
+   InputLog* inputLog = theMemController->getInputLog();
+   if (inputLog->getMode() == INPUT_LOG_REPLAY)
+   {
+      uint32_t val;
+      return (inputLog->replayNext(INPUT_SOURCE_UART, &val) ? val : 0);
+   }
+
    if (theClientSocket)
    {
       int numReady = SDLNet_CheckSockets(theSocketSet, 0);
@@ -99,6 +107,7 @@ uint8_t UartDevice::read8(CpuAddress absAddr)
          else
          {
             UART_DEBUG() << "UART Read: " << (char) val << " = " << Utils::toHex8(val);
+            inputLog->record(INPUT_SOURCE_UART, val);
             return val;
          }
       }
@@ -209,6 +218,12 @@ void UartDevice::resetMemory()
    // At this point we should be fully configured so we can setup socket
    theSize = 0x10;
 
+   if (theMemController->getInputLog()->getMode() == INPUT_LOG_REPLAY)
+   {
+      UART_DEBUG() << "Replaying the UART from the input log, no socket";
+      return;
+   }
+
    // Create socket
    IPaddress ip;
    if (SDLNet_ResolveHost(&ip, NULL, thePortNumber) != 0)
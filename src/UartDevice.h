@@ -13,6 +13,9 @@
  *
  * Offset 0x1 is for writing.  Put a character there to write it to the network socket.
  * Offset 0x4 is for reading.  If 6502 reads non-zero, then it was a character from the socket
+ *
+ * Received characters are logged to the input log.  When replaying one, the characters come from
+ * the log and no socket is opened.
  */
 class UartDevice : public MemoryDev
 {
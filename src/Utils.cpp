@@ -1,5 +1,7 @@
 #include "Utils.h"
 
+#include <errno.h>
+#include <string.h>
 #include <sstream>
 
 Utils::Utils()
@@ -150,20 +152,26 @@ uint64_t Utils::parseUInt64(std::string userInput, bool* success)
    {
       std::string retVal;
 
-      SDL_RWops* f = SDL_RWFromFile(name.c_str(), "r");
+      FILE* f = fopen(name.c_str(), "r");
 
       if (f == NULL)
       {
-         errorOut = SDL_GetError();
+         errorOut = strerror(errno);
          return retVal;
       }
 
-      int fileSize = SDL_RWsize(f);
+      long fileSize = -1;
+      if (fseek(f, 0, SEEK_END) == 0)
+      {
+         fileSize = ftell(f);
+         rewind(f);
+      }
+
       if (fileSize == -1)
       {
          errorOut = "Error getting the file size: ";
-         errorOut += SDL_GetError();
-         SDL_RWclose(f);
+         errorOut += strerror(errno);
+         fclose(f);
          return retVal;
       }
 
@@ -177,7 +185,7 @@ uint64_t Utils::parseUInt64(std::string userInput, bool* success)
          if ( bytesToReadIntoBuf > bytesToRead)
             bytesToReadIntoBuf = bytesToRead;
 
-         int numBytes = SDL_RWread(f, buf, 1, bytesToReadIntoBuf);
+         int numBytes = fread(buf, 1, bytesToReadIntoBuf, f);
 
          if (numBytes == 0)
             break;
@@ -188,7 +196,7 @@ uint64_t Utils::parseUInt64(std::string userInput, bool* success)
          bytesToRead -= numBytes;
       }
 
-      SDL_RWclose(f);
+      fclose(f);
       return retVal;
    }
 
@@ -225,12 +233,12 @@ uint64_t Utils::parseUInt64(std::string userInput, bool* success)
       return retVal;
    }
 
-   int Utils::readUntilEof(uint8_t* buffer, int numBytes, SDL_RWops* fp)
+   int Utils::readUntilEof(uint8_t* buffer, int numBytes, FILE* fp)
    {
        int bytesReadTotal = 0;
        while (bytesReadTotal < numBytes)
        {
-           int bytesRead = SDL_RWread(fp, buffer + bytesReadTotal, 1, numBytes - bytesReadTotal);
+           int bytesRead = fread(buffer + bytesReadTotal, 1, numBytes - bytesReadTotal, fp);
 
            if (bytesRead == 0)
            {
@@ -4,11 +4,9 @@
 #include <iostream>
 #include <stdint.h>
 #include <vector>
+#include <stdio.h>
 #include "EmulatorConfig.h"
 
-#include <SDL.h>
-#include <SDL_rwops.h>
-
 /**
  * Standalone utility functions
  *
@@ -56,7 +54,7 @@ public:
                                               bool asciiToo);
 
 
-   static int readUntilEof(uint8_t* buffer, int numBytes, SDL_RWops* fp);
+   static int readUntilEof(uint8_t* buffer, int numBytes, FILE* fp);
 
 
    /// Is the given number a power of 2
@@ -0,0 +1,159 @@
+#include "WorkStealingPool.h"
+#include "EmulatorConfig.h"
+#include "Logger.h"
+
+#ifdef THREAD_POOL_TRACE
+   #define POOL_DEBUG    LOG_DEBUG
+#else
+   #define POOL_DEBUG    if(0) LOG_DEBUG
+#endif
+
+WorkStealingPool::WorkStealingPool(unsigned int numThreads):
+   theNumQueuedTasks(0),
+   theNumPendingTasks(0),
+   theNextQueue(0),
+   theShutdownFlag(false)
+{
+   if (numThreads == 0)
+   {
+      numThreads = std::thread::hardware_concurrency();
+   }
+
+   if (numThreads == 0)
+   {
+      // hardware_concurrency doesn't know
+      numThreads = 1;
+   }
+
+   POOL_DEBUG() << "Starting thread pool with " << numThreads << " workers";
+
+   for(unsigned int i = 0; i < numThreads; i++)
+   {
+      theQueues.push_back(new WorkerQueue());
+   }
+
+   for(unsigned int i = 0; i < numThreads; i++)
+   {
+      theThreads.push_back(std::thread(&WorkStealingPool::workerThread, this, i));
+   }
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+   waitAll();
+
+   {
+      std::lock_guard<std::mutex> lock(theStateLock);
+      theShutdownFlag = true;
+   }
+   theWorkAvailable.notify_all();
+
+   for(auto & t: theThreads)
+   {
+      t.join();
+   }
+
+   for(auto q: theQueues)
+   {
+      delete q;
+   }
+
+   POOL_DEBUG() << "Thread pool stopped";
+}
+
+void WorkStealingPool::submit(std::function<void()> task)
+{
+   std::unique_lock<std::mutex> lock(theStateLock);
+
+   WorkerQueue* q = theQueues[theNextQueue];
+   theNextQueue = (theNextQueue + 1) % theQueues.size();
+
+   {
+      std::lock_guard<std::mutex> queueLock(q->theLock);
+      q->theTasks.push_back(task);
+   }
+
+   theNumQueuedTasks++;
+   theNumPendingTasks++;
+
+   lock.unlock();
+   theWorkAvailable.notify_one();
+}
+
+void WorkStealingPool::waitAll()
+{
+   std::unique_lock<std::mutex> lock(theStateLock);
+   theAllDone.wait(lock, [this] { return theNumPendingTasks == 0; });
+}
+
+unsigned int WorkStealingPool::getNumThreads() const
+{
+   return theThreads.size();
+}
+
+bool WorkStealingPool::getTask(unsigned int index, std::function<void()>& task)
+{
+   // Newest task from our own queue first
+   {
+      WorkerQueue* q = theQueues[index];
+      std::lock_guard<std::mutex> queueLock(q->theLock);
+      if (!q->theTasks.empty())
+      {
+         task = std::move(q->theTasks.back());
+         q->theTasks.pop_back();
+         return true;
+      }
+   }
+
+   // Steal the oldest task from somebody else
+   for(unsigned int i = 1; i < theQueues.size(); i++)
+   {
+      WorkerQueue* q = theQueues[(index + i) % theQueues.size()];
+      std::lock_guard<std::mutex> queueLock(q->theLock);
+      if (!q->theTasks.empty())
+      {
+         task = std::move(q->theTasks.front());
+         q->theTasks.pop_front();
+
+         POOL_DEBUG() << "Worker " << index << " stole a task from worker "
+                      << (index + i) % theQueues.size();
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void WorkStealingPool::workerThread(unsigned int index)
+{
+   while(true)
+   {
+      std::function<void()> task;
+      if (getTask(index, task))
+      {
+         {
+            std::lock_guard<std::mutex> lock(theStateLock);
+            theNumQueuedTasks--;
+         }
+
+         task();
+
+         std::lock_guard<std::mutex> lock(theStateLock);
+         theNumPendingTasks--;
+         if (theNumPendingTasks == 0)
+         {
+            theAllDone.notify_all();
+         }
+
+         continue;
+      }
+
+      std::unique_lock<std::mutex> lock(theStateLock);
+      theWorkAvailable.wait(lock, [this] { return theShutdownFlag || (theNumQueuedTasks > 0); });
+
+      if (theShutdownFlag && (theNumQueuedTasks == 0))
+      {
+         return;
+      }
+   }
+}
@@ -0,0 +1,71 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Thread pool where every worker has its own queue of tasks.  Tasks are handed out to the queues
+ * round robin.  A worker takes tasks from the back of its own queue, and when its queue runs dry
+ * it steals from the front of the other workers' queues, so a worker that got a few long tasks
+ * doesn't hold up the rest of the batch.
+ */
+class WorkStealingPool
+{
+public:
+   /**
+    * Starts the worker threads
+    * @param numThreads Number of workers, 0 for one per hardware thread
+    */
+   WorkStealingPool(unsigned int numThreads = 0);
+
+   /// Finishes all of the submitted tasks and stops the workers
+   ~WorkStealingPool();
+
+   void submit(std::function<void()> task);
+
+   /// Blocks until every submitted task has finished
+   void waitAll();
+
+   unsigned int getNumThreads() const;
+
+protected:
+
+   typedef struct WorkerQueueStruct
+   {
+      std::mutex theLock;
+      std::deque<std::function<void()> > theTasks;
+   } WorkerQueue;
+
+   void workerThread(unsigned int index);
+
+   /// Gets a task from the worker's own queue, or steals one from another worker
+   bool getTask(unsigned int index, std::function<void()>& task);
+
+   std::vector<WorkerQueue*> theQueues;
+
+   std::vector<std::thread> theThreads;
+
+   /// Protects everything below
+   std::mutex theStateLock;
+
+   std::condition_variable theWorkAvailable;
+
+   std::condition_variable theAllDone;
+
+   /// Tasks sitting in the queues that no worker has taken yet
+   unsigned int theNumQueuedTasks;
+
+   /// Tasks that have been submitted but haven't finished
+   unsigned int theNumPendingTasks;
+
+   unsigned int theNextQueue;
+
+   bool theShutdownFlag;
+};
+
+#endif // WORKSTEALINGPOOL_H
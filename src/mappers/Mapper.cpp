@@ -4,3 +4,13 @@ Mapper::~Mapper()
 {
    // Intentionally empty
 }
+
+void Mapper::saveState(SaveState* state)
+{
+   // No state by default
+}
+
+bool Mapper::loadState(SaveState* state)
+{
+   return true;
+}
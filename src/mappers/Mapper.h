@@ -14,6 +14,8 @@
    #define MAPPER_WARNING  if(0) LOG_WARNING
 #endif
 
+class SaveState;
+
 /**
  * Common interface API for all the mapper classes
  */
@@ -25,6 +27,13 @@ public:
     virtual uint8_t read8(CpuAddress address) = 0;
 
     virtual void write8(CpuAddress address, uint8_t value) = 0;
+
+    /// Writes the mapper's RAM and bank registers to the NES ROM's save state chunk (default
+    /// writes nothing)
+    virtual void saveState(SaveState* state);
+
+    /// Restores what saveState wrote
+    virtual bool loadState(SaveState* state);
 };
 
 #endif // MAPPER_H
@@ -1,11 +1,14 @@
+#include <string.h>
+
 #include "NRomMapper.h"
+#include "../SaveState.h"
 
 const int NRomMapper::PRG_RAM_SIZE = 0x1000;  // 4KB
 const int NRomMapper::PRG_ROM_SIZE = 0x4000;  // 16KB
 const CpuAddress NRomMapper::PRG_RAM_ADDR = 0x6000;
 const CpuAddress NRomMapper::PRG_ROM_ADDR = 0x8000;
 
-NRomMapper::NRomMapper(struct INesHeader* inesHdr, SDL_RWops* romFile)
+NRomMapper::NRomMapper(struct INesHeader* inesHdr, FILE* romFile)
 {
    MAPPER_DEBUG() << "NROM Mapper (00) instantiated";
 
@@ -118,3 +121,13 @@ void NRomMapper::write8(CpuAddress address, uint8_t value)
     MAPPER_WARNING() << "Invalid NROM mapper write (read-only address) @" << addressToString(address);
     return;
 }
+
+void NRomMapper::saveState(SaveState* state)
+{
+    state->write(thePrgRamRom, PRG_RAM_SIZE);
+}
+
+bool NRomMapper::loadState(SaveState* state)
+{
+    return state->read(thePrgRamRom, PRG_RAM_SIZE);
+}
@@ -1,7 +1,7 @@
 #ifndef NROMMAPPER_H
 #define NROMMAPPER_H
 
-#include <SDL.h>
+#include <stdio.h>
 #include "Mapper.h"
 #include "../NesRom.h"
 
@@ -12,7 +12,7 @@
 class NRomMapper : public Mapper
 {
 public:
-    NRomMapper(struct INesHeader* inesHdr, SDL_RWops* romFile);
+    NRomMapper(struct INesHeader* inesHdr, FILE* romFile);
 
     ~NRomMapper();
 
@@ -20,6 +20,11 @@ public:
 
     virtual void write8(CpuAddress address, uint8_t value);
 
+    /// Saves the PRG RAM
+    virtual void saveState(SaveState* state);
+
+    virtual bool loadState(SaveState* state);
+
 protected:
 
     static const int PRG_RAM_SIZE;
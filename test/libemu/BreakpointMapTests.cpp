@@ -0,0 +1,94 @@
+#include <vector>
+
+#include "catch.hpp"
+
+#include "BreakpointMap.h"
+
+TEST_CASE("Breakpoints are added and removed one address at a time", "[BreakpointMap]")
+{
+   BreakpointMap bm;
+   REQUIRE(bm.getNumBreakpoints() == 0);
+   REQUIRE_FALSE(bm.hasBreakpoint(0x0000));
+
+   REQUIRE(bm.addBreakpoint(0x1234));
+   REQUIRE_FALSE(bm.addBreakpoint(0x1234));
+   REQUIRE(bm.addBreakpoint(0x12ff));
+   REQUIRE(bm.addBreakpoint(0xffff));
+   REQUIRE(bm.addBreakpoint(0x0000));
+   REQUIRE(bm.getNumBreakpoints() == 4);
+
+   REQUIRE(bm.hasBreakpoint(0x1234));
+   REQUIRE(bm.hasBreakpoint(0x12ff));
+   REQUIRE(bm.hasBreakpoint(0xffff));
+   REQUIRE(bm.hasBreakpoint(0x0000));
+
+   // Neighbours in the same 64-bit word and on the same page
+   REQUIRE_FALSE(bm.hasBreakpoint(0x1233));
+   REQUIRE_FALSE(bm.hasBreakpoint(0x1235));
+   REQUIRE_FALSE(bm.hasBreakpoint(0x1200));
+   REQUIRE_FALSE(bm.hasBreakpoint(0x1300));
+
+   REQUIRE(bm.getBreakpoints() == std::vector<CpuAddress>({ 0x0000, 0x1234, 0x12ff, 0xffff }));
+
+   REQUIRE(bm.removeBreakpoint(0x1234));
+   REQUIRE_FALSE(bm.removeBreakpoint(0x1234));
+   REQUIRE_FALSE(bm.removeBreakpoint(0x4000));
+   REQUIRE(bm.getNumBreakpoints() == 3);
+   REQUIRE_FALSE(bm.hasBreakpoint(0x1234));
+   REQUIRE(bm.hasBreakpoint(0x12ff));
+
+   REQUIRE(bm.getBreakpoints() == std::vector<CpuAddress>({ 0x0000, 0x12ff, 0xffff }));
+}
+
+TEST_CASE("A page is flagged while any address on it has a breakpoint or watchpoint", "[BreakpointMap]")
+{
+   BreakpointMap bm;
+
+   // In different 64-bit words of the page
+   REQUIRE(bm.addBreakpoint(0x2010));
+   REQUIRE(bm.addBreakpoint(0x20f0));
+
+   REQUIRE(bm.removeBreakpoint(0x2010));
+   REQUIRE(bm.hasBreakpoint(0x20f0));
+
+   // The last one on the page clears the flag, and the bit test isn't even reached
+   REQUIRE(bm.removeBreakpoint(0x20f0));
+   REQUIRE_FALSE(bm.hasBreakpoint(0x20f0));
+   REQUIRE(bm.getBreakpoints().empty());
+
+   // Watchpoints have their own flag on the same page
+   REQUIRE(bm.addWatchpoint(0x2080));
+   REQUIRE(bm.isPageWatched(0x2000));
+   REQUIRE(bm.isPageWatched(0x20ff));
+   REQUIRE_FALSE(bm.isPageWatched(0x2100));
+   REQUIRE_FALSE(bm.isPageWatched(0x1fff));
+   REQUIRE_FALSE(bm.hasBreakpoint(0x2080));
+
+   REQUIRE(bm.addBreakpoint(0x2080));
+   REQUIRE(bm.removeWatchpoint(0x2080));
+   REQUIRE_FALSE(bm.isPageWatched(0x2080));
+   REQUIRE(bm.hasBreakpoint(0x2080));
+}
+
+TEST_CASE("Watchpoints are kept apart from breakpoints", "[BreakpointMap]")
+{
+   BreakpointMap bm;
+
+   REQUIRE(bm.addWatchpoint(0xd012));
+   REQUIRE_FALSE(bm.addWatchpoint(0xd012));
+   REQUIRE(bm.addWatchpoint(0x00ff));
+   REQUIRE(bm.getNumWatchpoints() == 2);
+   REQUIRE(bm.getNumBreakpoints() == 0);
+
+   REQUIRE(bm.hasWatchpoint(0xd012));
+   REQUIRE_FALSE(bm.hasWatchpoint(0xd013));
+   REQUIRE_FALSE(bm.hasBreakpoint(0xd012));
+
+   REQUIRE(bm.getWatchpoints() == std::vector<CpuAddress>({ 0x00ff, 0xd012 }));
+   REQUIRE(bm.getBreakpoints().empty());
+
+   REQUIRE(bm.removeWatchpoint(0xd012));
+   REQUIRE_FALSE(bm.removeWatchpoint(0xd012));
+   REQUIRE_FALSE(bm.hasWatchpoint(0xd012));
+   REQUIRE(bm.getNumWatchpoints() == 1);
+}
@@ -0,0 +1,221 @@
+#include <string>
+#include <string.h>
+#include <sstream>
+
+#include "catch.hpp"
+
+#include "MemoryController.h"
+#include "MemoryDev.h"
+#include "TestMachine.h"
+#include "Utils.h"
+
+/// EhBASIC is loaded in ROM from $C000, RAM is below it
+#define LOCKSTEP_RAM_SIZE 0xc000
+
+/// Gives up if BASIC hasn't run the program after this many instructions
+#define LOCKSTEP_MAX_INSTRUCTIONS 5000000
+
+/**
+ * The UART EhBASIC talks to (write a character to offset 1, read one from offset 4, 0 when nothing
+ * was typed), with the input coming from a script
+ */
+class LockstepUart : public MemoryDev
+{
+public:
+   LockstepUart(std::string const & script):
+      MemoryDev("Lockstep UART"),
+      theScript(script),
+      theScriptPos(0)
+   {
+      theAddress = 0xf000;
+      theSize = 0x10;
+   }
+
+   virtual uint8_t read8(CpuAddress absAddr) override
+   {
+      if ( (absAddr - theAddress != 4) || (theScriptPos >= theScript.size()) )
+      {
+         return 0;
+      }
+
+      return theScript[theScriptPos++];
+   }
+
+   virtual bool write8(CpuAddress absAddr, uint8_t val) override
+   {
+      if (absAddr - theAddress == 1)
+      {
+         theOutput += (char) val;
+      }
+
+      return true;
+   }
+
+   virtual uint16_t read16(CpuAddress absAddr) override
+   {
+      return read8(absAddr) | (read8(absAddr + 1) << 8);
+   }
+
+   virtual bool write16(CpuAddress absAddr, uint16_t val) override
+   {
+      write8(absAddr, val & 0xff);
+      return write8(absAddr + 1, val >> 8);
+   }
+
+   virtual std::string getConfigTypeName() const override
+   {
+      return "LockstepUART";
+   }
+
+   virtual void resetMemory() override
+   {
+      theScriptPos = 0;
+      theOutput.clear();
+   }
+
+   /// The whole script was typed in, and BASIC printed Ready after it
+   bool isDone() const
+   {
+      return (theScriptPos >= theScript.size()) &&
+             (theOutput.rfind("Ready") != std::string::npos) &&
+             (theOutput.rfind("Ready") > theOutput.rfind("RUN"));
+   }
+
+   std::string theScript;
+
+   size_t theScriptPos;
+
+   std::string theOutput;
+};
+
+/// EhBASIC with the selected core, quiet so the tests don't write trace / dump files
+static Machine* createEhBasicMachine(std::string const & core, LockstepUart** uart)
+{
+   std::string romDir = std::string(TEST_DATA_DIR) + "/ehbasic";
+
+   Machine* machine = createTestMachine(LOCKSTEP_RAM_SIZE,
+                                        { "ROM.top.startAddress=0xc000",
+                                          "ROM.top.filename=" + romDir + "/ehbasic_top_c000.bin",
+                                          "ROM.irq.startAddress=0xff80",
+                                          "ROM.irq.filename=" + romDir + "/ehbasic_bottom_ff80.bin",
+                                          systemConfig(CPUCORE_NAME, core) },
+                                        { },
+                                        0xff80);
+
+   // Cold start, default memory size, then a program with loops, floating point and strings
+   *uart = new LockstepUart("C\r\r"
+                            "10 FOR I=1 TO 12\r"
+                            "20 PRINT I;SQR(I)*I/3;MID$(\"ABCDEFGHIJKLMNOP\",I,3)\r"
+                            "30 NEXT\r"
+                            "RUN\r");
+   machine->getMemoryController()->addNewDevice(*uart);
+
+   return machine;
+}
+
+/// Describes the first difference in registers, clock count or RAM, empty if there isn't one
+static std::string compareMachines(Machine* expected, Machine* actual)
+{
+   Cpu6502* e = expected->getCpu();
+   Cpu6502* a = actual->getCpu();
+
+   std::ostringstream diff;
+
+   uint8_t eX, eY, eA, aX, aY, aA;
+   e->getRegisters(&eX, &eY, &eA);
+   a->getRegisters(&aX, &aY, &aA);
+
+   if (e->getPc() != a->getPc())
+      diff << " PC " << addressToString(a->getPc()) << " (expected " << addressToString(e->getPc()) << ")";
+
+   if (eA != aA)
+      diff << " A " << Utils::toHex8(aA) << " (expected " << Utils::toHex8(eA) << ")";
+
+   if (eX != aX)
+      diff << " X " << Utils::toHex8(aX) << " (expected " << Utils::toHex8(eX) << ")";
+
+   if (eY != aY)
+      diff << " Y " << Utils::toHex8(aY) << " (expected " << Utils::toHex8(eY) << ")";
+
+   if (e->getStackPointer() != a->getStackPointer())
+      diff << " SP " << Utils::toHex8(a->getStackPointer()) << " (expected "
+           << Utils::toHex8(e->getStackPointer()) << ")";
+
+   if (e->getStatusReg() != a->getStatusReg())
+      diff << " P " << Utils::toHex8(a->getStatusReg()) << " (expected "
+           << Utils::toHex8(e->getStatusReg()) << ")";
+
+   if (e->getNumClocks() != a->getNumClocks())
+      diff << " clock " << a->getNumClocks() << " (expected " << e->getNumClocks() << ")";
+
+   for(CpuAddress page = 0; page < (LOCKSTEP_RAM_SIZE >> 8); page++)
+   {
+      uint8_t* ePage = expected->getMemoryController()->getHostReadPage(page << 8);
+      uint8_t* aPage = actual->getMemoryController()->getHostReadPage(page << 8);
+
+      if (memcmp(ePage, aPage, 0x100) != 0)
+      {
+         for(int i = 0; i < 0x100; i++)
+         {
+            if (ePage[i] != aPage[i])
+            {
+               diff << " RAM @ " << addressToString((page << 8) + i) << " " << Utils::toHex8(aPage[i])
+                    << " (expected " << Utils::toHex8(ePage[i]) << ")";
+               break;
+            }
+         }
+
+         break;
+      }
+   }
+
+   return diff.str();
+}
+
+TEST_CASE("The switch and block cores execute EhBASIC in lockstep with the handler core", "[cores]")
+{
+   LockstepUart* handlerUart;
+   LockstepUart* switchUart;
+   LockstepUart* blockUart;
+
+   Machine* handlerMachine = createEhBasicMachine("handler", &handlerUart);
+   Machine* switchMachine = createEhBasicMachine("switch", &switchUart);
+   Machine* blockMachine = createEhBasicMachine("block", &blockUart);
+
+   Machine* others[] = { switchMachine, blockMachine };
+   char const * otherNames[] = { "switch", "block" };
+
+   uint64_t numInstructions = 0;
+   while(!handlerUart->isDone() && (numInstructions < LOCKSTEP_MAX_INSTRUCTIONS))
+   {
+      CpuAddress pc = handlerMachine->getCpu()->getPc();
+
+      // A one cycle budget stops every core after a single instruction (the block core in the
+      // middle of its cached block, so the predecoded instructions are what gets compared)
+      REQUIRE(handlerMachine->getCpu()->runCycles(1) == STOP_BUDGET);
+
+      for(int i = 0; i < 2; i++)
+      {
+         others[i]->getCpu()->runCycles(1);
+
+         std::string diff = compareMachines(handlerMachine, others[i]);
+         if (!diff.empty())
+         {
+            FAIL(otherNames[i] << " core differs after instruction " << numInstructions << " @ "
+                 << addressToString(pc) << ":" << diff);
+         }
+      }
+
+      numInstructions++;
+   }
+
+   INFO("Compared " << numInstructions << " instructions, EhBASIC output:\n" << handlerUart->theOutput);
+   REQUIRE(handlerUart->isDone());
+   REQUIRE(handlerUart->theOutput.find(" 12 13.8564LMN") != std::string::npos);
+   REQUIRE(switchUart->theOutput == handlerUart->theOutput);
+   REQUIRE(blockUart->theOutput == handlerUart->theOutput);
+
+   delete handlerMachine;
+   delete switchMachine;
+   delete blockMachine;
+}
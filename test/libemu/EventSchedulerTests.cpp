@@ -0,0 +1,101 @@
+#include <string>
+
+#include "catch.hpp"
+
+#include "EventScheduler.h"
+
+/// What the test events did, in the order they ran
+static std::string gEventLog;
+
+static EventScheduler* gScheduler;
+
+static void logEvent(void* context)
+{
+   gEventLog += *(char const *) context;
+}
+
+/// Schedules event 'z' for the clock count it is running at
+static void scheduleSameClock(void* context)
+{
+   logEvent(context);
+
+   static char const z = 'z';
+   gScheduler->schedule(gScheduler->getClock(), logEvent, (void*) &z);
+}
+
+TEST_CASE("Events run in clock order, and in the order they were scheduled at the same clock", "[EventScheduler]")
+{
+   static char const names[] = "abcde";
+
+   EventScheduler scheduler;
+   gScheduler = &scheduler;
+   gEventLog.clear();
+
+   uint64_t clock = 0;
+   uint64_t batchEndClock = UINT64_MAX;
+   scheduler.attachClock(&clock, &batchEndClock);
+
+   REQUIRE(scheduler.getNextEventClock() == UINT64_MAX);
+
+   scheduler.schedule(100, logEvent, (void*) &names[0]);
+   scheduler.schedule(50, logEvent, (void*) &names[1]);
+   scheduler.schedule(100, scheduleSameClock, (void*) &names[2]);
+   scheduler.schedule(100, logEvent, (void*) &names[3]);
+   scheduler.schedule(150, logEvent, (void*) &names[4]);
+
+   // The CPU's batch is cut short for an event before its end
+   REQUIRE(batchEndClock == 50);
+   REQUIRE(scheduler.getNextEventClock() == 50);
+
+   clock = 49;
+   scheduler.runDueEvents();
+   REQUIRE(gEventLog == "");
+
+   // Events run at the first boundary at or after their clock count
+   clock = 99;
+   scheduler.runDueEvents();
+   REQUIRE(gEventLog == "b");
+   REQUIRE(scheduler.getNextEventClock() == 100);
+
+   // The event scheduled by 'c' for the same clock count runs in this call, after 'd'
+   clock = 103;
+   scheduler.runDueEvents();
+   REQUIRE(gEventLog == "bacdz");
+   REQUIRE(scheduler.getNextEventClock() == 150);
+
+   clock = 200;
+   scheduler.runDueEvents();
+   REQUIRE(gEventLog == "bacdze");
+   REQUIRE(scheduler.getNextEventClock() == UINT64_MAX);
+}
+
+TEST_CASE("Cancelled events don't run", "[EventScheduler]")
+{
+   static char const names[] = "abc";
+
+   EventScheduler scheduler;
+   gEventLog.clear();
+
+   uint64_t clock = 0;
+   uint64_t batchEndClock = UINT64_MAX;
+   scheduler.attachClock(&clock, &batchEndClock);
+
+   uint32_t a = scheduler.scheduleIn(10, logEvent, (void*) &names[0]);
+   uint32_t b = scheduler.scheduleIn(20, logEvent, (void*) &names[1]);
+   uint32_t c = scheduler.scheduleIn(20, logEvent, (void*) &names[2]);
+
+   REQUIRE(scheduler.cancel(a));
+   REQUIRE_FALSE(scheduler.cancel(a));
+   REQUIRE(scheduler.getNextEventClock() == 20);
+
+   REQUIRE(scheduler.cancel(c));
+
+   clock = 20;
+   scheduler.runDueEvents();
+   REQUIRE(gEventLog == "b");
+
+   // Already ran
+   REQUIRE_FALSE(scheduler.cancel(b));
+
+   REQUIRE_FALSE(scheduler.cancel(0));
+}
@@ -0,0 +1,253 @@
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+#include "catch.hpp"
+
+#include "FlowTraceDecoder.h"
+#include "InterruptController.h"
+#include "MemoryController.h"
+#include "TestMachine.h"
+#include "TraceReader.h"
+
+#define FULL_TRACE_FILE "flowtrace_test_full.bin"
+#define FLOW_TRACE_FILE "flowtrace_test_flow.bin"
+
+#define SUBROUTINE_ADDRESS 0x0500
+#define IRQ_HANDLER 0x0600
+
+/// Instructions run before IRQ is asserted, somewhere in the middle of the loop
+#define INSTRUCTIONS_BEFORE_IRQ 100
+
+/// An instruction of the expanded trace, or the interrupt before it
+struct TracedInstruction
+{
+   CpuAddress thePc;
+
+   /// Only as many as the instruction has, the rest are 0
+   uint8_t theOpCodes[3];
+
+   /// The handler of an interrupt taken just before this instruction, 0 when there wasn't one
+   CpuAddress theInterruptHandler;
+
+   bool operator==(TracedInstruction const & other) const
+   {
+      return (thePc == other.thePc) && (theOpCodes[0] == other.theOpCodes[0]) &&
+             (theOpCodes[1] == other.theOpCodes[1]) && (theOpCodes[2] == other.theOpCodes[2]);
+   }
+};
+
+static TracedInstruction makeInstruction(CpuAddress pc, uint8_t const * opCodes)
+{
+   TracedInstruction ti;
+   ti.thePc = pc;
+   for(int i = 0; i < 3; i++)
+   {
+      ti.theOpCodes[i] = (i < gOpCodes[opCodes[0]].theNumBytes ? opCodes[i] : 0);
+   }
+   ti.theInterruptHandler = 0;
+   return ti;
+}
+
+/// Collects what FlowTraceDecoder expands the trace into
+class FlowCollector : public FlowTraceListener
+{
+public:
+   FlowCollector():
+      thePendingInterrupt(0),
+      theNumResumes(0)
+   {
+   }
+
+   virtual void flowInstruction(CpuAddress pc, uint8_t const * opCodes) override
+   {
+      theInstructions.push_back(makeInstruction(pc, opCodes));
+      theInstructions.back().theInterruptHandler = thePendingInterrupt;
+      thePendingInterrupt = 0;
+   }
+
+   virtual void flowInterrupt(CpuAddress handlerPc) override
+   {
+      thePendingInterrupt = handlerPc;
+   }
+
+   virtual void flowResumed(CpuAddress pc) override
+   {
+      theNumResumes++;
+   }
+
+   std::vector<TracedInstruction> theInstructions;
+
+   CpuAddress thePendingInterrupt;
+
+   int theNumResumes;
+};
+
+/**
+ * A loop with branches that go both ways, a JSR to a subroutine that goes on with a JMP
+ * (indirect) and returns with RTS, and every 4th time around the loop patches the subroutine
+ * (INC $30 <-> DEC $30, and the operand of its LDY #).  The wait loop has more branches between
+ * the RTS and the next JMP (indirect) than fit in one TNT packet.  IRQ comes from the test, the
+ * handler is INC $21, NOP, NOP, RTI.
+ */
+static Machine* createFlowMachine(std::string const & core)
+{
+   Machine* machine = createTestMachine(0x1000,
+                                        { "RAM.vectors.startAddress=0xff00",
+                                          "RAM.vectors.size=0x100",
+                                          systemConfig(CPUCORE_NAME, core) },
+                                        { 0x58,                 // CLI
+                                          0xa9, 0x20,           // LDA #$20
+                                          0x85, 0x10,           // STA $10
+                                          0xa9, 0x05,           // LDA #$05
+                                          0x85, 0x11,           // STA $11
+                                          0xa2, 0x14,           // LDX #$14
+                                          0x20, 0x00, 0x05,     // loop: JSR $0500
+                                          0xa0, 0x07,           // LDY #$07
+                                          0x88,                 // wait: DEY
+                                          0xd0, 0xfd,           // BNE wait
+                                          0x8a,                 // TXA
+                                          0x29, 0x03,           // AND #$03
+                                          0xd0, 0x0b,           // BNE next
+                                          0xad, 0x00, 0x05,     // LDA $0500
+                                          0x49, 0x20,           // EOR #$20
+                                          0x8d, 0x00, 0x05,     // STA $0500
+                                          0xee, 0x03, 0x05,     // INC $0503
+                                          0xca,                 // next: DEX
+                                          0xd0, 0xe5,           // BNE loop
+                                          0x02 });              // KIL
+   machine->getCpu()->setThrottle(false);
+
+   writeMemory(machine, SUBROUTINE_ADDRESS, { 0xe6, 0x30,          // INC $30
+                                              0xa0, 0x00,          // LDY #$00
+                                              0x6c, 0x10, 0x00 }); // JMP ($0010)
+   writeMemory(machine, SUBROUTINE_ADDRESS + 0x20, { 0xc0, 0x02,   // CPY #$02
+                                                     0xb0, 0x01,   // BCS +1
+                                                     0xc8,         // INY
+                                                     0x60 });      // RTS
+   writeMemory(machine, IRQ_HANDLER, { 0xe6, 0x21, 0xea, 0xea, 0x40 });
+   writeMemory(machine, 0xfffe, { IRQ_HANDLER & 0xff, IRQ_HANDLER >> 8 });
+
+   return machine;
+}
+
+/// Runs the program to its KIL with the trace on, IRQ is asserted for one instruction on the way
+static void runTraced(std::string const & core, TraceMode mode, std::string const & filename)
+{
+   Machine* machine = createFlowMachine(core);
+   Cpu6502* cpu = machine->getCpu();
+   InterruptController* ic = machine->getMemoryController()->getInterruptController();
+   uint32_t source = ic->allocateSource();
+
+   cpu->setTraceFilename(filename);
+   cpu->setTraceMode(mode);
+   cpu->setTraceEnabled(true);
+
+   REQUIRE(cpu->runInstructions(INSTRUCTIONS_BEFORE_IRQ) == STOP_BUDGET);
+   ic->setIrqLine(source, true);
+   REQUIRE(cpu->runInstructions(1) == STOP_BUDGET);
+   ic->setIrqLine(source, false);
+
+   REQUIRE(cpu->runInstructions(10000) == STOP_KIL);
+   REQUIRE(readMemory(machine, 0x21) == 1);
+
+   // Writes out the rest of the trace
+   delete machine;
+}
+
+static std::vector<TracedInstruction> readFullTrace(std::string const & filename)
+{
+   TraceReader reader;
+   REQUIRE(reader.open(filename));
+   REQUIRE_FALSE(reader.isFlowTrace());
+
+   std::vector<TracedInstruction> instructions;
+   std::vector<uint8_t> data;
+   std::vector<TraceRecord> records;
+   TraceBlockHeader header;
+   while(reader.readBlock(&header, data))
+   {
+      REQUIRE(TraceReader::readRecords(header, data, records));
+      for(auto const & r: records)
+      {
+         instructions.push_back(makeInstruction(r.thePc, r.theOpCodes));
+      }
+   }
+
+   REQUIRE_FALSE(reader.isCorrupt());
+   return instructions;
+}
+
+static void readFlowTrace(std::string const & filename, FlowCollector* collector)
+{
+   TraceReader reader;
+   REQUIRE(reader.open(filename));
+   REQUIRE(reader.isFlowTrace());
+
+   FlowTraceDecoder decoder(collector);
+   std::vector<uint8_t> data;
+   TraceBlockHeader header;
+   while(reader.readBlock(&header, data))
+   {
+      REQUIRE(decoder.decodeBlock(data.data(), data.size(), header.theNumRecords));
+   }
+
+   REQUIRE_FALSE(reader.isCorrupt());
+}
+
+TEST_CASE("A flow trace expands to the same instructions as a full trace with every core", "[FlowTrace]")
+{
+   char const * cores[] = { "handler", "switch", "block" };
+
+   for(char const * core: cores)
+   {
+      INFO("Core " << core);
+
+      runTraced(core, FULL_TRACE, FULL_TRACE_FILE);
+      runTraced(core, FLOW_TRACE, FLOW_TRACE_FILE);
+
+      std::vector<TracedInstruction> full = readFullTrace(FULL_TRACE_FILE);
+
+      FlowCollector flow;
+      readFlowTrace(FLOW_TRACE_FILE, &flow);
+
+      REQUIRE(full.size() > INSTRUCTIONS_BEFORE_IRQ);
+      REQUIRE(flow.theInstructions.size() == full.size());
+      REQUIRE(flow.theNumResumes == 0);
+
+      int numInterrupts = 0;
+      int numHandlerRuns = 0;
+      int numPatched = 0;
+      for(size_t i = 0; i < full.size(); i++)
+      {
+         INFO("Instruction " << i << " @ " << addressToString(full[i].thePc));
+         REQUIRE(flow.theInstructions[i] == full[i]);
+
+         if (flow.theInstructions[i].theInterruptHandler != 0)
+         {
+            REQUIRE(flow.theInstructions[i].theInterruptHandler == IRQ_HANDLER);
+            REQUIRE(full[i].thePc == IRQ_HANDLER);
+            numInterrupts++;
+         }
+
+         if (full[i].thePc == IRQ_HANDLER)
+         {
+            numHandlerRuns++;
+         }
+
+         if ( (full[i].thePc == SUBROUTINE_ADDRESS) && (full[i].theOpCodes[0] == 0xc6) )
+         {
+            numPatched++;
+         }
+      }
+
+      // One interrupt, and the subroutine ran both before and after it was patched
+      REQUIRE(numInterrupts == 1);
+      REQUIRE(numHandlerRuns == 1);
+      REQUIRE(numPatched > 0);
+      REQUIRE(numPatched < 20);
+   }
+
+   remove(FULL_TRACE_FILE);
+   remove(FLOW_TRACE_FILE);
+}
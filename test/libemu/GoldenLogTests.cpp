@@ -0,0 +1,176 @@
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+
+#include "catch.hpp"
+
+#include "GoldenLog.h"
+#include "TestMachine.h"
+
+#define NESTEST_EXCERPT (std::string(TEST_DATA_DIR) + "/nestest/nestest_excerpt.log")
+
+#define GOLDEN_LOG_FILE "goldenlog_test.log"
+
+/**
+ * The instructions in the nestest excerpt, in RAM where the nestest ROM would be.  The bytes the
+ * branches skip over are KILs.
+ * @param ldxOperand Operand of the LDX # at $C5F5 (0 in nestest)
+ */
+static Machine* createNestestMachine(uint8_t ldxOperand)
+{
+   Machine* machine = createTestMachine(0x800,
+                                        { "RAM.rom.startAddress=0xc000",
+                                          "RAM.rom.size=0x4000",
+                                          systemConfig(GOLDENLOG_NAME, NESTEST_EXCERPT),
+                                          systemConfig(GOLDENLOGCYCLES_NAME, "1") },
+                                        { 0x4c, 0xf5, 0xc5 },
+                                        0xc000);
+
+   writeMemory(machine, 0xc5f5, { 0xa2, ldxOperand, 0x86, 0x00, 0x86, 0x10, 0x86, 0x11, 0x20, 0x2d, 0xc7 });
+   writeMemory(machine, 0xc72d, { 0xea, 0x38, 0xb0, 0x04, 0x02, 0x02, 0x02, 0x02, 0xea, 0x18, 0xb0,
+                                  0x03, 0x4c, 0x40, 0xc7, 0x02, 0x02, 0x02, 0x02, 0xea, 0x38, 0xb0,
+                                  0x03, 0x02, 0x02, 0x02, 0xea, 0x18, 0x02 });
+
+   return machine;
+}
+
+static void writeLog(std::string const & text)
+{
+   std::ofstream f(GOLDEN_LOG_FILE);
+   f << text;
+}
+
+/// The state before the first instruction of nestest
+static FlightRecord firstInstruction()
+{
+   FlightRecord state;
+   memset(&state, 0, sizeof(state));
+   state.thePc = 0xc000;
+   state.theOpCodes[0] = 0x4c;
+   state.theOpCodes[1] = 0xf5;
+   state.theOpCodes[2] = 0xc5;
+   state.theStackPtr = 0xfd;
+   state.theStatusReg = 0x24;
+   state.theClock = 7;
+   return state;
+}
+
+TEST_CASE("The CPU matches the nestest excerpt, cycles included", "[GoldenLog]")
+{
+   Machine* machine = createNestestMachine(0x00);
+   GoldenLog* goldenLog = machine->getGoldenLog();
+   REQUIRE(goldenLog != nullptr);
+
+   // The golden log stops the CPU after its last line
+   REQUIRE(machine->getCpu()->runCycles(100000) == STOP_HALT);
+
+   INFO(goldenLog->getReport());
+   REQUIRE(goldenLog->isPassed());
+   REQUIRE_FALSE(goldenLog->isDiverged());
+   REQUIRE(goldenLog->getNumMatched() == 18);
+
+   delete machine;
+}
+
+TEST_CASE("The CPU is stopped where it goes a different way than the nestest excerpt", "[GoldenLog]")
+{
+   Machine* machine = createNestestMachine(0x01);
+   GoldenLog* goldenLog = machine->getGoldenLog();
+   REQUIRE(goldenLog != nullptr);
+
+   REQUIRE(machine->getCpu()->runCycles(100000) == STOP_HALT);
+   REQUIRE(goldenLog->isDiverged());
+   REQUIRE_FALSE(goldenLog->isPassed());
+   REQUIRE(goldenLog->getNumMatched() == 1);
+
+   std::string report = goldenLog->getReport();
+   INFO(report);
+   REQUIRE(report.find("at line 2 after 1 instructions: byte 1 0x01 (log 0x00)\n") != std::string::npos);
+
+   // The line before, the log's line and the CPU's
+   REQUIRE(report.find("      C000  4C F5 C5  JMP $C5F5 ") != std::string::npos);
+   REQUIRE(report.find("log > C5F5  A2 00     LDX #$00 ") != std::string::npos);
+   REQUIRE(report.find("cpu > C5F5  A2 01 ") != std::string::npos);
+   REQUIRE(report.find("A:00 X:00 Y:00 P:24 SP:FD CYC:10\n") != std::string::npos);
+
+   delete machine;
+}
+
+TEST_CASE("Golden log registers are compared on their own fields", "[GoldenLog]")
+{
+   GoldenLog goldenLog;
+
+   SECTION("Only the real flags of P are compared")
+   {
+      writeLog("C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 21 CYC:7\n");
+      REQUIRE(goldenLog.open(GOLDEN_LOG_FILE));
+
+      FlightRecord state = firstInstruction();
+      state.theStatusReg = 0x34;
+
+      REQUIRE_FALSE(goldenLog.checkInstruction(state));
+      REQUIRE(goldenLog.isPassed());
+   }
+
+   SECTION("A different P is reported")
+   {
+      writeLog("C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 21 CYC:7\n");
+      REQUIRE(goldenLog.open(GOLDEN_LOG_FILE));
+
+      FlightRecord state = firstInstruction();
+      state.theStatusReg = 0x25;
+
+      REQUIRE_FALSE(goldenLog.checkInstruction(state));
+      REQUIRE(goldenLog.isDiverged());
+      REQUIRE(goldenLog.getReport().find("instructions: P 0x25 (log 0x24)\n") != std::string::npos);
+   }
+
+   SECTION("P: isn't found in SP: or PPU: when a line doesn't have it")
+   {
+      writeLog("C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 SP:FD PPU:  0, 21 CYC:7\n");
+      REQUIRE(goldenLog.open(GOLDEN_LOG_FILE));
+
+      FlightRecord state = firstInstruction();
+      state.theStatusReg = 0xc3;
+
+      REQUIRE_FALSE(goldenLog.checkInstruction(state));
+      INFO(goldenLog.getReport());
+      REQUIRE(goldenLog.isPassed());
+   }
+
+   SECTION("Fields can be separated by tabs")
+   {
+      writeLog("C000  4C F5 C5  JMP $C5F5\tA:00\tX:00\tY:00\tP:24\tSP:FB\n");
+      REQUIRE(goldenLog.open(GOLDEN_LOG_FILE));
+
+      REQUIRE_FALSE(goldenLog.checkInstruction(firstInstruction()));
+      REQUIRE(goldenLog.isDiverged());
+      REQUIRE(goldenLog.getReport().find("instructions: SP 0xfd (log 0xfb)\n") != std::string::npos);
+   }
+
+   SECTION("Cycles are counted from the first line")
+   {
+      writeLog("C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 21 CYC:7\n"
+               "C5F5  A2 00     LDX #$00                        A:00 X:00 Y:00 P:24 SP:FD PPU:  0, 30 CYC:10\n");
+      REQUIRE(goldenLog.open(GOLDEN_LOG_FILE));
+      goldenLog.setCheckCycles(true);
+
+      // Any clock count lines up with the first line
+      FlightRecord state = firstInstruction();
+      state.theClock = 1000;
+      REQUIRE(goldenLog.checkInstruction(state));
+
+      state.thePc = 0xc5f5;
+      state.theOpCodes[0] = 0xa2;
+      state.theOpCodes[1] = 0x00;
+      state.theClock = 1004;
+
+      REQUIRE_FALSE(goldenLog.checkInstruction(state));
+      REQUIRE(goldenLog.isDiverged());
+      REQUIRE(goldenLog.getReport().find("instructions: CYC 11 (log 10)\n") != std::string::npos);
+   }
+
+   remove(GOLDEN_LOG_FILE);
+}
@@ -0,0 +1,226 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "EventScheduler.h"
+#include "InterruptController.h"
+#include "MemoryController.h"
+#include "MemoryDev.h"
+#include "TestMachine.h"
+
+#define IRQ_HANDLER 0x0500
+#define NMI_HANDLER 0x0600
+
+/// Cycles from arming the timer until it asserts IRQ
+#define TIMER_CYCLES 100
+
+/**
+ * Device at $F000 that drives the interrupt lines when it is written:
+ * @li 0: Asserts IRQ TIMER_CYCLES from now
+ * @li 1: Releases IRQ
+ * @li 2: Asserts IRQ now
+ * @li 3: Asserts NMI
+ * @li 4: Releases NMI
+ */
+class InterruptingDevice : public MemoryDev
+{
+public:
+   InterruptingDevice(MemoryController* memController):
+      MemoryDev("Interrupting device"),
+      theScheduler(memController->getEventScheduler()),
+      theInterruptController(memController->getInterruptController())
+   {
+      theAddress = 0xf000;
+      theSize = 0x10;
+      theSource = theInterruptController->allocateSource();
+   }
+
+   static void timerExpired(void* context)
+   {
+      InterruptingDevice* dev = (InterruptingDevice*) context;
+      dev->theInterruptController->setIrqLine(dev->theSource, true);
+   }
+
+   virtual uint8_t read8(CpuAddress absAddr) override
+   {
+      return 0;
+   }
+
+   virtual bool write8(CpuAddress absAddr, uint8_t val) override
+   {
+      switch(absAddr - theAddress)
+      {
+      case 0:
+         theScheduler->scheduleIn(TIMER_CYCLES, timerExpired, this);
+         break;
+
+      case 1:
+         theInterruptController->setIrqLine(theSource, false);
+         break;
+
+      case 2:
+         theInterruptController->setIrqLine(theSource, true);
+         break;
+
+      case 3:
+         theInterruptController->setNmiLine(theSource, true);
+         break;
+
+      case 4:
+         theInterruptController->setNmiLine(theSource, false);
+         break;
+      }
+
+      return true;
+   }
+
+   virtual uint16_t read16(CpuAddress absAddr) override
+   {
+      return 0;
+   }
+
+   virtual bool write16(CpuAddress absAddr, uint16_t val) override
+   {
+      write8(absAddr, val & 0xff);
+      return write8(absAddr + 1, val >> 8);
+   }
+
+   virtual std::string getConfigTypeName() const override
+   {
+      return "InterruptingDevice";
+   }
+
+   virtual void resetMemory() override
+   {
+   }
+
+   EventScheduler* theScheduler;
+
+   InterruptController* theInterruptController;
+
+   uint32_t theSource;
+};
+
+/**
+ * RAM with the program at $0400, the handlers and the interrupt vectors, and the interrupting
+ * device
+ */
+static Machine* createInterruptMachine(std::vector<uint8_t> const & program,
+                                       std::vector<uint8_t> const & irqHandler,
+                                       std::vector<uint8_t> const & nmiHandler,
+                                       InterruptingDevice** device)
+{
+   Machine* machine = createTestMachine(0xf000,
+                                        { "RAM.vectors.startAddress=0xff00", "RAM.vectors.size=0x100" },
+                                        program);
+
+   MemoryController* mc = machine->getMemoryController();
+   *device = new InterruptingDevice(mc);
+   mc->addNewDevice(*device);
+
+   writeMemory(machine, IRQ_HANDLER, irqHandler);
+   writeMemory(machine, NMI_HANDLER, nmiHandler);
+   writeMemory(machine, 0xfffa, { NMI_HANDLER & 0xff, NMI_HANDLER >> 8 });
+   writeMemory(machine, 0xfffe, { IRQ_HANDLER & 0xff, IRQ_HANDLER >> 8 });
+
+   return machine;
+}
+
+TEST_CASE("A device write that asserts IRQ interrupts the next instruction", "[interrupts]")
+{
+   InterruptingDevice* device;
+   Machine* machine = createInterruptMachine(
+      // CLI, LDX #$00, STA $F002, LDX #$AA, KIL
+      { 0x58, 0xa2, 0x00, 0x8d, 0x02, 0xf0, 0xa2, 0xaa, 0x02 },
+      // STX $12, STA $F001, RTI
+      { 0x86, 0x12, 0x8d, 0x01, 0xf0, 0x40 },
+      { 0x40 },
+      &device);
+
+   writeMemory(machine, 0x12, { 0xff });
+
+   // One batch, with nothing scheduled to end it early
+   REQUIRE(machine->getCpu()->runCycles(100000) == STOP_KIL);
+
+   // X was still 0 when the handler ran, the LDX #$AA after the STA came after the interrupt
+   REQUIRE(readMemory(machine, 0x12) == 0);
+
+   uint8_t x, y, a;
+   machine->getCpu()->getRegisters(&x, &y, &a);
+   REQUIRE(x == 0xaa);
+
+   delete machine;
+}
+
+TEST_CASE("A scheduled event asserts IRQ over and over", "[interrupts]")
+{
+   InterruptingDevice* device;
+   Machine* machine = createInterruptMachine(
+      // STA $F000, CLI, JMP $0404
+      { 0x8d, 0x00, 0xf0, 0x58, 0x4c, 0x04, 0x04 },
+      // INC $10, STA $F001, STA $F000, RTI
+      { 0xe6, 0x10, 0x8d, 0x01, 0xf0, 0x8d, 0x00, 0xf0, 0x40 },
+      { 0x40 },
+      &device);
+
+   REQUIRE(machine->getCpu()->runCycles(10000) == STOP_BUDGET);
+
+   // Each round trip is the timer plus the interrupt, the handler and the loop's JMP
+   uint8_t count = readMemory(machine, 0x10);
+   INFO("Interrupts taken: " << (int) count);
+   REQUIRE(count > 10000 / (TIMER_CYCLES + 40));
+   REQUIRE(count <= 10000 / TIMER_CYCLES);
+
+   delete machine;
+}
+
+TEST_CASE("NMI is taken once per edge, even with interrupts disabled", "[interrupts]")
+{
+   InterruptingDevice* device;
+   Machine* machine = createInterruptMachine(
+      // SEI, STA $F003 (edge), STA $F003 (still asserted), STA $F004, STA $F003 (edge), KIL
+      { 0x78, 0x8d, 0x03, 0xf0, 0x8d, 0x03, 0xf0, 0x8d, 0x04, 0xf0, 0x8d, 0x03, 0xf0, 0x02 },
+      { 0x40 },
+      // INC $11, RTI
+      { 0xe6, 0x11, 0x40 },
+      &device);
+
+   REQUIRE(machine->getCpu()->runCycles(100000) == STOP_KIL);
+   REQUIRE(readMemory(machine, 0x11) == 2);
+
+   delete machine;
+}
+
+TEST_CASE("A thread other than the CPU's can assert IRQ", "[interrupts]")
+{
+   InterruptingDevice* device;
+   Machine* machine = createInterruptMachine(
+      // CLI, JMP $0401
+      { 0x58, 0x4c, 0x01, 0x04 },
+      // INC $10, STA $F001, RTI
+      { 0xe6, 0x10, 0x8d, 0x01, 0xf0, 0x40 },
+      { 0x40 },
+      &device);
+
+   std::thread other([device]()
+   {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      device->theInterruptController->setIrqLine(device->theSource, true);
+   });
+
+   auto giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+   while( (readMemory(machine, 0x10) == 0) && (std::chrono::steady_clock::now() < giveUp) )
+   {
+      machine->getCpu()->runCycles(1000);
+   }
+
+   other.join();
+
+   // The handler released the line, so it was only taken once
+   machine->getCpu()->runCycles(1000);
+   REQUIRE(readMemory(machine, 0x10) == 1);
+
+   delete machine;
+}
@@ -0,0 +1,116 @@
+#include <vector>
+#include <random>
+
+#include "catch.hpp"
+
+#include "LzCodec.h"
+
+/// Compresses and decompresses data, checking the compressed size stays within compressBound
+static std::vector<uint8_t> roundTrip(std::vector<uint8_t> const & data, size_t* compressedSize = nullptr)
+{
+   std::vector<uint8_t> compressed(LzCodec::compressBound(data.size()));
+   size_t len = LzCodec::compress(data.data(), data.size(), compressed.data());
+   REQUIRE(len <= compressed.size());
+
+   if (compressedSize != nullptr)
+   {
+      *compressedSize = len;
+   }
+
+   std::vector<uint8_t> result(data.size());
+   REQUIRE(LzCodec::decompress(compressed.data(), len, result.data(), result.size()));
+   return result;
+}
+
+static std::vector<uint8_t> randomBytes(size_t len, uint32_t seed)
+{
+   std::mt19937 rng(seed);
+   std::vector<uint8_t> data(len);
+   for(auto & b: data)
+   {
+      b = rng() & 0xff;
+   }
+
+   return data;
+}
+
+TEST_CASE("LzCodec round trips short inputs that are only literals", "[LzCodec]")
+{
+   std::vector<uint8_t> empty;
+   REQUIRE(roundTrip(empty) == empty);
+
+   std::vector<uint8_t> tiny = { 1, 2, 3 };
+   REQUIRE(roundTrip(tiny) == tiny);
+
+   // Just too short for a match to start before the last literals
+   std::vector<uint8_t> repeated(12, 0xaa);
+   REQUIRE(roundTrip(repeated) == repeated);
+}
+
+TEST_CASE("LzCodec round trips long matches and long literal runs", "[LzCodec]")
+{
+   // A single match longer than the 255 extra length bytes can count at once
+   size_t len;
+   std::vector<uint8_t> zeros(100000, 0);
+   REQUIRE(roundTrip(zeros, &len) == zeros);
+   REQUIRE(len < 1000);
+
+   // Nothing to match, the literal count needs several extra length bytes
+   std::vector<uint8_t> noise = randomBytes(5000, 1);
+   REQUIRE(roundTrip(noise) == noise);
+
+   // Trace like data, the same few records over and over with a changing byte
+   std::vector<uint8_t> records;
+   for(int i = 0; i < 20000; i++)
+   {
+      uint8_t record[] = { 0x4c, 0x02, 0x04, (uint8_t) i, 0x00, 0xfd, 0x24 };
+      records.insert(records.end(), record, record + sizeof(record));
+   }
+
+   REQUIRE(roundTrip(records, &len) == records);
+   REQUIRE(len < records.size() / 2);
+}
+
+TEST_CASE("LzCodec round trips repeats further back than a match can reach", "[LzCodec]")
+{
+   std::vector<uint8_t> block = randomBytes(0x10010, 2);
+   std::vector<uint8_t> data = block;
+   data.insert(data.end(), block.begin(), block.end());
+
+   REQUIRE(roundTrip(data) == data);
+}
+
+TEST_CASE("LzCodec rejects corrupt compressed data", "[LzCodec]")
+{
+   std::vector<uint8_t> data = randomBytes(300, 3);
+   data.insert(data.end(), 300, 0x55);
+
+   std::vector<uint8_t> compressed(LzCodec::compressBound(data.size()));
+   size_t len = LzCodec::compress(data.data(), data.size(), compressed.data());
+
+   std::vector<uint8_t> result(data.size());
+
+   SECTION("Truncated")
+   {
+      REQUIRE_FALSE(LzCodec::decompress(compressed.data(), len - 1, result.data(), result.size()));
+      REQUIRE_FALSE(LzCodec::decompress(compressed.data(), 10, result.data(), result.size()));
+   }
+
+   SECTION("Decompresses to more bytes than expected")
+   {
+      REQUIRE_FALSE(LzCodec::decompress(compressed.data(), len, result.data(), result.size() - 1));
+   }
+
+   SECTION("Match before the start of the data")
+   {
+      // 1 literal, then a match 2 bytes back
+      uint8_t bad[] = { 0x10, 'a', 0x02, 0x00 };
+      REQUIRE_FALSE(LzCodec::decompress(bad, sizeof(bad), result.data(), 10));
+   }
+
+   SECTION("Match with an offset of 0")
+   {
+      uint8_t bad[] = { 0x10, 'a', 0x00, 0x00 };
+      REQUIRE_FALSE(LzCodec::decompress(bad, sizeof(bad), result.data(), 10));
+   }
+}
@@ -0,0 +1,129 @@
+#include "catch.hpp"
+
+#include "MachineSnapshot.h"
+#include "TestMachine.h"
+
+/// Pages of RAM, from address 0
+#define SNAPSHOT_RAM_PAGES 0x10
+
+/// RAM with a loop at $0400 that only writes to the zero page: INC $10, INX, JMP $0400
+static Machine* createZeroPageLoopMachine()
+{
+   return createTestMachine(SNAPSHOT_RAM_PAGES << 8, { }, { 0xe6, 0x10, 0xe8, 0x4c, 0x00, 0x04 });
+}
+
+TEST_CASE("A fork shares every page until one of its pages is written", "[MachineSnapshot]")
+{
+   Machine* machine = createZeroPageLoopMachine();
+
+   MachineSnapshot original;
+   machine->getCpu()->takeSnapshot(&original);
+
+   MachineSnapshot fork(original);
+   for(int page = 0; page < SNAPSHOT_RAM_PAGES; page++)
+   {
+      REQUIRE(fork.getPage(page) != nullptr);
+      REQUIRE(fork.getPage(page) == original.getPage(page));
+   }
+
+   // Not RAM, not part of the snapshot
+   REQUIRE(fork.getPage(0x80) == nullptr);
+   REQUIRE(fork.read8(0x8000) == 0);
+   REQUIRE_FALSE(fork.write8(0x8000, 1));
+
+   // The machine still holds a reference to every page too
+   REQUIRE(fork.getNumPrivatePages() == 0);
+
+   REQUIRE(fork.write8(0x0210, 0x55));
+   REQUIRE(fork.read8(0x0210) == 0x55);
+   REQUIRE(original.read8(0x0210) == 0);
+   REQUIRE(fork.getPage(2) != original.getPage(2));
+   REQUIRE(fork.getNumPrivatePages() == 1);
+
+   // Writing the page again doesn't copy it again
+   SnapshotPage* copied = fork.getPage(2);
+   REQUIRE(fork.write8(0x0211, 0x66));
+   REQUIRE(fork.getPage(2) == copied);
+
+   for(int page = 0; page < SNAPSHOT_RAM_PAGES; page++)
+   {
+      if (page != 2)
+      {
+         REQUIRE(fork.getPage(page) == original.getPage(page));
+      }
+   }
+
+   delete machine;
+}
+
+TEST_CASE("Taking another snapshot only copies the pages the CPU wrote", "[MachineSnapshot]")
+{
+   Machine* machine = createZeroPageLoopMachine();
+
+   MachineSnapshot first;
+   machine->getCpu()->takeSnapshot(&first);
+
+   machine->getCpu()->runInstructions(300);
+
+   MachineSnapshot second;
+   machine->getCpu()->takeSnapshot(&second);
+
+   REQUIRE(second.getPage(0) != first.getPage(0));
+   REQUIRE(second.read8(0x0010) == 100);
+   REQUIRE(first.read8(0x0010) == 0);
+
+   for(int page = 1; page < SNAPSHOT_RAM_PAGES; page++)
+   {
+      REQUIRE(second.getPage(page) == first.getPage(page));
+   }
+
+   REQUIRE(second.getCpuState()->theNumClocks > first.getCpuState()->theNumClocks);
+
+   delete machine;
+}
+
+TEST_CASE("Restoring a snapshot or a fork of it puts the machine back", "[MachineSnapshot]")
+{
+   Machine* machine = createZeroPageLoopMachine();
+   Cpu6502* cpu = machine->getCpu();
+
+   cpu->runInstructions(30);
+
+   MachineSnapshot snapshot;
+   cpu->takeSnapshot(&snapshot);
+
+   uint64_t clock = cpu->getNumClocks();
+   uint8_t x, y, a;
+   cpu->getRegisters(&x, &y, &a);
+   REQUIRE(readMemory(machine, 0x0010) == 10);
+
+   cpu->runInstructions(300);
+   REQUIRE(readMemory(machine, 0x0010) == 110);
+
+   cpu->restoreSnapshot(snapshot);
+   REQUIRE(cpu->getNumClocks() == clock);
+   REQUIRE(cpu->getPc() == snapshot.getCpuState()->thePc);
+   REQUIRE(readMemory(machine, 0x0010) == 10);
+
+   uint8_t restoredX, restoredY, restoredA;
+   cpu->getRegisters(&restoredX, &restoredY, &restoredA);
+   REQUIRE(restoredX == x);
+
+   // A fork with a different input, in another machine
+   MachineSnapshot fork(snapshot);
+   REQUIRE(fork.write8(0x0010, 200));
+
+   Machine* other = createZeroPageLoopMachine();
+   other->getCpu()->restoreSnapshot(fork);
+   REQUIRE(readMemory(other, 0x0010) == 200);
+
+   other->getCpu()->runInstructions(30);
+   REQUIRE(readMemory(other, 0x0010) == 210);
+
+   // The original machine and snapshot didn't see the fork's write
+   REQUIRE(readMemory(machine, 0x0010) == 10);
+   REQUIRE(snapshot.read8(0x0010) == 10);
+
+   delete other;
+   delete machine;
+}
@@ -0,0 +1,225 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "DebuggerHooks.h"
+#include "TestMachine.h"
+
+/// A machine with nothing but RAM, and the program copied in at TEST_PROGRAM_ADDRESS
+static Machine* createProgramMachine(std::vector<uint8_t> const & program,
+                                     std::string const & core = "handler")
+{
+   Machine* machine = createTestMachine(0x1000, { systemConfig(CPUCORE_NAME, core) }, program);
+   machine->getCpu()->setThrottle(false);
+   return machine;
+}
+
+/**
+ * Stands in for the DebugServer: pauses when the emulator halts, and asks the emulator to quit
+ * after a number of calls to the debugHook (or halts), so a CPU that never gets back to the
+ * debugger can't hang the test
+ */
+class FakeDebugger : public DebuggerHooks
+{
+public:
+   FakeDebugger(Cpu6502* cpu, int maxHookCalls):
+      theCpu(cpu),
+      theMaxHookCalls(maxHookCalls),
+      thePausedFlag(false),
+      theNumHookCalls(0),
+      theNumHalts(0)
+   {
+   }
+
+   virtual int debugHook() override
+   {
+      theNumHookCalls++;
+      if (theNumHookCalls >= theMaxHookCalls)
+      {
+         return -1;
+      }
+
+      return thePausedFlag ? 0 : 1;
+   }
+
+   virtual void debugMemoryAccessHook(CpuAddress addr, bool isWrite) override
+   {
+   }
+
+   virtual bool isRunning() override
+   {
+      return !thePausedFlag;
+   }
+
+   virtual void emulatorHalted(std::vector<FlightRecord> const & lastInstructions) override
+   {
+      thePausedFlag = true;
+      theHaltRecords = lastInstructions;
+
+      theNumHalts++;
+      if (theNumHalts >= theMaxHookCalls)
+      {
+         theCpu->exitEmulation();
+      }
+   }
+
+   Cpu6502* theCpu;
+
+   int theMaxHookCalls;
+
+   bool thePausedFlag;
+
+   int theNumHookCalls;
+
+   int theNumHalts;
+
+   /// The flight records the last halt was given
+   std::vector<FlightRecord> theHaltRecords;
+};
+
+TEST_CASE("A jammed CPU waits in the debugger instead of halting again every slice", "[runBatch]")
+{
+   // LDA #$01, NOP, KIL
+   Machine* machine = createProgramMachine({ 0xa9, 0x01, 0xea, 0x02 });
+   Cpu6502* cpu = machine->getCpu();
+
+   FakeDebugger* debugger = new FakeDebugger(cpu, 100);
+   cpu->attachDebugger(debugger);
+
+   cpu->start();
+
+   REQUIRE(cpu->isJammed());
+   REQUIRE(debugger->theNumHalts == 1);
+   REQUIRE(debugger->theNumHookCalls == 100);
+
+   delete machine;
+}
+
+TEST_CASE("A halt gives the debugger the last instructions, encoded the way the client reads them", "[runBatch]")
+{
+   // LDA #$01, NOP, KIL
+   Machine* machine = createProgramMachine({ 0xa9, 0x01, 0xea, 0x02 });
+   Cpu6502* cpu = machine->getCpu();
+
+   FakeDebugger* debugger = new FakeDebugger(cpu, 100);
+   cpu->attachDebugger(debugger);
+
+   cpu->start();
+
+   REQUIRE(debugger->theNumHalts == 1);
+
+   std::vector<FlightRecord> const & records = debugger->theHaltRecords;
+   REQUIRE(records.size() == 3);
+   REQUIRE(records[0].thePc == 0x0400);
+   REQUIRE(records[1].thePc == 0x0402);
+   REQUIRE(records[2].thePc == 0x0403);
+   REQUIRE(records[2].theOpCodes[0] == 0x02);
+
+   // The last 2, behind the uint16_t count
+   std::vector<uint8_t> msg = FlightRecorder::encodeRecords(records, 2);
+   REQUIRE(msg.size() == 2 + 2 * FLIGHT_RECORD_WIRE_LEN);
+   REQUIRE(msg[0] == 0x00);
+   REQUIRE(msg[1] == 0x02);
+
+   // PC, the NOP and 2 zeros past its end, A, X, Y, SP, SR, clock count
+   FlightRecord const & nop = records[1];
+   std::vector<uint8_t> nopBytes = { 0x04, 0x02, 0xea, 0x00, 0x00, 0x01, 0x00, 0x00,
+                                     nop.theStackPtr, nop.theStatusReg,
+                                     0, 0, 0, 0, 0, 0, 0, (uint8_t) nop.theClock };
+   REQUIRE(nop.theClock < 0x100);
+   REQUIRE(std::vector<uint8_t>(msg.begin() + 2, msg.begin() + 2 + FLIGHT_RECORD_WIRE_LEN) == nopBytes);
+   REQUIRE(msg[2 + FLIGHT_RECORD_WIRE_LEN + 1] == 0x03);
+
+   // Never more than there are
+   REQUIRE(FlightRecorder::encodeRecords(records, 100).size() == 2 + 3 * FLIGHT_RECORD_WIRE_LEN);
+   REQUIRE(FlightRecorder::encodeRecords(std::vector<FlightRecord>(), 100).size() == 2);
+
+   delete machine;
+}
+
+/// LDX #$00, then INX / JMP $0402 forever
+static std::vector<uint8_t> const gCountingLoop = { 0xa2, 0x00, 0xe8, 0x4c, 0x02, 0x04 };
+
+TEST_CASE("runInstructions and runUntil stop at the exact instruction with every core", "[runBatch]")
+{
+   char const * cores[] = { "handler", "switch", "block" };
+
+   for(char const * core: cores)
+   {
+      INFO("Core " << core);
+
+      Machine* machine = createProgramMachine(gCountingLoop, core);
+      Cpu6502* cpu = machine->getCpu();
+      uint8_t x, y, a;
+
+      REQUIRE(cpu->runInstructions(0) == STOP_BUDGET);
+      REQUIRE(cpu->getPc() == TEST_PROGRAM_ADDRESS);
+
+      // LDX, then three times around the loop
+      REQUIRE(cpu->runInstructions(7) == STOP_BUDGET);
+      cpu->getRegisters(&x, &y, &a);
+      REQUIRE(x == 3);
+      REQUIRE(cpu->getPc() == 0x0402);
+
+      // The block core stops in the middle of its block
+      REQUIRE(cpu->runInstructions(1) == STOP_BUDGET);
+      REQUIRE(cpu->getPc() == 0x0403);
+
+      // Already at the stop address, so it goes around the loop once
+      REQUIRE(cpu->runUntil(0x0403) == STOP_BREAKPOINT);
+      cpu->getRegisters(&x, &y, &a);
+      REQUIRE(x == 5);
+      REQUIRE(cpu->getPc() == 0x0403);
+
+      // The loop never gets to $0400 again, the cycle limit ends it
+      uint64_t startClock = cpu->getNumClocks();
+      REQUIRE(cpu->runUntil(TEST_PROGRAM_ADDRESS, 1000) == STOP_BUDGET);
+      REQUIRE(cpu->getNumClocks() >= startClock + 1000);
+      REQUIRE(cpu->getNumClocks() < startClock + 1010);
+
+      delete machine;
+   }
+}
+
+TEST_CASE("A running debugger's breakpoints stop the batch with every core", "[runBatch]")
+{
+   char const * cores[] = { "handler", "switch", "block" };
+
+   for(char const * core: cores)
+   {
+      INFO("Core " << core);
+
+      Machine* machine = createProgramMachine(gCountingLoop, core);
+      Cpu6502* cpu = machine->getCpu();
+      uint8_t x, y, a;
+
+      FakeDebugger* debugger = new FakeDebugger(cpu, 1000);
+      cpu->attachDebugger(debugger);
+
+      // Not on a page the loop runs on, the batch runs to its end
+      BreakpointMap* breakpoints = cpu->getBreakpointMap();
+      REQUIRE(breakpoints->addBreakpoint(0x0800));
+      REQUIRE(cpu->runCycles(1000) == STOP_BUDGET);
+
+      // On the JMP, in the middle of the block core's block
+      REQUIRE(breakpoints->addBreakpoint(0x0403));
+      REQUIRE(cpu->runCycles(100000) == STOP_BREAKPOINT);
+      REQUIRE(cpu->getPc() == 0x0403);
+      cpu->getRegisters(&x, &y, &a);
+      uint8_t stoppedX = x;
+
+      // Continuing executes the instruction at the breakpoint, and stops there the next time around
+      REQUIRE(cpu->runCycles(100000) == STOP_BREAKPOINT);
+      REQUIRE(cpu->getPc() == 0x0403);
+      cpu->getRegisters(&x, &y, &a);
+      REQUIRE(x == (uint8_t) (stoppedX + 1));
+
+      REQUIRE(breakpoints->removeBreakpoint(0x0403));
+      REQUIRE(cpu->runCycles(1000) == STOP_BUDGET);
+      cpu->getRegisters(&x, &y, &a);
+      REQUIRE(x != (uint8_t) (stoppedX + 1));
+
+      delete machine;
+   }
+}
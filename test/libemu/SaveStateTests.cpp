@@ -0,0 +1,138 @@
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+#include "catch.hpp"
+
+#include "MemoryController.h"
+#include "TestMachine.h"
+
+#define STATE_FILE "savestate_test.bin"
+#define BAD_STATE_FILE "savestate_test_bad.bin"
+
+/**
+ * RAM with a loop at $0400 that keeps changing the registers and memory: INX, INY, TXA, STA $10,X,
+ * ADC $10, PHA, PLA, JMP $0400.  The extra RAM is there to make states that don't fit.
+ */
+static Machine* createLoopMachine(std::string const & extraRamSize = "0x100")
+{
+   return createTestMachine(0x1000,
+                            { "RAM.extra.startAddress=0x2000", "RAM.extra.size=" + extraRamSize },
+                            { 0xe8, 0xc8, 0x8a, 0x95, 0x10, 0x65, 0x10, 0x48, 0x68, 0x4c, 0x00, 0x04 });
+}
+
+/// Registers, clock count and memory checksum
+static std::string describeMachine(Machine* machine)
+{
+   Cpu6502* cpu = machine->getCpu();
+
+   uint8_t x, y, a;
+   cpu->getRegisters(&x, &y, &a);
+
+   std::ostringstream desc;
+   desc << "PC=" << cpu->getPc() << " A=" << (int) a << " X=" << (int) x << " Y=" << (int) y
+        << " SP=" << (int) cpu->getStackPointer() << " P=" << (int) cpu->getStatusReg()
+        << " clock=" << cpu->getNumClocks()
+        << " memory=" << machine->getMemoryController()->getMemoryChecksum();
+   return desc.str();
+}
+
+static std::vector<char> readFile(std::string const & filename)
+{
+   std::ifstream f(filename, std::ios::binary);
+   return std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(std::string const & filename, std::vector<char> const & data, size_t size)
+{
+   std::ofstream f(filename, std::ios::binary);
+   f.write(data.data(), size);
+}
+
+TEST_CASE("A saved state loads back to the same machine, and runs the same from there", "[SaveState]")
+{
+   Machine* machine = createLoopMachine();
+   Cpu6502* cpu = machine->getCpu();
+
+   cpu->runInstructions(1000);
+   REQUIRE(cpu->saveState(STATE_FILE));
+   std::string saved = describeMachine(machine);
+
+   cpu->runInstructions(1000);
+   std::string after = describeMachine(machine);
+   REQUIRE(after != saved);
+
+   REQUIRE(cpu->loadState(STATE_FILE));
+   REQUIRE(describeMachine(machine) == saved);
+
+   cpu->runInstructions(1000);
+   REQUIRE(describeMachine(machine) == after);
+
+   // A different machine with the same configuration
+   Machine* other = createLoopMachine();
+   REQUIRE(other->getCpu()->loadState(STATE_FILE));
+   REQUIRE(describeMachine(other) == saved);
+
+   delete other;
+   delete machine;
+   remove(STATE_FILE);
+}
+
+TEST_CASE("Truncated save states are rejected without changing the machine", "[SaveState]")
+{
+   Machine* machine = createLoopMachine();
+   Cpu6502* cpu = machine->getCpu();
+
+   cpu->runInstructions(1000);
+   REQUIRE(cpu->saveState(STATE_FILE));
+   std::vector<char> data = readFile(STATE_FILE);
+   REQUIRE(data.size() > 0x1000);
+
+   cpu->runInstructions(1000);
+   std::string before = describeMachine(machine);
+
+   // Just the header, in the CPU chunk, and in the RAM chunks (the last chunk's data is followed
+   // by padding up to 8 bytes)
+   size_t sizes[] = { 8, 20, 60, data.size() / 2, data.size() - 8 };
+   for(size_t size: sizes)
+   {
+      INFO("Truncated to " << size << " of " << data.size() << " bytes");
+
+      writeFile(BAD_STATE_FILE, data, size);
+      REQUIRE_FALSE(cpu->loadState(BAD_STATE_FILE));
+      REQUIRE(describeMachine(machine) == before);
+   }
+
+   delete machine;
+   remove(STATE_FILE);
+   remove(BAD_STATE_FILE);
+}
+
+TEST_CASE("A save state from a different machine is rejected without changing any device", "[SaveState]")
+{
+   // Everything but the extra RAM fits
+   Machine* bigger = createLoopMachine("0x200");
+   bigger->getCpu()->runInstructions(5000);
+   REQUIRE(bigger->getCpu()->saveState(STATE_FILE));
+
+   Machine* machine = createLoopMachine();
+   machine->getCpu()->runInstructions(1000);
+   std::string before = describeMachine(machine);
+
+   REQUIRE_FALSE(machine->getCpu()->loadState(STATE_FILE));
+   REQUIRE(describeMachine(machine) == before);
+
+   // Still runs from where it was
+   machine->getCpu()->runInstructions(1000);
+   Machine* reference = createLoopMachine();
+   reference->getCpu()->runInstructions(2000);
+   REQUIRE(describeMachine(machine) == describeMachine(reference));
+
+   delete reference;
+   delete machine;
+   delete bigger;
+   remove(STATE_FILE);
+}
@@ -0,0 +1,45 @@
+#include <string.h>
+
+#include "TestMachine.h"
+#include "ConfigManager.h"
+#include "MemoryController.h"
+#include "Utils.h"
+
+Machine* createTestMachine(uint32_t ramSize,
+                           std::vector<std::string> const & configLines,
+                           std::vector<uint8_t> const & program,
+                           CpuAddress startAddress)
+{
+   ConfigManager cfg;
+   cfg.addConfig("RAM.main.startAddress=0");
+   cfg.addConfig("RAM.main.size=" + Utils::toHex32(ramSize));
+   cfg.addConfig(systemConfig(EMUSTART_NAME, Utils::toHex16(startAddress)));
+
+   for(auto const & line: configLines)
+   {
+      cfg.addConfig(line);
+   }
+
+   Machine* machine = new Machine(&cfg);
+   machine->makeQuiet();
+
+   writeMemory(machine, startAddress, program);
+
+   return machine;
+}
+
+std::string systemConfig(std::string const & name, std::string const & value)
+{
+   return EMULATOR_TYPE + ".system." + name + "=" + value;
+}
+
+void writeMemory(Machine* machine, CpuAddress addr, std::vector<uint8_t> const & bytes)
+{
+   memcpy(machine->getMemoryController()->getHostWritePage(addr) + (addr & 0xff), bytes.data(),
+          bytes.size());
+}
+
+uint8_t readMemory(Machine* machine, CpuAddress addr)
+{
+   return machine->getMemoryController()->getHostReadPage(addr)[addr & 0xff];
+}
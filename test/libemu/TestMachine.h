@@ -0,0 +1,33 @@
+#ifndef TESTMACHINE_H
+#define TESTMACHINE_H
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "Machine.h"
+
+/// The test programs are loaded at, and start from this address unless a test says otherwise
+#define TEST_PROGRAM_ADDRESS 0x0400
+
+/**
+ * A machine for the libemu tests, quiet so they don't write trace / dump files
+ * @param ramSize Bytes of RAM, from address 0
+ * @param configLines Any other devices and system settings, as config file lines
+ * @param program Copied into memory at the start address
+ * @param startAddress Where the CPU starts
+ */
+Machine* createTestMachine(uint32_t ramSize,
+                           std::vector<std::string> const & configLines,
+                           std::vector<uint8_t> const & program,
+                           CpuAddress startAddress = TEST_PROGRAM_ADDRESS);
+
+/// Config line for one of the system settings (EMUSTART_NAME, CPUCORE_NAME, ...)
+std::string systemConfig(std::string const & name, std::string const & value);
+
+/// Puts bytes in memory at an address, without going through the CPU or any device
+void writeMemory(Machine* machine, CpuAddress addr, std::vector<uint8_t> const & bytes);
+
+uint8_t readMemory(Machine* machine, CpuAddress addr);
+
+#endif
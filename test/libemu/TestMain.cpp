@@ -0,0 +1,8 @@
+// The tests for each part of libemu6502 are in their own files, this one just has Catch's main
+
+// This version of Catch sizes its signal stack with MINSIGSTKSZ, which newer glibc versions don't
+// define as a constant
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
+
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+
+# Generates the op code table for the switch core (src/Cpu6502SpecializedOps.h).  Every op code
+# becomes a SPECIALIZED_OP() line, and the switch core expands each line into a case that calls
+# the operation template instantiated for that addressing mode.
+#
+# The op code list is parsed the same way filterOpCodes.py does it.  OpCodeDoc.txt is used
+# instead of OpCodeBitsSorted.txt because the latter is a 65C02 table that is missing all of the
+# unofficial op codes.  The byte counts and cycles must stay the same as the CPU_OP table in
+# Cpu6502Defines.cpp.
+#
+# The template declarations for Cpu6502.h are written to SpecializedOpsOut.txt
+
+import sys
+
+opCodeDocFilename = "OpCodeDoc.txt"
+tableFilename = "../../src/Cpu6502SpecializedOps.h"
+declarationsFilename = "SpecializedOpsOut.txt"
+
+AddrModeToEnumVal = { "imm": "IMMEDIATE  ",
+                      "rel": "RELATIVE   ",
+                      "izx": "INDIRECT_X ",
+                      "izy": "INDIRECT_Y ",
+                      "abs": "ABSOLUTE   ",
+                      "abx": "ABSOLUTE_X ",
+                      "aby": "ABSOLUTE_Y ",
+                      "zp":  "ZERO_PAGE  ",
+                      "zpx": "ZERO_PAGE_X",
+                      "zpy": "ZERO_PAGE_Y",
+                      "imp": "IMPLIED    ",
+                      "ind": "INDIRECT   " }
+
+def parseOpCodeDoc(filename):
+   """Returns a dictionary of op code -> (mnemonic, addressing mode, length, cycles)"""
+   opCodes = {}
+   opCodeReached = False
+
+   for eachLine in open(filename, 'r'):
+      if not opCodeReached:
+         if eachLine.find("#BEGIN_OP_CODES") != -1:
+            opCodeReached = True
+         continue
+
+      if eachLine.find("#END_OP_CODES") != -1:
+         break
+
+      opCode = int(eachLine[3:5], 16)
+      instructionLen = int(eachLine[19:20])
+      delayCount = int(eachLine[21:22])
+
+      # The mnemonic follows the op code, but length is not standard
+      endOfMnemonic = eachLine.find(" ", 6)
+      if endOfMnemonic == -1:
+         sys.exit("Error finding the mnemonic on line: {}".format(eachLine))
+
+      mnemonicText = eachLine[6:endOfMnemonic]
+
+      # Throw away the leading astrik on the unofficial op codes
+      if mnemonicText[0] == '*':
+         mnemonicText = mnemonicText[1:]
+
+      endOfAddressingMode = eachLine.find(" ", endOfMnemonic + 1)
+      addressingModeText = eachLine[endOfMnemonic + 1:endOfAddressingMode]
+
+      opCodes[opCode] = (mnemonicText.lower(), AddrModeToEnumVal[addressingModeText],
+                         instructionLen, delayCount)
+
+   if len(opCodes) != 0x100:
+      sys.exit("Only found {} op codes in {}".format(len(opCodes), filename))
+
+   return opCodes
+
+
+opCodes = parseOpCodeDoc(opCodeDocFilename)
+
+tableFile = open(tableFilename, 'w')
+tableFile.write("/**\n")
+tableFile.write(" * Op code table for the switch core, each line expands into a case of the dispatch switch\n")
+tableFile.write(" *\n")
+tableFile.write(" * SPECIALIZED_OP(opCode, mnemonic, addrMode, numBytes, cycles)\n")
+tableFile.write(" *\n")
+tableFile.write(" * Generated by utils/OpCodeCodeGeneration/generateSpecializedOps.py, don't edit by hand\n")
+tableFile.write(" */\n\n")
+
+for opCode in sorted(opCodes.keys()):
+   mnemonic, addrMode, instructionLen, delayCount = opCodes[opCode]
+   tableFile.write("SPECIALIZED_OP(0x{:02x}, {}, {}, {}, {})\n".format(opCode, mnemonic, addrMode,
+                                                                     instructionLen, delayCount))
+
+tableFile.close()
+
+declarationsFile = open(declarationsFilename, 'w')
+declarationsFile.write("    // Specialized op code templates for the switch core (auto-generated code below)\n")
+for mnemonic in sorted(set(op[0] for op in opCodes.values())):
+   declarationsFile.write("    template<AddressMode6502 MODE> inline void spec_{}();\n".format(mnemonic))
+declarationsFile.write("    // End of auto generated code\n")
+declarationsFile.close()
+
+print("Wrote {} op codes to {}".format(len(opCodes), tableFilename))